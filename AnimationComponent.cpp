@@ -64,8 +64,8 @@ namespace tofu
 			return TF_UNKNOWN_ERR;
 		}
 
-		if (currentAnimation >= model->header->NumAnimations ||
-			static_cast<uint32_t>(sizeof(math::float4x4)) * model->header->NumBones > bufferSize)
+		if (currentAnimation >= model->header.NumAnimations ||
+			static_cast<uint32_t>(sizeof(math::float4x4)) * model->header.NumBones > bufferSize)
 		{
 			return TF_UNKNOWN_ERR;
 		}
@@ -77,7 +77,7 @@ namespace tofu
 		ticks = std::fmodf(ticks, anim.durationInTicks);
 
 		// load bone matrices
-		for (uint32_t i = 0; i < model->header->NumBones; i++)
+		for (uint32_t i = 0; i < model->header.NumBones; i++)
 		{
 			matrices[i] = model->bones[i].transform;
 		}
@@ -124,7 +124,7 @@ namespace tofu
 		}
 
 		// convert to world space 
-		for (uint32_t i = 0; i < model->header->NumBones; i++)
+		for (uint32_t i = 0; i < model->header.NumBones; i++)
 		{
 			uint32_t p = model->bones[i].parent;
 			if (UINT32_MAX != p)
@@ -134,7 +134,7 @@ namespace tofu
 		}
 
 		// append the offset matrices ( convert vertices from model space to bone local space )
-		for (uint32_t i = 0; i < model->header->NumBones; i++)
+		for (uint32_t i = 0; i < model->header.NumBones; i++)
 		{
 			matrices[i] = matrices[i] * model->bones[i].offsetMatrix;
 		}
@@ -8,6 +8,7 @@ namespace tofu
 	class AnimationComponentData
 	{
 		friend class RenderingSystem;
+		template<class> friend class Component;
 	public:
 
 		TF_INLINE AnimationComponentData() : AnimationComponentData(Entity()) {}
@@ -0,0 +1,410 @@
+#include "ArchetypeStorage.h"
+
+#include "PageAllocator.h"
+
+namespace
+{
+	constexpr uint32_t align_to(uint32_t offset, uint32_t alignment)
+	{
+		return (offset + (alignment - 1u)) & ~(alignment - 1u);
+	}
+
+	// arrays start at cache lines, so a chunk loop never shares a line between two arrays
+	constexpr uint32_t ArrayAlignment = 64;
+
+	constexpr uint32_t ChunkHeaderSize = align_to(sizeof(tofu::ArchetypeChunk), ArrayAlignment);
+
+	uint8_t* element(void* array, uint32_t size, uint32_t row)
+	{
+		return reinterpret_cast<uint8_t*>(array) + static_cast<size_t>(size) * row;
+	}
+}
+
+namespace tofu
+{
+	ArchetypeStorage::ArchetypeStorage()
+		:
+		numArchetypes(0),
+		freeChunks(nullptr),
+		numAllocatedChunks(0)
+	{}
+
+	ArchetypeStorage::~ArchetypeStorage()
+	{
+		Release();
+	}
+
+	int32_t ArchetypeStorage::Init(uint32_t maxEntities)
+	{
+		if (locations.IsReserved())
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		CHECKED(locations.Reserve(maxEntities));
+		CHECKED(archetypes.Reserve(MAX_ARCHETYPES));
+
+		return TF_OK;
+	}
+
+	void ArchetypeStorage::Release()
+	{
+		for (uint32_t i = 0; i < numArchetypes; ++i)
+		{
+			Archetype& arch = archetypes[i];
+
+			for (uint32_t c = 0; c < arch.numChunks; ++c)
+			{
+				ArchetypeChunk* chunk = arch.chunks[c];
+
+				for (uint32_t t = 0; t < arch.numTypes; ++t)
+				{
+					const ComponentTypeInfo& info = ComponentTypes::GetInfo(arch.typeIds[t]);
+					void* array = arch.GetArray(chunk, arch.typeIds[t]);
+
+					for (uint32_t row = 0; row < chunk->count; ++row)
+					{
+						info.destruct(element(array, info.size, row));
+					}
+				}
+
+				PageAllocator().Deallocate(chunk, ARCHETYPE_CHUNK_SIZE);
+			}
+		}
+
+		while (nullptr != freeChunks)
+		{
+			ArchetypeChunk* chunk = freeChunks;
+			freeChunks = chunk->nextFree;
+			PageAllocator().Deallocate(chunk, ARCHETYPE_CHUNK_SIZE);
+		}
+
+		locations.Release();
+		archetypes.Release();
+
+		numArchetypes = 0;
+		numAllocatedChunks = 0;
+	}
+
+	int32_t ArchetypeStorage::RemoveAll(Entity e)
+	{
+		EntityLocation* loc = Find(e);
+		if (nullptr == loc)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		Archetype* arch = loc->chunk->archetype;
+		for (uint32_t t = 0; t < arch->numTypes; ++t)
+		{
+			const ComponentTypeInfo& info = ComponentTypes::GetInfo(arch->typeIds[t]);
+			info.destruct(element(arch->GetArray(loc->chunk, arch->typeIds[t]), info.size, loc->row));
+		}
+
+		RemoveRow(*loc);
+		*loc = EntityLocation();
+
+		return TF_OK;
+	}
+
+	void* ArchetypeStorage::AddComponent(Entity e, uint32_t typeId)
+	{
+		uint32_t idx = e.Index();
+		if (idx >= locations.GetCapacity() || TF_OK != locations.Grow(idx + 1))
+		{
+			return nullptr;
+		}
+
+		Archetype* from = nullptr;
+		EntityLocation* loc = Find(e);
+
+		if (nullptr != loc)
+		{
+			from = loc->chunk->archetype;
+			if (from->Has(typeId))
+			{
+				return element(from->GetArray(loc->chunk, typeId), ComponentTypes::GetInfo(typeId).size, loc->row);
+			}
+		}
+		else if (nullptr != locations[idx].chunk)
+		{
+			// slot is still taken by an entity of an older generation
+			return nullptr;
+		}
+
+		Archetype* to = nullptr != from ? from->addEdges[typeId] : nullptr;
+		if (nullptr == to)
+		{
+			to = FindArchetype((nullptr != from ? from->mask : 0) | (1ull << typeId));
+			if (nullptr == to)
+			{
+				return nullptr;
+			}
+
+			if (nullptr != from)
+			{
+				from->addEdges[typeId] = to;
+				to->removeEdges[typeId] = from;
+			}
+		}
+
+		EntityLocation newLoc;
+		if (TF_OK != AddRow(to, e, &newLoc))
+		{
+			return nullptr;
+		}
+
+		// components it had already are moved, the new one is constructed
+		for (uint32_t t = 0; t < to->numTypes; ++t)
+		{
+			uint32_t id = to->typeIds[t];
+			const ComponentTypeInfo& info = ComponentTypes::GetInfo(id);
+			uint8_t* dst = element(to->GetArray(newLoc.chunk, id), info.size, newLoc.row);
+
+			if (id == typeId)
+			{
+				info.construct(dst, e);
+			}
+			else
+			{
+				info.relocate(dst, element(from->GetArray(loc->chunk, id), info.size, loc->row));
+			}
+		}
+
+		if (nullptr != from)
+		{
+			RemoveRow(*loc);
+		}
+
+		locations[idx] = newLoc;
+
+		return element(to->GetArray(newLoc.chunk, typeId), ComponentTypes::GetInfo(typeId).size, newLoc.row);
+	}
+
+	int32_t ArchetypeStorage::RemoveComponent(Entity e, uint32_t typeId)
+	{
+		EntityLocation* loc = Find(e);
+		if (nullptr == loc || !loc->chunk->archetype->Has(typeId))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		Archetype* from = loc->chunk->archetype;
+		ComponentMask mask = from->mask & ~(1ull << typeId);
+
+		// the last component, entity is not stored anymore
+		if (0 == mask)
+		{
+			return RemoveAll(e);
+		}
+
+		Archetype* to = from->removeEdges[typeId];
+		if (nullptr == to)
+		{
+			to = FindArchetype(mask);
+			if (nullptr == to)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			from->removeEdges[typeId] = to;
+			to->addEdges[typeId] = from;
+		}
+
+		EntityLocation newLoc;
+		CHECKED(AddRow(to, e, &newLoc));
+
+		for (uint32_t t = 0; t < to->numTypes; ++t)
+		{
+			uint32_t id = to->typeIds[t];
+			const ComponentTypeInfo& info = ComponentTypes::GetInfo(id);
+			info.relocate(
+				element(to->GetArray(newLoc.chunk, id), info.size, newLoc.row),
+				element(from->GetArray(loc->chunk, id), info.size, loc->row));
+		}
+
+		const ComponentTypeInfo& removed = ComponentTypes::GetInfo(typeId);
+		removed.destruct(element(from->GetArray(loc->chunk, typeId), removed.size, loc->row));
+
+		RemoveRow(*loc);
+		*loc = newLoc;
+
+		return TF_OK;
+	}
+
+	void* ArchetypeStorage::GetComponent(Entity e, uint32_t typeId) const
+	{
+		EntityLocation* loc = Find(e);
+		if (nullptr == loc || !loc->chunk->archetype->Has(typeId))
+		{
+			return nullptr;
+		}
+
+		return element(loc->chunk->archetype->GetArray(loc->chunk, typeId), ComponentTypes::GetInfo(typeId).size, loc->row);
+	}
+
+	ArchetypeStorage::EntityLocation* ArchetypeStorage::Find(Entity e) const
+	{
+		uint32_t idx = e.Index();
+		if (idx >= locations.GetNumCommitted())
+		{
+			return nullptr;
+		}
+
+		EntityLocation* loc = locations.GetData() + idx;
+		if (nullptr == loc->chunk || loc->chunk->archetype->GetEntities(loc->chunk)[loc->row].id != e.id)
+		{
+			return nullptr;
+		}
+
+		return loc;
+	}
+
+	Archetype* ArchetypeStorage::FindArchetype(ComponentMask mask)
+	{
+		for (uint32_t i = 0; i < numArchetypes; ++i)
+		{
+			if (archetypes[i].mask == mask)
+			{
+				return &archetypes[i];
+			}
+		}
+
+		if (numArchetypes >= MAX_ARCHETYPES || TF_OK != archetypes.Grow(numArchetypes + 1))
+		{
+			return nullptr;
+		}
+
+		Archetype& arch = archetypes[numArchetypes];
+		arch.mask = mask;
+
+		uint32_t rowSize = sizeof(Entity);
+		for (uint32_t id = 0; id < MAX_COMPONENT_TYPES; ++id)
+		{
+			if (arch.Has(id))
+			{
+				arch.typeIds[arch.numTypes++] = id;
+				rowSize += ComponentTypes::GetInfo(id).size;
+			}
+		}
+
+		// leave room for padding in front of every array
+		uint32_t space = ARCHETYPE_CHUNK_SIZE - ChunkHeaderSize - (arch.numTypes + 1) * ArrayAlignment;
+		arch.chunkCapacity = space / rowSize;
+
+		assert(arch.chunkCapacity > 0 && "components don't fit into a chunk");
+		if (0 == arch.chunkCapacity)
+		{
+			return nullptr;
+		}
+
+		uint32_t offset = ChunkHeaderSize;
+		arch.entitiesOffset = offset;
+		offset += arch.chunkCapacity * sizeof(Entity);
+
+		for (uint32_t t = 0; t < arch.numTypes; ++t)
+		{
+			const ComponentTypeInfo& info = ComponentTypes::GetInfo(arch.typeIds[t]);
+			offset = align_to(offset, info.alignment > ArrayAlignment ? info.alignment : ArrayAlignment);
+			arch.offsets[arch.typeIds[t]] = offset;
+			offset += arch.chunkCapacity * info.size;
+		}
+
+		assert(offset <= ARCHETYPE_CHUNK_SIZE);
+
+		// enough chunks for every entity there can be
+		if (TF_OK != arch.chunks.Reserve(locations.GetCapacity() / arch.chunkCapacity + 1))
+		{
+			return nullptr;
+		}
+
+		numArchetypes++;
+		return &arch;
+	}
+
+	int32_t ArchetypeStorage::AddRow(Archetype* arch, Entity e, EntityLocation* loc)
+	{
+		if (0 == arch->numChunks || arch->chunks[arch->numChunks - 1]->count == arch->chunkCapacity)
+		{
+			CHECKED(arch->chunks.Grow(arch->numChunks + 1));
+
+			ArchetypeChunk* chunk = AllocateChunk();
+			if (nullptr == chunk)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			chunk->archetype = arch;
+			chunk->count = 0;
+			arch->chunks[arch->numChunks++] = chunk;
+		}
+
+		ArchetypeChunk* chunk = arch->chunks[arch->numChunks - 1];
+		uint32_t row = chunk->count++;
+		arch->GetEntities(chunk)[row] = e;
+		arch->numEntities++;
+
+		loc->chunk = chunk;
+		loc->row = row;
+
+		return TF_OK;
+	}
+
+	void ArchetypeStorage::RemoveRow(EntityLocation loc)
+	{
+		Archetype* arch = loc.chunk->archetype;
+		ArchetypeChunk* last = arch->chunks[arch->numChunks - 1];
+		uint32_t lastRow = last->count - 1;
+
+		if (last != loc.chunk || lastRow != loc.row)
+		{
+			Entity moved = arch->GetEntities(last)[lastRow];
+			arch->GetEntities(loc.chunk)[loc.row] = moved;
+
+			for (uint32_t t = 0; t < arch->numTypes; ++t)
+			{
+				uint32_t id = arch->typeIds[t];
+				const ComponentTypeInfo& info = ComponentTypes::GetInfo(id);
+				info.relocate(
+					element(arch->GetArray(loc.chunk, id), info.size, loc.row),
+					element(arch->GetArray(last, id), info.size, lastRow));
+			}
+
+			locations[moved.Index()] = loc;
+		}
+
+		last->count--;
+		arch->numEntities--;
+
+		if (0 == last->count)
+		{
+			FreeChunk(last);
+			arch->numChunks--;
+		}
+	}
+
+	ArchetypeChunk* ArchetypeStorage::AllocateChunk()
+	{
+		ArchetypeChunk* chunk = freeChunks;
+		if (nullptr != chunk)
+		{
+			freeChunks = chunk->nextFree;
+			return chunk;
+		}
+
+		chunk = reinterpret_cast<ArchetypeChunk*>(PageAllocator().Allocate(ARCHETYPE_CHUNK_SIZE, ArrayAlignment));
+		if (nullptr != chunk)
+		{
+			numAllocatedChunks++;
+		}
+		return chunk;
+	}
+
+	void ArchetypeStorage::FreeChunk(ArchetypeChunk* chunk)
+	{
+		// kept for reuse, entities moving between archetypes free and take chunks all the time
+		chunk->archetype = nullptr;
+		chunk->nextFree = freeChunks;
+		freeChunks = chunk;
+	}
+}
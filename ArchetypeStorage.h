@@ -0,0 +1,248 @@
+#pragma once
+
+#include "Common.h"
+#include "ComponentType.h"
+#include "Entity.h"
+#include "PagedArray.h"
+
+#include <cassert>
+#include <utility>
+
+namespace tofu
+{
+	class Archetype;
+
+	// fixed size block holding rows of entities of one archetype (ARCHETYPE_CHUNK_SIZE bytes),
+	// entities and each component type have an array of their own in the chunk (SoA),
+	// so a loop over a few component types only touches memory of those
+	struct ArchetypeChunk
+	{
+		Archetype*			archetype;
+		uint32_t			count;
+		// free chunks are linked through this
+		ArchetypeChunk*		nextFree;
+
+		// ... followed by entity array and component arrays, at offsets kept by Archetype
+	};
+
+	// entities with the same set of component types,
+	// every chunk of it is full but the last one
+	class Archetype
+	{
+	public:
+		Archetype()
+			:
+			mask(0),
+			numTypes(0),
+			typeIds(),
+			offsets(),
+			entitiesOffset(0),
+			chunkCapacity(0),
+			numEntities(0),
+			numChunks(0),
+			addEdges(),
+			removeEdges()
+		{}
+
+		TF_INLINE ComponentMask GetMask() const { return mask; }
+
+		TF_INLINE bool Has(uint32_t typeId) const { return 0 != (mask & (1ull << typeId)); }
+
+		TF_INLINE uint32_t GetNumEntities() const { return numEntities; }
+
+		TF_INLINE uint32_t GetChunkCapacity() const { return chunkCapacity; }
+
+		TF_INLINE uint32_t GetNumChunks() const { return numChunks; }
+
+		TF_INLINE ArchetypeChunk* GetChunk(uint32_t idx) const
+		{
+			assert(idx < numChunks);
+			return chunks.GetData()[idx];
+		}
+
+		TF_INLINE Entity* GetEntities(ArchetypeChunk* chunk) const
+		{
+			return reinterpret_cast<Entity*>(reinterpret_cast<uint8_t*>(chunk) + entitiesOffset);
+		}
+
+		TF_INLINE void* GetArray(ArchetypeChunk* chunk, uint32_t typeId) const
+		{
+			assert(Has(typeId));
+			return reinterpret_cast<uint8_t*>(chunk) + offsets[typeId];
+		}
+
+		template<class T>
+		TF_INLINE T* GetArray(ArchetypeChunk* chunk) const
+		{
+			return reinterpret_cast<T*>(GetArray(chunk, ComponentTypes::GetId<T>()));
+		}
+
+	private:
+		friend class ArchetypeStorage;
+
+		ComponentMask				mask;
+		uint32_t					numTypes;
+		// in ascending order
+		uint32_t					typeIds[MAX_COMPONENT_TYPES];
+		// offset of array in a chunk for each type id in mask
+		uint32_t					offsets[MAX_COMPONENT_TYPES];
+		uint32_t					entitiesOffset;
+		uint32_t					chunkCapacity;
+		uint32_t					numEntities;
+
+		PagedArray<ArchetypeChunk*>	chunks;
+		uint32_t					numChunks;
+
+		// archetype reached by adding or removing a type, filled in on first use
+		Archetype*					addEdges[MAX_COMPONENT_TYPES];
+		Archetype*					removeEdges[MAX_COMPONENT_TYPES];
+	};
+
+	// component storage grouping entities by the set of component types they have,
+	// so iterating entities with several components is a linear walk over chunks,
+	// with no lookup per entity.
+	// adding or removing a component moves the entity's row to another archetype,
+	// so pointers to components are only valid until the next change of the storage.
+	// not thread safe
+	class ArchetypeStorage
+	{
+	public:
+		ArchetypeStorage();
+
+		~ArchetypeStorage();
+
+		ArchetypeStorage(const ArchetypeStorage&) = delete;
+		ArchetypeStorage& operator = (const ArchetypeStorage&) = delete;
+
+		// entities with index below maxEntities can be stored
+		int32_t Init(uint32_t maxEntities);
+
+		// destruct all components and give chunks back
+		void Release();
+
+		// component of e, constructed if e doesn't have one yet,
+		// nullptr if e can't be stored
+		template<class T>
+		T* Add(Entity e)
+		{
+			return reinterpret_cast<T*>(AddComponent(e, ComponentTypes::GetId<T>()));
+		}
+
+		template<class T>
+		int32_t Remove(Entity e)
+		{
+			return RemoveComponent(e, ComponentTypes::GetId<T>());
+		}
+
+		template<class T>
+		T* Get(Entity e) const
+		{
+			return reinterpret_cast<T*>(GetComponent(e, ComponentTypes::GetId<T>()));
+		}
+
+		template<class T>
+		bool Has(Entity e) const
+		{
+			return nullptr != Get<T>(e);
+		}
+
+		// remove every component of e, it's no longer stored
+		int32_t RemoveAll(Entity e);
+
+		// fn(uint32_t count, Entity* entities, Ts*... arrays) for every chunk having all of Ts
+		template<class... Ts, class Func>
+		void ForEachChunk(Func fn)
+		{
+			static_assert(sizeof...(Ts) > 0, "no component type given");
+
+			const uint32_t ids[] = { ComponentTypes::GetId<Ts>()... };
+
+			ComponentMask mask = 0;
+			for (uint32_t id : ids)
+			{
+				mask |= 1ull << id;
+			}
+
+			for (uint32_t i = 0; i < numArchetypes; ++i)
+			{
+				const Archetype& arch = archetypes[i];
+				if ((arch.mask & mask) != mask)
+				{
+					continue;
+				}
+
+				for (uint32_t c = 0; c < arch.numChunks; ++c)
+				{
+					CallChunk<Ts...>(fn, arch, arch.chunks[c], ids, std::index_sequence_for<Ts...>());
+				}
+			}
+		}
+
+		// fn(Entity e, Ts&... components) for every entity having all of Ts
+		template<class... Ts, class Func>
+		void ForEach(Func fn)
+		{
+			ForEachChunk<Ts...>([&fn](uint32_t count, Entity* entities, Ts*... arrays)
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					fn(entities[i], arrays[i]...);
+				}
+			});
+		}
+
+		TF_INLINE uint32_t GetNumArchetypes() const { return numArchetypes; }
+
+		TF_INLINE const Archetype& GetArchetype(uint32_t idx) const { return archetypes[idx]; }
+
+		// chunks taken from OS, free ones included
+		size_t GetMemoryUsage() const { return static_cast<size_t>(numAllocatedChunks) * ARCHETYPE_CHUNK_SIZE; }
+
+	private:
+		struct EntityLocation
+		{
+			ArchetypeChunk*	chunk;
+			uint32_t		row;
+
+			EntityLocation() : chunk(nullptr), row(0) {}
+		};
+
+		template<class... Ts, class Func, size_t... I>
+		static TF_INLINE void CallChunk(Func& fn, const Archetype& arch, ArchetypeChunk* chunk, const uint32_t* ids, std::index_sequence<I...>)
+		{
+			uint8_t* base = reinterpret_cast<uint8_t*>(chunk);
+			fn(chunk->count, arch.GetEntities(chunk), reinterpret_cast<Ts*>(base + arch.offsets[ids[I]])...);
+		}
+
+		void* AddComponent(Entity e, uint32_t typeId);
+
+		int32_t RemoveComponent(Entity e, uint32_t typeId);
+
+		void* GetComponent(Entity e, uint32_t typeId) const;
+
+		// location of a stored entity, nullptr if it's not stored
+		EntityLocation* Find(Entity e) const;
+
+		// find archetype of a component set, or create it
+		Archetype* FindArchetype(ComponentMask mask);
+
+		// append an uninitialized row for e
+		int32_t AddRow(Archetype* arch, Entity e, EntityLocation* loc);
+
+		// components of the row must be relocated or destructed already,
+		// last row of the archetype is moved into it
+		void RemoveRow(EntityLocation loc);
+
+		ArchetypeChunk* AllocateChunk();
+
+		void FreeChunk(ArchetypeChunk* chunk);
+
+	private:
+		PagedArray<EntityLocation>	locations;
+		PagedArray<Archetype>		archetypes;
+		uint32_t					numArchetypes;
+
+		ArchetypeChunk*				freeChunks;
+		uint32_t					numAllocatedChunks;
+	};
+}
@@ -1,5 +1,8 @@
 #include "CameraComponent.h"
 #include "TransformComponent.h"
+#include "SceneSnapshot.h"
+
+#include <cstddef>
 
 namespace tofu
 {
@@ -37,6 +40,10 @@ namespace tofu
 		return matrix::perspective(fov * PI / 180.0f, aspect, zNear, zFar);
 	}
 
-
+	int32_t CameraComponentData::AddSnapshotType(SceneSnapshot& snapshot)
+	{
+		const SnapshotField fields[] = { { offsetof(CameraComponentData, skybox), scene::SCENE_FIXUP_ASSET } };
+		return snapshot.AddType<CameraComponent>("CameraComponent", fields, 1);
+	}
 }
 
@@ -7,6 +7,7 @@
 namespace tofu
 {
 	class Material;
+	class SceneSnapshot;
 
 	enum class ProjectionType : uint32_t
 	{
@@ -17,6 +18,7 @@ namespace tofu
 	class CameraComponentData
 	{
 		friend class RenderingSystem;
+		template<class> friend class Component;
 	public:
 		CameraComponentData() : CameraComponentData(Entity()) {}
 
@@ -87,6 +89,9 @@ namespace tofu
 
 		math::float4x4 CalcProjectionMatrix() const;
 
+		// saved bitwise, skybox is an asset field
+		static int32_t AddSnapshotType(SceneSnapshot& snapshot);
+
 	private:
 		Entity					entity;
 		ProjectionType			projType;
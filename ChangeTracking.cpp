@@ -0,0 +1,21 @@
+#include "ChangeTracking.h"
+#include "ComponentRegistry.h"
+
+namespace
+{
+	uint32_t currentFrame = 1;
+}
+
+namespace tofu
+{
+	uint32_t ChangeTracking::GetFrame()
+	{
+		return currentFrame;
+	}
+
+	void ChangeTracking::NextFrame()
+	{
+		++currentFrame;
+		ComponentRegistry::NextFrame(currentFrame);
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.h"
+#include "PagedArray.h"
+
+#include <atomic>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tofu
+{
+	// set of entity indices, in two levels: a bit per index, and a bit per nonzero word of those,
+	// so walking and clearing it costs about as much as the number of indices in it.
+	// any thread can add to it, walking and clearing is for one thread at a time
+	class ChangeSet
+	{
+	public:
+		ChangeSet() {}
+
+		ChangeSet(const ChangeSet&) = delete;
+		ChangeSet& operator = (const ChangeSet&) = delete;
+
+		int32_t Reserve(uint32_t maxCount)
+		{
+			CHECKED(words.Reserve((maxCount + 63) / 64));
+			return summary.Reserve((maxCount + 64 * 64 - 1) / (64 * 64));
+		}
+
+		// make indices [0, count) usable, not thread safe
+		int32_t Grow(uint32_t count)
+		{
+			CHECKED(words.Grow((count + 63) / 64));
+			return summary.Grow((count + 64 * 64 - 1) / (64 * 64));
+		}
+
+		// false if it was in set already
+		TF_INLINE bool Add(uint32_t idx)
+		{
+			uint64_t bit = 1ull << (idx & 63);
+			uint64_t prev = words[idx >> 6].fetch_or(bit, std::memory_order_relaxed);
+
+			// first index of its word
+			if (0 == prev)
+			{
+				summary[idx >> 12].fetch_or(1ull << ((idx >> 6) & 63), std::memory_order_relaxed);
+			}
+
+			return 0 == (prev & bit);
+		}
+
+		TF_INLINE bool Contains(uint32_t idx) const
+		{
+			return (idx >> 6) < words.GetNumCommitted()
+				&& 0 != (words[idx >> 6].load(std::memory_order_relaxed) & (1ull << (idx & 63)));
+		}
+
+		// fn(idx) for every index in set, in increasing order
+		template<class Func>
+		void ForEach(Func fn) const
+		{
+			uint32_t numSummary = summary.GetNumCommitted();
+			for (uint32_t s = 0; s < numSummary; ++s)
+			{
+				uint64_t nonzero = summary[s].load(std::memory_order_relaxed);
+				while (0 != nonzero)
+				{
+					uint32_t w = s * 64 + LowestBit(nonzero);
+					nonzero &= nonzero - 1;
+
+					uint64_t bits = words[w].load(std::memory_order_relaxed);
+					while (0 != bits)
+					{
+						fn(w * 64 + LowestBit(bits));
+						bits &= bits - 1;
+					}
+				}
+			}
+		}
+
+		void Clear()
+		{
+			uint32_t numSummary = summary.GetNumCommitted();
+			for (uint32_t s = 0; s < numSummary; ++s)
+			{
+				uint64_t nonzero = summary[s].exchange(0, std::memory_order_relaxed);
+				while (0 != nonzero)
+				{
+					words[s * 64 + LowestBit(nonzero)].store(0, std::memory_order_relaxed);
+					nonzero &= nonzero - 1;
+				}
+			}
+		}
+
+		size_t GetCommittedBytes() const
+		{
+			return words.GetCommittedBytes() + summary.GetCommittedBytes();
+		}
+
+	private:
+		// index of least significant set bit, x is not 0
+		static TF_INLINE uint32_t LowestBit(uint64_t x)
+		{
+#if defined(_MSC_VER) && defined(_WIN64)
+			unsigned long index;
+			_BitScanForward64(&index, x);
+			return index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<uint32_t>(x))) return index;
+			_BitScanForward(&index, static_cast<uint32_t>(x >> 32));
+			return index + 32;
+#else
+			return static_cast<uint32_t>(__builtin_ctzll(x));
+#endif
+		}
+
+	private:
+		PagedArray<std::atomic<uint64_t>>	words;
+		PagedArray<std::atomic<uint64_t>>	summary;
+	};
+
+	// frame number changes are stamped with, component storages keep sets of
+	// entities changed in current and last frame (see Component<T>::ForEachChanged)
+	class ChangeTracking
+	{
+	public:
+		// starts from 1, 0 is before anything changed
+		static uint32_t GetFrame();
+
+		// called by engine at end of every frame,
+		// changes of the frame before last are dropped from change sets of ComponentRegistry storages
+		static void NextFrame();
+	};
+}
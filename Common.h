@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __APPLE__
+#include <_types.h>
+#endif
+
+#include "Error.h"
+
+#ifndef TF_INLINE
+#ifdef _MSC_VER
+#define TF_INLINE __forceinline
+#else
+#define TF_INLINE inline
+#endif
+#endif
+
+#define CHECKED(x) { int32_t err = TF_OK; if (TF_OK != (err = (x))) return err; }
+
+#define SINGLETON_DECL(CLASS_NAME) \
+	private:\
+		static CLASS_NAME* _instance;\
+	public:\
+		TF_INLINE static CLASS_NAME* instance() { return _instance; }
+
+#define SINGLETON_IMPL(CLASS_NAME) \
+	CLASS_NAME* CLASS_NAME::_instance = nullptr;
+
+
+// id of a handle is slot index in low bits and generation of the slot in high bits,
+// Index() is what arrays of objects are indexed with
+#define HANDLE_DECL(CLASS_NAME) \
+	struct CLASS_NAME##Handle \
+	{ \
+		uint32_t id; \
+		TF_INLINE explicit CLASS_NAME##Handle(uint32_t _id = UINT32_MAX) : id (_id) {} \
+		TF_INLINE operator bool() const { return id != UINT32_MAX; } \
+		TF_INLINE uint32_t Index() const { return id & ::tofu::HANDLE_INDEX_MASK; } \
+	};
+
+
+namespace tofu
+{
+	// generation is bumped every time a slot is freed, so stale handles don't match reused slots
+	constexpr uint32_t HANDLE_INDEX_BITS = 20;
+	constexpr uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+
+	HANDLE_DECL(Buffer);
+	HANDLE_DECL(Texture);
+	HANDLE_DECL(Sampler);
+	HANDLE_DECL(VertexShader);
+	HANDLE_DECL(PixelShader);
+	HANDLE_DECL(PipelineState);
+
+	constexpr uint32_t FRAME_BUFFER_COUNT = 2;
+
+	constexpr uint32_t LEVEL_BASED_MEM_SIZE = 128 * 1024 * 1024;
+	constexpr uint32_t LEVEL_BASED_MEM_ALIGN = 2 * 1024 * 1024;
+
+	constexpr uint32_t LEVEL_BASED_HEAP_SIZE = 128 * 1024 * 1024;
+	constexpr uint32_t LEVEL_BASED_HEAP_ALIGN = 2 * 1024 * 1024;
+
+	constexpr uint32_t FRAME_BASED_MEM_SIZE = 128 * 1024 * 1024;
+	constexpr uint32_t FRAME_BASED_MEM_ALIGN = 2 * 1024 * 1024;
+
+	constexpr uint32_t SCRATCH_MEM_SIZE = 16 * 1024 * 1024;
+	constexpr uint32_t SCRATCH_MEM_ALIGN = 4096;
+
+	// large page size arenas are aligned to, so they can be backed by huge pages
+	constexpr uint32_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	// virtual arenas only reserve address space, so they can be much larger (less on 32 bit)
+	constexpr size_t LEVEL_BASED_VMEM_SIZE = sizeof(void*) == 8 ? static_cast<size_t>(4ull * 1024 * 1024 * 1024) : 512u * 1024 * 1024;
+	constexpr size_t FRAME_BASED_VMEM_SIZE = sizeof(void*) == 8 ? static_cast<size_t>(1ull * 1024 * 1024 * 1024) : 128u * 1024 * 1024;
+
+	// virtual arenas commit pages in steps of this size
+	constexpr uint32_t VMEM_COMMIT_SIZE = 2 * 1024 * 1024;
+
+	// memory telemetry (TF_MEMORY_STATS)
+	constexpr uint32_t MAX_MEMORY_TAGS = 32;
+	constexpr uint32_t MEMORY_STATS_HISTORY_SIZE = 256;
+
+	// size of chunk each thread takes from a concurrent allocator
+	constexpr uint32_t CONCURRENT_MEM_CHUNK_SIZE = 64 * 1024;
+
+	// asynchronous file reads
+	constexpr uint32_t MAX_IO_REQUESTS = 256;
+	constexpr uint32_t MAX_IO_PATH_LENGTH = 256;
+	constexpr uint32_t NUM_IO_THREADS = 2;
+
+	// compressed files (Compression.h) are split into blocks of this size
+	constexpr uint32_t COMPRESSED_BLOCK_SIZE = 256 * 1024;
+	constexpr uint32_t MAX_DECOMPRESS_THREADS = 8;
+
+	// handle tables and component storage grow by pages of this many entries
+	constexpr uint32_t STORAGE_PAGE_SIZE = 1024;
+
+	constexpr uint32_t MAX_USER_MODULES = 8;
+	// modules the engine schedules each frame, user modules and physics
+	constexpr uint32_t MAX_SCHEDULED_MODULES = MAX_USER_MODULES + 1;
+
+	// job system (JobSystem.h), deque capacity is a power of two
+	constexpr uint32_t MAX_JOB_THREADS = 64;
+	constexpr uint32_t MAX_JOBS_PER_THREAD = 4096;
+	// ParallelFor() splits work into at most this many batches per thread
+	constexpr uint32_t JOB_BATCHES_PER_THREAD = 4;
+
+	// entity command buffers (EntityCommandBuffer.h), one per job thread, in bytes and sort key runs
+	constexpr uint32_t ENTITY_COMMAND_BUFFER_SIZE = 4 * 1024 * 1024;
+	constexpr uint32_t MAX_ENTITY_COMMAND_SEGMENTS = 16 * 1024;
+
+	// prefabs (Prefab.h), component types of a prefab, and entities SpawnBatch() creates at a time
+	constexpr uint32_t MAX_PREFAB_COMPONENTS = 16;
+	constexpr uint32_t SPAWN_BATCH_SIZE = 1024;
+
+	// scene snapshots (SceneSnapshot.h), component types and patched fields of each, assets referenced
+	constexpr uint32_t MAX_SNAPSHOT_TYPES = 64;
+	constexpr uint32_t MAX_SNAPSHOT_FIELDS = 8;
+	constexpr uint32_t MAX_SNAPSHOT_ASSETS = 4096;
+	// of a record a component is saved as, when it can't be saved bitwise
+	constexpr uint32_t MAX_SNAPSHOT_RECORD_SIZE = 256;
+
+	// component array sorting (ComponentSorter.h), steps each sorted array gets per frame
+	constexpr uint32_t COMPONENT_SORT_BUDGET = 4096;
+
+	// default entity capacity, Entity::SetCapacity() changes it at run time
+	constexpr uint32_t MAX_ENTITIES = 4096;
+	// renderables drawn in a frame, transforms are addressed with 16 bit constant buffer offsets
+	constexpr uint32_t MAX_RENDERABLES = 4096;
+
+	// archetype storage (ArchetypeStorage.h), component type ids are bits of a 64 bit mask
+	constexpr uint32_t MAX_COMPONENT_TYPES = 64;
+	constexpr uint32_t MAX_ARCHETYPES = 256;
+	constexpr uint32_t ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+	constexpr uint32_t MAX_MODELS = 1024;
+	constexpr uint32_t MAX_MESHES = 1024;
+	constexpr uint32_t MAX_MATERIALS = 1024;
+
+	constexpr uint32_t MAX_MESHES_PER_MODEL = 8;
+
+	constexpr uint32_t COMMAND_BUFFER_CAPACITY = 64;
+
+	constexpr uint32_t MAX_BUFFERS = 1024;
+	constexpr uint32_t MAX_TEXTURES = 1024;
+	constexpr uint32_t MAX_SAMPLERS = 256;
+	constexpr uint32_t MAX_VERTEX_SHADERS = 256;
+	constexpr uint32_t MAX_PIXEL_SHADERS = 256;
+	constexpr uint32_t MAX_PIPELINE_STATES = 256;
+
+	constexpr uint32_t MAX_CONSTANT_BUFFER_BINDINGS = 14;
+	constexpr uint32_t MAX_TEXTURE_BINDINGS = 16;
+	constexpr uint32_t MAX_SAMPLER_BINDINGS = 16;
+	constexpr uint32_t MAX_RENDER_TARGET_BINDINGS = 8;
+	
+}
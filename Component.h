@@ -2,7 +2,11 @@
 
 #include "Common.h"
 #include "Entity.h"
+#include "PagedArray.h"
+#include "ChangeTracking.h"
+#include "ComponentRegistry.h"
 
+#include <algorithm>
 #include <utility>
 #include <cassert>
 
@@ -15,8 +19,23 @@ namespace tofu
 		explicit ComponentIndex() : idx(UINT32_MAX) {}
 	};
 
+	// when component of an entity last changed
+	struct ChangeStamp
+	{
+		// bumped on every change
+		uint32_t	version;
+		// ChangeTracking::GetFrame() of last change
+		uint32_t	frame;
+
+		ChangeStamp() : version(0), frame(0) {}
+	};
+
 	// Component is actually like a handle or pointer, 
 	// the actuall component T is in Component<T>::components[]
+	// storage of a component type is reserved for Entity::GetCapacity() entities on first Create(),
+	// and committed page by page as entities and components are added.
+	// mutators of T call MarkChanged(), so systems can visit only what changed (ForEachChanged()),
+	// creating a component counts as a change
 	template<class T>
 	class Component
 	{
@@ -31,7 +50,8 @@ namespace tofu
 
 		Component(Entity e) : entity(e), compIdx(nullptr) 
 		{
-			if (e) compIdx = &(pointers[e.id].idx);
+			// entities past committed pages have no component of this type
+			if (e && e.Index() < pointers.GetNumCommitted()) compIdx = &(pointers[e.Index()].idx);
 		}
 
 		operator bool() const
@@ -48,78 +68,341 @@ namespace tofu
 		inline void Destroy()
 		{
 			assert(true == *this);
-			
-			// swap the last element to this location
-			// change the pointers
-			// then decrease numComponents
-
-			if (numComponents > 1)
-			{
-				uint32_t lastElemIdx = numComponents - 1;
-				Entity lastElemEntity = back_pointers[lastElemIdx];
-
-				components[*compIdx] = std::move(components[lastElemIdx]);
-
-				back_pointers[lastElemIdx] = Entity();
-				back_pointers[*compIdx] = lastElemEntity;
-
-				pointers[lastElemEntity.id].idx = *compIdx;
-				*compIdx = UINT32_MAX;
-			}
-			else
-			{
-				components[*compIdx].~T();
-				back_pointers[*compIdx] = Entity();
-				*compIdx = UINT32_MAX;
-			}
-
-			numComponents--;
+			Remove(*compIdx);
 		}
 
 	public:
 		
 		static Component<T> Create(Entity e)
 		{
-			if (pointers[e.id].idx < numComponents)
+			assert(e);
+
+			if (TF_OK != ReserveStorage())
+			{
+				return Component<T>();
+			}
+
+			if (TF_OK != pointers.Grow(e.Index() + 1)
+				|| TF_OK != stamps.Grow(e.Index() + 1)
+				|| TF_OK != changes[0].Grow(e.Index() + 1)
+				|| TF_OK != changes[1].Grow(e.Index() + 1))
+			{
+				return Component<T>();
+			}
+
+			if (pointers[e.Index()].idx < numComponents)
 				return Component<T>(e);
 
+			if (TF_OK != back_pointers.Grow(numComponents + 1) || TF_OK != components.Grow(numComponents + 1))
+				return Component<T>();
+
 			uint32_t loc = numComponents++;
 
 			back_pointers[loc] = e;
-			pointers[e.id].idx = loc;
+			pointers[e.Index()].idx = loc;
 
 			// clear this component in case it was used
 			// and prevent resources leaking
 			components[loc].~T();
 			new (&components[loc]) T(e);
 
+			MarkChanged(e);
+
 			return Component<T>(e);
 		}
 
-		static T* GetAllComponents() { return components; }
+		// commit component slots for count more components up front, so following
+		// Create()/CreateBatch() calls don't commit pages one by one
+		static int32_t Reserve(uint32_t count)
+		{
+			CHECKED(ReserveStorage());
+			CHECKED(back_pointers.Grow(numComponents + count));
+			return components.Grow(numComponents + count);
+		}
+
+		// add a copy of prototype to each of count new entities, none of which has this component yet.
+		// storage is grown once for the whole batch, owner entity of each copy is set to its entity
+		static int32_t CreateBatch(const Entity* entities, uint32_t count, const T& prototype)
+		{
+			return CreateBatchWith(entities, count, [&prototype](T* dst, uint32_t n) { std::fill(dst, dst + n, prototype); });
+		}
+
+		// same, with a value of its own for each entity. new components are
+		// appended, so they are at [GetNumComponents() - count, GetNumComponents()) after it
+		static int32_t CreateBatch(const Entity* entities, uint32_t count, const T* values)
+		{
+			return CreateBatchWith(entities, count, [values](T* dst, uint32_t n) { std::copy(values, values + n, dst); });
+		}
+
+		// exchange places of two components in the array, handles stay valid.
+		// main thread only, with no system walking components of T (see ComponentSorter.h)
+		static void Swap(uint32_t a, uint32_t b)
+		{
+			assert(a < numComponents && b < numComponents);
+
+			using std::swap;
+			swap(components[a], components[b]);
+
+			Entity ea = back_pointers[a];
+			Entity eb = back_pointers[b];
+
+			back_pointers[a] = eb;
+			back_pointers[b] = ea;
+			pointers[ea.Index()].idx = b;
+			pointers[eb.Index()].idx = a;
+		}
+
+		// called by mutators of T, any thread may mark components of different entities
+		static TF_INLINE void MarkChanged(Entity e)
+		{
+			uint32_t idx = e.Index();
+			if (idx >= stamps.GetNumCommitted())
+			{
+				return;
+			}
+
+			ChangeStamp& stamp = stamps[idx];
+			stamp.version++;
+
+			uint32_t frame = ChangeTracking::GetFrame();
+			if (stamp.frame != frame)
+			{
+				stamp.frame = frame;
+				changes[frame & 1].Add(idx);
+			}
+		}
+
+		// changes when component of e changes, 0 if it never did
+		static TF_INLINE uint32_t GetVersion(Entity e)
+		{
+			return e.Index() < stamps.GetNumCommitted() ? stamps[e.Index()].version : 0;
+		}
+
+		// fn(Entity, T&) for components changed in sinceFrame or later frames.
+		// changes of current and last frame are kept, only those are visited,
+		// an older sinceFrame walks all components
+		template<class Func>
+		static void ForEachChanged(uint32_t sinceFrame, Func fn)
+		{
+			uint32_t frame = ChangeTracking::GetFrame();
+
+			if (sinceFrame + 1 < frame)
+			{
+				for (uint32_t i = 0; i < numComponents; ++i)
+				{
+					Entity e = back_pointers[i];
+					if (stamps[e.Index()].frame >= sinceFrame)
+					{
+						fn(e, components[i]);
+					}
+				}
+				return;
+			}
+
+			for (uint32_t f = sinceFrame; f <= frame; ++f)
+			{
+				changes[f & 1].ForEach([&fn, f](uint32_t idx)
+				{
+					// changed again in a later frame, or removed since
+					uint32_t loc = pointers[idx].idx;
+					if (stamps[idx].frame == f && loc < numComponents)
+					{
+						fn(back_pointers[loc], components[loc]);
+					}
+				});
+			}
+		}
+
+		static T* GetAllComponents() { return components.GetData(); }
 		static uint32_t GetNumComponents() { return numComponents; }
 
+		// owner entity of every component, in the same order as GetAllComponents()
+		static Entity* GetAllEntities() { return back_pointers.GetData(); }
+
+		// entity index -> component index table used by views (View.h),
+		// entities at or past GetIndexTableSize() have no component of this type
+		static const ComponentIndex* GetIndexTable() { return pointers.GetData(); }
+		static uint32_t GetIndexTableSize() { return pointers.GetNumCommitted(); }
+
+		// memory committed for this component type, 0 if it was never used
+		static size_t GetMemoryUsage()
+		{
+			return pointers.GetCommittedBytes() + back_pointers.GetCommittedBytes() + components.GetCommittedBytes()
+				+ stamps.GetCommittedBytes() + changes[0].GetCommittedBytes() + changes[1].GetCommittedBytes();
+		}
+
+	private:
+		// fill(dst, count) assigns new components, one block copy for trivially copyable values
+		template<class Func>
+		static int32_t CreateBatchWith(const Entity* entities, uint32_t count, Func fill)
+		{
+			if (0 == count)
+			{
+				return TF_OK;
+			}
+
+			CHECKED(ReserveStorage());
+
+			uint32_t maxIndex = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				assert(entities[i]);
+				maxIndex = entities[i].Index() > maxIndex ? entities[i].Index() : maxIndex;
+			}
+
+			CHECKED(pointers.Grow(maxIndex + 1));
+			CHECKED(stamps.Grow(maxIndex + 1));
+			CHECKED(changes[0].Grow(maxIndex + 1));
+			CHECKED(changes[1].Grow(maxIndex + 1));
+			CHECKED(back_pointers.Grow(numComponents + count));
+			CHECKED(components.Grow(numComponents + count));
+
+			// assigning resets whatever a removed component left in the slot, as Create() does
+			fill(&components[numComponents], count);
+
+			uint32_t loc = numComponents;
+			for (uint32_t i = 0; i < count; ++i, ++loc)
+			{
+				Entity e = entities[i];
+				assert(pointers[e.Index()].idx >= numComponents && "entity has this component already");
+
+				back_pointers[loc] = e;
+				pointers[e.Index()].idx = loc;
+				components[loc].entity = e;
+			}
+
+			numComponents = loc;
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				MarkChanged(entities[i]);
+			}
+
+			return TF_OK;
+		}
+
+		// reserve address space on first use, and register to ComponentRegistry
+		static int32_t ReserveStorage()
+		{
+			if (pointers.IsReserved())
+			{
+				return TF_OK;
+			}
+
+			uint32_t capacity = Entity::GetCapacity();
+			CHECKED(pointers.Reserve(capacity));
+			CHECKED(back_pointers.Reserve(capacity));
+			CHECKED(components.Reserve(capacity));
+			CHECKED(stamps.Reserve(capacity));
+			CHECKED(changes[0].Reserve(capacity));
+			CHECKED(changes[1].Reserve(capacity));
+			return ComponentRegistry::Register({ &Component<T>::DestroyEntities, &Component<T>::OnNextFrame, &Component<T>::RemoveAll });
+		}
+
+		// swap the last element to this location
+		// change the pointers
+		// then decrease numComponents
+		static void Remove(uint32_t loc)
+		{
+			uint32_t lastElemIdx = numComponents - 1;
+			Entity removed = back_pointers[loc];
+
+			if (loc != lastElemIdx)
+			{
+				Entity lastElemEntity = back_pointers[lastElemIdx];
+
+				components[loc] = std::move(components[lastElemIdx]);
+
+				back_pointers[loc] = lastElemEntity;
+				pointers[lastElemEntity.Index()].idx = loc;
+			}
+			else
+			{
+				// release what it holds, the slot stays constructed until Create() reuses it
+				components[loc] = T();
+			}
+
+			back_pointers[lastElemIdx] = Entity();
+			pointers[removed.Index()].idx = UINT32_MAX;
+
+			numComponents--;
+		}
+
+		// Entity::FlushDestroyed() removes components of a batch of entities type by type
+		static void DestroyEntities(const Entity* entities, uint32_t count)
+		{
+			uint32_t numPointers = pointers.GetNumCommitted();
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				uint32_t idx = entities[i].Index();
+
+				// sorted, so no later one has a component either
+				if (idx >= numPointers)
+				{
+					break;
+				}
+
+				uint32_t loc = pointers[idx].idx;
+				if (loc < numComponents && back_pointers[loc].id == entities[i].id)
+				{
+					Remove(loc);
+				}
+			}
+		}
+
+		// change set of new frame held the frame before last
+		static void OnNextFrame(uint32_t frame)
+		{
+			changes[frame & 1].Clear();
+		}
+
+		// slots stay constructed, emptied as Remove() does
+		static void RemoveAll()
+		{
+			for (uint32_t i = 0; i < numComponents; ++i)
+			{
+				pointers[back_pointers[i].Index()].idx = UINT32_MAX;
+				back_pointers[i] = Entity();
+				components[i] = T();
+			}
+
+			numComponents = 0;
+		}
+
 	protected:
 		// mapping from entity id to component index(location)
-		static ComponentIndex pointers[MAX_ENTITIES];
+		static PagedArray<ComponentIndex> pointers;
 
 		// mapping from component index(location) to entity id
-		static Entity back_pointers[MAX_ENTITIES];
+		static PagedArray<Entity> back_pointers;
 
-		// array of actual components
-		static T components[MAX_ENTITIES];
+		// array of actual components, contiguous so systems can walk all of them
+		static PagedArray<T> components;
 		static uint32_t numComponents;
+
+		// change stamp by entity index
+		static PagedArray<ChangeStamp> stamps;
+
+		// entities changed in even and odd frames
+		static ChangeSet changes[2];
 	};
 
 	template<class T>
-	ComponentIndex Component<T>::pointers[MAX_ENTITIES];
+	PagedArray<ComponentIndex> Component<T>::pointers;
 
 	template<class T>
-	Entity Component<T>::back_pointers[MAX_ENTITIES];
+	PagedArray<Entity> Component<T>::back_pointers;
 
 	template<class T>
-	T Component<T>::components[MAX_ENTITIES];
+	PagedArray<T> Component<T>::components;
 
 	template<class T>
 	uint32_t Component<T>::numComponents = 0;
+
+	template<class T>
+	PagedArray<ChangeStamp> Component<T>::stamps;
+
+	template<class T>
+	ChangeSet Component<T>::changes[2];
 }
@@ -0,0 +1,59 @@
+#include "ComponentRegistry.h"
+
+#include <cassert>
+
+namespace
+{
+	tofu::ComponentStorage storages[tofu::MAX_COMPONENT_TYPES];
+	uint32_t numStorages = 0;
+}
+
+namespace tofu
+{
+	int32_t ComponentRegistry::Register(const ComponentStorage& storage)
+	{
+		assert(numStorages < MAX_COMPONENT_TYPES && "too many component types");
+		if (numStorages >= MAX_COMPONENT_TYPES)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		storages[numStorages++] = storage;
+		return TF_OK;
+	}
+
+	uint32_t ComponentRegistry::GetNumStorages()
+	{
+		return numStorages;
+	}
+
+	const ComponentStorage& ComponentRegistry::GetStorage(uint32_t i)
+	{
+		assert(i < numStorages);
+		return storages[i];
+	}
+
+	void ComponentRegistry::DestroyEntities(const Entity* entities, uint32_t count)
+	{
+		for (uint32_t i = 0; i < numStorages; i++)
+		{
+			storages[i].destroyEntities(entities, count);
+		}
+	}
+
+	void ComponentRegistry::NextFrame(uint32_t frame)
+	{
+		for (uint32_t i = 0; i < numStorages; i++)
+		{
+			storages[i].nextFrame(frame);
+		}
+	}
+
+	void ComponentRegistry::RemoveAll()
+	{
+		for (uint32_t i = 0; i < numStorages; i++)
+		{
+			storages[i].removeAll();
+		}
+	}
+}
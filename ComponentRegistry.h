@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Common.h"
+#include "Entity.h"
+
+namespace tofu
+{
+	// what code not knowing a component type needs of its storage (Component<T>)
+	struct ComponentStorage
+	{
+		// remove components of entities sorted by index, entities without one are skipped
+		void	(*destroyEntities)(const Entity* entities, uint32_t count);
+		// called with new frame number by ChangeTracking::NextFrame()
+		void	(*nextFrame)(uint32_t frame);
+		// remove every component, releasing what they hold
+		void	(*removeAll)();
+	};
+
+	// every component storage in use, they register on first Create().
+	// registering is not thread safe
+	class ComponentRegistry
+	{
+	public:
+		static int32_t Register(const ComponentStorage& storage);
+
+		static uint32_t GetNumStorages();
+
+		static const ComponentStorage& GetStorage(uint32_t i);
+
+		// remove every component of entities sorted by index, a whole batch per storage
+		static void DestroyEntities(const Entity* entities, uint32_t count);
+
+		static void NextFrame(uint32_t frame);
+
+		// remove every component of every storage, so memory components hold goes back
+		// to engine allocators before they shut down. entities stay allocated
+		static void RemoveAll();
+	};
+}
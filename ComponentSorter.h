@@ -0,0 +1,270 @@
+#pragma once
+
+#include "Common.h"
+#include "Component.h"
+#include "Entity.h"
+#include "PagedArray.h"
+
+#include <algorithm>
+
+namespace tofu
+{
+	// puts array of Component<T> in order of a key, a little every frame.
+	// swap and pop on destroy and creation order leave arrays in no order,
+	// so loops looking up other components of the same entities jump around memory.
+	// ordering arrays of those types by the same key (or by where the entity is in another sorted array)
+	// makes such lookups walk forward instead.
+	// each pass takes keys of all components, sorts them (runs, then merges) and moves components into place,
+	// spread over as many Update() calls as the budget needs. components added or destroyed meanwhile
+	// are only put in order by the next pass.
+	// call on main thread with no system walking components of T
+	template<class T>
+	class ComponentSorter
+	{
+	public:
+		ComponentSorter()
+			:
+			numEntries(0),
+			src(0),
+			phase(PHASE_GATHER),
+			cursor(0),
+			width(0),
+			left(0),
+			right(0),
+			lastKey(0),
+			inOrder(true),
+			sorted(false)
+		{}
+
+		ComponentSorter(const ComponentSorter&) = delete;
+		ComponentSorter& operator = (const ComponentSorter&) = delete;
+
+		// do about budget steps (a step takes a key, or moves an entry or a component).
+		// key(Entity, const T&) returns uint64_t, keys must differ between entities
+		// (like having entity index in low bits), or equal ones may swap places every pass
+		template<class Func>
+		int32_t Update(uint32_t budget, Func key);
+
+		// last Update() found array in order, false while a pass is going on
+		TF_INLINE bool IsSorted() const { return sorted; }
+
+	private:
+		// length of runs std::sort() sorts before merging
+		static constexpr uint32_t RunLength = 64;
+
+		enum Phase
+		{
+			PHASE_GATHER,
+			PHASE_SORT_RUNS,
+			PHASE_MERGE,
+			PHASE_APPLY,
+		};
+
+		struct Entry
+		{
+			uint64_t	key;
+			Entity		entity;
+		};
+
+		// component of e is at loc, if it still has one
+		static TF_INLINE bool Find(Entity e, uint32_t* loc)
+		{
+			uint32_t idx = e.Index();
+			if (idx >= Component<T>::GetIndexTableSize())
+			{
+				return false;
+			}
+
+			*loc = Component<T>::GetIndexTable()[idx].idx;
+			return *loc < Component<T>::GetNumComponents() && Component<T>::GetAllEntities()[*loc].id == e.id;
+		}
+
+	private:
+		// keys, and merge buffer
+		PagedArray<Entry>	entries[2];
+		uint32_t			numEntries;
+		uint32_t			src;
+
+		Phase				phase;
+		// next component to gather, run to sort, merge output or entry to apply
+		uint32_t			cursor;
+		// merged run length
+		uint32_t			width;
+		// merge inputs, or next array location to fill when applying
+		uint32_t			left;
+		uint32_t			right;
+
+		uint64_t			lastKey;
+		bool				inOrder;
+		bool				sorted;
+	};
+
+	template<class T>
+	template<class Func>
+	int32_t ComponentSorter<T>::Update(uint32_t budget, Func key)
+	{
+		if (!entries[0].IsReserved())
+		{
+			uint32_t capacity = Entity::GetCapacity();
+			CHECKED(entries[0].Reserve(capacity));
+			CHECKED(entries[1].Reserve(capacity));
+		}
+
+		while (budget > 0)
+		{
+			switch (phase)
+			{
+			case PHASE_GATHER:
+			{
+				uint32_t count = Component<T>::GetNumComponents();
+				if (0 == cursor)
+				{
+					numEntries = 0;
+					src = 0;
+					inOrder = true;
+					sorted = false;
+				}
+
+				CHECKED(entries[0].Grow(count));
+				CHECKED(entries[1].Grow(count));
+
+				const T* comps = Component<T>::GetAllComponents();
+				const Entity* owners = Component<T>::GetAllEntities();
+				Entry* out = entries[0].GetData();
+
+				for (; cursor < count && budget > 0; ++cursor, --budget)
+				{
+					uint64_t k = key(owners[cursor], comps[cursor]);
+					inOrder = inOrder && (0 == numEntries || k > lastKey);
+					lastKey = k;
+					out[numEntries++] = { k, owners[cursor] };
+				}
+
+				if (cursor < count)
+				{
+					break;
+				}
+
+				// nothing to move if array was in order, start over
+				sorted = inOrder;
+				cursor = 0;
+				if (!inOrder)
+				{
+					phase = PHASE_SORT_RUNS;
+				}
+				else
+				{
+					return TF_OK;
+				}
+				break;
+			}
+
+			case PHASE_SORT_RUNS:
+			{
+				Entry* data = entries[0].GetData();
+				while (cursor < numEntries && budget > 0)
+				{
+					uint32_t end = std::min(cursor + RunLength, numEntries);
+					std::sort(data + cursor, data + end, [](const Entry& a, const Entry& b) { return a.key < b.key; });
+					budget -= std::min(budget, end - cursor);
+					cursor = end;
+				}
+
+				if (cursor >= numEntries)
+				{
+					phase = PHASE_MERGE;
+					width = RunLength;
+					cursor = 0;
+					left = 0;
+					right = std::min(width, numEntries);
+				}
+				break;
+			}
+
+			case PHASE_MERGE:
+			{
+				if (width >= numEntries)
+				{
+					phase = PHASE_APPLY;
+					cursor = 0;
+					left = 0;
+					break;
+				}
+
+				const Entry* in = entries[src].GetData();
+				Entry* out = entries[1 - src].GetData();
+
+				// merging [base, base + width) and [base + width, base + 2 * width), cursor is output
+				while (budget > 0 && cursor < numEntries)
+				{
+					uint32_t base = cursor - (cursor % (2 * width));
+					uint32_t mid = std::min(base + width, numEntries);
+					uint32_t end = std::min(base + 2 * width, numEntries);
+
+					for (; cursor < end && budget > 0; ++cursor, --budget)
+					{
+						if (right >= end || (left < mid && in[left].key <= in[right].key))
+						{
+							out[cursor] = in[left++];
+						}
+						else
+						{
+							out[cursor] = in[right++];
+						}
+					}
+
+					// next pair
+					if (cursor == end)
+					{
+						left = end;
+						right = std::min(end + width, numEntries);
+					}
+				}
+
+				// pass done
+				if (cursor >= numEntries)
+				{
+					src = 1 - src;
+					width *= 2;
+					cursor = 0;
+					left = 0;
+					right = std::min(width, numEntries);
+				}
+				break;
+			}
+
+			case PHASE_APPLY:
+			{
+				// left is next location to fill
+				const Entry* order = entries[src].GetData();
+				for (; cursor < numEntries && left < Component<T>::GetNumComponents() && budget > 0; ++cursor, --budget)
+				{
+					uint32_t loc;
+
+					// gone, or placed already (gathered twice)
+					if (!Find(order[cursor].entity, &loc) || loc < left)
+					{
+						continue;
+					}
+
+					if (loc != left)
+					{
+						Component<T>::Swap(loc, left);
+					}
+					left++;
+				}
+
+				if (cursor >= numEntries || left >= Component<T>::GetNumComponents())
+				{
+					phase = PHASE_GATHER;
+					cursor = 0;
+					return TF_OK;
+				}
+				break;
+			}
+			}
+		}
+
+		return TF_OK;
+	}
+}
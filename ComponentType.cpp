@@ -0,0 +1,42 @@
+#include "ComponentType.h"
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+
+namespace
+{
+	tofu::ComponentTypeInfo typeInfos[tofu::MAX_COMPONENT_TYPES];
+	std::atomic<uint32_t> numTypes(0);
+	std::mutex registerLock;
+}
+
+namespace tofu
+{
+	const ComponentTypeInfo& ComponentTypes::GetInfo(uint32_t id)
+	{
+		assert(id < numTypes.load(std::memory_order_acquire));
+		return typeInfos[id];
+	}
+
+	uint32_t ComponentTypes::GetNumTypes()
+	{
+		return numTypes.load(std::memory_order_acquire);
+	}
+
+	uint32_t ComponentTypes::Register(const ComponentTypeInfo& info)
+	{
+		std::lock_guard<std::mutex> guard(registerLock);
+
+		uint32_t id = numTypes.load(std::memory_order_relaxed);
+		assert(id < MAX_COMPONENT_TYPES && "too many component types");
+		if (id >= MAX_COMPONENT_TYPES)
+		{
+			return MAX_COMPONENT_TYPES - 1;
+		}
+
+		typeInfos[id] = info;
+		numTypes.store(id + 1, std::memory_order_release);
+		return id;
+	}
+}
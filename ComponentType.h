@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Common.h"
+#include "Entity.h"
+
+#include <new>
+#include <utility>
+
+namespace tofu
+{
+	// one bit per component type id
+	typedef uint64_t ComponentMask;
+
+	// what storage needs to handle a component type it doesn't know
+	struct ComponentTypeInfo
+	{
+		uint32_t	size;
+		uint32_t	alignment;
+		// construct a component of entity e at dst
+		void		(*construct)(void* dst, Entity e);
+		// move construct at dst, and destruct src
+		void		(*relocate)(void* dst, void* src);
+		void		(*destruct)(void* ptr);
+	};
+
+	// component types get small ids on first use,
+	// ids stay the same while program runs, but not between runs
+	class ComponentTypes
+	{
+	public:
+		template<class T>
+		static uint32_t GetId()
+		{
+			static const uint32_t id = Register({ sizeof(T), alignof(T), &Construct<T>, &Relocate<T>, &Destruct<T> });
+			return id;
+		}
+
+		template<class T>
+		static ComponentMask GetMask() { return 1ull << GetId<T>(); }
+
+		static const ComponentTypeInfo& GetInfo(uint32_t id);
+
+		static uint32_t GetNumTypes();
+
+	private:
+		static uint32_t Register(const ComponentTypeInfo& info);
+
+		template<class T>
+		static void Construct(void* dst, Entity e) { new (dst) T(e); }
+
+		template<class T>
+		static void Relocate(void* dst, void* src)
+		{
+			T* from = reinterpret_cast<T*>(src);
+			new (dst) T(std::move(*from));
+			from->~T();
+		}
+
+		template<class T>
+		static void Destruct(void* ptr) { reinterpret_cast<T*>(ptr)->~T(); }
+	};
+}
@@ -0,0 +1,386 @@
+#include "Compression.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	using tofu::compressed::CompressedHeader;
+	using tofu::compressed::CompressedBlock;
+
+	constexpr size_t MinMatch = 4;
+	// last bytes of a block are always literals, and no match starts close to the end
+	constexpr size_t LastLiterals = 5;
+	constexpr size_t MatchFindLimit = 12;
+	constexpr size_t MaxOffset = 65535;
+
+	constexpr uint32_t HashBits = 12;
+
+	uint32_t read32(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t hash32(uint32_t v)
+	{
+		return (v * 2654435761u) >> (32 - HashBits);
+	}
+
+	// length of literals or match beyond what fits into the token
+	bool write_length(uint8_t*& op, uint8_t* oend, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			if (op >= oend) return false;
+			*op++ = 255;
+		}
+		if (op >= oend) return false;
+		*op++ = static_cast<uint8_t>(length);
+		return true;
+	}
+
+	bool read_length(const uint8_t*& ip, const uint8_t* iend, size_t& length)
+	{
+		uint8_t b;
+		do
+		{
+			if (ip >= iend) return false;
+			b = *ip++;
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+
+	bool write_sequence(uint8_t*& op, uint8_t* oend, const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength)
+	{
+		if (op >= oend) return false;
+
+		uint8_t* token = op++;
+		*token = static_cast<uint8_t>((numLiterals >= 15 ? 15 : numLiterals) << 4);
+
+		if (numLiterals >= 15 && !write_length(op, oend, numLiterals - 15)) return false;
+
+		if (static_cast<size_t>(oend - op) < numLiterals) return false;
+		if (numLiterals > 0)
+		{
+			std::memcpy(op, literals, numLiterals);
+			op += numLiterals;
+		}
+
+		// last sequence has literals only
+		if (0 == offset) return true;
+
+		if (oend - op < 2) return false;
+		*op++ = static_cast<uint8_t>(offset);
+		*op++ = static_cast<uint8_t>(offset >> 8);
+
+		size_t length = matchLength - MinMatch;
+		*token |= static_cast<uint8_t>(length >= 15 ? 15 : length);
+		if (length >= 15 && !write_length(op, oend, length - 15)) return false;
+
+		return true;
+	}
+
+	bool check_header(const void* data, size_t size)
+	{
+		if (size < sizeof(CompressedHeader)) return false;
+
+		const CompressedHeader* header = reinterpret_cast<const CompressedHeader*>(data);
+		return header->Magic == tofu::compressed::COMPRESSED_FILE_MAGIC
+			&& header->Version == tofu::compressed::COMPRESSED_FILE_VERSION;
+	}
+}
+
+namespace tofu
+{
+	size_t Compression::CompressBlockBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	size_t Compression::CompressBlock(const void* src, size_t srcSize, void* dst, size_t dstCapacity)
+	{
+		const uint8_t* base = reinterpret_cast<const uint8_t*>(src);
+		const uint8_t* iend = base + srcSize;
+		const uint8_t* anchor = base;
+
+		uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+		uint8_t* oend = op + dstCapacity;
+
+		if (srcSize > MatchFindLimit)
+		{
+			const uint8_t* mflimit = iend - MatchFindLimit;
+			const uint8_t* matchlimit = iend - LastLiterals;
+
+			// position of last occurrence of a 4 byte hash
+			uint32_t table[1 << HashBits] = {};
+
+			const uint8_t* ip = base + 1;
+			while (ip < mflimit)
+			{
+				uint32_t h = hash32(read32(ip));
+				const uint8_t* ref = base + table[h];
+				table[h] = static_cast<uint32_t>(ip - base);
+
+				if (ref >= ip || static_cast<size_t>(ip - ref) > MaxOffset || read32(ref) != read32(ip))
+				{
+					// step faster through data that doesn't compress
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				while (ip > anchor && ref > base && ip[-1] == ref[-1])
+				{
+					ip--;
+					ref--;
+				}
+
+				const uint8_t* matchEnd = ip + MinMatch;
+				const uint8_t* refEnd = ref + MinMatch;
+				while (matchEnd < matchlimit && *matchEnd == *refEnd)
+				{
+					matchEnd++;
+					refEnd++;
+				}
+
+				if (!write_sequence(op, oend, anchor, ip - anchor, ip - ref, matchEnd - ip))
+				{
+					return 0;
+				}
+
+				ip = matchEnd;
+				anchor = ip;
+
+				if (ip < mflimit)
+				{
+					table[hash32(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+				}
+			}
+		}
+
+		if (!write_sequence(op, oend, anchor, iend - anchor, 0, 0))
+		{
+			return 0;
+		}
+
+		return op - reinterpret_cast<uint8_t*>(dst);
+	}
+
+	int32_t Compression::DecompressBlock(const void* src, size_t srcSize, void* dst, size_t dstSize)
+	{
+		const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+		const uint8_t* iend = ip + srcSize;
+
+		uint8_t* base = reinterpret_cast<uint8_t*>(dst);
+		uint8_t* op = base;
+		uint8_t* oend = op + dstSize;
+
+		while (true)
+		{
+			if (ip >= iend) return TF_UNKNOWN_ERR;
+
+			uint8_t token = *ip++;
+
+			size_t numLiterals = token >> 4;
+			if (15 == numLiterals && !read_length(ip, iend, numLiterals)) return TF_UNKNOWN_ERR;
+
+			if (numLiterals > static_cast<size_t>(iend - ip) || numLiterals > static_cast<size_t>(oend - op)) return TF_UNKNOWN_ERR;
+			std::memcpy(op, ip, numLiterals);
+			ip += numLiterals;
+			op += numLiterals;
+
+			// last sequence
+			if (ip == iend) break;
+
+			if (iend - ip < 2) return TF_UNKNOWN_ERR;
+			size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+			ip += 2;
+
+			if (0 == offset || offset > static_cast<size_t>(op - base)) return TF_UNKNOWN_ERR;
+
+			size_t length = token & 15;
+			if (15 == length && !read_length(ip, iend, length)) return TF_UNKNOWN_ERR;
+			length += MinMatch;
+
+			if (length > static_cast<size_t>(oend - op)) return TF_UNKNOWN_ERR;
+
+			const uint8_t* ref = op - offset;
+			if (offset >= length)
+			{
+				std::memcpy(op, ref, length);
+				op += length;
+			}
+			else
+			{
+				// overlapping match repeats the last offset bytes
+				for (size_t i = 0; i < length; i++)
+				{
+					*op++ = *ref++;
+				}
+			}
+		}
+
+		return op == oend ? TF_OK : TF_UNKNOWN_ERR;
+	}
+
+	size_t Compression::CompressFileBound(size_t size, uint32_t blockSize)
+	{
+		size_t numBlocks = (size + blockSize - 1) / blockSize;
+		return sizeof(CompressedHeader) + sizeof(CompressedBlock) * numBlocks + size;
+	}
+
+	size_t Compression::CompressFile(const void* src, size_t srcSize, void* dst, size_t dstCapacity, uint32_t blockSize)
+	{
+		size_t numBlocks = (srcSize + blockSize - 1) / blockSize;
+		if (numBlocks > UINT32_MAX || dstCapacity < sizeof(CompressedHeader) + sizeof(CompressedBlock) * numBlocks)
+		{
+			return 0;
+		}
+
+		uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+
+		CompressedHeader* header = reinterpret_cast<CompressedHeader*>(out);
+		header->Magic = compressed::COMPRESSED_FILE_MAGIC;
+		header->Version = compressed::COMPRESSED_FILE_VERSION;
+		header->BlockSize = blockSize;
+		header->NumBlocks = static_cast<uint32_t>(numBlocks);
+		header->UncompressedSize = srcSize;
+
+		CompressedBlock* blocks = reinterpret_cast<CompressedBlock*>(header + 1);
+		size_t offset = sizeof(CompressedHeader) + sizeof(CompressedBlock) * numBlocks;
+
+		for (size_t i = 0; i < numBlocks; i++)
+		{
+			const uint8_t* block = reinterpret_cast<const uint8_t*>(src) + i * blockSize;
+			size_t rawSize = (i + 1 < numBlocks) ? blockSize : srcSize - i * blockSize;
+
+			if (dstCapacity - offset < rawSize)
+			{
+				return 0;
+			}
+
+			// anything not smaller than the raw block is stored instead
+			size_t compressedSize = CompressBlock(block, rawSize, out + offset, rawSize - 1);
+
+			blocks[i].Offset = offset;
+			if (0 == compressedSize)
+			{
+				std::memcpy(out + offset, block, rawSize);
+				blocks[i].CompressedSize = static_cast<uint32_t>(rawSize);
+				blocks[i].Flags = compressed::BLOCK_FLAG_STORED;
+			}
+			else
+			{
+				blocks[i].CompressedSize = static_cast<uint32_t>(compressedSize);
+				blocks[i].Flags = 0;
+			}
+
+			offset += blocks[i].CompressedSize;
+		}
+
+		return offset;
+	}
+
+	bool Compression::IsCompressedFile(const void* data, size_t size)
+	{
+		return check_header(data, size);
+	}
+
+	size_t Compression::GetUncompressedSize(const void* data)
+	{
+		return static_cast<size_t>(reinterpret_cast<const CompressedHeader*>(data)->UncompressedSize);
+	}
+
+	bool Compression::CheckBlockTable(const CompressedHeader* header, size_t size)
+	{
+		uint32_t blockSize = header->BlockSize;
+		uint32_t numBlocks = header->NumBlocks;
+
+		return 0 != blockSize
+			&& numBlocks == (header->UncompressedSize + blockSize - 1) / blockSize
+			&& size >= sizeof(CompressedHeader)
+			&& numBlocks <= (size - sizeof(CompressedHeader)) / sizeof(CompressedBlock);
+	}
+
+	int32_t Compression::DecompressFileBlock(const CompressedBlock& block, const void* blockData, void* dst, size_t rawSize)
+	{
+		if (block.Flags & compressed::BLOCK_FLAG_STORED)
+		{
+			if (block.CompressedSize != rawSize)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+			std::memcpy(dst, blockData, rawSize);
+			return TF_OK;
+		}
+
+		return DecompressBlock(blockData, block.CompressedSize, dst, rawSize);
+	}
+
+	int32_t Compression::DecompressFile(const void* data, size_t size, void* dst, size_t dstSize, uint32_t numThreads)
+	{
+		if (!check_header(data, size))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+		const CompressedHeader* header = reinterpret_cast<const CompressedHeader*>(in);
+		const CompressedBlock* blocks = reinterpret_cast<const CompressedBlock*>(header + 1);
+
+		if (header->UncompressedSize != dstSize || !CheckBlockTable(header, size))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		uint32_t blockSize = header->BlockSize;
+		uint32_t numBlocks = header->NumBlocks;
+
+		std::atomic<uint32_t> nextBlock(0);
+		std::atomic<bool> failed(false);
+
+		// threads take blocks one by one until all are done
+		auto decode = [&]()
+		{
+			for (uint32_t i = nextBlock.fetch_add(1u); i < numBlocks; i = nextBlock.fetch_add(1u))
+			{
+				const CompressedBlock& block = blocks[i];
+				uint8_t* out = reinterpret_cast<uint8_t*>(dst) + static_cast<size_t>(i) * blockSize;
+				size_t rawSize = (i + 1 < numBlocks) ? blockSize : dstSize - static_cast<size_t>(i) * blockSize;
+
+				if (block.Offset > size || block.CompressedSize > size - block.Offset)
+				{
+					failed.store(true);
+					return;
+				}
+
+				if (TF_OK != DecompressFileBlock(block, in + block.Offset, out, rawSize))
+				{
+					failed.store(true);
+					return;
+				}
+			}
+		};
+
+		if (numThreads > numBlocks) numThreads = numBlocks;
+		if (numThreads > MAX_DECOMPRESS_THREADS) numThreads = MAX_DECOMPRESS_THREADS;
+
+		std::thread threads[MAX_DECOMPRESS_THREADS];
+		for (uint32_t i = 1; i < numThreads; i++)
+		{
+			threads[i] = std::thread(decode);
+		}
+
+		decode();
+
+		for (uint32_t i = 1; i < numThreads; i++)
+		{
+			threads[i].join();
+		}
+
+		return failed.load() ? TF_UNKNOWN_ERR : TF_OK;
+	}
+}
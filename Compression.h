@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Common.h"
+
+#include <cstddef>
+
+namespace tofu
+{
+	namespace compressed
+	{
+
+		constexpr uint32_t COMPRESSED_FILE_MAGIC = 0x5A434654; // "TFCZ"
+		constexpr uint32_t COMPRESSED_FILE_VERSION = 0x00000001;
+
+		struct CompressedHeader
+		{
+			uint32_t			Magic;
+			uint32_t			Version;
+			// every block but the last one holds BlockSize bytes when decompressed
+			uint32_t			BlockSize;
+			uint32_t			NumBlocks;
+			uint64_t			UncompressedSize;
+		};
+
+		// ... followed by an array of CompressedBlock struct
+
+		// ... followed by block data
+
+		enum CompressedBlockFlag
+		{
+			// block didn't get smaller, it is stored as it is
+			BLOCK_FLAG_STORED = 1 << 0,
+		};
+
+		struct CompressedBlock
+		{
+			// from beginning of the file
+			uint64_t			Offset;
+			uint32_t			CompressedSize;
+			uint32_t			Flags;
+		};
+	}
+
+	// LZ4 style block codec (same sequence layout as LZ4 block format),
+	// and a container of independently compressed blocks, so they can be decoded in parallel
+	class Compression
+	{
+	public:
+		// largest output of CompressBlock()
+		static size_t CompressBlockBound(size_t size);
+
+		// returns compressed size, 0 if it doesn't fit into dstCapacity
+		static size_t CompressBlock(const void* src, size_t srcSize, void* dst, size_t dstCapacity);
+
+		// dstSize must be exact size of decompressed data, corrupted input fails instead of overrunning
+		static int32_t DecompressBlock(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+		// largest output of CompressFile(), it never gets much bigger than the input
+		static size_t CompressFileBound(size_t size, uint32_t blockSize = COMPRESSED_BLOCK_SIZE);
+
+		// write a whole compressed file, returns its size, 0 on failure
+		static size_t CompressFile(const void* src, size_t srcSize, void* dst, size_t dstCapacity, uint32_t blockSize = COMPRESSED_BLOCK_SIZE);
+
+		static bool IsCompressedFile(const void* data, size_t size);
+
+		static size_t GetUncompressedSize(const void* data);
+
+		// block table fits into a file of given size and matches the uncompressed size
+		static bool CheckBlockTable(const compressed::CompressedHeader* header, size_t size);
+
+		// decode a single block of a compressed file, rawSize is BlockSize except for the last block
+		static int32_t DecompressFileBlock(const compressed::CompressedBlock& block, const void* blockData, void* dst, size_t rawSize);
+
+		// decode blocks of a compressed file on up to numThreads threads (calling thread included)
+		static int32_t DecompressFile(const void* data, size_t size, void* dst, size_t dstSize, uint32_t numThreads);
+	};
+}
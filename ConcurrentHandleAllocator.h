@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Common.h"
+#include "PagedArray.h"
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+
+namespace tofu
+{
+	// HandleAllocator that any thread can allocate from and free to, without locking.
+	// free slots are kept in a lock-free stack, its head is tagged with a counter,
+	// so a head popped and pushed back by other threads in between is not mistaken (ABA)
+	// handles have generations like HandleAllocator, but live ones can't be iterated densely.
+	// Count is the default capacity, slots are added a page at a time when the stack runs empty,
+	// only that takes a lock
+	template<class Handle, uint32_t Count>
+	class ConcurrentHandleAllocator
+	{
+		static_assert(Count > 0 && Count <= HANDLE_INDEX_MASK, "too many handles");
+
+		static constexpr uint32_t EmptyStack = UINT32_MAX;
+
+		struct Slot
+		{
+			// id of slot while in use, UINT32_MAX while free
+			std::atomic<uint32_t>	id;
+			// id the slot is given out with next time, owned by whoever holds the slot
+			uint32_t				nextId;
+			// free stack link
+			std::atomic<uint32_t>	next;
+		};
+
+	public:
+		inline ConcurrentHandleAllocator()
+			:
+			freeHead(EmptyStack),
+			numInUse(0),
+			numSlots(0),
+			capacity(Count)
+		{
+		}
+
+		ConcurrentHandleAllocator(const ConcurrentHandleAllocator&) = delete;
+		ConcurrentHandleAllocator& operator = (const ConcurrentHandleAllocator&) = delete;
+
+		// change capacity before first handle is allocated
+		inline int32_t SetCapacity(uint32_t maxCount)
+		{
+			std::lock_guard<std::mutex> guard(growLock);
+
+			if (0 == maxCount || maxCount > HANDLE_INDEX_MASK || slots.IsReserved())
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			capacity = maxCount;
+			return TF_OK;
+		}
+
+		inline uint32_t GetCapacity() const
+		{
+			std::lock_guard<std::mutex> guard(growLock);
+			return capacity;
+		}
+
+		inline Handle Allocate()
+		{
+			uint64_t head = freeHead.load(std::memory_order_acquire);
+			uint32_t slot;
+
+			while (true)
+			{
+				slot = static_cast<uint32_t>(head);
+				if (EmptyStack == slot)
+				{
+					if (!Grow())
+					{
+						return Handle();
+					}
+
+					head = freeHead.load(std::memory_order_acquire);
+					continue;
+				}
+
+				// may be stale if another thread takes the slot first, the tag makes the CAS fail then
+				uint32_t nextSlot = slots.GetData()[slot].next.load(std::memory_order_relaxed);
+				uint64_t newHead = (head & ~0xFFFFFFFFull) + (1ull << 32) + nextSlot;
+
+				if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					break;
+				}
+			}
+
+			Slot& s = slots.GetData()[slot];
+			uint32_t id = s.nextId;
+			s.id.store(id, std::memory_order_release);
+			numInUse.fetch_add(1, std::memory_order_relaxed);
+
+			return Handle(id);
+		}
+
+		// allocate up to count handles, a run of free slots is taken with one CAS.
+		// returns number allocated, less than count when capacity is reached
+		inline uint32_t Allocate(Handle* handles, uint32_t count)
+		{
+			uint32_t done = 0;
+
+			while (done < count)
+			{
+				uint64_t head = freeHead.load(std::memory_order_acquire);
+				uint32_t first = static_cast<uint32_t>(head);
+
+				if (EmptyStack == first)
+				{
+					if (!Grow())
+					{
+						break;
+					}
+					continue;
+				}
+
+				// links may be stale if other threads pop or push meanwhile, the tag makes the CAS fail then
+				uint32_t n = 1;
+				uint32_t nextSlot = slots.GetData()[first].next.load(std::memory_order_relaxed);
+				while (n < count - done && EmptyStack != nextSlot)
+				{
+					nextSlot = slots.GetData()[nextSlot].next.load(std::memory_order_relaxed);
+					n++;
+				}
+
+				uint64_t newHead = (head & ~0xFFFFFFFFull) + (1ull << 32) + nextSlot;
+				if (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					continue;
+				}
+
+				// the run is ours now
+				uint32_t slot = first;
+				for (uint32_t i = 0; i < n; i++)
+				{
+					Slot& s = slots.GetData()[slot];
+					uint32_t id = s.nextId;
+					s.id.store(id, std::memory_order_release);
+					handles[done++] = Handle(id);
+					slot = s.next.load(std::memory_order_relaxed);
+				}
+			}
+
+			numInUse.fetch_add(done, std::memory_order_relaxed);
+			return done;
+		}
+
+		inline void Free(Handle handle)
+		{
+			uint32_t slot = handle.id & HANDLE_INDEX_MASK;
+			assert(slot < numSlots.load(std::memory_order_relaxed));
+
+			Slot& s = slots.GetData()[slot];
+
+			// only one of threads freeing the same handle gets the slot
+			uint32_t expected = handle.id;
+			bool freed = s.id.compare_exchange_strong(expected, UINT32_MAX, std::memory_order_relaxed);
+			assert(freed && "handle is not in use");
+			if (!freed)
+			{
+				return;
+			}
+
+			// next generation of this slot, published by the push below
+			s.nextId = handle.id + (1u << HANDLE_INDEX_BITS);
+			numInUse.fetch_sub(1, std::memory_order_relaxed);
+
+			Push(slot, slot);
+		}
+
+		inline bool IsValid(Handle handle) const
+		{
+			uint32_t slot = handle.id & HANDLE_INDEX_MASK;
+			return slot < numSlots.load(std::memory_order_acquire)
+				&& slots.GetData()[slot].id.load(std::memory_order_acquire) == handle.id;
+		}
+
+		// only a snapshot while other threads allocate or free
+		inline uint32_t GetNumInUse() const { return numInUse.load(std::memory_order_relaxed); }
+
+	private:
+		// push linked slots first..last onto free stack
+		inline void Push(uint32_t first, uint32_t last)
+		{
+			uint64_t head = freeHead.load(std::memory_order_relaxed);
+			uint64_t newHead;
+			do
+			{
+				slots.GetData()[last].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+				newHead = (head & ~0xFFFFFFFFull) + (1ull << 32) + first;
+			} while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		// commit a page of new slots and push them, unless other threads pushed some
+		// since the stack was seen empty. false when capacity is reached
+		inline bool Grow()
+		{
+			std::lock_guard<std::mutex> guard(growLock);
+
+			if (EmptyStack != static_cast<uint32_t>(freeHead.load(std::memory_order_relaxed)))
+			{
+				return true;
+			}
+
+			uint32_t base = numSlots.load(std::memory_order_relaxed);
+			if (base >= capacity)
+			{
+				return false;
+			}
+
+			if (!slots.IsReserved() && TF_OK != slots.Reserve(capacity))
+			{
+				return false;
+			}
+
+			if (TF_OK != slots.Grow(base + 1))
+			{
+				return false;
+			}
+
+			uint32_t end = slots.GetNumCommitted();
+			for (uint32_t i = base; i < end; ++i)
+			{
+				Slot& s = slots[i];
+				s.id.store(UINT32_MAX, std::memory_order_relaxed);
+				s.nextId = i;
+				s.next.store(i + 1 < end ? i + 1 : EmptyStack, std::memory_order_relaxed);
+			}
+
+			numSlots.store(end, std::memory_order_release);
+			Push(base, end - 1);
+
+			return true;
+		}
+
+	private:
+		// tag in high 32 bits, top slot of free stack in low 32 bits
+		std::atomic<uint64_t>	freeHead;
+		std::atomic<uint32_t>	numInUse;
+		// slots with committed memory, a slot below it is never moved or decommitted
+		std::atomic<uint32_t>	numSlots;
+
+		PagedArray<Slot>		slots;
+
+		// taken when growing only
+		mutable std::mutex		growLock;
+		uint32_t				capacity;
+	};
+}
@@ -3,10 +3,24 @@
 #include <cassert>
 
 #include "NativeContext.h"
+#include "MemoryAllocator.h"
+#include "FileIO.h"
+#include "ChangeTracking.h"
+#include "ComponentRegistry.h"
+#include "Entity.h"
 
 #include "RenderingSystem.h"
 #include "PhysicsSystem.h"
 #include "InputSystem.h"
+#include "IOSystem.h"
+#include "JobSystem.h"
+#include "ModuleScheduler.h"
+#include "EntityCommandBuffer.h"
+#include "SceneSnapshot.h"
+
+#include "TransformComponent.h"
+#include "CameraComponent.h"
+#include "RenderingComponent.h"
 
 namespace tofu
 {
@@ -20,8 +34,14 @@ namespace tofu
 		nativeContext(nullptr),
 		renderingSystem(nullptr),
 		inputSystem(nullptr),
+		ioSystem(nullptr),
+		jobSystem(nullptr),
+		moduleScheduler(nullptr),
 		userModules(),
 		numUserModules(0),
+		frameStats(),
+		statsCallback(nullptr),
+		statsUserData(nullptr),
 		timeCounterFreq(0),
 		startTimeCounter(0),
 		lastTimeCounter(0),
@@ -51,6 +71,18 @@ namespace tofu
 		int32_t err = nativeContext->Init();
 		CHECKED(err);
 
+		// one job thread per core, this one included
+		jobSystem = new JobSystem();
+		CHECKED(jobSystem->Init());
+		moduleScheduler = new ModuleScheduler();
+
+		// packed assets are used when there is an archive, loose files otherwise
+		FileIO::MountPak("assets.pak");
+
+		// initialize io system, assets are read by its threads
+		ioSystem = new IOSystem();
+		CHECKED(ioSystem->Init());
+
 		// initialize rendering system
 		renderingSystem = new RenderingSystem();
 		CHECKED(renderingSystem->Init());
@@ -95,19 +127,58 @@ namespace tofu
 
 			CHECKED(renderingSystem->BeginFrame());
 
-			CHECKED(inputSystem->Update());
+			// callbacks of finished reads may add render commands
+			CHECKED(ioSystem->Update());
 
-			CHECKED(physicsSystem->Update());
+			CHECKED(inputSystem->Update());
 
-			for (uint32_t i = 0; i < numUserModules; i++)
+			// physics and user modules, ones not sharing components are updated in parallel
 			{
-				CHECKED(userModules[i]->Update());
+				Module* modules[MAX_SCHEDULED_MODULES];
+				uint32_t numModules = 0;
+
+				modules[numModules++] = physicsSystem;
+				for (uint32_t i = 0; i < numUserModules; i++)
+				{
+					modules[numModules++] = userModules[i];
+				}
+
+				CHECKED(moduleScheduler->Update(modules, numModules));
 			}
 
+			// structural changes modules recorded while running in parallel
+			CHECKED(EntityCommands::Playback());
+
 			CHECKED(renderingSystem->Update());
 
 			CHECKED(renderingSystem->EndFrame());
 
+#ifdef TF_MEMORY_STATS
+			MemoryAllocator::RecordFrame();
+#endif
+
+			// entities destroyed in this frame go with all of their components
+			CHECKED(Entity::FlushDestroyed());
+
+			// a little sorting of component arrays every frame, so systems walk memory in order
+			CHECKED(renderingSystem->Defragment(COMPONENT_SORT_BUDGET));
+
+			// changes from now on are stamped with next frame
+			ChangeTracking::NextFrame();
+
+			// core utilization of this frame, see JobSystem::GetUtilization()
+			jobSystem->EndFrame();
+
+			frameStats.deltaTime = deltaTime;
+			frameStats.coreUtilization = jobSystem->GetUtilization();
+			frameStats.numThreads = jobSystem->GetNumThreads();
+			frameStats.maxParallelism = moduleScheduler->GetMaxParallelism();
+
+			if (nullptr != statsCallback)
+			{
+				statsCallback(frameStats, statsUserData);
+			}
+
 			// frame ends
 		}
 
@@ -120,14 +191,41 @@ namespace tofu
 		return nativeContext->QuitApplication();
 	}
 
+	int32_t Engine::AddSnapshotTypes(SceneSnapshot& snapshot)
+	{
+		CHECKED(TransformComponentData::AddSnapshotType(snapshot));
+		CHECKED(CameraComponentData::AddSnapshotType(snapshot));
+		CHECKED(RenderingComponentData::AddSnapshotType(snapshot));
+		return renderingSystem->AddSnapshotAssets(snapshot);
+	}
+
+	void Engine::SetFrameStatsCallback(FrameStatsCallback callback, void* userData)
+	{
+		statsCallback = callback;
+		statsUserData = userData;
+	}
+
 	int32_t Engine::Shutdown()
 	{
+#ifdef TF_MEMORY_STATS
+		// usage of the whole run, for sizing the arenas
+		MemoryAllocator::DumpStats("memory_stats.txt");
+#endif
+
 		for (uint32_t i = 0; i < numUserModules; i++)
 		{
 			CHECKED(userModules[i]->Shutdown());
 			delete userModules[i];
 		}
 
+		// components may hold level heap memory, rendering system shuts it down
+		Entity::FlushDestroyed();
+		ComponentRegistry::RemoveAll();
+
+		// reads in flight go to level heap, so it stops before rendering system
+		CHECKED(ioSystem->Shutdown());
+		delete ioSystem;
+
 		CHECKED(inputSystem->Shutdown());
 		delete inputSystem;
 
@@ -137,6 +235,15 @@ namespace tofu
 		CHECKED(renderingSystem->Shutdown());
 		delete renderingSystem;
 
+		// models point into mapped archive until rendering system is gone
+		CHECKED(FileIO::UnmountPaks());
+
+		delete moduleScheduler;
+
+		// no job is running once modules are shut down
+		CHECKED(jobSystem->Shutdown());
+		delete jobSystem;
+
 		CHECKED(nativeContext->Shutdown());
 		delete nativeContext;
 
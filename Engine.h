@@ -10,6 +10,10 @@ namespace tofu
 	class ScriptingSystem;
 	class PhysicsSystem;
 	class InputSystem;
+	class IOSystem;
+	class JobSystem;
+	class ModuleScheduler;
+	class SceneSnapshot;
 
 	class Time
 	{
@@ -18,6 +22,19 @@ namespace tofu
 		static float DeltaTime;
 	};
 
+	// measures of a frame, handed to FrameStatsCallback at its end
+	struct FrameStats
+	{
+		float		deltaTime;
+		// fraction of time job threads spent running jobs, see JobSystem::GetUtilization()
+		float		coreUtilization;
+		uint32_t	numThreads;
+		// modules updated at the same time, see ModuleScheduler::GetMaxParallelism()
+		uint32_t	maxParallelism;
+	};
+
+	typedef void(*FrameStatsCallback)(const FrameStats& stats, void* userData);
+
 	class Engine
 	{
 		SINGLETON_DECL(Engine)
@@ -33,6 +50,15 @@ namespace tofu
 
 		int32_t Quit();
 
+		// engine components and models created so far, for saving and loading scenes.
+		// call after Init()
+		int32_t AddSnapshotTypes(SceneSnapshot& snapshot);
+
+		// called at end of every frame, for logging or on screen stats
+		void SetFrameStatsCallback(FrameStatsCallback callback, void* userData);
+
+		const FrameStats& GetFrameStats() const { return frameStats; }
+
 	private:
 
 		int32_t Shutdown();
@@ -43,10 +69,17 @@ namespace tofu
 		RenderingSystem*	renderingSystem;
 		PhysicsSystem*		physicsSystem;
 		InputSystem*		inputSystem;
+		IOSystem*			ioSystem;
+		JobSystem*			jobSystem;
+		ModuleScheduler*	moduleScheduler;
 
 		Module*				userModules[MAX_USER_MODULES];
 		uint32_t			numUserModules;
 
+		FrameStats			frameStats;
+		FrameStatsCallback	statsCallback;
+		void*				statsUserData;
+
 	private:
 		int64_t				timeCounterFreq;
 		int64_t				startTimeCounter;
@@ -1,19 +1,40 @@
 #include "Entity.h"
+#include "ComponentRegistry.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace tofu
 {
-	HandleAllocator<Entity, MAX_ENTITIES> Entity::entityAlloc;
+	ConcurrentHandleAllocator<Entity, MAX_ENTITIES> Entity::entityAlloc;
+
+	PagedArray<Entity> Entity::pendingDestroy;
+	ChangeSet Entity::pendingDestroySet;
+	uint32_t Entity::numPendingDestroy = 0;
 
 	int32_t Entity::Destroy()
 	{
-		assert(!*this);
+		if (!*this)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (!pendingDestroy.IsReserved())
+		{
+			uint32_t capacity = entityAlloc.GetCapacity();
+			CHECKED(pendingDestroy.Reserve(capacity));
+			CHECKED(pendingDestroySet.Reserve(capacity));
+		}
 
-		entityAlloc.Free(*this);
+		CHECKED(pendingDestroySet.Grow(Index() + 1));
 
-		// TODO remove all components;
-		assert(false && "not implemented yet");
+		if (!pendingDestroySet.Add(Index()))
+		{
+			return TF_OK;
+		}
+
+		CHECKED(pendingDestroy.Grow(numPendingDestroy + 1));
+		pendingDestroy[numPendingDestroy++] = *this;
 
 		return TF_OK;
 	}
@@ -23,4 +44,56 @@ namespace tofu
 		return Entity(entityAlloc.Allocate());
 	}
 
-}
\ No newline at end of file
+	int32_t Entity::CreateBatch(Entity* entities, uint32_t count)
+	{
+		uint32_t numCreated = entityAlloc.Allocate(entities, count);
+
+		if (numCreated < count)
+		{
+			for (uint32_t i = 0; i < numCreated; i++)
+			{
+				entityAlloc.Free(entities[i]);
+			}
+			return TF_UNKNOWN_ERR;
+		}
+
+		return TF_OK;
+	}
+
+	int32_t Entity::FlushDestroyed()
+	{
+		if (0 == numPendingDestroy)
+		{
+			return TF_OK;
+		}
+
+		Entity* entities = pendingDestroy.GetData();
+		uint32_t count = numPendingDestroy;
+
+		// storages walk their index tables forward
+		std::sort(entities, entities + count, [](Entity a, Entity b) { return a.Index() < b.Index(); });
+
+		ComponentRegistry::DestroyEntities(entities, count);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			entityAlloc.Free(entities[i]);
+		}
+
+		pendingDestroySet.Clear();
+		numPendingDestroy = 0;
+
+		return TF_OK;
+	}
+
+	int32_t Entity::SetCapacity(uint32_t maxEntities)
+	{
+		return entityAlloc.SetCapacity(maxEntities);
+	}
+
+	uint32_t Entity::GetCapacity()
+	{
+		return entityAlloc.GetCapacity();
+	}
+
+}
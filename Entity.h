@@ -1,7 +1,8 @@
 #pragma once
 
-#include "common.h"
-#include "HandleAllocator.h"
+#include "Common.h"
+#include "ConcurrentHandleAllocator.h"
+#include "ChangeTracking.h"
 
 namespace tofu
 {
@@ -9,16 +10,18 @@ namespace tofu
 	class Component;
 
 	// Entity just contans an id
-	// and we can find its component directly by this id
+	// and we can find its component directly by index part of this id
 	class Entity
 	{
 	public:
 		uint32_t	id;
 
-		Entity(uint32_t _id = MAX_ENTITIES) : id(_id) {}
+		Entity(uint32_t _id = UINT32_MAX) : id(_id) {}
 
-		// if this eneity is valid
-		inline operator bool() const { return entityAlloc.IsValid(id); }
+		// if this eneity is valid, false for a destroyed entity even if its slot is reused
+		inline operator bool() const { return entityAlloc.IsValid(*this); }
+
+		TF_INLINE uint32_t Index() const { return id & HANDLE_INDEX_MASK; }
 
 		template<class T>
 		Component<typename T::component_data_t> AddComponent()
@@ -41,13 +44,39 @@ namespace tofu
 			return Component<typename T::component_data_t>(*this);
 		}
 
+		// entity and all of its components are destroyed at end of frame (FlushDestroyed()),
+		// until then it stays valid. destroying it again before that does nothing.
+		// main thread only
 		int32_t Destroy();
 
 		// create a new entity
 		static Entity Create();
 
+		// create count entities into entities, ids are taken in runs rather than one by one.
+		// none is created if there is no room for all of them
+		static int32_t CreateBatch(Entity* entities, uint32_t count);
+
+		// destroy entities given to Destroy() since last flush, called by engine at end of frame.
+		// components are removed one type at a time, in order of entity index
+		static int32_t FlushDestroyed();
+
+		// entities waiting for FlushDestroyed()
+		static uint32_t GetNumPendingDestroy() { return numPendingDestroy; }
+
+		// most entities alive at once, MAX_ENTITIES by default.
+		// it can only be changed before the first entity is created,
+		// component storage reserves address space for this many
+		static int32_t SetCapacity(uint32_t maxEntities);
+
+		static uint32_t GetCapacity();
+
 	private:
-		// entity id allocator
-		static HandleAllocator<Entity, MAX_ENTITIES> entityAlloc;
+		// entity id allocator, entities can be created on any thread
+		static ConcurrentHandleAllocator<Entity, MAX_ENTITIES> entityAlloc;
+
+		// entities to destroy, and their indices so none is added twice
+		static PagedArray<Entity> pendingDestroy;
+		static ChangeSet pendingDestroySet;
+		static uint32_t numPendingDestroy;
 	};
 }
\ No newline at end of file
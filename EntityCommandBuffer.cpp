@@ -0,0 +1,130 @@
+#include "EntityCommandBuffer.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tofu
+{
+	EntityCommandBuffer EntityCommands::buffers[MAX_JOB_THREADS];
+
+	EntityCommandBuffer::EntityCommandBuffer()
+		:
+		data(),
+		size(0),
+		segments(),
+		numSegments(0),
+		sortKey(0),
+		numCommands(0)
+	{
+	}
+
+	void EntityCommandBuffer::SetSortKey(uint32_t key)
+	{
+		Job* job = JobSystem::GetCurrentJob();
+		if (nullptr != job)
+		{
+			job->sortKey = key;
+		}
+		else
+		{
+			sortKey = key;
+		}
+	}
+
+	uint32_t EntityCommandBuffer::GetSortKey() const
+	{
+		Job* job = JobSystem::GetCurrentJob();
+		return nullptr != job ? job->sortKey : sortKey;
+	}
+
+	void EntityCommandBuffer::Replay(const Segment& segment)
+	{
+		uint32_t offset = segment.begin;
+		while (offset < segment.end)
+		{
+			Command* cmd = reinterpret_cast<Command*>(data.GetData() + offset);
+			offset += cmd->size;
+			cmd->apply(cmd);
+		}
+	}
+
+	void EntityCommandBuffer::Reset()
+	{
+		size = 0;
+		numSegments = 0;
+		sortKey = 0;
+		numCommands = 0;
+	}
+
+	EntityCommandBuffer& EntityCommands::Get()
+	{
+		JobSystem* jobSystem = JobSystem::instance();
+		uint32_t index = nullptr != jobSystem ? jobSystem->GetThreadIndex() : 0;
+
+		assert((nullptr == jobSystem || UINT32_MAX != index) && "thread is not of job system");
+		if (UINT32_MAX == index)
+		{
+			index = 0;
+		}
+
+		return buffers[index];
+	}
+
+	int32_t EntityCommands::Playback()
+	{
+		// segments of each buffer by key, recording order is kept for the same key
+		uint32_t cursors[MAX_JOB_THREADS];
+
+		for (uint32_t i = 0; i < MAX_JOB_THREADS; i++)
+		{
+			EntityCommandBuffer& buf = buffers[i];
+			cursors[i] = 0;
+
+			if (buf.numSegments > 1)
+			{
+				EntityCommandBuffer::Segment* segs = buf.segments.GetData();
+				std::sort(segs, segs + buf.numSegments, [](const EntityCommandBuffer::Segment& a, const EntityCommandBuffer::Segment& b)
+				{
+					return a.key < b.key || (a.key == b.key && a.begin < b.begin);
+				});
+			}
+		}
+
+		// merge buffers, lowest key first, lower thread index first for the same key
+		while (true)
+		{
+			uint32_t next = UINT32_MAX;
+			uint32_t nextKey = 0;
+
+			for (uint32_t i = 0; i < MAX_JOB_THREADS; i++)
+			{
+				EntityCommandBuffer& buf = buffers[i];
+				if (cursors[i] < buf.numSegments)
+				{
+					uint32_t key = buf.segments[cursors[i]].key;
+					if (UINT32_MAX == next || key < nextKey)
+					{
+						next = i;
+						nextKey = key;
+					}
+				}
+			}
+
+			if (UINT32_MAX == next)
+			{
+				break;
+			}
+
+			EntityCommandBuffer& buf = buffers[next];
+			buf.Replay(buf.segments[cursors[next]++]);
+		}
+
+		for (uint32_t i = 0; i < MAX_JOB_THREADS; i++)
+		{
+			buffers[i].Reset();
+		}
+
+		return TF_OK;
+	}
+}
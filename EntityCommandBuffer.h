@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Common.h"
+#include "Component.h"
+#include "Entity.h"
+#include "PagedArray.h"
+
+#include <new>
+#include <utility>
+
+namespace tofu
+{
+	// structural changes (adding and removing components, destroying entities) recorded
+	// on one thread, to be replayed on main thread when no system is running.
+	// commands are replayed in order of sort key, then in order recorded.
+	// commands of entities destroyed in between are skipped
+	class EntityCommandBuffer
+	{
+	public:
+		EntityCommandBuffer();
+
+		EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+		EntityCommandBuffer& operator = (const EntityCommandBuffer&) = delete;
+
+		// key of commands recorded from now on by the running job (Job::sortKey, which is
+		// first index of a ParallelFor batch by default), or by main thread outside of jobs.
+		// a job's commands are replayed in the same place whichever thread ran it,
+		// a key set by one job doesn't carry over to the next job on the thread
+		void SetSortKey(uint32_t key);
+
+		// entity id is taken now, it has no component until replay
+		Entity CreateEntity() { return Entity::Create(); }
+
+		// T is a handle type, like TransformComponent
+		template<class T>
+		int32_t AddComponent(Entity e)
+		{
+			return Record(e, [](Entity e) { e.AddComponent<T>(); });
+		}
+
+		// init(T::component_data_t&) is called on the new component at replay,
+		// it is copied into the buffer
+		template<class T, class Func>
+		int32_t AddComponent(Entity e, const Func& init)
+		{
+			return Record(e, [init](Entity e)
+			{
+				Component<typename T::component_data_t> c = e.AddComponent<T>();
+				if (c)
+				{
+					init(*c.operator->());
+				}
+			});
+		}
+
+		template<class T>
+		int32_t RemoveComponent(Entity e)
+		{
+			return Record(e, [](Entity e)
+			{
+				Component<typename T::component_data_t> c = e.GetComponent<T>();
+				if (c)
+				{
+					c.Destroy();
+				}
+			});
+		}
+
+		// Entity::Destroy() at replay, so it goes at end of that frame
+		int32_t DestroyEntity(Entity e)
+		{
+			return Record(e, [](Entity e) { e.Destroy(); });
+		}
+
+		uint32_t GetNumCommands() const { return numCommands; }
+
+	private:
+		friend class EntityCommands;
+
+		// each command starts with this, the operation follows it
+		struct alignas(16) Command
+		{
+			// run the operation and destruct it
+			void		(*apply)(Command* cmd);
+			Entity		entity;
+			// bytes to next command
+			uint32_t	size;
+		};
+
+		// commands of one sort key recorded in a row
+		struct Segment
+		{
+			uint32_t	key;
+			uint32_t	begin;
+			uint32_t	end;
+		};
+
+		template<class Op>
+		int32_t Record(Entity e, Op&& op);
+
+		// key of running job, or the one set outside of jobs
+		uint32_t GetSortKey() const;
+
+		// replay commands of a segment
+		void Replay(const Segment& segment);
+
+		void Reset();
+
+	private:
+		PagedArray<uint8_t>		data;
+		uint32_t				size;
+
+		PagedArray<Segment>		segments;
+		uint32_t				numSegments;
+
+		// key set outside of jobs
+		uint32_t				sortKey;
+		uint32_t				numCommands;
+	};
+
+	// one command buffer per JobSystem thread, systems record to the buffer of the thread
+	// they are running on without any lock, engine replays all of them after systems are updated
+	class EntityCommands
+	{
+	public:
+		// buffer of calling thread, main thread's when job system isn't running.
+		// threads not of job system must not record
+		static EntityCommandBuffer& Get();
+
+		// replay and empty all buffers, on main thread with no job running.
+		// commands of the same sort key go in order of thread index
+		static int32_t Playback();
+
+	private:
+		static EntityCommandBuffer buffers[MAX_JOB_THREADS];
+	};
+
+	template<class Op>
+	int32_t EntityCommandBuffer::Record(Entity e, Op&& op)
+	{
+		typedef typename std::decay<Op>::type op_t;
+
+		struct Packet
+		{
+			Command		cmd;
+			op_t		op;
+
+			static void Apply(Command* cmd)
+			{
+				Packet* p = reinterpret_cast<Packet*>(cmd);
+				if (p->cmd.entity)
+				{
+					p->op(p->cmd.entity);
+				}
+				p->~Packet();
+			}
+		};
+
+		static_assert(alignof(Packet) <= alignof(Command), "operation is over aligned");
+
+		if (!data.IsReserved())
+		{
+			CHECKED(data.Reserve(ENTITY_COMMAND_BUFFER_SIZE));
+			CHECKED(segments.Reserve(MAX_ENTITY_COMMAND_SEGMENTS));
+		}
+
+		uint32_t packetSize = (sizeof(Packet) + alignof(Command) - 1) / alignof(Command) * alignof(Command);
+		uint32_t offset = size;
+
+		CHECKED(data.Grow(offset + packetSize));
+
+		// continue the last segment if the key is the same
+		uint32_t key = GetSortKey();
+		if (0 == numSegments || segments[numSegments - 1].key != key)
+		{
+			CHECKED(segments.Grow(numSegments + 1));
+			segments[numSegments++] = { key, offset, offset };
+		}
+
+		Packet* p = new (data.GetData() + offset) Packet{ Command{ &Packet::Apply, e, packetSize }, std::forward<Op>(op) };
+		(void)p;
+
+		size = offset + packetSize;
+		segments[numSegments - 1].end = size;
+		numCommands++;
+
+		return TF_OK;
+	}
+}
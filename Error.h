@@ -10,6 +10,9 @@ namespace tofu
 		TF_OK = 0,
 
 		TF_CONFIG_LOADING_FAILED,
+
+		// request was cancelled before it completed
+		TF_CANCELLED,
 	};
 
 	
@@ -0,0 +1,579 @@
+#include "FileIO.h"
+
+#include "Compression.h"
+#include "MemoryAllocator.h"
+#include "PageAllocator.h"
+#include "PakFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	using tofu::FileMapping;
+	using tofu::pak::PakEntry;
+
+	constexpr uint32_t MaxMountedPaks = 8;
+
+	struct MountedPak
+	{
+		FileMapping			mapping;
+		const PakEntry*		entries;
+		uint32_t			numEntries;
+	};
+
+	// written by MountPak()/UnmountPaks() only, so io threads can search it without locking
+	MountedPak mountedPaks[MaxMountedPaks];
+	uint32_t numMountedPaks = 0;
+
+	const PakEntry* find_entry(const MountedPak& pak, uint64_t hash)
+	{
+		uint32_t first = 0;
+		uint32_t count = pak.numEntries;
+
+		// lower bound in the sorted table
+		while (count > 0)
+		{
+			uint32_t step = count / 2;
+			if (pak.entries[first + step].PathHash < hash)
+			{
+				first += step + 1;
+				count -= step + 1;
+			}
+			else
+			{
+				count = step;
+			}
+		}
+
+		if (first < pak.numEntries && pak.entries[first].PathHash == hash)
+		{
+			return &pak.entries[first];
+		}
+		return nullptr;
+	}
+}
+
+namespace tofu
+{
+	class FileIO::RangeReader
+	{
+	public:
+		RangeReader()
+			:
+			view(nullptr),
+			handle(0),
+			opened(false),
+			storedSize(0),
+			contentSize(0),
+			compressed(false),
+			header(),
+			blocks(nullptr),
+			blocksAllocated(false),
+			staging(nullptr),
+			blockBuffer(nullptr),
+			cachedBlock(UINT32_MAX)
+		{}
+
+		~RangeReader()
+		{
+			PageAllocator pages;
+			if (blocksAllocated)
+			{
+				pages.Deallocate(const_cast<compressed::CompressedBlock*>(blocks), sizeof(compressed::CompressedBlock) * header.NumBlocks);
+			}
+			pages.Deallocate(staging, header.BlockSize);
+			pages.Deallocate(blockBuffer, header.BlockSize);
+
+			if (opened)
+			{
+				CloseLooseFile(handle);
+			}
+		}
+
+		int32_t Open(const char* file)
+		{
+			const void* data = nullptr;
+			if (FindInPaks(file, &data, &storedSize))
+			{
+				view = reinterpret_cast<const uint8_t*>(data);
+			}
+			else
+			{
+				CHECKED(OpenLooseFile(file, &handle, &storedSize));
+				opened = true;
+			}
+
+			contentSize = storedSize;
+
+			if (storedSize < sizeof(header))
+			{
+				return TF_OK;
+			}
+
+			CHECKED(ReadStored(0, sizeof(header), &header));
+
+			if (!Compression::IsCompressedFile(&header, sizeof(header)))
+			{
+				header = compressed::CompressedHeader();
+				return TF_OK;
+			}
+
+			if (!Compression::CheckBlockTable(&header, storedSize))
+			{
+				header = compressed::CompressedHeader();
+				return TF_UNKNOWN_ERR;
+			}
+
+			compressed = true;
+			contentSize = static_cast<size_t>(header.UncompressedSize);
+
+			PageAllocator pages;
+			size_t tableSize = sizeof(compressed::CompressedBlock) * header.NumBlocks;
+
+			if (nullptr != view)
+			{
+				blocks = reinterpret_cast<const compressed::CompressedBlock*>(view + sizeof(header));
+			}
+			else if (tableSize > 0)
+			{
+				void* table = pages.Allocate(tableSize, PageAllocator::GetPageSize());
+				if (nullptr == table)
+				{
+					return TF_UNKNOWN_ERR;
+				}
+				blocks = reinterpret_cast<const compressed::CompressedBlock*>(table);
+				blocksAllocated = true;
+
+				CHECKED(ReadStored(sizeof(header), tableSize, table));
+
+				// loose file blocks are read here before being decoded
+				staging = reinterpret_cast<uint8_t*>(pages.Allocate(header.BlockSize, PageAllocator::GetPageSize()));
+				if (nullptr == staging)
+				{
+					return TF_UNKNOWN_ERR;
+				}
+			}
+
+			// for blocks only partly covered by a range
+			blockBuffer = reinterpret_cast<uint8_t*>(pages.Allocate(header.BlockSize, PageAllocator::GetPageSize()));
+			if (nullptr == blockBuffer)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			return TF_OK;
+		}
+
+		TF_INLINE size_t GetSize() const { return contentSize; }
+
+		int32_t Read(size_t offset, size_t size, void* dst)
+		{
+			if (offset > contentSize || size > contentSize - offset)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			if (!compressed)
+			{
+				return ReadStored(offset, size, dst);
+			}
+
+			uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+			size_t blockSize = header.BlockSize;
+
+			while (size > 0)
+			{
+				uint32_t block = static_cast<uint32_t>(offset / blockSize);
+				size_t blockStart = static_cast<size_t>(block) * blockSize;
+				size_t rawSize = contentSize - blockStart < blockSize ? contentSize - blockStart : blockSize;
+				size_t start = offset - blockStart;
+				size_t count = size < rawSize - start ? size : rawSize - start;
+
+				if (0 == start && count == rawSize)
+				{
+					// whole block is decoded straight into destination
+					CHECKED(DecodeBlock(block, out, rawSize));
+				}
+				else
+				{
+					// keep the block, next chunk of a stream is most likely in it too
+					if (cachedBlock != block)
+					{
+						cachedBlock = UINT32_MAX;
+						CHECKED(DecodeBlock(block, blockBuffer, rawSize));
+						cachedBlock = block;
+					}
+					std::memcpy(out, blockBuffer + start, count);
+				}
+
+				out += count;
+				offset += count;
+				size -= count;
+			}
+
+			return TF_OK;
+		}
+
+	private:
+		int32_t ReadStored(size_t offset, size_t size, void* dst)
+		{
+			if (offset > storedSize || size > storedSize - offset)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			if (nullptr != view)
+			{
+				std::memcpy(dst, view + offset, size);
+				return TF_OK;
+			}
+
+			return 0 == size ? TF_OK : ReadLooseFileAt(handle, offset, size, dst);
+		}
+
+		int32_t DecodeBlock(uint32_t i, void* dst, size_t rawSize)
+		{
+			const compressed::CompressedBlock& block = blocks[i];
+
+			if (block.Offset > storedSize || block.CompressedSize > storedSize - block.Offset)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			const void* src = staging;
+			if (nullptr != view)
+			{
+				src = view + block.Offset;
+			}
+			else
+			{
+				// a block never gets bigger than BlockSize, it would be stored otherwise
+				if (block.CompressedSize > header.BlockSize)
+				{
+					return TF_UNKNOWN_ERR;
+				}
+				CHECKED(ReadStored(static_cast<size_t>(block.Offset), block.CompressedSize, staging));
+			}
+
+			return Compression::DecompressFileBlock(block, src, dst, rawSize);
+		}
+
+		// pak entry, or null for a loose file
+		const uint8_t*							view;
+		intptr_t								handle;
+		bool									opened;
+
+		// size of file as stored, and its content
+		size_t									storedSize;
+		size_t									contentSize;
+
+		bool									compressed;
+		compressed::CompressedHeader			header;
+		const compressed::CompressedBlock*		blocks;
+		bool									blocksAllocated;
+		uint8_t*								staging;
+		uint8_t*								blockBuffer;
+		uint32_t								cachedBlock;
+	};
+
+	int32_t FileIO::ReadFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo)
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[allocNo];
+
+		const void* src = nullptr;
+		size_t srcSize = 0;
+		bool packed = FindInPaks(file, &src, &srcSize);
+
+		if (!packed)
+		{
+			CHECKED(ReadLooseFile(file, data, size, alignment, allocNo));
+
+			if (!Compression::IsCompressedFile(*data, *size))
+			{
+				return TF_OK;
+			}
+
+			// loose compressed file is decoded out of the block just read,
+			// bump allocators only get this block back on reset
+			src = *data;
+			srcSize = *size;
+		}
+
+		bool compressed = Compression::IsCompressedFile(src, srcSize);
+		size_t dstSize = compressed ? Compression::GetUncompressedSize(src) : srcSize;
+
+		int32_t err = TF_OK;
+
+		// compressed blocks are decoded right into their destination
+		void* ptr = alloc.Allocate(dstSize, alignment);
+		if (nullptr == ptr)
+		{
+			err = TF_UNKNOWN_ERR;
+		}
+		else if (compressed)
+		{
+			err = Decompress(src, srcSize, ptr, dstSize);
+		}
+		else
+		{
+			std::memcpy(ptr, src, srcSize);
+		}
+
+		if (!packed)
+		{
+			alloc.Deallocate(const_cast<void*>(src));
+		}
+
+		if (TF_OK != err)
+		{
+			// only heap allocators really give it back
+			alloc.Deallocate(ptr);
+			return err;
+		}
+
+		*data = ptr;
+		*size = dstSize;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::MapFile(const char* file, FileMapping* mapping)
+	{
+		FileMapping view = {};
+
+		if (FindInPaks(file, &view.data, &view.size))
+		{
+			// view into the archive mapping, nothing to map
+			if (0 == view.size)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+		}
+		else
+		{
+			CHECKED(MapLooseFile(file, &view));
+		}
+
+		if (!Compression::IsCompressedFile(view.data, view.size))
+		{
+			*mapping = view;
+			return TF_OK;
+		}
+
+		size_t dstSize = Compression::GetUncompressedSize(view.data);
+		void* ptr = 0 == dstSize ? nullptr : PageAllocator().Allocate(dstSize, PageAllocator::GetPageSize());
+
+		int32_t err = nullptr == ptr ? TF_UNKNOWN_ERR : Decompress(view.data, view.size, ptr, dstSize);
+
+		if (!IsInPaks(view.data))
+		{
+			UnmapLooseFile(&view);
+		}
+
+		if (TF_OK != err)
+		{
+			PageAllocator().Deallocate(ptr, dstSize);
+			return err;
+		}
+
+		mapping->data = ptr;
+		mapping->size = dstSize;
+		mapping->decoded = true;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::UnmapFile(FileMapping* mapping)
+	{
+		if (nullptr == mapping->data)
+		{
+			return TF_OK;
+		}
+
+		if (mapping->decoded)
+		{
+			CHECKED(PageAllocator().Deallocate(const_cast<void*>(mapping->data), mapping->size));
+		}
+		else if (!IsInPaks(mapping->data))
+		{
+			return UnmapLooseFile(mapping);
+		}
+
+		mapping->data = nullptr;
+		mapping->size = 0;
+		mapping->decoded = false;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::WriteFile(const char* file, const void* data, size_t size)
+	{
+		FILE* fp = fopen(file, "wb");
+		if (nullptr == fp)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		bool written = 0 == size || 1 == fwrite(data, size, 1, fp);
+
+		// data may still be buffered until it is closed
+		if (0 != fclose(fp) || !written)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::GetFileSize(const char* file, size_t* size)
+	{
+		RangeReader reader;
+		CHECKED(reader.Open(file));
+
+		*size = reader.GetSize();
+		return TF_OK;
+	}
+
+	int32_t FileIO::ReadRange(const char* file, size_t offset, size_t size, void* dst)
+	{
+		RangeReader reader;
+		CHECKED(reader.Open(file));
+
+		return reader.Read(offset, size, dst);
+	}
+
+	int32_t FileIO::StreamFile(const char* file, size_t offset, size_t size, void* buffer, size_t chunkSize, StreamCallback callback, void* userData)
+	{
+		if (0 == chunkSize || nullptr == callback)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		RangeReader reader;
+		CHECKED(reader.Open(file));
+
+		if (offset > reader.GetSize() || size > reader.GetSize() - offset)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		// file is opened once and every chunk goes through the same buffer
+		for (size_t end = offset + size; offset < end; )
+		{
+			size_t count = end - offset < chunkSize ? end - offset : chunkSize;
+
+			CHECKED(reader.Read(offset, count, buffer));
+			CHECKED(callback(buffer, offset, count, userData));
+
+			offset += count;
+		}
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::MountPak(const char* file)
+	{
+		if (numMountedPaks >= MaxMountedPaks)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		FileMapping mapping = {};
+		CHECKED(MapLooseFile(file, &mapping));
+
+		const uint8_t* base = reinterpret_cast<const uint8_t*>(mapping.data);
+		const pak::PakHeader* header = reinterpret_cast<const pak::PakHeader*>(base);
+		const PakEntry* entries = reinterpret_cast<const PakEntry*>(header + 1);
+
+		bool valid = mapping.size >= sizeof(pak::PakHeader)
+			&& header->Magic == pak::PAK_FILE_MAGIC
+			&& header->Version == pak::PAK_FILE_VERSION
+			&& header->NumEntries <= (mapping.size - sizeof(pak::PakHeader)) / sizeof(PakEntry);
+
+		// every entry has to be inside the archive, and table sorted for binary search
+		for (uint32_t i = 0; valid && i < header->NumEntries; i++)
+		{
+			valid = entries[i].Offset <= mapping.size
+				&& entries[i].Size <= mapping.size - entries[i].Offset
+				&& (i == 0 || entries[i - 1].PathHash < entries[i].PathHash);
+		}
+
+		if (!valid)
+		{
+			UnmapLooseFile(&mapping);
+			return TF_UNKNOWN_ERR;
+		}
+
+		MountedPak& pak = mountedPaks[numMountedPaks++];
+		pak.mapping = mapping;
+		pak.entries = entries;
+		pak.numEntries = header->NumEntries;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::UnmountPaks()
+	{
+		int32_t ret = TF_OK;
+
+		for (uint32_t i = 0; i < numMountedPaks; i++)
+		{
+			if (TF_OK != UnmapLooseFile(&mountedPaks[i].mapping))
+			{
+				ret = TF_UNKNOWN_ERR;
+			}
+			mountedPaks[i] = MountedPak();
+		}
+		numMountedPaks = 0;
+
+		return ret;
+	}
+
+	bool FileIO::FindInPaks(const char* file, const void** data, size_t* size)
+	{
+		if (0 == numMountedPaks)
+		{
+			return false;
+		}
+
+		uint64_t hash = pak::HashPath(file);
+
+		// later mounted archives override earlier ones
+		for (uint32_t i = numMountedPaks; i > 0; i--)
+		{
+			const MountedPak& pak = mountedPaks[i - 1];
+
+			const PakEntry* entry = find_entry(pak, hash);
+			if (nullptr != entry)
+			{
+				*data = reinterpret_cast<const uint8_t*>(pak.mapping.data) + entry->Offset;
+				*size = static_cast<size_t>(entry->Size);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int32_t FileIO::Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize)
+	{
+		uint32_t numThreads = std::thread::hardware_concurrency();
+		return Compression::DecompressFile(src, srcSize, dst, dstSize, numThreads > 0 ? numThreads : 1);
+	}
+
+	bool FileIO::IsInPaks(const void* ptr)
+	{
+		uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+
+		for (uint32_t i = 0; i < numMountedPaks; i++)
+		{
+			uintptr_t base = reinterpret_cast<uintptr_t>(mountedPaks[i].mapping.data);
+			if (addr >= base && addr - base < mountedPaks[i].mapping.size)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
@@ -2,12 +2,84 @@
 
 #include "Common.h"
 
+#include <cstddef>
+
 namespace tofu
 {
+	// read-only view of a whole file mapped into memory,
+	// valid until FileIO::UnmapFile() is called with it
+	struct FileMapping
+	{
+		const void*		data;
+		size_t			size;
+		// compressed file decoded into pages of its own
+		bool			decoded;
+	};
+
+	// called with every chunk of FileIO::StreamFile() in order, offset is from the beginning of the file,
+	// returning anything but TF_OK stops the stream
+	typedef int32_t(*StreamCallback)(const void* data, size_t offset, size_t size, void* userData);
+
+	// files are looked up in mounted pak archives first,
+	// then read from disk as loose files.
+	// compressed files (Compression.h) are decompressed transparently
 	class FileIO
 	{
 	public:
 		// read a file to a new allocated memory from allocator[allocNo]
 		static int32_t ReadFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo);
+
+		// map a file into memory without copying it, pages are loaded from page cache on first touch,
+		// data is page aligned, empty files can not be mapped.
+		// a compressed file is decoded into new pages instead
+		static int32_t MapFile(const char* file, FileMapping* mapping);
+
+		static int32_t UnmapFile(FileMapping* mapping);
+
+		// write data to a loose file on disk, replacing what it had
+		static int32_t WriteFile(const char* file, const void* data, size_t size);
+
+		// size of file content, which is the decompressed size for compressed files
+		static int32_t GetFileSize(const char* file, size_t* size);
+
+		// read [offset, offset + size) of a file to memory provided by caller,
+		// only blocks covering the range are decoded for compressed files
+		static int32_t ReadRange(const char* file, size_t offset, size_t size, void* dst);
+
+		// read [offset, offset + size) of a file through a buffer of chunkSize bytes,
+		// callback gets every chunk, so memory used doesn't grow with the file
+		static int32_t StreamFile(const char* file, size_t offset, size_t size, void* buffer, size_t chunkSize, StreamCallback callback, void* userData);
+
+		// map a pak archive (see PakFormat.h) as a whole, its entries are found
+		// by path hash and read without opening any other file.
+		// mount before any read is queued, and unmount after every view of it is unmapped
+		static int32_t MountPak(const char* file);
+
+		static int32_t UnmountPaks();
+
+	private:
+		// reads parts of a file, FileIO.cpp
+		class RangeReader;
+
+		// find a file in mounted archives, data points into the archive mapping
+		static bool FindInPaks(const char* file, const void** data, size_t* size);
+
+		static bool IsInPaks(const void* ptr);
+
+		// decode a compressed file on several threads
+		static int32_t Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+		// platform part, FileIOWin32.cpp or FileIOPosix.cpp
+		static int32_t ReadLooseFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo);
+
+		static int32_t MapLooseFile(const char* file, FileMapping* mapping);
+
+		static int32_t UnmapLooseFile(FileMapping* mapping);
+
+		static int32_t OpenLooseFile(const char* file, intptr_t* handle, size_t* size);
+
+		static int32_t ReadLooseFileAt(intptr_t handle, size_t offset, size_t size, void* dst);
+
+		static int32_t CloseLooseFile(intptr_t handle);
 	};
 }
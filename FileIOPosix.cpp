@@ -0,0 +1,180 @@
+#include "FileIO.h"
+
+#include "MemoryAllocator.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+
+namespace
+{
+	int open_file(const char* file, size_t* size)
+	{
+		int fd = open(file, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			return -1;
+		}
+
+		struct stat st;
+		if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode))
+		{
+			close(fd);
+			return -1;
+		}
+
+		*size = static_cast<size_t>(st.st_size);
+		return fd;
+	}
+}
+
+namespace tofu
+{
+	int32_t FileIO::ReadLooseFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo)
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[allocNo];
+
+		size_t fileSize = 0;
+		int fd = open_file(file, &fileSize);
+		if (fd < 0)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+		// allocate memory for content
+		uint8_t* ptr = reinterpret_cast<uint8_t*>(alloc.Allocate(fileSize, alignment));
+		if (nullptr == ptr)
+		{
+			close(fd);
+			return TF_UNKNOWN_ERR;
+		}
+
+		// read() may return less than asked for
+		size_t offset = 0;
+		while (offset < fileSize)
+		{
+			ssize_t ret = read(fd, ptr + offset, fileSize - offset);
+			if (ret < 0 && EINTR == errno)
+			{
+				continue;
+			}
+
+			if (ret <= 0)
+			{
+				// only heap allocators really give it back
+				alloc.Deallocate(ptr);
+				close(fd);
+				return TF_UNKNOWN_ERR;
+			}
+
+			offset += static_cast<size_t>(ret);
+		}
+
+		close(fd);
+
+		*data = ptr;
+		*size = fileSize;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::OpenLooseFile(const char* file, intptr_t* handle, size_t* size)
+	{
+		int fd = open_file(file, size);
+		if (fd < 0)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		*handle = fd;
+		return TF_OK;
+	}
+
+	int32_t FileIO::ReadLooseFileAt(intptr_t handle, size_t offset, size_t size, void* dst)
+	{
+		uint8_t* ptr = reinterpret_cast<uint8_t*>(dst);
+
+		// pread() doesn't move file offset, and may return less than asked for
+		size_t done = 0;
+		while (done < size)
+		{
+			ssize_t ret = pread(static_cast<int>(handle), ptr + done, size - done, static_cast<off_t>(offset + done));
+			if (ret < 0 && EINTR == errno)
+			{
+				continue;
+			}
+
+			if (ret <= 0)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			done += static_cast<size_t>(ret);
+		}
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::CloseLooseFile(intptr_t handle)
+	{
+		return 0 == close(static_cast<int>(handle)) ? TF_OK : TF_UNKNOWN_ERR;
+	}
+
+	int32_t FileIO::MapLooseFile(const char* file, FileMapping* mapping)
+	{
+		size_t fileSize = 0;
+		int fd = open_file(file, &fileSize);
+		if (fd < 0)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (0 == fileSize)
+		{
+			close(fd);
+			return TF_UNKNOWN_ERR;
+		}
+
+		void* ptr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		// the mapping keeps the file alive by itself
+		close(fd);
+
+		if (MAP_FAILED == ptr)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		// start read-ahead now, the whole file is going to be touched soon
+		madvise(ptr, fileSize, MADV_WILLNEED);
+
+		mapping->data = ptr;
+		mapping->size = fileSize;
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::UnmapLooseFile(FileMapping* mapping)
+	{
+		if (nullptr == mapping->data)
+		{
+			return TF_OK;
+		}
+
+		if (0 != munmap(const_cast<void*>(mapping->data), mapping->size))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		mapping->data = nullptr;
+		mapping->size = 0;
+
+		return TF_OK;
+	}
+}
@@ -4,9 +4,11 @@
 #include <cstdio>
 #include <cstdlib>
 
+#include <Windows.h>
+
 namespace tofu
 {
-	int32_t FileIO::ReadFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo)
+	int32_t FileIO::ReadLooseFile(const char* file, void** data, size_t* size, size_t alignment, uint32_t allocNo)
 	{
 		MemoryAllocator& alloc = MemoryAllocator::Allocators[allocNo];
 
@@ -46,7 +48,8 @@ namespace tofu
 
 		if (1 != fread(ptr, fileSize, 1, fp))
 		{
-			// TODO we cannot deallocate here :(
+			// only heap allocators really give it back
+			alloc.Deallocate(ptr);
 			fclose(fp);
 			return TF_UNKNOWN_ERR;
 		}
@@ -58,4 +61,117 @@ namespace tofu
 
 		return TF_OK;
 	}
+
+	int32_t FileIO::OpenLooseFile(const char* file, intptr_t* handle, size_t* size)
+	{
+		HANDLE fileHandle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (INVALID_HANDLE_VALUE == fileHandle)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+		{
+			CloseHandle(fileHandle);
+			return TF_UNKNOWN_ERR;
+		}
+
+		*handle = reinterpret_cast<intptr_t>(fileHandle);
+		*size = static_cast<size_t>(fileSize.QuadPart);
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::ReadLooseFileAt(intptr_t handle, size_t offset, size_t size, void* dst)
+	{
+		uint8_t* ptr = reinterpret_cast<uint8_t*>(dst);
+
+		// position is given with each read, a single read is limited to 4GB
+		size_t done = 0;
+		while (done < size)
+		{
+			uint64_t position = static_cast<uint64_t>(offset + done);
+
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(position);
+			overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+			DWORD toRead = size - done > 0x40000000u ? 0x40000000u : static_cast<DWORD>(size - done);
+			DWORD read = 0;
+			if (!::ReadFile(reinterpret_cast<HANDLE>(handle), ptr + done, toRead, &read, &overlapped) || 0 == read)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			done += read;
+		}
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::CloseLooseFile(intptr_t handle)
+	{
+		return CloseHandle(reinterpret_cast<HANDLE>(handle)) ? TF_OK : TF_UNKNOWN_ERR;
+	}
+
+	int32_t FileIO::MapLooseFile(const char* file, FileMapping* mapping)
+	{
+		HANDLE fileHandle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (INVALID_HANDLE_VALUE == fileHandle)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || 0 == fileSize.QuadPart
+			|| static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+		{
+			CloseHandle(fileHandle);
+			return TF_UNKNOWN_ERR;
+		}
+
+		HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (nullptr == mappingHandle)
+		{
+			CloseHandle(fileHandle);
+			return TF_UNKNOWN_ERR;
+		}
+
+		void* ptr = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+		// the view keeps file and mapping object alive by itself
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+
+		if (nullptr == ptr)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		mapping->data = ptr;
+		mapping->size = static_cast<size_t>(fileSize.QuadPart);
+
+		return TF_OK;
+	}
+
+	int32_t FileIO::UnmapLooseFile(FileMapping* mapping)
+	{
+		if (nullptr == mapping->data)
+		{
+			return TF_OK;
+		}
+
+		if (!UnmapViewOfFile(mapping->data))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		mapping->data = nullptr;
+		mapping->size = 0;
+
+		return TF_OK;
+	}
 }
@@ -1,76 +1,158 @@
 #pragma once
 
 #include "Common.h"
+#include "PagedArray.h"
 #include <cassert>
 
 namespace tofu
 {
 	// Id allocator, allocate and deallocate at O(1), spatial O(n)
 	// idea is from https://github.com/bkaradzic/bgfx
+	// ids carry a generation (see HANDLE_DECL), a freed handle is never valid again,
+	// even after its slot is reused.
+	// Count is the default capacity, slot tables grow by pages up to capacity as handles are taken
 	template<class Handle, uint32_t Count>
 	class HandleAllocator
 	{
+		// largest index is reserved, so no id is ever UINT32_MAX
+		static_assert(Count > 0 && Count <= HANDLE_INDEX_MASK, "too many handles");
+
 	public:
 		inline HandleAllocator()
 			:
+			capacity(Count),
+			numSlots(0),
 			numInUse(0)
 		{
-			for (uint32_t i = 0; i < Count; ++i)
+		}
+
+		HandleAllocator(const HandleAllocator&) = delete;
+		HandleAllocator& operator = (const HandleAllocator&) = delete;
+
+		// change capacity before first handle is allocated
+		inline int32_t SetCapacity(uint32_t maxCount)
+		{
+			if (0 == maxCount || maxCount > HANDLE_INDEX_MASK || indices.IsReserved())
 			{
-				handles[i] = UINT32_MAX;
-				indices[i] = i;
+				return TF_UNKNOWN_ERR;
 			}
+
+			capacity = maxCount;
+			return TF_OK;
 		}
 
+		inline uint32_t GetCapacity() const { return capacity; }
+
 		inline Handle Allocate()
 		{
-			if (numInUse < Count)
+			if (numInUse == numSlots && TF_OK != Grow())
 			{
-				uint32_t idx = numInUse;
-				uint32_t id = indices[idx];
+				return Handle();
+			}
 
-				assert(handles[id] == UINT32_MAX);
+			uint32_t idx = numInUse;
+			uint32_t id = indices[idx];
 
-				handles[id] = idx;
-				numInUse++;
+			assert(handles[id & HANDLE_INDEX_MASK] == UINT32_MAX);
 
-				return Handle(id);
-			}
-			return Handle();
+			handles[id & HANDLE_INDEX_MASK] = idx;
+			numInUse++;
+
+			return Handle(id);
 		}
 
 		inline void Free(Handle handle)
 		{
-			assert(true == handle);
-
-			uint32_t idx = handles[handle.id];
+			assert(IsValid(handle));
 
-			assert(idx < numInUse);
+			uint32_t slot = handle.id & HANDLE_INDEX_MASK;
+			uint32_t idx = handles[slot];
 
 			uint32_t lastIdx = numInUse - 1;
 			if (idx != lastIdx)
 			{
 				uint32_t lastHandle = indices[lastIdx];
 
-				indices[lastIdx] = handle.id;
-
 				indices[idx] = lastHandle;
-				handles[lastHandle] = idx;
+				handles[lastHandle & HANDLE_INDEX_MASK] = idx;
 			}
 
-			handles[handle.id] = UINT32_MAX;
+			// next generation of this slot, it wraps around after 4096 reuses
+			indices[lastIdx] = handle.id + (1u << HANDLE_INDEX_BITS);
+
+			handles[slot] = UINT32_MAX;
 
 			numInUse--;
 		}
 
 		inline bool IsValid(Handle handle) const
 		{
-			return handles[handle.id] < numInUse;
+			uint32_t slot = handle.id & HANDLE_INDEX_MASK;
+			if (slot >= numSlots)
+			{
+				return false;
+			}
+
+			uint32_t idx = handles[slot];
+			return idx < numInUse && indices[idx] == handle.id;
+		}
+
+		// handles in use are packed at the beginning of indices,
+		// in no particular order, freeing one moves the last one into its place
+		inline uint32_t GetNumInUse() const { return numInUse; }
+
+		inline Handle GetHandle(uint32_t idx) const
+		{
+			assert(idx < numInUse);
+			return Handle(indices[idx]);
+		}
+
+		// give all memory back, every handle becomes invalid, capacity is kept
+		inline void Reset()
+		{
+			handles.Release();
+			indices.Release();
+			numSlots = 0;
+			numInUse = 0;
+		}
+
+	private:
+		// add a page of free slots
+		inline int32_t Grow()
+		{
+			if (numSlots >= capacity)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			if (!indices.IsReserved())
+			{
+				CHECKED(handles.Reserve(capacity));
+				CHECKED(indices.Reserve(capacity));
+			}
+
+			CHECKED(handles.Grow(numSlots + 1));
+			CHECKED(indices.Grow(numSlots + 1));
+
+			uint32_t newSlots = indices.GetNumCommitted();
+			for (uint32_t i = numSlots; i < newSlots; ++i)
+			{
+				handles[i] = UINT32_MAX;
+				indices[i] = i;
+			}
+
+			numSlots = newSlots;
+			return TF_OK;
 		}
 
 	private:
-		uint32_t		handles[Count];
-		uint32_t		indices[Count];
-		uint32_t		numInUse;
+		// slot -> position in indices, UINT32_MAX if not in use
+		PagedArray<uint32_t>	handles;
+		// handle ids, in use ones first, then the ones to give out next
+		PagedArray<uint32_t>	indices;
+		uint32_t				capacity;
+		// slots with committed table entries
+		uint32_t				numSlots;
+		uint32_t				numInUse;
 	};
-}
\ No newline at end of file
+}
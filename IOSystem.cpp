@@ -0,0 +1,281 @@
+#include "IOSystem.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "FileIO.h"
+#include "MemoryAllocator.h"
+
+namespace tofu
+{
+	SINGLETON_IMPL(IOSystem);
+
+	IOSystem::IOSystem()
+		:
+		requestHandleAlloc(),
+		requests(),
+		pending(),
+		finished(),
+		numFinished(0),
+		quit(false)
+	{
+		assert(nullptr == _instance);
+		_instance = this;
+	}
+
+	int32_t IOSystem::Init()
+	{
+		quit = false;
+
+		for (uint32_t i = 0; i < NUM_IO_THREADS; i++)
+		{
+			threads[i] = std::thread(&IOSystem::WorkerThread, this);
+		}
+
+		return TF_OK;
+	}
+
+	int32_t IOSystem::Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		pendingCond.notify_all();
+
+		for (uint32_t i = 0; i < NUM_IO_THREADS; i++)
+		{
+			if (threads[i].joinable())
+			{
+				threads[i].join();
+			}
+		}
+
+		// nobody takes the data of requests finished after last Update()
+		for (uint32_t i = 0; i < numFinished; i++)
+		{
+			Request& req = requests[finished[i]];
+			if (nullptr != req.data)
+			{
+				MemoryAllocator::Allocators[req.allocNo].Deallocate(req.data);
+			}
+		}
+
+		for (uint32_t i = 0; i < MAX_IO_REQUESTS; i++)
+		{
+			requests[i].state = REQUEST_FREE;
+		}
+		requestHandleAlloc.Reset();
+
+		for (uint32_t i = 0; i < MAX_IO_PRIORITIES; i++)
+		{
+			pending[i].count = 0;
+		}
+		numFinished = 0;
+
+		return TF_OK;
+	}
+
+	int32_t IOSystem::Update()
+	{
+		uint32_t ids[MAX_IO_REQUESTS];
+		uint32_t count = 0;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			count = numFinished;
+			std::memcpy(ids, finished, sizeof(uint32_t) * count);
+			numFinished = 0;
+		}
+
+		// callbacks may queue new requests, so lock is not held
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Request& req = requests[ids[i]];
+
+			IOResult result;
+			result.handle = req.handle;
+			result.err = req.err;
+			result.data = req.data;
+			result.size = req.size;
+			result.userData = req.userData;
+
+			req.state = REQUEST_FREE;
+			req.data = nullptr;
+			requestHandleAlloc.Free(result.handle);
+
+			req.callback(result);
+		}
+
+		return TF_OK;
+	}
+
+	IORequestHandle IOSystem::ReadAsync(const char* file, uint32_t allocNo, size_t alignment,
+		IOPriority priority, IOCallback callback, void* userData)
+	{
+		assert(nullptr != callback && priority < MAX_IO_PRIORITIES);
+		assert(MemoryAllocator::Allocators[allocNo].IsConcurrent() && "files are read into memory on worker threads");
+
+		size_t length = strlen(file);
+		if (length >= MAX_IO_PATH_LENGTH)
+		{
+			return IORequestHandle();
+		}
+
+		IORequestHandle handle = requestHandleAlloc.Allocate();
+		if (!handle)
+		{
+			return IORequestHandle();
+		}
+
+		Request& req = requests[handle.Index()];
+		req.handle = handle;
+		std::memcpy(req.file, file, length + 1);
+		req.callback = callback;
+		req.userData = userData;
+		req.allocNo = allocNo;
+		req.alignment = alignment;
+		req.priority = priority;
+		req.err = TF_OK;
+		req.data = nullptr;
+		req.size = 0;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			RequestQueue& queue = pending[priority];
+			queue.ids[(queue.head + queue.count) % MAX_IO_REQUESTS] = handle.Index();
+			queue.count++;
+
+			req.state = REQUEST_PENDING;
+		}
+		pendingCond.notify_one();
+
+		return handle;
+	}
+
+	int32_t IOSystem::Cancel(IORequestHandle handle)
+	{
+		// handle of a request already called back may be reused by another request
+		if (!requestHandleAlloc.IsValid(handle))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		std::lock_guard<std::mutex> guard(lock);
+
+		uint32_t id = handle.Index();
+		Request& req = requests[id];
+
+		if (REQUEST_PENDING == req.state)
+		{
+			bool removed = RemovePending(id);
+			assert(removed);
+			(void)removed;
+
+			req.state = REQUEST_CANCELLED;
+			Finish(id);
+			return TF_OK;
+		}
+
+		// worker drops the data when it is done reading
+		if (REQUEST_READING == req.state)
+		{
+			req.state = REQUEST_CANCELLED;
+			return TF_OK;
+		}
+
+		return TF_UNKNOWN_ERR;
+	}
+
+	void IOSystem::WorkerThread()
+	{
+		TF_MEMORY_TAG("IOSystem::ReadAsync");
+
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (true)
+		{
+			uint32_t id = 0;
+			pendingCond.wait(guard, [this, &id]() { return quit || PopPending(id); });
+
+			if (quit)
+			{
+				break;
+			}
+
+			Request& req = requests[id];
+			req.state = REQUEST_READING;
+
+			guard.unlock();
+
+			void* data = nullptr;
+			size_t size = 0;
+			int32_t err = FileIO::ReadFile(req.file, &data, &size, req.alignment, req.allocNo);
+
+			guard.lock();
+
+			req.err = err;
+			req.data = data;
+			req.size = size;
+			Finish(id);
+		}
+	}
+
+	bool IOSystem::PopPending(uint32_t& id)
+	{
+		for (uint32_t i = 0; i < MAX_IO_PRIORITIES; i++)
+		{
+			RequestQueue& queue = pending[i];
+			if (queue.count > 0)
+			{
+				id = queue.ids[queue.head];
+				queue.head = (queue.head + 1) % MAX_IO_REQUESTS;
+				queue.count--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool IOSystem::RemovePending(uint32_t id)
+	{
+		RequestQueue& queue = pending[requests[id].priority];
+
+		for (uint32_t i = 0; i < queue.count; i++)
+		{
+			if (queue.ids[(queue.head + i) % MAX_IO_REQUESTS] == id)
+			{
+				// shift the rest of the queue forward
+				for (uint32_t j = i + 1; j < queue.count; j++)
+				{
+					queue.ids[(queue.head + j - 1) % MAX_IO_REQUESTS] = queue.ids[(queue.head + j) % MAX_IO_REQUESTS];
+				}
+				queue.count--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void IOSystem::Finish(uint32_t id)
+	{
+		Request& req = requests[id];
+
+		if (REQUEST_CANCELLED == req.state)
+		{
+			if (nullptr != req.data)
+			{
+				MemoryAllocator::Allocators[req.allocNo].Deallocate(req.data);
+			}
+			req.err = TF_CANCELLED;
+			req.data = nullptr;
+			req.size = 0;
+		}
+
+		req.state = REQUEST_FINISHED;
+
+		assert(numFinished < MAX_IO_REQUESTS);
+		finished[numFinished++] = id;
+	}
+}
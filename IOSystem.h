@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Common.h"
+#include "Module.h"
+#include "HandleAllocator.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace tofu
+{
+	HANDLE_DECL(IORequest);
+
+	// requests of higher priority are read first
+	enum IOPriority
+	{
+		IO_PRIORITY_HIGH,
+		IO_PRIORITY_NORMAL,
+		IO_PRIORITY_LOW,
+		MAX_IO_PRIORITIES,
+	};
+
+	// passed to the callback of a finished request
+	struct IOResult
+	{
+		IORequestHandle		handle;
+		// TF_OK, TF_CANCELLED or an error of FileIO::ReadFile
+		int32_t				err;
+		// owned by the callback, allocated from allocator[allocNo] of the request
+		void*				data;
+		size_t				size;
+		void*				userData;
+	};
+
+	typedef void(*IOCallback)(const IOResult& result);
+
+	// reads whole files on worker threads, callbacks of finished
+	// requests are called on main thread in Update() once per frame
+	class IOSystem : public Module
+	{
+		SINGLETON_DECL(IOSystem)
+
+	public:
+		IOSystem();
+
+	public:
+		int32_t Init() override;
+
+		// waits for reads in progress, pending requests are dropped without callback
+		int32_t Shutdown() override;
+
+		// call callbacks of finished requests
+		int32_t Update() override;
+
+		// queue a read of file into allocator[allocNo], which must be concurrent,
+		// handle is valid until its callback is called
+		IORequestHandle ReadAsync(const char* file, uint32_t allocNo, size_t alignment,
+			IOPriority priority, IOCallback callback, void* userData = nullptr);
+
+		// callback is still called, with TF_CANCELLED,
+		// fails if request has already finished
+		int32_t Cancel(IORequestHandle handle);
+
+	private:
+		enum RequestState
+		{
+			REQUEST_FREE,
+			REQUEST_PENDING,
+			REQUEST_READING,
+			REQUEST_CANCELLED,
+			REQUEST_FINISHED,
+		};
+
+		struct Request
+		{
+			IORequestHandle	handle;
+			char			file[MAX_IO_PATH_LENGTH];
+			IOCallback		callback;
+			void*			userData;
+			uint32_t		allocNo;
+			size_t			alignment;
+			uint32_t		priority;
+			uint32_t		state;
+			int32_t			err;
+			void*			data;
+			size_t			size;
+		};
+
+		// ring of request ids
+		struct RequestQueue
+		{
+			uint32_t		ids[MAX_IO_REQUESTS];
+			uint32_t		head;
+			uint32_t		count;
+		};
+
+		void WorkerThread();
+
+		// called with lock held
+		bool PopPending(uint32_t& id);
+		bool RemovePending(uint32_t id);
+		void Finish(uint32_t id);
+
+	private:
+		// only used on main thread
+		HandleAllocator<IORequestHandle, MAX_IO_REQUESTS>	requestHandleAlloc;
+
+		Request						requests[MAX_IO_REQUESTS];
+
+		// guards request states and both queues
+		std::mutex					lock;
+		std::condition_variable		pendingCond;
+		RequestQueue				pending[MAX_IO_PRIORITIES];
+		uint32_t					finished[MAX_IO_REQUESTS];
+		uint32_t					numFinished;
+		bool						quit;
+
+		std::thread					threads[NUM_IO_THREADS];
+	};
+}
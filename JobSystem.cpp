@@ -0,0 +1,440 @@
+#include "JobSystem.h"
+
+#include "PageAllocator.h"
+
+#include <cassert>
+#include <chrono>
+#include <new>
+
+namespace
+{
+	// index of current thread in job system, UINT32_MAX for other threads
+	thread_local uint32_t threadIndex = UINT32_MAX;
+
+	// jobs run inside jobs (from Wait()) are timed by the outermost one
+	thread_local uint32_t jobDepth = 0;
+
+	// innermost job running on this thread
+	thread_local tofu::Job* currentJob = nullptr;
+
+	int64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+namespace tofu
+{
+	static_assert((MAX_JOBS_PER_THREAD & (MAX_JOBS_PER_THREAD - 1)) == 0, "deque capacity must be a power of two");
+
+	SINGLETON_IMPL(JobSystem);
+
+	bool JobSystem::JobQueue::Push(Job* job)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+
+		if (b - t >= static_cast<int64_t>(MAX_JOBS_PER_THREAD))
+		{
+			return false;
+		}
+
+		jobs[b & (MAX_JOBS_PER_THREAD - 1)].store(job, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	Job* JobSystem::JobQueue::Pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			// empty
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = jobs[b & (MAX_JOBS_PER_THREAD - 1)].load(std::memory_order_relaxed);
+
+		// last job, thieves may be taking it too
+		if (t == b)
+		{
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				job = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	Job* JobSystem::JobQueue::Steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+		{
+			return nullptr;
+		}
+
+		Job* job = jobs[t & (MAX_JOBS_PER_THREAD - 1)].load(std::memory_order_relaxed);
+
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+
+		return job;
+	}
+
+	JobSystem::JobSystem()
+		:
+		workers(nullptr),
+		numThreads(0),
+		numQueued(0),
+		quit(false),
+		frameStartTime(0),
+		utilization()
+	{
+		assert(nullptr == _instance);
+		_instance = this;
+	}
+
+	JobSystem::~JobSystem()
+	{
+		assert(nullptr == workers && "Shutdown() is not called");
+
+		if (this == _instance)
+		{
+			_instance = nullptr;
+		}
+	}
+
+	int32_t JobSystem::Init(uint32_t numThreads)
+	{
+		if (nullptr != workers)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (0 == numThreads)
+		{
+			numThreads = std::thread::hardware_concurrency();
+			if (0 == numThreads) numThreads = 1;
+		}
+		if (numThreads > MAX_JOB_THREADS) numThreads = MAX_JOB_THREADS;
+
+		void* mem = PageAllocator().Allocate(sizeof(Worker) * numThreads, alignof(Worker));
+		if (nullptr == mem)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		workers = reinterpret_cast<Worker*>(mem);
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			Worker* w = new (&workers[i]) Worker();
+			w->busyTime.store(0, std::memory_order_relaxed);
+			w->nextVictim = (i + 1) % numThreads;
+		}
+
+		this->numThreads = numThreads;
+		numQueued.store(0, std::memory_order_relaxed);
+		quit = false;
+
+		threadIndex = 0;
+		for (uint32_t i = 1; i < numThreads; i++)
+		{
+			threads[i] = std::thread(&JobSystem::WorkerThread, this, i);
+		}
+
+		frameStartTime = now_ns();
+		return TF_OK;
+	}
+
+	int32_t JobSystem::Shutdown()
+	{
+		if (nullptr == workers)
+		{
+			return TF_OK;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		wakeCond.notify_all();
+
+		for (uint32_t i = 1; i < numThreads; i++)
+		{
+			if (threads[i].joinable())
+			{
+				threads[i].join();
+			}
+		}
+
+		assert(0 == numQueued.load() && "jobs are left in queues");
+
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			workers[i].~Worker();
+		}
+		PageAllocator().Deallocate(workers, sizeof(Worker) * numThreads);
+
+		workers = nullptr;
+		numThreads = 0;
+		threadIndex = UINT32_MAX;
+
+		return TF_OK;
+	}
+
+	uint32_t JobSystem::GetThreadIndex() const
+	{
+		return threadIndex < numThreads ? threadIndex : UINT32_MAX;
+	}
+
+	Job* JobSystem::GetCurrentJob()
+	{
+		return currentJob;
+	}
+
+	void JobSystem::Run(Job* jobs, uint32_t count, JobCounter& counter)
+	{
+		counter.count.fetch_add(count, std::memory_order_relaxed);
+
+		uint32_t index = GetThreadIndex();
+
+		if (UINT32_MAX == index)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Job* outer = currentJob;
+				currentJob = &jobs[i];
+
+				jobs[i].counter = &counter;
+				jobs[i].func(jobs[i].data);
+
+				currentJob = outer;
+				counter.count.fetch_sub(1, std::memory_order_release);
+			}
+			return;
+		}
+
+		uint32_t queued = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			jobs[i].counter = &counter;
+
+			// counted before it can be stolen
+			numQueued.fetch_add(1, std::memory_order_relaxed);
+
+			if (workers[index].queue.Push(&jobs[i]))
+			{
+				queued++;
+			}
+			else
+			{
+				// deque is full
+				numQueued.fetch_sub(1, std::memory_order_relaxed);
+				Execute(&jobs[i], index);
+			}
+		}
+
+		if (queued > 0)
+		{
+			Wake(queued);
+		}
+	}
+
+	void JobSystem::Wait(const JobCounter& counter)
+	{
+		uint32_t index = GetThreadIndex();
+
+		while (!counter.IsDone())
+		{
+			if (UINT32_MAX != index)
+			{
+				Job* job = FindJob(index);
+				if (nullptr != job)
+				{
+					Execute(job, index);
+					continue;
+				}
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::RunNow(Job* job, JobCounter& counter)
+	{
+		uint32_t index = GetThreadIndex();
+		if (UINT32_MAX == index)
+		{
+			Run(job, 1, counter);
+			return;
+		}
+
+		counter.count.fetch_add(1, std::memory_order_relaxed);
+		job->counter = &counter;
+		Execute(job, index);
+	}
+
+	bool JobSystem::RunPending()
+	{
+		uint32_t index = GetThreadIndex();
+		if (UINT32_MAX == index)
+		{
+			return false;
+		}
+
+		Job* job = FindJob(index);
+		if (nullptr == job)
+		{
+			return false;
+		}
+
+		Execute(job, index);
+		return true;
+	}
+
+	void JobSystem::EndFrame()
+	{
+		int64_t time = now_ns();
+		int64_t elapsed = time - frameStartTime;
+		frameStartTime = time;
+
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			uint64_t busy = workers[i].busyTime.exchange(0, std::memory_order_relaxed);
+			float u = elapsed > 0 ? static_cast<float>(static_cast<double>(busy) / elapsed) : 0.0f;
+
+			// a job spanning frames is counted in the frame it finishes
+			utilization[i] = u < 1.0f ? u : 1.0f;
+		}
+	}
+
+	float JobSystem::GetUtilization() const
+	{
+		if (0 == numThreads)
+		{
+			return 0.0f;
+		}
+
+		float sum = 0.0f;
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			sum += utilization[i];
+		}
+		return sum / numThreads;
+	}
+
+	void JobSystem::WorkerThread(uint32_t index)
+	{
+		threadIndex = index;
+
+		while (true)
+		{
+			Job* job = FindJob(index);
+			if (nullptr != job)
+			{
+				Execute(job, index);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> guard(lock);
+			wakeCond.wait(guard, [this]() { return quit || numQueued.load(std::memory_order_relaxed) > 0; });
+
+			if (quit)
+			{
+				break;
+			}
+		}
+
+		threadIndex = UINT32_MAX;
+	}
+
+	Job* JobSystem::FindJob(uint32_t index)
+	{
+		Worker& self = workers[index];
+
+		Job* job = self.queue.Pop();
+
+		// steal from others, starting after the last one stolen from
+		for (uint32_t i = 0; nullptr == job && i < numThreads; i++)
+		{
+			uint32_t victim = self.nextVictim;
+			if (victim != index)
+			{
+				job = workers[victim].queue.Steal();
+			}
+
+			if (nullptr == job)
+			{
+				self.nextVictim = (victim + 1) % numThreads;
+			}
+		}
+
+		if (nullptr != job)
+		{
+			numQueued.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	void JobSystem::Execute(Job* job, uint32_t index)
+	{
+		// job may be gone once its counter is decreased
+		JobCounter* counter = job->counter;
+
+		Job* outer = currentJob;
+		currentJob = job;
+
+		if (0 == jobDepth)
+		{
+			int64_t start = now_ns();
+
+			jobDepth++;
+			job->func(job->data);
+			jobDepth--;
+
+			workers[index].busyTime.fetch_add(static_cast<uint64_t>(now_ns() - start), std::memory_order_relaxed);
+		}
+		else
+		{
+			jobDepth++;
+			job->func(job->data);
+			jobDepth--;
+		}
+
+		currentJob = outer;
+		counter->count.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::Wake(uint32_t count)
+	{
+		// sleeping threads check numQueued with lock held, so the wake up is not missed
+		{
+			std::lock_guard<std::mutex> guard(lock);
+		}
+
+		if (count > 1)
+		{
+			wakeCond.notify_all();
+		}
+		else
+		{
+			wakeCond.notify_one();
+		}
+	}
+}
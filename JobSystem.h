@@ -0,0 +1,209 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace tofu
+{
+	typedef void(*JobFunc)(void* data);
+
+	// number of jobs not finished yet, Wait() on it to join them
+	struct JobCounter
+	{
+		std::atomic<uint32_t>	count;
+
+		JobCounter() : count(0) {}
+
+		TF_INLINE bool IsDone() const { return 0 == count.load(std::memory_order_acquire); }
+	};
+
+	// memory of a job is owned by whoever runs it, and must stay until its counter is done
+	struct Job
+	{
+		JobFunc			func;
+		void*			data;
+		JobCounter*		counter;
+		// sort key of entity commands it records until it sets another (EntityCommandBuffer::SetSortKey()),
+		// jobs recording commands need keys of their own for a deterministic replay order
+		uint32_t		sortKey = 0;
+	};
+
+	// runs jobs on one thread per core, the thread calling Init() is thread 0.
+	// every thread has its own deque, jobs are pushed to and popped from the
+	// bottom by the owner, idle threads steal from the top of other threads' deques.
+	// jobs can be run from jobs, and Wait() runs other jobs until the counter is done,
+	// so waiting in a job doesn't block a thread
+	class JobSystem
+	{
+		SINGLETON_DECL(JobSystem)
+
+	public:
+		JobSystem();
+
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator = (const JobSystem&) = delete;
+
+	public:
+		// 0 threads is one per core
+		int32_t Init(uint32_t numThreads = 0);
+
+		// waits for jobs in progress, call it with no job queued
+		int32_t Shutdown();
+
+		// count of threads jobs run on, including thread 0
+		uint32_t GetNumThreads() const { return numThreads; }
+
+		// index of calling thread, UINT32_MAX for threads not of job system
+		uint32_t GetThreadIndex() const;
+
+		// job running on calling thread (innermost one if jobs are run from Wait()), nullptr if none
+		static Job* GetCurrentJob();
+
+		// queue jobs on calling thread, counter is increased by count.
+		// on threads not of job system, jobs are run before it returns
+		void Run(Job* jobs, uint32_t count, JobCounter& counter);
+
+		// run queued jobs until counter is done
+		void Wait(const JobCounter& counter);
+
+		// run a job on calling thread before returning, counted like a queued one
+		void RunNow(Job* job, JobCounter& counter);
+
+		// run one queued job on calling thread, false if there was none.
+		// for threads waiting on something other than a counter
+		bool RunPending();
+
+		// call fn(begin, end) for ranges covering [0, count), in parallel,
+		// ranges have at least minBatch elements, and it returns when all are done.
+		// begin is the sort key of entity commands of a range
+		template<class Func>
+		void ParallelFor(uint32_t count, uint32_t minBatch, const Func& fn);
+
+		// take core utilization of the frame, called once per frame
+		void EndFrame();
+
+		// fraction of last frame thread spent running jobs
+		float GetThreadUtilization(uint32_t thread) const { return thread < numThreads ? utilization[thread] : 0.0f; }
+
+		// average of all threads
+		float GetUtilization() const;
+
+	private:
+		// Chase-Lev work-stealing deque of fixed capacity
+		struct JobQueue
+		{
+			std::atomic<int64_t>	top;
+			std::atomic<int64_t>	bottom;
+			std::atomic<Job*>		jobs[MAX_JOBS_PER_THREAD];
+
+			JobQueue() : top(0), bottom(0), jobs() {}
+
+			// owner only, false if full
+			bool Push(Job* job);
+
+			// owner only
+			Job* Pop();
+
+			// any thread, may fail when racing with others
+			Job* Steal();
+		};
+
+		// per thread data, on its own cache lines
+		struct alignas(64) Worker
+		{
+			JobQueue				queue;
+			// nanoseconds spent running jobs in this frame
+			std::atomic<uint64_t>	busyTime;
+			uint32_t				nextVictim;
+		};
+
+		void WorkerThread(uint32_t index);
+
+		Job* FindJob(uint32_t index);
+
+		void Execute(Job* job, uint32_t index);
+
+		void Wake(uint32_t count);
+
+	private:
+		Worker*						workers;
+		uint32_t					numThreads;
+
+		// jobs in deques, idle threads sleep while it is 0
+		std::atomic<uint32_t>		numQueued;
+		std::mutex					lock;
+		std::condition_variable		wakeCond;
+		bool						quit;
+
+		std::thread					threads[MAX_JOB_THREADS];
+
+		int64_t						frameStartTime;
+		float						utilization[MAX_JOB_THREADS];
+	};
+
+	template<class Func>
+	void JobSystem::ParallelFor(uint32_t count, uint32_t minBatch, const Func& fn)
+	{
+		constexpr uint32_t MaxBatches = MAX_JOB_THREADS * JOB_BATCHES_PER_THREAD;
+
+		struct Batch
+		{
+			const Func*		fn;
+			uint32_t		begin;
+			uint32_t		end;
+		};
+
+		if (0 == count)
+		{
+			return;
+		}
+
+		if (0 == minBatch) minBatch = 1;
+
+		uint32_t numBatches = (count + minBatch - 1) / minBatch;
+		if (numBatches > numThreads * JOB_BATCHES_PER_THREAD) numBatches = numThreads * JOB_BATCHES_PER_THREAD;
+		if (numBatches > MaxBatches) numBatches = MaxBatches;
+
+		if (numBatches <= 1)
+		{
+			fn(0u, count);
+			return;
+		}
+
+		Batch batches[MaxBatches];
+		Job jobs[MaxBatches];
+
+		// first (count % numBatches) batches take one more element
+		uint32_t batchSize = count / numBatches;
+		uint32_t remainder = count % numBatches;
+		uint32_t begin = 0;
+
+		for (uint32_t i = 0; i < numBatches; i++)
+		{
+			uint32_t size = batchSize + (i < remainder ? 1 : 0);
+
+			batches[i].fn = &fn;
+			batches[i].begin = begin;
+			batches[i].end = begin + size;
+			begin += size;
+
+			jobs[i].func = [](void* data)
+			{
+				Batch* batch = reinterpret_cast<Batch*>(data);
+				(*batch->fn)(batch->begin, batch->end);
+			};
+			jobs[i].data = &batches[i];
+			jobs[i].sortKey = batches[i].begin;
+		}
+
+		JobCounter counter;
+		Run(jobs, numBatches, counter);
+		Wait(counter);
+	}
+}
@@ -1,8 +1,16 @@
 #include "MemoryAllocator.h"
+#include "TlsfAllocator.h"
+#include "PageAllocator.h"
 
 #include <cassert>
+#include <cstring>
 #ifdef _MSC_VER
 #include <malloc.h>
+#else
+#include <cstdlib>
+#endif
+#ifdef TF_MEMORY_STATS
+#include <cstdio>
 #endif
 
 namespace
@@ -11,6 +19,146 @@ namespace
 	{
 		return (address + (alignment - 1u)) & ~(alignment - 1u);
 	}
+
+	// chunks are cache line aligned so threads don't share lines
+	constexpr size_t ThreadChunkAlignment = 64u;
+
+	// chunk of a concurrent allocator owned by current thread
+	struct ThreadChunk
+	{
+		uint32_t	generation;
+		size_t		offset;
+		size_t		end;
+	};
+
+	thread_local ThreadChunk threadChunks[tofu::MAX_MEMORY_ALLOCATOR];
+
+#ifdef TF_MEMORY_STATS
+	struct TagCounter
+	{
+		std::atomic<const char*>	tag;
+		std::atomic<size_t>			bytes;
+		std::atomic<uint64_t>		count;
+	};
+
+	// counters are atomic since concurrent allocators are used by many threads
+	struct AllocatorStats
+	{
+		size_t						capacity;
+		// live block bytes of a TLSF heap, bump allocators use their top instead
+		std::atomic<size_t>			liveBytes;
+		std::atomic<size_t>			peakBytes;
+		// peak since last RecordFrame()
+		std::atomic<size_t>			framePeakBytes;
+		std::atomic<uint64_t>		numAllocations;
+		std::atomic<uint64_t>		numDeallocations;
+		std::atomic<uint64_t>		numFailures;
+		std::atomic<size_t>			largestFailedSize;
+		std::atomic<const char*>	lastFailedTag;
+
+		TagCounter					tags[tofu::MAX_MEMORY_TAGS];
+
+		// ring buffer of frame peaks
+		size_t						history[tofu::MEMORY_STATS_HISTORY_SIZE];
+		uint32_t					historyHead;
+		uint32_t					historyCount;
+	};
+
+	AllocatorStats allocatorStats[tofu::MAX_MEMORY_ALLOCATOR];
+
+	thread_local const char* currentTag = nullptr;
+
+	const char* const UntaggedName = "untagged";
+	const char* const OtherTagsName = "other";
+
+	void atomic_max(std::atomic<size_t>& target, size_t value)
+	{
+		size_t current = target.load(std::memory_order_relaxed);
+		while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+	}
+
+	void reset_stats(AllocatorStats& stats, size_t capacity)
+	{
+		stats.capacity = capacity;
+		stats.liveBytes.store(0u, std::memory_order_relaxed);
+		stats.peakBytes.store(0u, std::memory_order_relaxed);
+		stats.framePeakBytes.store(0u, std::memory_order_relaxed);
+		stats.numAllocations.store(0u, std::memory_order_relaxed);
+		stats.numDeallocations.store(0u, std::memory_order_relaxed);
+		stats.numFailures.store(0u, std::memory_order_relaxed);
+		stats.largestFailedSize.store(0u, std::memory_order_relaxed);
+		stats.lastFailedTag.store(nullptr, std::memory_order_relaxed);
+
+		for (uint32_t i = 0; i < tofu::MAX_MEMORY_TAGS; i++)
+		{
+			stats.tags[i].tag.store(nullptr, std::memory_order_relaxed);
+			stats.tags[i].bytes.store(0u, std::memory_order_relaxed);
+			stats.tags[i].count.store(0u, std::memory_order_relaxed);
+		}
+
+		stats.historyHead = 0;
+		stats.historyCount = 0;
+	}
+
+	// find or claim the counter of a tag, the last one collects tags that don't fit
+	TagCounter& find_tag(AllocatorStats& stats, const char* tag)
+	{
+		if (nullptr == tag)
+		{
+			tag = UntaggedName;
+		}
+
+		for (uint32_t i = 0; i < tofu::MAX_MEMORY_TAGS - 1; i++)
+		{
+			TagCounter& counter = stats.tags[i];
+			const char* t = counter.tag.load(std::memory_order_acquire);
+
+			if (nullptr == t)
+			{
+				// another thread may claim it first, with the same tag or not
+				counter.tag.compare_exchange_strong(t, tag, std::memory_order_acq_rel);
+				if (nullptr == t) return counter;
+			}
+
+			if (t == tag)
+			{
+				return counter;
+			}
+		}
+
+		TagCounter& other = stats.tags[tofu::MAX_MEMORY_TAGS - 1];
+		other.tag.store(OtherTagsName, std::memory_order_relaxed);
+		return other;
+	}
+
+	void get_allocator_name(uint32_t allocNo, char* buf, size_t bufSize)
+	{
+		using namespace tofu;
+
+		if (allocNo >= ALLOC_FRAME_BASED_MEM && allocNo <= ALLOC_FRAME_BASED_MEM_END)
+		{
+			snprintf(buf, bufSize, "frame_based_mem_%u", allocNo - ALLOC_FRAME_BASED_MEM);
+			return;
+		}
+
+		if (allocNo >= ALLOC_FRAME_BASED_VMEM && allocNo <= ALLOC_FRAME_BASED_VMEM_END)
+		{
+			snprintf(buf, bufSize, "frame_based_vmem_%u", allocNo - ALLOC_FRAME_BASED_VMEM);
+			return;
+		}
+
+		const char* name = "unknown";
+		switch (allocNo)
+		{
+		case ALLOC_DEFAULT:				name = "default"; break;
+		case ALLOC_LEVEL_BASED_MEM:		name = "level_based_mem"; break;
+		case ALLOC_LEVEL_BASED_HEAP:	name = "level_based_heap"; break;
+		case ALLOC_SCRATCH_MEM:			name = "scratch_mem"; break;
+		case ALLOC_LEVEL_BASED_VMEM:	name = "level_based_vmem"; break;
+		}
+		snprintf(buf, bufSize, "%s", name);
+	}
+#endif
 }
 
 namespace tofu
@@ -19,24 +167,40 @@ namespace tofu
 	MemoryAllocator MemoryAllocator::Allocators[MAX_MEMORY_ALLOCATOR];
 	NativeAllocator* MemoryAllocator::DefaultNativeAllocator = nullptr;
 
-	int32_t MemoryAllocator::Init(size_t size, size_t alignment, NativeAllocator * nativeAlloc)
+	int32_t MemoryAllocator::Init(size_t size, size_t alignment, NativeAllocator * nativeAlloc, uint32_t flags)
 	{
 		assert(size != 0u);
+		assert(!((flags & ALLOC_FLAG_VIRTUAL) && (flags & ALLOC_FLAG_TLSF)) && "TLSF heap needs the whole block committed");
+
+		if (flags & ALLOC_FLAG_VIRTUAL)
+		{
+			assert(nullptr == nativeAlloc && "virtual allocator reserves pages by itself");
+			size = (size + VMEM_COMMIT_SIZE - 1) & ~static_cast<size_t>(VMEM_COMMIT_SIZE - 1);
+		}
+		else if (nullptr == nativeAlloc)
+		{
+			nativeAlloc = DefaultNativeAllocator;
+		}
 
 		void* ptr = nullptr;
-		if (nullptr != nativeAlloc)
+		if (flags & ALLOC_FLAG_VIRTUAL)
 		{
-			ptr = nativeAlloc->Allocate(size, alignment);
+			ptr = PageAllocator::Reserve(size, alignment > VMEM_COMMIT_SIZE ? alignment : VMEM_COMMIT_SIZE);
 		}
-		else if (nullptr != DefaultNativeAllocator)
+		else if (nullptr != nativeAlloc)
 		{
-			ptr = DefaultNativeAllocator->Allocate(size, alignment);
+			ptr = nativeAlloc->Allocate(size, alignment);
 		}
 #ifdef _MSC_VER
 		else
 		{
 			ptr = _aligned_malloc(size, alignment);
 		}
+#else
+		else if (0 != posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size))
+		{
+			ptr = nullptr;
+		}
 #endif
 
 		if (nullptr == ptr)
@@ -44,11 +208,24 @@ namespace tofu
 			return TF_UNKNOWN_ERR;
 		}
 
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			tlsf = TlsfAllocator::Create(ptr, size);
+			assert(nullptr != tlsf);
+		}
+
 		memoryBase = ptr;
 		memorySize = size;
-		currentSize = 0u;
+		currentSize.store(0u, std::memory_order_relaxed);
+		committedSize.store((flags & ALLOC_FLAG_VIRTUAL) ? 0u : size, std::memory_order_relaxed);
+		generation.fetch_add(1u, std::memory_order_release);
 
 		this->nativeAlloc = nativeAlloc;
+		this->flags = flags;
+
+#ifdef TF_MEMORY_STATS
+		reset_stats(allocatorStats[this - Allocators], size);
+#endif
 
 		return TF_OK;
 	}
@@ -59,48 +236,467 @@ namespace tofu
 
 		if (nullptr != memoryBase)
 		{
-			if (nullptr != nativeAlloc)
+			if (flags & ALLOC_FLAG_VIRTUAL)
+			{
+				err = PageAllocator::Release(memoryBase, memorySize);
+			}
+			else if (nullptr != nativeAlloc)
 			{
 				err = nativeAlloc->Deallocate(memoryBase, memorySize);
 			}
-#ifdef _MSC_VER
 			else
 			{
+#ifdef _MSC_VER
 				_aligned_free(memoryBase);
-			}
+#else
+				free(memoryBase);
 #endif
+			}
 		}
 
 		nativeAlloc = nullptr;
 		memoryBase = nullptr;
 		memorySize = 0u;
+		committedSize.store(0u, std::memory_order_relaxed);
+		flags = ALLOC_FLAG_NONE;
+		tlsf = nullptr;
 
 		return err;
 	}
 
-	int32_t MemoryAllocator::Reset()
+	int32_t MemoryAllocator::Reset(size_t keepCommitted)
 	{
 		assert(nullptr != memoryBase);
 
-		currentSize = 0u;
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			// rebuild an empty heap
+			tlsf = TlsfAllocator::Create(memoryBase, memorySize);
+			assert(nullptr != tlsf);
+		}
+
+		currentSize.store(0u, std::memory_order_relaxed);
+		generation.fetch_add(1u, std::memory_order_release);
+
+#ifdef TF_MEMORY_STATS
+		allocatorStats[this - Allocators].liveBytes.store(0u, std::memory_order_relaxed);
+#endif
+
+		if (flags & ALLOC_FLAG_VIRTUAL)
+		{
+			size_t committed = committedSize.load(std::memory_order_relaxed);
+			size_t keep = keepCommitted < memorySize ? align_to(keepCommitted, VMEM_COMMIT_SIZE) : memorySize;
+
+			if (keep < committed)
+			{
+				CHECKED(PageAllocator::Decommit(reinterpret_cast<uint8_t*>(memoryBase) + keep, committed - keep));
+				committedSize.store(keep, std::memory_order_relaxed);
+			}
+		}
 
 		return TF_OK;
 	}
 
 	void * MemoryAllocator::Allocate(size_t size, size_t alignment)
+	{
+		void* ptr = AllocateFromBlock(size, alignment);
+
+#ifdef TF_MEMORY_STATS
+		AllocatorStats& stats = allocatorStats[this - Allocators];
+
+		if (nullptr == ptr)
+		{
+			stats.numFailures.fetch_add(1u, std::memory_order_relaxed);
+			atomic_max(stats.largestFailedSize, size);
+			stats.lastFailedTag.store(nullptr != currentTag ? currentTag : UntaggedName, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		size_t used = 0;
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			size_t blockSize = GetHeapBlockSize(ptr);
+			used = stats.liveBytes.fetch_add(blockSize, std::memory_order_relaxed) + blockSize;
+		}
+		else
+		{
+			used = currentSize.load(std::memory_order_relaxed);
+		}
+
+		stats.numAllocations.fetch_add(1u, std::memory_order_relaxed);
+		atomic_max(stats.peakBytes, used);
+		atomic_max(stats.framePeakBytes, used);
+
+		TagCounter& counter = find_tag(stats, currentTag);
+		counter.bytes.fetch_add(size, std::memory_order_relaxed);
+		counter.count.fetch_add(1u, std::memory_order_relaxed);
+#endif
+
+		return ptr;
+	}
+
+	void * MemoryAllocator::AllocateFromBlock(size_t size, size_t alignment)
 	{
 		assert(nullptr != memoryBase);
 
-		size_t offset = align_to(currentSize, alignment);
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			if (flags & ALLOC_FLAG_CONCURRENT)
+			{
+				std::lock_guard<std::mutex> lock(heapMutex);
+				return tlsf->Allocate(size, alignment);
+			}
+			return tlsf->Allocate(size, alignment);
+		}
+
+		if (flags & ALLOC_FLAG_CONCURRENT)
+		{
+			return AllocateConcurrent(size, alignment);
+		}
+
+		// single threaded, relaxed load/store compile to plain moves
+		size_t offset = align_to(currentSize.load(std::memory_order_relaxed), alignment);
 
 		if (offset + size > memorySize)
 		{
 			return nullptr;
 		}
 
-		currentSize = offset + size;
+		if ((flags & ALLOC_FLAG_VIRTUAL) && !CommitTo(offset + size))
+		{
+			return nullptr;
+		}
+
+		currentSize.store(offset + size, std::memory_order_relaxed);
 
 		return reinterpret_cast<uint8_t*>(memoryBase) + offset;
 	}
 
+	int32_t MemoryAllocator::Deallocate(void * ptr)
+	{
+		assert(nullptr != memoryBase);
+
+		if (nullptr == ptr)
+		{
+			return TF_OK;
+		}
+
+		assert(ptr >= memoryBase && ptr < reinterpret_cast<uint8_t*>(memoryBase) + memorySize);
+
+#ifdef TF_MEMORY_STATS
+		AllocatorStats& stats = allocatorStats[this - Allocators];
+		stats.numDeallocations.fetch_add(1u, std::memory_order_relaxed);
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			stats.liveBytes.fetch_sub(GetHeapBlockSize(ptr), std::memory_order_relaxed);
+		}
+#endif
+
+		if (flags & ALLOC_FLAG_TLSF)
+		{
+			if (flags & ALLOC_FLAG_CONCURRENT)
+			{
+				std::lock_guard<std::mutex> lock(heapMutex);
+				tlsf->Deallocate(ptr);
+			}
+			else
+			{
+				tlsf->Deallocate(ptr);
+			}
+		}
+
+		return TF_OK;
+	}
+
+#ifdef TF_MEMORY_STATS
+	size_t MemoryAllocator::GetHeapBlockSize(void* ptr)
+	{
+		// size shares a word with flags that neighbour blocks change
+		if (flags & ALLOC_FLAG_CONCURRENT)
+		{
+			std::lock_guard<std::mutex> lock(heapMutex);
+			return TlsfAllocator::GetBlockSize(ptr);
+		}
+		return TlsfAllocator::GetBlockSize(ptr);
+	}
+#endif
+
+	MemoryMarker MemoryAllocator::GetMarker() const
+	{
+		assert(nullptr != memoryBase);
+		assert(!(flags & (ALLOC_FLAG_CONCURRENT | ALLOC_FLAG_TLSF)) && "markers only work on a single threaded bump allocator");
+
+		return currentSize.load(std::memory_order_relaxed);
+	}
+
+	int32_t MemoryAllocator::FreeToMarker(MemoryMarker marker)
+	{
+		assert(nullptr != memoryBase);
+		assert(!(flags & (ALLOC_FLAG_CONCURRENT | ALLOC_FLAG_TLSF)) && "markers only work on a single threaded bump allocator");
+
+		size_t current = currentSize.load(std::memory_order_relaxed);
+		if (marker > current)
+		{
+			// marker is freed already by an outer scope
+			return TF_UNKNOWN_ERR;
+		}
+
+#ifdef _DEBUG
+		// make use of freed scratch memory easy to spot
+		memset(reinterpret_cast<uint8_t*>(memoryBase) + marker, 0xDD, current - marker);
+#endif
+
+		currentSize.store(marker, std::memory_order_relaxed);
+
+		return TF_OK;
+	}
+
+#ifdef TF_MEMORY_STATS
+	void MemoryAllocator::GetStats(MemoryStats& out) const
+	{
+		const AllocatorStats& stats = allocatorStats[this - Allocators];
+
+		out.capacity = stats.capacity;
+		out.committedBytes = committedSize.load(std::memory_order_relaxed);
+		out.usedBytes = (flags & ALLOC_FLAG_TLSF)
+			? stats.liveBytes.load(std::memory_order_relaxed)
+			: currentSize.load(std::memory_order_relaxed);
+		out.peakBytes = stats.peakBytes.load(std::memory_order_relaxed);
+		out.numAllocations = stats.numAllocations.load(std::memory_order_relaxed);
+		out.numDeallocations = stats.numDeallocations.load(std::memory_order_relaxed);
+		out.numFailures = stats.numFailures.load(std::memory_order_relaxed);
+		out.largestFailedSize = stats.largestFailedSize.load(std::memory_order_relaxed);
+		out.lastFailedTag = stats.lastFailedTag.load(std::memory_order_relaxed);
+	}
+
+	uint32_t MemoryAllocator::GetTagStats(MemoryTagStats* tags, uint32_t maxTags) const
+	{
+		const AllocatorStats& stats = allocatorStats[this - Allocators];
+		uint32_t num = 0;
+
+		for (uint32_t i = 0; i < MAX_MEMORY_TAGS && num < maxTags; i++)
+		{
+			const TagCounter& counter = stats.tags[i];
+			const char* tag = counter.tag.load(std::memory_order_acquire);
+			if (nullptr == tag)
+			{
+				continue;
+			}
+
+			tags[num].tag = tag;
+			tags[num].bytes = counter.bytes.load(std::memory_order_relaxed);
+			tags[num].count = counter.count.load(std::memory_order_relaxed);
+			num++;
+		}
+
+		return num;
+	}
+
+	uint32_t MemoryAllocator::GetFrameHistory(size_t* peaks, uint32_t maxFrames) const
+	{
+		const AllocatorStats& stats = allocatorStats[this - Allocators];
+
+		uint32_t num = stats.historyCount < maxFrames ? stats.historyCount : maxFrames;
+		uint32_t start = (stats.historyHead + MEMORY_STATS_HISTORY_SIZE - num) % MEMORY_STATS_HISTORY_SIZE;
+
+		for (uint32_t i = 0; i < num; i++)
+		{
+			peaks[i] = stats.history[(start + i) % MEMORY_STATS_HISTORY_SIZE];
+		}
+
+		return num;
+	}
+
+	void MemoryAllocator::RecordFrame()
+	{
+		for (uint32_t i = 0; i < MAX_MEMORY_ALLOCATOR; i++)
+		{
+			MemoryAllocator& alloc = Allocators[i];
+			if (nullptr == alloc.memoryBase)
+			{
+				continue;
+			}
+
+			AllocatorStats& stats = allocatorStats[i];
+
+			stats.history[stats.historyHead] = stats.framePeakBytes.load(std::memory_order_relaxed);
+			stats.historyHead = (stats.historyHead + 1) % MEMORY_STATS_HISTORY_SIZE;
+			if (stats.historyCount < MEMORY_STATS_HISTORY_SIZE)
+			{
+				stats.historyCount++;
+			}
+
+			// next frame starts from what is still in use
+			MemoryStats current;
+			alloc.GetStats(current);
+			stats.framePeakBytes.store(current.usedBytes, std::memory_order_relaxed);
+		}
+	}
+
+	int32_t MemoryAllocator::DumpStats(const char* filename)
+	{
+		FILE* fp = fopen(filename, "w");
+		if (nullptr == fp)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		for (uint32_t i = 0; i < MAX_MEMORY_ALLOCATOR; i++)
+		{
+			MemoryStats stats;
+			Allocators[i].GetStats(stats);
+			if (stats.capacity == 0)
+			{
+				continue;
+			}
+
+			char name[32];
+			get_allocator_name(i, name, sizeof(name));
+
+			fprintf(fp, "[%s]\n", name);
+			fprintf(fp, "capacity %zu, committed %zu, used %zu, peak %zu (%.1f%%)\n",
+				stats.capacity, stats.committedBytes, stats.usedBytes, stats.peakBytes,
+				100.0 * stats.peakBytes / stats.capacity);
+			fprintf(fp, "allocations %llu, deallocations %llu\n",
+				static_cast<unsigned long long>(stats.numAllocations),
+				static_cast<unsigned long long>(stats.numDeallocations));
+
+			if (stats.numFailures > 0)
+			{
+				fprintf(fp, "OVERFLOW: %llu failed allocations, largest %zu bytes, last tag %s\n",
+					static_cast<unsigned long long>(stats.numFailures),
+					stats.largestFailedSize,
+					stats.lastFailedTag);
+			}
+
+			MemoryTagStats tags[MAX_MEMORY_TAGS];
+			uint32_t numTags = Allocators[i].GetTagStats(tags, MAX_MEMORY_TAGS);
+			for (uint32_t t = 0; t < numTags; t++)
+			{
+				fprintf(fp, "  tag %-24s %12zu bytes %10llu allocations\n",
+					tags[t].tag, tags[t].bytes,
+					static_cast<unsigned long long>(tags[t].count));
+			}
+
+			size_t history[MEMORY_STATS_HISTORY_SIZE];
+			uint32_t numFrames = Allocators[i].GetFrameHistory(history, MEMORY_STATS_HISTORY_SIZE);
+			if (numFrames > 0)
+			{
+				fprintf(fp, "  frame peaks:");
+				for (uint32_t f = 0; f < numFrames; f++)
+				{
+					fprintf(fp, " %zu", history[f]);
+				}
+				fprintf(fp, "\n");
+			}
+
+			fprintf(fp, "\n");
+		}
+
+		fclose(fp);
+		return TF_OK;
+	}
+
+	const char* MemoryAllocator::GetCurrentTag()
+	{
+		return currentTag;
+	}
+
+	void MemoryAllocator::SetCurrentTag(const char* tag)
+	{
+		currentTag = tag;
+	}
+#endif
+
+	void * MemoryAllocator::AllocateConcurrent(size_t size, size_t alignment)
+	{
+		ThreadChunk& chunk = threadChunks[this - Allocators];
+		uint32_t gen = generation.load(std::memory_order_acquire);
+
+		// fast path, no atomic operations
+		if (chunk.generation == gen)
+		{
+			size_t offset = align_to(chunk.offset, alignment);
+			if (offset + size <= chunk.end)
+			{
+				chunk.offset = offset + size;
+				return reinterpret_cast<uint8_t*>(memoryBase) + offset;
+			}
+		}
+
+		// large allocations go to shared block directly,
+		// otherwise they would waste most of a chunk
+		if (size + alignment > CONCURRENT_MEM_CHUNK_SIZE / 4)
+		{
+			return AllocateShared(size, alignment);
+		}
+
+		// the rest of the old chunk is abandoned until next Reset()
+		void* ptr = AllocateShared(CONCURRENT_MEM_CHUNK_SIZE, ThreadChunkAlignment);
+		if (nullptr == ptr)
+		{
+			// shared block is nearly full, still try to fit this one in
+			return AllocateShared(size, alignment);
+		}
+
+		size_t begin = reinterpret_cast<uint8_t*>(ptr) - reinterpret_cast<uint8_t*>(memoryBase);
+		size_t offset = align_to(begin, alignment);
+
+		chunk.generation = gen;
+		chunk.offset = offset + size;
+		chunk.end = begin + CONCURRENT_MEM_CHUNK_SIZE;
+
+		return reinterpret_cast<uint8_t*>(memoryBase) + offset;
+	}
+
+	void * MemoryAllocator::AllocateShared(size_t size, size_t alignment)
+	{
+		size_t current = currentSize.load(std::memory_order_relaxed);
+		size_t offset;
+
+		do
+		{
+			offset = align_to(current, alignment);
+
+			if (offset + size > memorySize)
+			{
+				return nullptr;
+			}
+		} while (!currentSize.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+		// range is taken already, it stays unused until Reset() if commit fails
+		if ((flags & ALLOC_FLAG_VIRTUAL) && !CommitTo(offset + size))
+		{
+			return nullptr;
+		}
+
+		return reinterpret_cast<uint8_t*>(memoryBase) + offset;
+	}
+
+	bool MemoryAllocator::CommitTo(size_t end)
+	{
+		size_t committed = committedSize.load(std::memory_order_acquire);
+		if (end <= committed)
+		{
+			return true;
+		}
+
+		size_t newCommitted = align_to(end, VMEM_COMMIT_SIZE);
+		if (newCommitted > memorySize)
+		{
+			newCommitted = memorySize;
+		}
+
+		// threads may commit overlapping ranges at once, that is harmless
+		if (TF_OK != PageAllocator::Commit(reinterpret_cast<uint8_t*>(memoryBase) + committed, newCommitted - committed))
+		{
+			return false;
+		}
+
+		while (committed < newCommitted &&
+			!committedSize.compare_exchange_weak(committed, newCommitted, std::memory_order_acq_rel));
+
+		return true;
+	}
+
 }
@@ -2,13 +2,21 @@
 
 #include "Common.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace tofu
 {
+	class TlsfAllocator;
+
 	// sets of allocator for different scenario
 	enum AllocatorType
 	{
 		ALLOC_DEFAULT,
 		ALLOC_LEVEL_BASED_MEM,
+		ALLOC_LEVEL_BASED_HEAP,
+		// temporary memory of main thread, used as a stack with markers
+		ALLOC_SCRATCH_MEM,
 		ALLOC_FRAME_BASED_MEM,
 		ALLOC_FRAME_BASED_MEM_END = ALLOC_FRAME_BASED_MEM + FRAME_BUFFER_COUNT - 1,
 		ALLOC_LEVEL_BASED_VMEM,
@@ -17,6 +25,52 @@ namespace tofu
 		MAX_MEMORY_ALLOCATOR,
 	};
 
+	// behaviour flags of a memory allocator
+	enum AllocatorFlag
+	{
+		ALLOC_FLAG_NONE = 0,
+		// bump pointer is atomic, and each thread carves its own chunk
+		// from the shared block so most allocations don't contend
+		ALLOC_FLAG_CONCURRENT = 1 << 0,
+		// two-level segregated fit heap, allocations can be freed one by one,
+		// with ALLOC_FLAG_CONCURRENT the heap is guarded by a lock
+		ALLOC_FLAG_TLSF = 1 << 1,
+		// only reserve address space at Init(), pages are committed as the
+		// bump pointer moves (native allocator is not used)
+		ALLOC_FLAG_VIRTUAL = 1 << 2,
+	};
+
+#ifdef TF_MEMORY_STATS
+	// usage of one allocator, bytes used is the top of a bump allocator
+	// (including chunks reserved by threads) or live blocks of a TLSF heap
+	struct MemoryStats
+	{
+		size_t			capacity;
+		// committed part of a virtual allocator, capacity for others
+		size_t			committedBytes;
+		size_t			usedBytes;
+		size_t			peakBytes;
+		uint64_t		numAllocations;
+		uint64_t		numDeallocations;
+		// requests that didn't fit
+		uint64_t		numFailures;
+		size_t			largestFailedSize;
+		const char*		lastFailedTag;
+	};
+
+	// bytes requested under one tag since Init()
+	struct MemoryTagStats
+	{
+		const char*		tag;
+		size_t			bytes;
+		uint64_t		count;
+	};
+#endif
+
+	// position of a bump allocator, everything allocated after it
+	// can be freed at once by FreeToMarker()
+	typedef size_t MemoryMarker;
+
 	// interface for native memory allocation API wraping
 	struct NativeAllocator
 	{
@@ -25,7 +79,7 @@ namespace tofu
 	};
 
 	// global memory allocator set
-	// (standard library containters still using system malloc/free)
+	// (standard library containers can use them through StlAllocator)
 	class MemoryAllocator
 	{
 	public:
@@ -42,8 +96,17 @@ namespace tofu
 			return new(ptr) T();
 		}
 
+		// delete and deallocate
+		template<typename T>
+		static void Deallocate(uint32_t allocNo, T* ptr)
+		{
+			if (nullptr == ptr) return;
+			ptr->~T();
+			Allocators[allocNo].Deallocate(ptr);
+		}
+
 	private:
-		MemoryAllocator() : nativeAlloc(nullptr), memoryBase(nullptr), memorySize(0u) {}
+		MemoryAllocator() : nativeAlloc(nullptr), memoryBase(nullptr), memorySize(0u), currentSize(0u), committedSize(0u), flags(ALLOC_FLAG_NONE), generation(0u), tlsf(nullptr) {}
 		//~MemoryAllocator();
 
 	public:
@@ -55,18 +118,157 @@ namespace tofu
 
 	public:
 
-		int32_t Init(size_t size, size_t alignment, NativeAllocator* nativeAlloc = nullptr);
+		int32_t Init(size_t size, size_t alignment, NativeAllocator* nativeAlloc = nullptr, uint32_t flags = ALLOC_FLAG_NONE);
 
 		int32_t Shutdown();
 
-		int32_t Reset();
+		// free everything at once, for concurrent allocators
+		// no other thread may be allocating at the same time.
+		// virtual allocator decommits pages beyond keepCommitted bytes
+		int32_t Reset(size_t keepCommitted = SIZE_MAX);
 
 		void* Allocate(size_t size, size_t alignment);
 
+		// give memory back to a TLSF allocator,
+		// other allocators only reclaim memory on Reset() or FreeToMarker()
+		int32_t Deallocate(void* ptr);
+
+		bool IsInitialized() const { return nullptr != memoryBase; }
+
+		// whether other threads may allocate from it
+		bool IsConcurrent() const { return 0 != (flags & ALLOC_FLAG_CONCURRENT); }
+
+		// whether ptr is inside the block of this allocator
+		bool Owns(const void* ptr) const
+		{
+			uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+			uintptr_t base = reinterpret_cast<uintptr_t>(memoryBase);
+			return addr >= base && addr - base < memorySize;
+		}
+
+		// bytes taken from the block so far (not for TLSF allocator)
+		size_t GetUsedSize() const { return currentSize.load(std::memory_order_relaxed); }
+
+		// current top of a bump allocator (not for concurrent or TLSF allocator)
+		MemoryMarker GetMarker() const;
+
+		// free everything allocated after the marker was taken,
+		// markers must be freed in reverse order
+		int32_t FreeToMarker(MemoryMarker marker);
+
+#ifdef TF_MEMORY_STATS
+		void GetStats(MemoryStats& stats) const;
+
+		// copy at most maxTags tag records, return number copied
+		uint32_t GetTagStats(MemoryTagStats* tags, uint32_t maxTags) const;
+
+		// copy peak usage of last frames (oldest first), return number copied
+		uint32_t GetFrameHistory(size_t* peaks, uint32_t maxFrames) const;
+
+		// push peak usage of this frame into history of every allocator
+		static void RecordFrame();
+
+		// write stats of all initialized allocators to a text file
+		static int32_t DumpStats(const char* filename);
+
+		// tag of allocations made by current thread, nullptr for untagged
+		static const char* GetCurrentTag();
+		static void SetCurrentTag(const char* tag);
+#endif
+
 	private:
-		NativeAllocator*	nativeAlloc;
-		void*				memoryBase;
-		size_t				memorySize;
-		size_t				currentSize;
+		// allocate from the block according to flags
+		void* AllocateFromBlock(size_t size, size_t alignment);
+
+		// allocate from per-thread chunk, refill it from the shared block when exhausted
+		void* AllocateConcurrent(size_t size, size_t alignment);
+
+		// lock-free bump on the shared block
+		void* AllocateShared(size_t size, size_t alignment);
+
+		// make sure block is committed up to given offset (ALLOC_FLAG_VIRTUAL)
+		bool CommitTo(size_t end);
+
+#ifdef TF_MEMORY_STATS
+		// size of a TLSF block, under the lock if heap is concurrent
+		size_t GetHeapBlockSize(void* ptr);
+#endif
+
+	private:
+		NativeAllocator*		nativeAlloc;
+		void*					memoryBase;
+		size_t					memorySize;
+		std::atomic<size_t>		currentSize;
+		// committed part of a virtual block, multiple of VMEM_COMMIT_SIZE
+		std::atomic<size_t>		committedSize;
+		uint32_t				flags;
+
+		// increased on every Init() and Reset(), per-thread chunks
+		// carved in an older generation are discarded
+		std::atomic<uint32_t>	generation;
+
+		// control structure at beginning of memory block (ALLOC_FLAG_TLSF)
+		TlsfAllocator*			tlsf;
+		// taken around heap operations of a concurrent TLSF allocator
+		std::mutex				heapMutex;
+	};
+
+#ifdef TF_MEMORY_STATS
+	// allocations of current thread are counted under given tag until scope ends,
+	// tag must be a string literal (compared by address)
+	class ScopedMemoryTag
+	{
+	public:
+		explicit ScopedMemoryTag(const char* tag)
+			:
+			prevTag(MemoryAllocator::GetCurrentTag())
+		{
+			MemoryAllocator::SetCurrentTag(tag);
+		}
+
+		~ScopedMemoryTag()
+		{
+			MemoryAllocator::SetCurrentTag(prevTag);
+		}
+
+		ScopedMemoryTag(const ScopedMemoryTag&) = delete;
+		ScopedMemoryTag& operator = (const ScopedMemoryTag&) = delete;
+
+	private:
+		const char*		prevTag;
+	};
+#endif
+
+	// take a marker on construction and free to it on destruction,
+	// so nested passes can reuse the same scratch memory
+	class ScopedMemoryMarker
+	{
+	public:
+		explicit ScopedMemoryMarker(uint32_t allocNo = ALLOC_SCRATCH_MEM)
+			:
+			allocNo(allocNo),
+			marker(MemoryAllocator::Allocators[allocNo].GetMarker())
+		{}
+
+		~ScopedMemoryMarker()
+		{
+			MemoryAllocator::Allocators[allocNo].FreeToMarker(marker);
+		}
+
+		ScopedMemoryMarker(const ScopedMemoryMarker&) = delete;
+		ScopedMemoryMarker& operator = (const ScopedMemoryMarker&) = delete;
+
+	private:
+		uint32_t		allocNo;
+		MemoryMarker	marker;
 	};
 }
+
+// count allocations of current scope under a tag, compiled out without TF_MEMORY_STATS
+#ifdef TF_MEMORY_STATS
+#define TF_MEMORY_TAG_CONCAT_(a, b) a##b
+#define TF_MEMORY_TAG_CONCAT(a, b) TF_MEMORY_TAG_CONCAT_(a, b)
+#define TF_MEMORY_TAG(tag) tofu::ScopedMemoryTag TF_MEMORY_TAG_CONCAT(_memoryTag, __LINE__)(tag)
+#else
+#define TF_MEMORY_TAG(tag)
+#endif
@@ -16,21 +16,24 @@ namespace tofu
 		friend class AnimationComponentData;
 	public:
 
-		TF_INLINE bool HasAnimation() const { return header->HasAnimation; }
+		TF_INLINE bool HasAnimation() const { return header.HasAnimation; }
 
 	private:
 		ModelHandle					handle;
 		MeshHandle					meshes[MAX_MESHES_PER_MODEL];
 		uint32_t					numMeshes;
 		uint32_t					vertexSize;
-		model::ModelHeader*			header;
+		model::ModelHeader			header;
+		// file path, bones, animations and channels share one block on level heap
+		const char*					path;
 		model::ModelBone*			bones;
 		model::ModelAnimation*		animations;
 		model::ModelAnimChannel*	channels;
+		// frames share another block, read by RenderingSystem::LoadAnimationFrames()
+		// when an animation component uses the model for the first time
 		model::ModelFloat3Frame*	translationFrames;
 		model::ModelQuatFrame*		rotationFrames;
 		model::ModelFloat3Frame*	scaleFrames;
-		void*						rawData;
-		size_t						rawDataSize;
+		size_t						framesOffset;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common.h"
+#include "ComponentType.h"
 
 namespace tofu
 {
@@ -13,6 +14,17 @@ namespace tofu
 
 		virtual int32_t Update() = 0;
 
+		// component types Update() reads and writes (ComponentTypes::GetMask<T>() of component data),
+		// modules that don't write what others read or write are updated at the same time.
+		// by default a module touches everything, so it is updated alone and on main thread,
+		// where it may create entities and components and use any allocator.
+		// a module declaring less for both is updated on any thread of JobSystem,
+		// and may only use concurrent allocators there, and add or remove
+		// components through EntityCommands::Get()
+		virtual ComponentMask GetReadMask() const { return ~ComponentMask(0); }
+
+		virtual ComponentMask GetWriteMask() const { return ~ComponentMask(0); }
+
 		virtual ~Module() {}
 	};
-}
\ No newline at end of file
+}
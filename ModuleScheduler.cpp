@@ -0,0 +1,162 @@
+#include "ModuleScheduler.h"
+
+#include "Module.h"
+
+#include <cassert>
+#include <thread>
+
+namespace tofu
+{
+	ModuleScheduler::ModuleScheduler()
+		:
+		nodes(),
+		counter(),
+		numRemaining(0),
+		err(TF_OK),
+		maxParallelism(0)
+	{
+	}
+
+	int32_t ModuleScheduler::Update(Module* const* modules, uint32_t count)
+	{
+		if (count > MAX_SCHEDULED_MODULES)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (0 == count)
+		{
+			return TF_OK;
+		}
+
+		JobSystem* jobSystem = JobSystem::instance();
+		assert(nullptr != jobSystem && jobSystem->GetNumThreads() > 0);
+		assert(0 == jobSystem->GetThreadIndex() && "modules are updated from main thread");
+
+		ComponentMask reads[MAX_SCHEDULED_MODULES];
+		ComponentMask writes[MAX_SCHEDULED_MODULES];
+		uint32_t numAtLevel[MAX_SCHEDULED_MODULES] = {};
+
+		// j depends on earlier i if either writes what the other touches
+		for (uint32_t j = 0; j < count; j++)
+		{
+			Node& node = nodes[j];
+			node.scheduler = this;
+			node.module = modules[j];
+			node.job.func = &ModuleScheduler::UpdateModule;
+			node.job.data = &node;
+			// entity commands of a module replay in module order
+			node.job.sortKey = j;
+			node.numSuccessors = 0;
+			node.numPredecessors = 0;
+			node.level = 0;
+
+			reads[j] = modules[j]->GetReadMask();
+			writes[j] = modules[j]->GetWriteMask();
+
+			// modules that didn't narrow their masks may use what is main thread only
+			node.mainThread = ~ComponentMask(0) == reads[j] || ~ComponentMask(0) == writes[j];
+			node.ready.store(false, std::memory_order_relaxed);
+
+			for (uint32_t i = 0; i < j; i++)
+			{
+				bool conflict = 0 != (writes[i] & (reads[j] | writes[j]))
+					|| 0 != (writes[j] & reads[i]);
+
+				if (conflict)
+				{
+					Node& pred = nodes[i];
+					pred.successors[pred.numSuccessors++] = j;
+					node.numPredecessors++;
+					if (pred.level + 1 > node.level) node.level = pred.level + 1;
+				}
+			}
+
+			node.numPending.store(node.numPredecessors, std::memory_order_relaxed);
+			numAtLevel[node.level]++;
+		}
+
+		maxParallelism = 0;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (numAtLevel[i] > maxParallelism) maxParallelism = numAtLevel[i];
+		}
+
+		err.store(TF_OK, std::memory_order_relaxed);
+		numRemaining.store(count, std::memory_order_relaxed);
+
+		// modules with nothing to wait for start now, others are started by their last predecessor
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (0 == nodes[i].numPredecessors)
+			{
+				Start(nodes[i]);
+			}
+		}
+
+		// update main thread modules as they get ready, help with jobs in between
+		while (numRemaining.load(std::memory_order_acquire) > 0)
+		{
+			bool updated = false;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				Node& node = nodes[i];
+				if (node.mainThread && node.ready.exchange(false, std::memory_order_acquire))
+				{
+					jobSystem->RunNow(&node.job, counter);
+					updated = true;
+				}
+			}
+
+			if (!updated && !jobSystem->RunPending())
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// jobs are counted done after UpdateModule() returns
+		jobSystem->Wait(counter);
+
+		return err.load(std::memory_order_relaxed);
+	}
+
+	void ModuleScheduler::Start(Node& node)
+	{
+		if (node.mainThread)
+		{
+			node.ready.store(true, std::memory_order_release);
+		}
+		else
+		{
+			JobSystem::instance()->Run(&node.job, 1, counter);
+		}
+	}
+
+	void ModuleScheduler::UpdateModule(void* data)
+	{
+		Node& node = *reinterpret_cast<Node*>(data);
+		ModuleScheduler* scheduler = node.scheduler;
+
+		if (TF_OK == scheduler->err.load(std::memory_order_relaxed))
+		{
+			int32_t ret = node.module->Update();
+			if (TF_OK != ret)
+			{
+				int32_t expected = TF_OK;
+				scheduler->err.compare_exchange_strong(expected, ret);
+			}
+		}
+
+		// successors are started before this module is counted as done, so Update() doesn't return early
+		for (uint32_t i = 0; i < node.numSuccessors; i++)
+		{
+			Node& next = scheduler->nodes[node.successors[i]];
+			if (1 == next.numPending.fetch_sub(1, std::memory_order_acq_rel))
+			{
+				scheduler->Start(next);
+			}
+		}
+
+		scheduler->numRemaining.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Common.h"
+#include "JobSystem.h"
+
+#include <atomic>
+
+namespace tofu
+{
+	class Module;
+
+	// updates modules as a dependency graph on JobSystem.
+	// a module waits for the modules before it whose component masks conflict with its own,
+	// modules not depending on each other are updated at the same time.
+	// modules touching everything (default masks) are updated on the calling (main) thread,
+	// which runs jobs of other modules while none of them is ready
+	class ModuleScheduler
+	{
+	public:
+		ModuleScheduler();
+
+		ModuleScheduler(const ModuleScheduler&) = delete;
+		ModuleScheduler& operator = (const ModuleScheduler&) = delete;
+
+		// masks are read again every call, so the graph follows modules changing them.
+		// once a module fails no other is started, first error is returned.
+		// call on thread 0 of JobSystem
+		int32_t Update(Module* const* modules, uint32_t count);
+
+		// modules at the widest level of last graph, a rough measure of how many ran at the same time
+		uint32_t GetMaxParallelism() const { return maxParallelism; }
+
+	private:
+		struct Node
+		{
+			ModuleScheduler*		scheduler;
+			Module*					module;
+			Job						job;
+			uint32_t				successors[MAX_SCHEDULED_MODULES];
+			uint32_t				numSuccessors;
+			uint32_t				numPredecessors;
+			// predecessors not updated yet
+			std::atomic<uint32_t>	numPending;
+			// depth in graph, for GetMaxParallelism()
+			uint32_t				level;
+			// updated on main thread, not as a job
+			bool					mainThread;
+			// all predecessors are updated (main thread modules)
+			std::atomic<bool>		ready;
+		};
+
+		static void UpdateModule(void* data);
+
+		// start a module whose predecessors are all updated
+		void Start(Node& node);
+
+	private:
+		Node					nodes[MAX_SCHEDULED_MODULES];
+		JobCounter				counter;
+		// modules not updated yet
+		std::atomic<uint32_t>	numRemaining;
+		std::atomic<int32_t>	err;
+		uint32_t				maxParallelism;
+	};
+}
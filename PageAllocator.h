@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Common.h"
+#include "MemoryAllocator.h"
+
+namespace tofu
+{
+	enum PageAllocatorFlag
+	{
+		PAGE_FLAG_NONE = 0,
+		// explicit huge pages (MAP_HUGETLB / MEM_LARGE_PAGES),
+		// falls back to normal pages if none is available
+		PAGE_FLAG_HUGE_PAGES = 1 << 0,
+		// ask kernel to back the block with transparent huge pages (linux only)
+		PAGE_FLAG_TRANSPARENT_HUGE_PAGES = 1 << 1,
+		// touch every page at allocation, so no page faults happen later
+		PAGE_FLAG_PREFAULT = 1 << 2,
+	};
+
+	// native allocator taking pages from OS directly,
+	// sizes are rounded up to page size (huge page size with huge page flags)
+	class PageAllocator : public NativeAllocator
+	{
+	public:
+		explicit PageAllocator(uint32_t flags = PAGE_FLAG_NONE) : flags(flags) {}
+
+		virtual void* Allocate(size_t size, size_t alignment) override;
+
+		virtual int32_t Deallocate(void* addr, size_t size) override;
+
+		static size_t GetPageSize();
+
+		// reserve address space only, it takes no memory until committed
+		static void* Reserve(size_t size, size_t alignment);
+
+		// make reserved pages usable, committing pages twice is harmless
+		static int32_t Commit(void* addr, size_t size);
+
+		// give pages back to OS, but keep them reserved
+		static int32_t Decommit(void* addr, size_t size);
+
+		// release whole reserved range
+		static int32_t Release(void* addr, size_t size);
+
+	private:
+		uint32_t	flags;
+	};
+}
@@ -0,0 +1,174 @@
+#include "PageAllocator.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace
+{
+	constexpr size_t align_to(size_t size, size_t alignment)
+	{
+		return (size + (alignment - 1u)) & ~(alignment - 1u);
+	}
+
+	void* map_pages(size_t size, int prot, int extraFlags)
+	{
+		void* ptr = mmap(nullptr, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+		return ptr == MAP_FAILED ? nullptr : ptr;
+	}
+
+	// map more than needed and cut off both ends to get an aligned block
+	void* map_aligned(size_t size, size_t alignment, size_t pageSize, int prot, int extraFlags)
+	{
+		if (alignment <= pageSize)
+		{
+			return map_pages(size, prot, extraFlags);
+		}
+
+		size_t mappedSize = size + alignment;
+		uint8_t* mapped = reinterpret_cast<uint8_t*>(map_pages(mappedSize, prot, extraFlags));
+		if (nullptr == mapped)
+		{
+			return nullptr;
+		}
+
+		uint8_t* ptr = reinterpret_cast<uint8_t*>(align_to(reinterpret_cast<size_t>(mapped), alignment));
+
+		size_t head = ptr - mapped;
+		size_t tail = mappedSize - head - size;
+
+		if (head > 0) munmap(mapped, head);
+		if (tail > 0) munmap(ptr + size, tail);
+
+		return ptr;
+	}
+}
+
+namespace tofu
+{
+	void* PageAllocator::Allocate(size_t size, size_t alignment)
+	{
+		size_t pageSize = GetPageSize();
+		bool hugePages = 0 != (flags & (PAGE_FLAG_HUGE_PAGES | PAGE_FLAG_TRANSPARENT_HUGE_PAGES));
+
+		// huge pages must be used as a whole, Deallocate() rounds the same way
+		size_t blockAlign = hugePages ? HUGE_PAGE_SIZE : pageSize;
+		size = align_to(size, blockAlign);
+		if (alignment < blockAlign)
+		{
+			alignment = blockAlign;
+		}
+
+		void* ptr = nullptr;
+
+#ifdef MAP_HUGETLB
+		// fails unless huge pages are reserved (vm.nr_hugepages)
+		if ((flags & PAGE_FLAG_HUGE_PAGES) && alignment <= HUGE_PAGE_SIZE)
+		{
+			ptr = map_pages(size, PROT_READ | PROT_WRITE, MAP_HUGETLB | ((flags & PAGE_FLAG_PREFAULT) ? MAP_POPULATE : 0));
+			if (nullptr != ptr)
+			{
+				return ptr;
+			}
+		}
+#endif
+
+		ptr = map_aligned(size, alignment, pageSize, PROT_READ | PROT_WRITE, 0);
+		if (nullptr == ptr)
+		{
+			return nullptr;
+		}
+
+#ifdef MADV_HUGEPAGE
+		// has to be done before the pages are touched
+		if (hugePages)
+		{
+			madvise(ptr, size, MADV_HUGEPAGE);
+		}
+#endif
+
+		if (flags & PAGE_FLAG_PREFAULT)
+		{
+			volatile uint8_t* bytes = reinterpret_cast<uint8_t*>(ptr);
+			for (size_t offset = 0; offset < size; offset += pageSize)
+			{
+				bytes[offset] = 0;
+			}
+		}
+
+		return ptr;
+	}
+
+	int32_t PageAllocator::Deallocate(void* addr, size_t size)
+	{
+		if (nullptr == addr)
+		{
+			return TF_OK;
+		}
+
+		bool hugePages = 0 != (flags & (PAGE_FLAG_HUGE_PAGES | PAGE_FLAG_TRANSPARENT_HUGE_PAGES));
+		size = align_to(size, hugePages ? HUGE_PAGE_SIZE : GetPageSize());
+
+		if (0 != munmap(addr, size))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	void* PageAllocator::Reserve(size_t size, size_t alignment)
+	{
+		size_t pageSize = GetPageSize();
+		size = align_to(size, pageSize);
+
+		// no swap space is accounted for reserved range
+		void* ptr = map_aligned(size, alignment, pageSize, PROT_NONE, MAP_NORESERVE);
+
+#ifdef MADV_HUGEPAGE
+		// committed ranges that cover whole huge pages can be backed by them
+		if (nullptr != ptr && alignment >= HUGE_PAGE_SIZE)
+		{
+			madvise(ptr, size, MADV_HUGEPAGE);
+		}
+#endif
+
+		return ptr;
+	}
+
+	int32_t PageAllocator::Commit(void* addr, size_t size)
+	{
+		if (0 != mprotect(addr, size, PROT_READ | PROT_WRITE))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	int32_t PageAllocator::Decommit(void* addr, size_t size)
+	{
+		// private anonymous pages are dropped at once, and read back as zero if committed again
+		if (0 != madvise(addr, size, MADV_DONTNEED) || 0 != mprotect(addr, size, PROT_NONE))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	int32_t PageAllocator::Release(void* addr, size_t size)
+	{
+		if (0 != munmap(addr, align_to(size, GetPageSize())))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	size_t PageAllocator::GetPageSize()
+	{
+		static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return pageSize;
+	}
+}
@@ -0,0 +1,151 @@
+#include "PageAllocator.h"
+
+#include <Windows.h>
+
+namespace
+{
+	constexpr size_t align_to(size_t size, size_t alignment)
+	{
+		return (size + (alignment - 1u)) & ~(alignment - 1u);
+	}
+
+	// reserve a larger range to find an aligned address, then release it
+	// and map exactly there, retry if another thread took the range meanwhile
+	void* alloc_aligned(size_t size, size_t alignment, DWORD allocType, DWORD protect)
+	{
+		for (uint32_t retry = 0; retry < 8; retry++)
+		{
+			uint8_t* range = reinterpret_cast<uint8_t*>(VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS));
+			if (nullptr == range)
+			{
+				return nullptr;
+			}
+
+			void* ptr = reinterpret_cast<void*>(align_to(reinterpret_cast<size_t>(range), alignment));
+			VirtualFree(range, 0, MEM_RELEASE);
+
+			ptr = VirtualAlloc(ptr, size, allocType, protect);
+			if (nullptr != ptr)
+			{
+				return ptr;
+			}
+		}
+		return nullptr;
+	}
+}
+
+namespace tofu
+{
+	void* PageAllocator::Allocate(size_t size, size_t alignment)
+	{
+		size_t pageSize = GetPageSize();
+
+		// large pages need SeLockMemoryPrivilege, fall back to normal pages without it
+		if (flags & PAGE_FLAG_HUGE_PAGES)
+		{
+			size_t largePageSize = GetLargePageMinimum();
+			if (largePageSize > 0 && alignment <= largePageSize)
+			{
+				void* ptr = VirtualAlloc(nullptr, align_to(size, largePageSize),
+					MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (nullptr != ptr)
+				{
+					return ptr;
+				}
+			}
+		}
+
+		size = align_to(size, pageSize);
+
+		// VirtualAlloc is aligned to allocation granularity (64KB)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+
+		void* ptr = nullptr;
+		if (alignment <= info.dwAllocationGranularity)
+		{
+			ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+		else
+		{
+			ptr = alloc_aligned(size, alignment, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+
+		if (nullptr == ptr)
+		{
+			return nullptr;
+		}
+
+		if (flags & PAGE_FLAG_PREFAULT)
+		{
+			volatile uint8_t* bytes = reinterpret_cast<uint8_t*>(ptr);
+			for (size_t offset = 0; offset < size; offset += pageSize)
+			{
+				bytes[offset] = 0;
+			}
+		}
+
+		return ptr;
+	}
+
+	int32_t PageAllocator::Deallocate(void* addr, size_t size)
+	{
+		if (nullptr == addr)
+		{
+			return TF_OK;
+		}
+
+		// whole reservation is released, size is not needed
+		if (!VirtualFree(addr, 0, MEM_RELEASE))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	void* PageAllocator::Reserve(size_t size, size_t alignment)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+
+		if (alignment <= info.dwAllocationGranularity)
+		{
+			return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+		}
+		return alloc_aligned(size, alignment, MEM_RESERVE, PAGE_NOACCESS);
+	}
+
+	int32_t PageAllocator::Commit(void* addr, size_t size)
+	{
+		if (nullptr == VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	int32_t PageAllocator::Decommit(void* addr, size_t size)
+	{
+		if (!VirtualFree(addr, size, MEM_DECOMMIT))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	int32_t PageAllocator::Release(void* addr, size_t size)
+	{
+		if (!VirtualFree(addr, 0, MEM_RELEASE))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+		return TF_OK;
+	}
+
+	size_t PageAllocator::GetPageSize()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwPageSize;
+	}
+}
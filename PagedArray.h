@@ -0,0 +1,140 @@
+#pragma once
+
+#include "Common.h"
+#include "PageAllocator.h"
+
+#include <cassert>
+#include <new>
+
+namespace tofu
+{
+	// array growing in place, address space for all of its capacity is reserved on Reserve(),
+	// but pages of STORAGE_PAGE_SIZE entries are only committed (and constructed) as it grows.
+	// entries never move, and an array never reserved takes no memory at all.
+	// not thread safe, callers sharing one between threads keep their own published size
+	template<class T>
+	class PagedArray
+	{
+	public:
+		constexpr PagedArray()
+			:
+			data(nullptr),
+			capacity(0),
+			numCommitted(0)
+		{}
+
+		~PagedArray()
+		{
+			Release();
+		}
+
+		PagedArray(const PagedArray&) = delete;
+		PagedArray& operator = (const PagedArray&) = delete;
+
+		// takes address space only, no entry is usable before Grow()
+		int32_t Reserve(uint32_t maxCount)
+		{
+			if (nullptr != data || 0 == maxCount)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			void* ptr = PageAllocator::Reserve(sizeof(T) * maxCount, alignof(T));
+			if (nullptr == ptr)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			data = reinterpret_cast<T*>(ptr);
+			capacity = maxCount;
+			return TF_OK;
+		}
+
+		// make entries [0, count) usable, new ones are default constructed
+		int32_t Grow(uint32_t count)
+		{
+			if (count <= numCommitted)
+			{
+				return TF_OK;
+			}
+
+			if (count > capacity)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			uint32_t newCommitted = (count + STORAGE_PAGE_SIZE - 1) / STORAGE_PAGE_SIZE * STORAGE_PAGE_SIZE;
+			if (newCommitted > capacity)
+			{
+				newCommitted = capacity;
+			}
+
+			// last page committed before may be shared with the new entries, committing it again is harmless
+			size_t pageSize = PageAllocator::GetPageSize();
+			size_t begin = sizeof(T) * numCommitted / pageSize * pageSize;
+			size_t end = (sizeof(T) * newCommitted + pageSize - 1) / pageSize * pageSize;
+
+			CHECKED(PageAllocator::Commit(reinterpret_cast<uint8_t*>(data) + begin, end - begin));
+
+			for (uint32_t i = numCommitted; i < newCommitted; ++i)
+			{
+				new (&data[i]) T();
+			}
+
+			numCommitted = newCommitted;
+			return TF_OK;
+		}
+
+		// destruct all entries and give address space back
+		void Release()
+		{
+			if (nullptr == data)
+			{
+				return;
+			}
+
+			for (uint32_t i = 0; i < numCommitted; ++i)
+			{
+				data[i].~T();
+			}
+
+			PageAllocator::Release(data, sizeof(T) * capacity);
+
+			data = nullptr;
+			capacity = 0;
+			numCommitted = 0;
+		}
+
+		inline T& operator [] (uint32_t idx)
+		{
+			assert(idx < numCommitted);
+			return data[idx];
+		}
+
+		inline const T& operator [] (uint32_t idx) const
+		{
+			assert(idx < numCommitted);
+			return data[idx];
+		}
+
+		inline bool IsReserved() const { return nullptr != data; }
+
+		inline T* GetData() const { return data; }
+
+		inline uint32_t GetCapacity() const { return capacity; }
+
+		inline uint32_t GetNumCommitted() const { return numCommitted; }
+
+		// memory actually taken, rounded up to pages
+		inline size_t GetCommittedBytes() const
+		{
+			size_t pageSize = PageAllocator::GetPageSize();
+			return (sizeof(T) * numCommitted + pageSize - 1) / pageSize * pageSize;
+		}
+
+	private:
+		T*			data;
+		uint32_t	capacity;
+		uint32_t	numCommitted;
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tofu
+{
+	namespace pak
+	{
+
+		constexpr uint32_t PAK_FILE_MAGIC = 0x4B415054; // "TPAK"
+		constexpr uint32_t PAK_FILE_VERSION = 0x00000001;
+
+		// entry data starts on a page boundary, so a mapped archive
+		// gives every asset the same alignment a mapped loose file has
+		constexpr uint32_t PAK_ENTRY_ALIGNMENT = 4096;
+
+		struct PakHeader
+		{
+			uint32_t			Magic;
+			uint32_t			Version;
+			uint32_t			NumEntries;
+			uint32_t			EntryAlignment;
+		};
+
+		// ... followed by an array of PakEntry struct, sorted by PathHash
+
+		// ... followed by entry data, each aligned to EntryAlignment
+
+		struct PakEntry
+		{
+			uint64_t			PathHash;
+			// from beginning of the archive
+			uint64_t			Offset;
+			uint64_t			Size;
+		};
+
+		// case and slash direction of a path character don't matter
+		inline char NormalizePathChar(char ch)
+		{
+			if (ch == '\\') return '/';
+			if (ch >= 'A' && ch <= 'Z') return static_cast<char>(ch - 'A' + 'a');
+			return ch;
+		}
+
+		// 64 bit FNV-1a of a path, case and slash direction don't matter,
+		// so "assets\\Cube.model" and "assets/cube.model" are the same entry
+		inline uint64_t HashPath(const char* path)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (const char* c = path; *c; c++)
+			{
+				hash ^= static_cast<uint8_t>(NormalizePathChar(*c));
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		// paths HashPath() takes as the same, for telling apart paths whose hashes collide
+		inline bool SamePath(const char* a, const char* b)
+		{
+			for (;; a++, b++)
+			{
+				char ca = NormalizePathChar(*a);
+				if (ca != NormalizePathChar(*b))
+					return false;
+				if (0 == ca)
+					return true;
+			}
+		}
+	}
+}
@@ -43,6 +43,7 @@ namespace tofu
 	class PhysicsComponentData
 	{
 		friend class PhysicsSystem;
+		template<class> friend class Component;
 
 	public:
 		PhysicsComponentData() : PhysicsComponentData(Entity()) {}
@@ -62,8 +63,7 @@ namespace tofu
 			lockRotX(false),
 			lockRotY(false),
 			lockRotZ(false),
-			lastWorldPosition(),
-			lastWorldRotation(),
+			transformVersion(0),
 			isCollided(false),
 			dirty(true)
 		{}
@@ -155,8 +155,8 @@ namespace tofu
 		bool				lockRotY;
 		bool				lockRotZ;
 
-		math::float3		lastWorldPosition;
-		math::quat			lastWorldRotation;
+		// TransformComponent::GetVersion() when transform and rigid body last matched
+		uint32_t			transformVersion;
 
 		bool				isCollided;
 
@@ -3,8 +3,11 @@
 #include "Engine.h"
 #include "PhysicsComponent.h"
 #include "TransformComponent.h"
+#include "PoolAllocator.h"
+#include "View.h"
 
 #include <btBulletDynamicsCommon.h>
+#include <cassert>
 
 
 namespace
@@ -18,6 +21,53 @@ namespace
 	{
 		return btQuaternion(q.x, q.y, q.z, q.w);
 	}
+
+	// rigid bodies and shapes are re-created every time a component gets dirty
+	tofu::PoolAllocator<btRigidBody>			rigidBodyPool;
+	tofu::PoolAllocator<btDefaultMotionState>	motionStatePool;
+	tofu::PoolAllocator<btBoxShape>				boxShapePool;
+	tofu::PoolAllocator<btSphereShape>			sphereShapePool;
+	tofu::PoolAllocator<btCapsuleShape>			capsuleShapePool;
+	tofu::PoolAllocator<btCylinderShape>		cylinderShapePool;
+
+	btCollisionShape* CreateCollider(const tofu::ColliderDesc& desc)
+	{
+		switch (desc.type)
+		{
+		case tofu::ColliderType::Box:
+			return boxShapePool.Create(btVec3(desc.halfExtends));
+		case tofu::ColliderType::Sphere:
+			return sphereShapePool.Create(desc.radius);
+		case tofu::ColliderType::Capsule:
+			return capsuleShapePool.Create(desc.radius, desc.height);
+		case tofu::ColliderType::Cylinder:
+			return cylinderShapePool.Create(btVec3(desc.halfExtends));
+		}
+		return nullptr;
+	}
+
+	// collider desc may have changed since creation, so check the actual shape
+	void DestroyCollider(btCollisionShape* shape)
+	{
+		switch (shape->getShapeType())
+		{
+		case BOX_SHAPE_PROXYTYPE:
+			boxShapePool.Destroy(static_cast<btBoxShape*>(shape));
+			break;
+		case SPHERE_SHAPE_PROXYTYPE:
+			sphereShapePool.Destroy(static_cast<btSphereShape*>(shape));
+			break;
+		case CAPSULE_SHAPE_PROXYTYPE:
+			capsuleShapePool.Destroy(static_cast<btCapsuleShape*>(shape));
+			break;
+		case CYLINDER_SHAPE_PROXYTYPE:
+			cylinderShapePool.Destroy(static_cast<btCylinderShape*>(shape));
+			break;
+		default:
+			assert(false && "collider is not created by physics system");
+			break;
+		}
+	}
 }
 
 namespace tofu
@@ -52,20 +102,28 @@ namespace tofu
 				{
 					if (comp.rigidbody->getMotionState())
 					{
-						delete comp.rigidbody->getMotionState();
+						motionStatePool.Destroy(static_cast<btDefaultMotionState*>(comp.rigidbody->getMotionState()));
 					}
 					world->removeRigidBody(comp.rigidbody);
-					delete comp.rigidbody;
+					rigidBodyPool.Destroy(comp.rigidbody);
 					comp.rigidbody = nullptr;
 				}
 				if (nullptr != comp.collider)
 				{
-					delete comp.collider;
+					DestroyCollider(comp.collider);
 					comp.collider = nullptr;
 				}
 			}
 		}
 
+		// pools take memory from level heap, give it back before it shuts down
+		rigidBodyPool.Release();
+		motionStatePool.Release();
+		boxShapePool.Release();
+		sphereShapePool.Release();
+		capsuleShapePool.Release();
+		cylinderShapePool.Release();
+
 		delete world;
 		delete solver;
 		delete pairCache;
@@ -83,19 +141,12 @@ namespace tofu
 
 	int32_t PhysicsSystem::Update()
 	{
-		PhysicsComponentData* comps = PhysicsComponent::GetAllComponents();
-		uint32_t count = PhysicsComponent::GetNumComponents();
+		TF_MEMORY_TAG("PhysicsSystem::Update");
 
-		for (uint32_t i = 0; i < count; i++)
-		{
-			PhysicsComponentData& comp = comps[i];
-
-			TransformComponent t = comp.entity.GetComponent<TransformComponent>();
-			if (!t)
-			{
-				return TF_UNKNOWN_ERR;
-			}
+		View<PhysicsComponent, TransformComponent> view;
 
+		view.Each([&](Entity e, PhysicsComponentData& comp, TransformComponentData& t)
+		{
 			// create or re-create collision shape and rigidbody if necessary
 			if (comp.dirty)
 			{
@@ -103,42 +154,27 @@ namespace tofu
 				{
 					if (comp.rigidbody->getMotionState())
 					{
-						delete comp.rigidbody->getMotionState();
+						motionStatePool.Destroy(static_cast<btDefaultMotionState*>(comp.rigidbody->getMotionState()));
 					}
 					world->removeRigidBody(comp.rigidbody);
-					delete comp.rigidbody;
+					rigidBodyPool.Destroy(comp.rigidbody);
 					comp.rigidbody = nullptr;
 				}
 				if (nullptr != comp.collider)
 				{
-					delete comp.collider;
+					DestroyCollider(comp.collider);
 					comp.collider = nullptr;
 				}
 
 				{
-					math::quat rot = t->GetWorldRotation();
-					math::float3 pos = t->GetWorldPosition() + 
+					math::quat rot = t.GetWorldRotation();
+					math::float3 pos = t.GetWorldPosition() + 
 						rot.rotate(comp.colliderDesc.origin);
 					
 					btTransform btTrans(btQuat(rot), btVec3(pos));
 					
-					switch (comp.colliderDesc.type)
-					{
-					case ColliderType::Box:
-						comp.collider = new btBoxShape(btVec3(comp.colliderDesc.halfExtends));
-						break;
-					case ColliderType::Sphere:
-						comp.collider = new btSphereShape(comp.colliderDesc.radius);
-						break;
-					case ColliderType::Capsule:
-						comp.collider = new btCapsuleShape(
-							comp.colliderDesc.radius,
-							comp.colliderDesc.height);
-						break;
-					case ColliderType::Cylinder:
-						comp.collider = new btCylinderShape(btVec3(comp.colliderDesc.halfExtends));
-						break;
-					}
+					comp.collider = CreateCollider(comp.colliderDesc);
+					assert(nullptr != comp.collider);
 
 					btVector3 inertia(0, 0, 0);
 					float mass = 0.0f;
@@ -148,9 +184,9 @@ namespace tofu
 						comp.collider->calculateLocalInertia(mass, inertia);
 					}
 
-					btDefaultMotionState* motionState = new btDefaultMotionState(btTrans);
+					btDefaultMotionState* motionState = motionStatePool.Create(btTrans);
 					btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, motionState, comp.collider, inertia);
-					comp.rigidbody = new btRigidBody(rbInfo);
+					comp.rigidbody = rigidBodyPool.Create(rbInfo);
 					
 					if (comp.isKinematic)
 					{
@@ -185,11 +221,12 @@ namespace tofu
 				}
 
 				comp.dirty = false;
+				comp.transformVersion = TransformComponent::GetVersion(e);
 			}
 			else if (comp.isKinematic)
 			{
-				math::quat rot = t->GetWorldRotation();
-				math::float3 pos = t->GetWorldPosition() +
+				math::quat rot = t.GetWorldRotation();
+				math::float3 pos = t.GetWorldPosition() +
 					rot.rotate(comp.colliderDesc.origin);
 
 				btTransform btTrans(btQuat(rot), btVec3(pos));
@@ -197,18 +234,13 @@ namespace tofu
 			}
 			else if (!comp.isStatic) // normal dynamic rigid bodies
 			{
-				math::quat entityRot = t->GetWorldRotation();
-				math::float3 entityPos = t->GetWorldPosition();
-
-				// if it moved since last frame
-				if (entityRot.x != comp.lastWorldRotation.x ||
-					entityRot.y != comp.lastWorldRotation.y ||
-					entityRot.z != comp.lastWorldRotation.z ||
-					entityRot.w != comp.lastWorldRotation.w ||
-					entityPos.x != comp.lastWorldPosition.x ||
-					entityPos.y != comp.lastWorldPosition.y ||
-					entityPos.z != comp.lastWorldPosition.z)
+				// if something else moved it since physics did
+				uint32_t version = TransformComponent::GetVersion(e);
+				if (version != comp.transformVersion)
 				{
+					math::quat entityRot = t.GetWorldRotation();
+					math::float3 entityPos = t.GetWorldPosition();
+
 					comp.rigidbody->activate();
 
 					math::float3 pos = entityPos +
@@ -216,31 +248,35 @@ namespace tofu
 
 					btTransform btTrans(btQuat(entityRot), btVec3(pos));
 					comp.rigidbody->setWorldTransform(btTrans);
+
+					comp.transformVersion = version;
 				}
 			}
-		}
+		});
 
 		world->stepSimulation(Time::DeltaTime, 10);
 
-		for (uint32_t i = 0; i < count; i++)
+		int32_t err = TF_OK;
+
+		view.Each([&](Entity e, PhysicsComponentData& comp, TransformComponentData& t)
 		{
-			PhysicsComponentData& comp = comps[i];
 			if (nullptr == comp.rigidbody)
 			{
-				return TF_UNKNOWN_ERR;
+				err = TF_UNKNOWN_ERR;
+				return;
 			}
 
 			comp.isCollided = false;
 
 			if (comp.isStatic /*|| comp.isKinematic*/)
 			{
-				continue;
+				return;
 			}
 
-			TransformComponent t = comp.entity.GetComponent<TransformComponent>();
-			if (!t)
+			// sleeping bodies don't move, their transforms are left unchanged
+			if (!comp.isKinematic && !comp.rigidbody->isActive())
 			{
-				return TF_UNKNOWN_ERR;
+				return;
 			}
 
 			btTransform btTrans;
@@ -253,12 +289,15 @@ namespace tofu
 			pos -= rot.rotate(comp.colliderDesc.origin);
 
 			// TODO world position & rotation actually
-			t->SetLocalPosition(pos);
-			t->SetLocalRotation(rot);
+			t.SetLocalPosition(pos);
+			t.SetLocalRotation(rot);
+
+			comp.transformVersion = TransformComponent::GetVersion(e);
+		});
 
-			comp.lastWorldPosition = pos;
-			comp.lastWorldRotation = rot;
-			
+		if (TF_OK != err)
+		{
+			return err;
 		}
 
 		int numManifolds = dispatcher->getNumManifolds();
@@ -283,5 +322,15 @@ namespace tofu
 		world->setGravity(btVector3(g.x, g.y, g.z));
 	}
 
+	ComponentMask PhysicsSystem::GetReadMask() const
+	{
+		return ComponentTypes::GetMask<PhysicsComponentData>() | ComponentTypes::GetMask<TransformComponentData>();
+	}
+
+	ComponentMask PhysicsSystem::GetWriteMask() const
+	{
+		return ComponentTypes::GetMask<PhysicsComponentData>() | ComponentTypes::GetMask<TransformComponentData>();
+	}
+
 }
 
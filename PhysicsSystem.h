@@ -32,6 +32,11 @@ namespace tofu
 
 		int32_t Update() override;
 
+		// reads and moves transforms of physics components
+		ComponentMask GetReadMask() const override;
+
+		ComponentMask GetWriteMask() const override;
+
 		void SetGravity(const math::float3& g);
 
 	private:
@@ -0,0 +1,361 @@
+#pragma once
+
+#include "Common.h"
+#include "MemoryAllocator.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace tofu
+{
+	// Fixed size object pool, allocate and deallocate at O(1).
+	// Free slots are linked through their own memory (intrusive free list),
+	// slots are carved from blocks of BlockSize objects taken from allocator[allocNo].
+	// With thread cache enabled, each thread keeps a few free slots of its own
+	// and only touches the shared list (behind a lock) in batches.
+	// A cache taken over by another pool of same type gives its slots back to its pool first.
+	template<class T, uint32_t BlockSize = 64>
+	class PoolAllocator
+	{
+	public:
+		// max number of free slots kept by one thread
+		static constexpr uint32_t THREAD_CACHE_SIZE = 32;
+
+		// pools of same type that can use thread cache at once
+		static constexpr uint32_t MAX_THREAD_CACHES = 16;
+
+	private:
+		struct FreeNode
+		{
+			FreeNode*	next;
+		};
+
+		struct BlockHeader
+		{
+			BlockHeader* next;
+		};
+
+		struct ThreadCache
+		{
+			PoolAllocator*	pool;
+			uint64_t		owner;
+			FreeNode*		head;
+			uint32_t		count;
+		};
+
+		static constexpr size_t SlotAlignment = alignof(T) > alignof(FreeNode) ? alignof(T) : alignof(FreeNode);
+
+		static constexpr size_t SlotSize = ((sizeof(T) > sizeof(FreeNode) ? sizeof(T) : sizeof(FreeNode)) + SlotAlignment - 1) & ~(SlotAlignment - 1);
+
+		static constexpr size_t SlotsOffset = (sizeof(BlockHeader) + SlotAlignment - 1) & ~(SlotAlignment - 1);
+
+#ifdef _DEBUG
+		static constexpr uint8_t FreshPattern = 0xCD;
+		static constexpr uint8_t FreedPattern = 0xDD;
+#endif
+
+	public:
+		explicit PoolAllocator(uint32_t allocNo = ALLOC_LEVEL_BASED_HEAP, bool threadCache = false)
+			:
+			allocNo(allocNo),
+			threadCache(threadCache),
+			serial(++NextSerial),
+			freeList(nullptr),
+			blocks(nullptr),
+			numAllocated(0),
+			prevLive(nullptr),
+			nextLive(nullptr)
+		{
+			if (threadCache)
+			{
+				std::lock_guard<std::mutex> guard(LiveLock);
+				nextLive = LivePools;
+				if (nullptr != LivePools) LivePools->prevLive = this;
+				LivePools = this;
+			}
+		}
+
+		~PoolAllocator()
+		{
+			if (threadCache)
+			{
+				std::lock_guard<std::mutex> guard(LiveLock);
+				if (nullptr != prevLive) prevLive->nextLive = nextLive;
+				else LivePools = nextLive;
+				if (nullptr != nextLive) nextLive->prevLive = prevLive;
+			}
+
+			Release();
+		}
+
+		PoolAllocator(const PoolAllocator&) = delete;
+		PoolAllocator& operator = (const PoolAllocator&) = delete;
+
+		// allocate and construct
+		template<class... Args>
+		T* Create(Args&&... args)
+		{
+			void* ptr = Allocate();
+			if (nullptr == ptr) return nullptr;
+			return new (ptr) T(std::forward<Args>(args)...);
+		}
+
+		// destruct and deallocate
+		void Destroy(T* ptr)
+		{
+			if (nullptr == ptr) return;
+			ptr->~T();
+			Deallocate(ptr);
+		}
+
+		void* Allocate()
+		{
+			FreeNode* node = nullptr;
+
+			if (threadCache)
+			{
+				ThreadCache& cache = GetThreadCache();
+				if (nullptr == cache.head)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					Refill(cache);
+				}
+
+				node = cache.head;
+				if (nullptr != node)
+				{
+					cache.head = node->next;
+					cache.count--;
+				}
+			}
+			else
+			{
+				if (nullptr == freeList)
+				{
+					Grow();
+				}
+
+				node = freeList;
+				if (nullptr != node)
+				{
+					freeList = node->next;
+				}
+			}
+
+			if (nullptr == node)
+			{
+				return nullptr;
+			}
+
+			numAllocated.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef _DEBUG
+			// any write to a freed slot shows up here
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(node);
+			for (size_t i = sizeof(FreeNode); i < SlotSize; i++)
+			{
+				assert((bytes[i] == FreedPattern || bytes[i] == FreshPattern) && "pool slot modified after free");
+			}
+#endif
+			return node;
+		}
+
+		void Deallocate(void* ptr)
+		{
+			if (nullptr == ptr) return;
+
+			assert(numAllocated.load(std::memory_order_relaxed) > 0);
+			numAllocated.fetch_sub(1, std::memory_order_relaxed);
+
+#ifdef _DEBUG
+			memset(ptr, FreedPattern, SlotSize);
+#endif
+
+			FreeNode* node = reinterpret_cast<FreeNode*>(ptr);
+
+			if (threadCache)
+			{
+				ThreadCache& cache = GetThreadCache();
+				node->next = cache.head;
+				cache.head = node;
+				cache.count++;
+
+				// give half of the cache back to shared list
+				if (cache.count > THREAD_CACHE_SIZE)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					Flush(cache, THREAD_CACHE_SIZE / 2);
+				}
+			}
+			else
+			{
+				node->next = freeList;
+				freeList = node;
+			}
+		}
+
+		// give all blocks back to allocator, every object must be destroyed already.
+		// slots still kept in thread caches are discarded.
+		void Release()
+		{
+			assert(numAllocated.load(std::memory_order_relaxed) == 0 && "objects are still alive");
+
+			// other threads may be evicting caches of this pool
+			std::unique_lock<std::mutex> liveGuard(LiveLock, std::defer_lock);
+			std::unique_lock<std::mutex> guard(lock, std::defer_lock);
+			if (threadCache)
+			{
+				liveGuard.lock();
+				guard.lock();
+			}
+
+			BlockHeader* block = blocks;
+			while (nullptr != block)
+			{
+				BlockHeader* next = block->next;
+				MemoryAllocator::Allocators[allocNo].Deallocate(block);
+				block = next;
+			}
+
+			blocks = nullptr;
+			freeList = nullptr;
+
+			// caches of other threads are left behind, they are dropped by serial check
+			serial = ++NextSerial;
+		}
+
+		uint32_t GetNumAllocated() const { return numAllocated.load(std::memory_order_relaxed); }
+
+	private:
+		// add a new block of slots to shared free list
+		void Grow()
+		{
+			void* mem = MemoryAllocator::Allocators[allocNo].Allocate(SlotsOffset + SlotSize * BlockSize, SlotAlignment);
+			if (nullptr == mem)
+			{
+				return;
+			}
+
+			BlockHeader* block = reinterpret_cast<BlockHeader*>(mem);
+			block->next = blocks;
+			blocks = block;
+
+			uint8_t* slots = reinterpret_cast<uint8_t*>(mem) + SlotsOffset;
+
+#ifdef _DEBUG
+			memset(slots, FreshPattern, SlotSize * BlockSize);
+#endif
+
+			// link in reverse so slots are handed out in address order
+			for (uint32_t i = BlockSize; i > 0; i--)
+			{
+				FreeNode* node = reinterpret_cast<FreeNode*>(slots + SlotSize * (i - 1));
+				node->next = freeList;
+				freeList = node;
+			}
+		}
+
+		// move up to half a cache from shared list, lock must be held
+		void Refill(ThreadCache& cache)
+		{
+			if (nullptr == freeList)
+			{
+				Grow();
+			}
+
+			while (nullptr != freeList && cache.count < THREAD_CACHE_SIZE / 2)
+			{
+				FreeNode* node = freeList;
+				freeList = node->next;
+				node->next = cache.head;
+				cache.head = node;
+				cache.count++;
+			}
+		}
+
+		// move slots from cache back to shared list until 'keep' are left, lock must be held
+		void Flush(ThreadCache& cache, uint32_t keep)
+		{
+			while (cache.count > keep)
+			{
+				FreeNode* node = cache.head;
+				cache.head = node->next;
+				cache.count--;
+				node->next = freeList;
+				freeList = node;
+			}
+		}
+
+		ThreadCache& GetThreadCache()
+		{
+			ThreadCache& cache = ThreadCaches[serial % MAX_THREAD_CACHES];
+
+			if (cache.owner != serial)
+			{
+				if (nullptr != cache.head)
+				{
+					Evict(cache);
+				}
+
+				cache.pool = this;
+				cache.owner = serial;
+				cache.head = nullptr;
+				cache.count = 0;
+			}
+			return cache;
+		}
+
+		// slots of a cache owned by another pool go back to that pool if it is still alive,
+		// ones of a released or destroyed pool went with its blocks
+		static void Evict(ThreadCache& cache)
+		{
+			std::lock_guard<std::mutex> guard(LiveLock);
+
+			for (PoolAllocator* pool = LivePools; nullptr != pool; pool = pool->nextLive)
+			{
+				if (pool == cache.pool && pool->serial == cache.owner)
+				{
+					std::lock_guard<std::mutex> poolGuard(pool->lock);
+					pool->Flush(cache, 0);
+					break;
+				}
+			}
+		}
+
+	private:
+		uint32_t				allocNo;
+		bool					threadCache;
+		uint64_t				serial;
+
+		std::mutex				lock;
+		FreeNode*				freeList;
+		BlockHeader*			blocks;
+
+		std::atomic<uint32_t>	numAllocated;
+
+		// pools with thread cache, so evicted caches find their pool
+		PoolAllocator*			prevLive;
+		PoolAllocator*			nextLive;
+
+		static std::mutex					LiveLock;
+		static PoolAllocator*				LivePools;
+		static std::atomic<uint64_t>		NextSerial;
+		static thread_local ThreadCache		ThreadCaches[MAX_THREAD_CACHES];
+	};
+
+	template<class T, uint32_t BlockSize>
+	std::mutex PoolAllocator<T, BlockSize>::LiveLock;
+
+	template<class T, uint32_t BlockSize>
+	PoolAllocator<T, BlockSize>* PoolAllocator<T, BlockSize>::LivePools = nullptr;
+
+	template<class T, uint32_t BlockSize>
+	std::atomic<uint64_t> PoolAllocator<T, BlockSize>::NextSerial(0);
+
+	template<class T, uint32_t BlockSize>
+	thread_local typename PoolAllocator<T, BlockSize>::ThreadCache PoolAllocator<T, BlockSize>::ThreadCaches[MAX_THREAD_CACHES];
+}
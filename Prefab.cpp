@@ -0,0 +1,42 @@
+#include "Prefab.h"
+
+namespace tofu
+{
+	Prefab::~Prefab()
+	{
+		for (uint32_t i = 0; i < numEntries; i++)
+		{
+			entries[i].destroy(entries[i].value);
+		}
+	}
+
+	int32_t Prefab::Reserve(uint32_t count) const
+	{
+		for (uint32_t i = 0; i < numEntries; i++)
+		{
+			CHECKED(entries[i].reserve(count));
+		}
+		return TF_OK;
+	}
+
+	int32_t Prefab::Instantiate(Entity* entities, uint32_t count) const
+	{
+		CHECKED(Entity::CreateBatch(entities, count));
+
+		for (uint32_t i = 0; i < numEntries; i++)
+		{
+			int32_t err = entries[i].create(entries[i].value, entities, count);
+			if (TF_OK != err)
+			{
+				// components added so far go with them at end of frame
+				for (uint32_t j = 0; j < count; j++)
+				{
+					entities[j].Destroy();
+				}
+				return err;
+			}
+		}
+
+		return TF_OK;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Common.h"
+#include "Component.h"
+#include "Entity.h"
+
+namespace tofu
+{
+	// set of component types, with values entities are spawned with (SpawnBatch()).
+	// values are copied to every instance as they are, only the owner entity is set,
+	// so models and materials they point to are shared by all instances
+	class Prefab
+	{
+	public:
+		Prefab() : entries(), numEntries(0) {}
+
+		~Prefab();
+
+		Prefab(const Prefab&) = delete;
+		Prefab& operator = (const Prefab&) = delete;
+
+		// T is a handle type, like TransformComponent. adding a type again replaces its value
+		template<class T>
+		int32_t Add(const typename T::component_data_t& value = typename T::component_data_t());
+
+		TF_INLINE uint32_t GetNumComponents() const { return numEntries; }
+
+		// commit component slots of every type for count more instances
+		int32_t Reserve(uint32_t count) const;
+
+		// create count entities with all components of prefab into entities,
+		// storage of each component type is grown once for all of them
+		int32_t Instantiate(Entity* entities, uint32_t count) const;
+
+	private:
+		struct Entry
+		{
+			int32_t		(*reserve)(uint32_t count);
+			// value is a T
+			int32_t		(*create)(const void* value, const Entity* entities, uint32_t count);
+			void		(*destroy)(void* value);
+			void*		value;
+		};
+
+		template<class T>
+		struct Ops
+		{
+			static int32_t Create(const void* value, const Entity* entities, uint32_t count)
+			{
+				return Component<T>::CreateBatch(entities, count, *reinterpret_cast<const T*>(value));
+			}
+
+			static void Destroy(void* value)
+			{
+				delete reinterpret_cast<T*>(value);
+			}
+		};
+
+		Entry		entries[MAX_PREFAB_COMPONENTS];
+		uint32_t	numEntries;
+	};
+
+	template<class T>
+	int32_t Prefab::Add(const typename T::component_data_t& value)
+	{
+		typedef typename T::component_data_t data_t;
+
+		for (uint32_t i = 0; i < numEntries; i++)
+		{
+			if (entries[i].create == &Ops<data_t>::Create)
+			{
+				*reinterpret_cast<data_t*>(entries[i].value) = value;
+				return TF_OK;
+			}
+		}
+
+		if (numEntries >= MAX_PREFAB_COMPONENTS)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		entries[numEntries++] = { &Component<data_t>::Reserve, &Ops<data_t>::Create, &Ops<data_t>::Destroy, new data_t(value) };
+		return TF_OK;
+	}
+
+	// spawn count instances of prefab, then init(Entity, uint32_t i) on each of them.
+	// component slots for all of them are committed first, entities are then
+	// created and filled SPAWN_BATCH_SIZE at a time. main thread only
+	template<class Func>
+	int32_t SpawnBatch(const Prefab& prefab, uint32_t count, Func init)
+	{
+		CHECKED(prefab.Reserve(count));
+
+		Entity batch[SPAWN_BATCH_SIZE];
+
+		for (uint32_t first = 0; first < count; first += SPAWN_BATCH_SIZE)
+		{
+			uint32_t num = count - first < SPAWN_BATCH_SIZE ? count - first : SPAWN_BATCH_SIZE;
+
+			CHECKED(prefab.Instantiate(batch, num));
+
+			for (uint32_t i = 0; i < num; i++)
+			{
+				init(batch[i], first + i);
+			}
+		}
+
+		return TF_OK;
+	}
+
+	inline int32_t SpawnBatch(const Prefab& prefab, uint32_t count)
+	{
+		return SpawnBatch(prefab, count, [](Entity, uint32_t) {});
+	}
+}
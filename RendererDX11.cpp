@@ -440,7 +440,7 @@ namespace tofu
 				CreateBufferParams* params = reinterpret_cast<CreateBufferParams*>(_params);
 
 				assert(true == params->handle);
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				bool isShaderResource = ((params->bindingFlags & BINDING_SHADER_RESOURCE) != 0u);
 
@@ -508,7 +508,7 @@ namespace tofu
 				UpdateBufferParams* params = reinterpret_cast<UpdateBufferParams*>(_params);
 
 				assert(true == params->handle);
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr != buffers[id].buf);
 				assert(params->size > 0 && params->offset + params->size <= buffers[id].size);
@@ -559,7 +559,7 @@ namespace tofu
 				BufferHandle* handle = reinterpret_cast<BufferHandle*>(params);
 
 				assert(true == *handle);
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != buffers[id].buf);
 
@@ -579,9 +579,9 @@ namespace tofu
 			{
 				CreateTextureParams* params = reinterpret_cast<CreateTextureParams*>(_params);
 
-				assert(true == params->handle && params->handle.id < MAX_TEXTURES);
+				assert(true == params->handle && params->handle.Index() < MAX_TEXTURES);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr == textures[id].tex);
 
@@ -670,9 +670,9 @@ namespace tofu
 			{
 				UpdateTextureParams* params = reinterpret_cast<UpdateTextureParams*>(_params);
 
-				assert(true == params->handle && params->handle.id < MAX_TEXTURES);
+				assert(true == params->handle && params->handle.Index() < MAX_TEXTURES);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr != textures[id].tex);
 
@@ -707,9 +707,9 @@ namespace tofu
 			{
 				TextureHandle* handle = reinterpret_cast<TextureHandle*>(params);
 
-				assert(true == *handle && handle->id < MAX_TEXTURES);
+				assert(true == *handle && handle->Index() < MAX_TEXTURES);
 
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != textures[id].tex);
 
@@ -738,7 +738,7 @@ namespace tofu
 
 				assert(true == params->handle);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr == samplers[id].samp);
 
@@ -758,7 +758,7 @@ namespace tofu
 
 				assert(true == *handle);
 
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != samplers[id].samp);
 
@@ -775,12 +775,12 @@ namespace tofu
 
 				assert(true == params->handle);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr == vertexShaders[id].shader);
 
 				// store binary code for further use (input layout)
-				void* ptr = MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_MEM].Allocate(params->size, 4);
+				void* ptr = MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_VMEM].Allocate(params->size, 4);
 				assert(nullptr != ptr);
 				memcpy(ptr, params->data, params->size);
 
@@ -798,7 +798,7 @@ namespace tofu
 
 				assert(true == *handle);
 
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != vertexShaders[id].shader);
 
@@ -815,12 +815,12 @@ namespace tofu
 
 				assert(true == params->handle);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr == pixelShaders[id].shader);
 
 				// store binary code for further use
-				void* ptr = MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_MEM].Allocate(params->size, 4);
+				void* ptr = MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_VMEM].Allocate(params->size, 4);
 				assert(nullptr != ptr);
 				memcpy(ptr, params->data, params->size);
 
@@ -838,7 +838,7 @@ namespace tofu
 
 				assert(true == *handle);
 
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != pixelShaders[id].shader);
 
@@ -855,7 +855,7 @@ namespace tofu
 
 				assert(true == params->handle);
 
-				uint32_t id = params->handle.id;
+				uint32_t id = params->handle.Index();
 
 				assert(nullptr == pipelineStates[id].depthStencilState);
 
@@ -872,8 +872,8 @@ namespace tofu
 				CD3D11_BLEND_DESC blendState(D3D11_DEFAULT);
 				DXCHECKED(device->CreateBlendState(&blendState, &(pipelineStates[id].blendState)));
 
-				assert(true == params->vertexShader && nullptr != vertexShaders[params->vertexShader.id].shader);
-				assert(true == params->pixelShader && nullptr != pixelShaders[params->vertexShader.id].shader);
+				assert(true == params->vertexShader && nullptr != vertexShaders[params->vertexShader.Index()].shader);
+				assert(true == params->pixelShader && nullptr != pixelShaders[params->vertexShader.Index()].shader);
 
 				DXCHECKED(device->CreateInputLayout(
 					InputElemDescTable[params->vertexFormat],
@@ -899,7 +899,7 @@ namespace tofu
 
 				assert(true == *handle);
 
-				uint32_t id = handle->id;
+				uint32_t id = handle->Index();
 
 				assert(nullptr != pipelineStates[id].depthStencilState);
 
@@ -924,7 +924,7 @@ namespace tofu
 						break;
 					}
 
-					uint32_t id = params->renderTargets[i].id;
+					uint32_t id = params->renderTargets[i].Index();
 					assert(nullptr != textures[id].rtv);
 
 					context->ClearRenderTargetView(textures[id].rtv, params->clearColor);
@@ -932,7 +932,7 @@ namespace tofu
 
 				if (params->depthRenderTarget)
 				{
-					uint32_t id = params->depthRenderTarget.id;
+					uint32_t id = params->depthRenderTarget.Index();
 					assert(nullptr != textures[id].dsv);
 
 					context->ClearDepthStencilView(
@@ -954,11 +954,11 @@ namespace tofu
 				// change pipeline states if necessary
 				if (params->pipelineState.id != currentPipelineState.id)
 				{
-					PipelineState& pso = pipelineStates[params->pipelineState.id];
+					PipelineState& pso = pipelineStates[params->pipelineState.Index()];
 
 					context->IASetInputLayout(pso.inputLayout);
-					context->VSSetShader(vertexShaders[pso.vertexShader.id].shader, nullptr, 0);
-					context->PSSetShader(pixelShaders[pso.pixelShader.id].shader, nullptr, 0);
+					context->VSSetShader(vertexShaders[pso.vertexShader.Index()].shader, nullptr, 0);
+					context->PSSetShader(pixelShaders[pso.pixelShader.Index()].shader, nullptr, 0);
 					context->RSSetState(pso.rasterizerState);
 					context->RSSetViewports(1, &(pso.viewport));
 					context->OMSetDepthStencilState(pso.depthStencilState, 0u);
@@ -978,7 +978,7 @@ namespace tofu
 					{
 						if (params->vsConstantBuffers[i].bufferHandle)
 						{
-							Buffer& buf = buffers[params->vsConstantBuffers[i].bufferHandle.id];
+							Buffer& buf = buffers[params->vsConstantBuffers[i].bufferHandle.Index()];
 							assert(nullptr != buf.buf);
 							if (!(buf.bindingFlags & BINDING_CONSTANT_BUFFER))
 							{
@@ -1002,8 +1002,12 @@ namespace tofu
 					{
 						if (params->vsTextures[i])
 						{
-							Texture& tex = textures[params->vsTextures[i].id];
-							assert(nullptr != tex.srv);
+							Texture& tex = textures[params->vsTextures[i].Index()];
+							// texture is still being read asynchronously, leave the slot empty
+							if (nullptr == tex.srv)
+							{
+								continue;
+							}
 							if (!(tex.bindingFlags & BINDING_SHADER_RESOURCE))
 							{
 								return TF_UNKNOWN_ERR;
@@ -1020,7 +1024,7 @@ namespace tofu
 					{
 						if (params->vsSamplers[i])
 						{
-							Sampler& samp = samplers[params->vsSamplers[i].id];
+							Sampler& samp = samplers[params->vsSamplers[i].Index()];
 							assert(nullptr != samp.samp);
 
 							samps[i] = samp.samp;
@@ -1040,7 +1044,7 @@ namespace tofu
 					{
 						if (params->psConstantBuffers[i].bufferHandle)
 						{
-							Buffer& buf = buffers[params->psConstantBuffers[i].bufferHandle.id];
+							Buffer& buf = buffers[params->psConstantBuffers[i].bufferHandle.Index()];
 							assert(nullptr != buf.buf);
 							if (!(buf.bindingFlags & BINDING_CONSTANT_BUFFER))
 							{
@@ -1064,8 +1068,12 @@ namespace tofu
 					{
 						if (params->psTextures[i])
 						{
-							Texture& tex = textures[params->psTextures[i].id];
-							assert(nullptr != tex.srv);
+							Texture& tex = textures[params->psTextures[i].Index()];
+							// texture is still being read asynchronously, leave the slot empty
+							if (nullptr == tex.srv)
+							{
+								continue;
+							}
 							if (!(tex.bindingFlags & BINDING_SHADER_RESOURCE))
 							{
 								return TF_UNKNOWN_ERR;
@@ -1082,7 +1090,7 @@ namespace tofu
 					{
 						if (params->psSamplers[i])
 						{
-							Sampler& samp = samplers[params->psSamplers[i].id];
+							Sampler& samp = samplers[params->psSamplers[i].Index()];
 							assert(nullptr != samp.samp);
 
 							samps[i] = samp.samp;
@@ -1095,7 +1103,7 @@ namespace tofu
 				{
 					// set vertex buffer
 					assert(true == params->vertexBuffer);
-					Buffer& vb = buffers[params->vertexBuffer.id];
+					Buffer& vb = buffers[params->vertexBuffer.Index()];
 					if (!(vb.bindingFlags & BINDING_VERTEX_BUFFER))
 					{
 						return TF_UNKNOWN_ERR;
@@ -1111,7 +1119,7 @@ namespace tofu
 
 					// set index buffer
 					assert(true == params->indexBuffer);
-					Buffer& ib = buffers[params->indexBuffer.id];
+					Buffer& ib = buffers[params->indexBuffer.Index()];
 					if (!(ib.bindingFlags & BINDING_INDEX_BUFFER))
 					{
 						return TF_UNKNOWN_ERR;
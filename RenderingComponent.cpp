@@ -0,0 +1,18 @@
+#include "RenderingComponent.h"
+
+#include "SceneSnapshot.h"
+
+#include <cstddef>
+
+namespace tofu
+{
+	int32_t RenderingComponentData::AddSnapshotType(SceneSnapshot& snapshot)
+	{
+		const SnapshotField fields[] =
+		{
+			{ offsetof(RenderingComponentData, model), scene::SCENE_FIXUP_ASSET },
+			{ offsetof(RenderingComponentData, material), scene::SCENE_FIXUP_ASSET },
+		};
+		return snapshot.AddType<RenderingComponent>("RenderingComponent", fields, 2);
+	}
+}
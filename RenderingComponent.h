@@ -1,16 +1,19 @@
 #pragma once
 
 #include "Component.h"
+#include "TofuMath.h"
 
 namespace tofu
 {
 	class RenderingSystem;
+	class SceneSnapshot;
 	class Model;
 	class Material;
 
 	class RenderingComponentData
 	{
 		friend class RenderingSystem;
+		template<class> friend class Component;
 
 	public:
 		RenderingComponentData() : RenderingComponentData(Entity()) {}
@@ -19,22 +22,29 @@ namespace tofu
 			: 
 			entity(e),
 			model(nullptr),
-			material(nullptr)
+			material(nullptr),
+			worldMatrix()
 		{}
 
-		void SetModel(Model* model) { this->model = model; }
+		void SetModel(Model* model) { this->model = model; Component<RenderingComponentData>::MarkChanged(entity); }
 
-		void SetMaterial(Material* material) { this->material = material; }
+		void SetMaterial(Material* material) { this->material = material; Component<RenderingComponentData>::MarkChanged(entity); }
 
 		Model* GetModel() const { return model; }
 
 		Material* GetMaterial() const { return material; }
 
+		// saved bitwise, model and material are asset fields (RenderingSystem::AddSnapshotAssets())
+		static int32_t AddSnapshotType(SceneSnapshot& snapshot);
+
 	private:
 		Entity				entity;
 		Model*				model;
 		Material*			material;
 
+		// world matrix of transform, updated by rendering system when either changes
+		math::float4x4		worldMatrix;
+
 	};
 
 	typedef Component<RenderingComponentData> RenderingComponent;
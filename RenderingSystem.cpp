@@ -1,11 +1,16 @@
 #include "RenderingSystem.h"
 
 #include <cassert>
+#include <cstring>
 
 #include "Renderer.h"
 
 #include "MemoryAllocator.h"
+#include "PageAllocator.h"
 #include "FileIO.h"
+#include "IOSystem.h"
+#include "PakFormat.h"
+#include "SceneSnapshot.h"
 
 #include "ModelFormat.h"
 
@@ -13,6 +18,7 @@
 #include "CameraComponent.h"
 #include "RenderingComponent.h"
 #include "AnimationComponent.h"
+#include "View.h"
 
 namespace
 {
@@ -25,6 +31,34 @@ namespace
 		float					padding2;
 		float					padding3[4 * 15];	// 15 shader constants
 	};
+
+	// level heap blocks spread over the whole arena, huge pages save TLB misses
+	tofu::PageAllocator arenaPageAllocator(tofu::PAGE_FLAG_HUGE_PAGES | tofu::PAGE_FLAG_TRANSPARENT_HUGE_PAGES);
+
+	// transforms and animations go in the order of renderables of their entities,
+	// then ones without a renderable, parents before children
+	uint64_t follow_rendering_key(tofu::Entity e, uint32_t depth)
+	{
+		tofu::RenderingComponent r = e.GetComponent<tofu::RenderingComponent>();
+		if (r)
+		{
+			uint32_t loc = tofu::RenderingComponent::GetIndexTable()[e.Index()].idx;
+			return static_cast<uint64_t>(loc) << tofu::HANDLE_INDEX_BITS | e.Index();
+		}
+
+		return 1ull << 40 | static_cast<uint64_t>(depth) << tofu::HANDLE_INDEX_BITS | e.Index();
+	}
+
+	// levels above a transform, deep hierarchies are counted as the same depth
+	uint32_t transform_depth(const tofu::TransformComponentData& t)
+	{
+		uint32_t depth = 0;
+		for (tofu::TransformComponent p = t.GetParent(); p && depth < 255; p = p->GetParent())
+		{
+			depth++;
+		}
+		return depth;
+	}
 }
 
 namespace tofu
@@ -37,7 +71,7 @@ namespace tofu
 		modelHandleAlloc(),
 		meshHandleAlloc(),
 		materialHandleAlloc(),
-		modelTable(),
+		modelTable(nullptr),
 		bufferHandleAlloc(),
 		textureHandleAlloc(),
 		samplerHandleAlloc(),
@@ -46,6 +80,7 @@ namespace tofu
 		pipelineStateHandleAlloc(),
 		frameNo(0),
 		allocNo(0),
+		lastUpdateFrame(0),
 		transformBuffer(),
 		transformBufferSize(0),
 		frameConstantBuffer(),
@@ -57,7 +92,12 @@ namespace tofu
 		materialPSs(),
 		defaultSampler(),
 		builtinCube(),
-		cmdBuf(nullptr)
+		renderingSorter(),
+		transformSorter(),
+		animationSorter(),
+		cmdBuf(nullptr),
+		uploadBuffers(),
+		numUploadBuffers(0)
 	{
 		assert(nullptr == _instance);
 		_instance = this;
@@ -72,18 +112,40 @@ namespace tofu
 
 	int32_t RenderingSystem::Init()
 	{
-		// Initialize Memory Management for Rendering
-		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_MEM].Init(
-			LEVEL_BASED_MEM_SIZE,
-			LEVEL_BASED_MEM_ALIGN));
-
-		for (uint32_t i = ALLOC_FRAME_BASED_MEM;
-			i <= ALLOC_FRAME_BASED_MEM_END;
+		// Initialize Memory Management for Rendering,
+		// bump allocators only commit the pages they reach
+		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_VMEM].Init(
+			LEVEL_BASED_VMEM_SIZE,
+			LEVEL_BASED_MEM_ALIGN,
+			nullptr,
+			ALLOC_FLAG_VIRTUAL));
+
+		// level lifetime memory that can be freed one by one,
+		// io threads read asset files into it
+		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Init(
+			LEVEL_BASED_HEAP_SIZE,
+			LEVEL_BASED_HEAP_ALIGN,
+			&arenaPageAllocator,
+			ALLOC_FLAG_TLSF | ALLOC_FLAG_CONCURRENT));
+
+		modelTable = MemoryAllocator::Allocate<ModelTable>(ALLOC_LEVEL_BASED_HEAP, alignof(ModelTable));
+		assert(nullptr != modelTable);
+
+		// temporary buffers that don't live through a whole frame
+		CHECKED(MemoryAllocator::Allocators[ALLOC_SCRATCH_MEM].Init(
+			SCRATCH_MEM_SIZE,
+			SCRATCH_MEM_ALIGN));
+
+		for (uint32_t i = ALLOC_FRAME_BASED_VMEM;
+			i <= ALLOC_FRAME_BASED_VMEM_END;
 			++i)
 		{
+			// frame memory can be filled from worker threads
 			CHECKED(MemoryAllocator::Allocators[i].Init(
-				FRAME_BASED_MEM_SIZE,
-				FRAME_BASED_MEM_ALIGN));
+				FRAME_BASED_VMEM_SIZE,
+				FRAME_BASED_MEM_ALIGN,
+				nullptr,
+				ALLOC_FLAG_CONCURRENT | ALLOC_FLAG_VIRTUAL));
 		}
 
 		// Initialize Renderer Backend
@@ -119,7 +181,7 @@ namespace tofu
 			transformBuffer = bufferHandleAlloc.Allocate();
 			assert(transformBuffer);
 
-			transformBufferSize = sizeof(math::float4x4) * 4 * MAX_ENTITIES;
+			transformBufferSize = sizeof(math::float4x4) * 4 * MAX_RENDERABLES;
 
 			{
 				CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(allocNo);
@@ -223,14 +285,28 @@ namespace tofu
 	{
 		renderer->Release();
 
-		for (uint32_t i = ALLOC_FRAME_BASED_MEM;
-			i <= ALLOC_FRAME_BASED_MEM_END;
+		for (uint32_t i = ALLOC_FRAME_BASED_VMEM;
+			i <= ALLOC_FRAME_BASED_VMEM_END;
 			++i)
 		{
 			CHECKED(MemoryAllocator::Allocators[i].Shutdown());
 		}
 
-		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_MEM].Shutdown());
+		CHECKED(MemoryAllocator::Allocators[ALLOC_SCRATCH_MEM].Shutdown());
+
+		for (uint32_t i = 0; i < modelHandleAlloc.GetNumInUse(); i++)
+		{
+			Model& model = models[modelHandleAlloc.GetHandle(i).Index()];
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(model.translationFrames);
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(const_cast<char*>(model.path));
+		}
+
+		MemoryAllocator::Deallocate(ALLOC_LEVEL_BASED_HEAP, modelTable);
+		modelTable = nullptr;
+
+		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Shutdown());
+
+		CHECKED(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_VMEM].Shutdown());
 		return TF_OK;
 	}
 
@@ -243,8 +319,14 @@ namespace tofu
 
 		//assert(false && "sync need to be done.");
 
-		allocNo = ALLOC_FRAME_BASED_MEM + frameNo % FRAME_BUFFER_COUNT;
-		MemoryAllocator::Allocators[allocNo].Reset();
+		allocNo = ALLOC_FRAME_BASED_VMEM + frameNo % FRAME_BUFFER_COUNT;
+
+		// keep as many pages as this allocator used last time, give the rest back
+		MemoryAllocator& frameAlloc = MemoryAllocator::Allocators[allocNo];
+		CHECKED(frameAlloc.Reset(frameAlloc.GetUsedSize()));
+
+		// every scratch scope of last frame should have ended
+		assert(0 == MemoryAllocator::Allocators[ALLOC_SCRATCH_MEM].GetMarker());
 
 		cmdBuf = RendererCommandBuffer::Create(COMMAND_BUFFER_CAPACITY, allocNo);
 		assert(nullptr != cmdBuf);
@@ -254,6 +336,8 @@ namespace tofu
 
 	int32_t RenderingSystem::Update()
 	{
+		TF_MEMORY_TAG("RenderingSystem::Update");
+
 		if (CameraComponent::GetNumComponents() == 0)
 		{
 			return TF_OK;
@@ -309,7 +393,7 @@ namespace tofu
 			assert(camera.skybox->type == SkyboxMaterial);
 			skyboxTex = camera.skybox->mainTex;
 
-			Mesh& mesh = meshes[builtinCube->meshes[0].id];
+			Mesh& mesh = meshes[builtinCube->meshes[0].Index()];
 
 			DrawParams* params = MemoryAllocator::Allocate<DrawParams>(allocNo);
 			params->pipelineState = materialPSOs[SkyboxMaterial];
@@ -327,36 +411,62 @@ namespace tofu
 		}
 
 		// get all renderables in system
-		RenderingComponentData* renderables = RenderingComponent::GetAllComponents();
 		uint32_t renderableCount = RenderingComponent::GetNumComponents();
 
-		// buffer for transform matrices
+		// scratch memory below is freed when Update() returns
+		ScopedMemoryMarker scratchScope(ALLOC_SCRATCH_MEM);
+
+		// buffer for transform matrices, it is read on submit so it has to live in frame memory,
+		// (at least 1 slot, so data pointer is never null)
 		math::float4x4* transformArray = reinterpret_cast<math::float4x4*>(
-			MemoryAllocator::Allocators[allocNo].Allocate(transformBufferSize, 4)
+			MemoryAllocator::Allocators[allocNo].Allocate(sizeof(math::float4x4) * 4 * (renderableCount > 0 ? renderableCount : 1), 16)
 			);
 
 		// list of active renderables (used for culling)
-		uint32_t* activeRenderables = reinterpret_cast<uint32_t*>(
-			MemoryAllocator::Allocators[allocNo].Allocate(sizeof(uint32_t) * MAX_ENTITIES, 4)
+		RenderingComponentData** activeRenderables = reinterpret_cast<RenderingComponentData**>(
+			MemoryAllocator::Allocators[ALLOC_SCRATCH_MEM].Allocate(sizeof(RenderingComponentData*) * (renderableCount > 0 ? renderableCount : 1), alignof(RenderingComponentData*))
 			);
 
 		assert(nullptr != transformArray && nullptr != activeRenderables);
 
 		uint32_t numActiveRenderables = 0;
 
-		// fill in transform matrix for active renderables
-		for (uint32_t i = 0; i < renderableCount; ++i)
+		// world matrices of renderables only built again for what moved or changed
+		TransformComponent::ForEachChanged(lastUpdateFrame, [](Entity e, TransformComponentData& transform)
+		{
+			RenderingComponent r = e.GetComponent<RenderingComponent>();
+			if (r)
+			{
+				r->worldMatrix = transform.GetWorldTransform().GetMatrix();
+			}
+		});
+
+		RenderingComponent::ForEachChanged(lastUpdateFrame, [](Entity e, RenderingComponentData& comp)
 		{
-			RenderingComponentData& comp = renderables[i];
-			TransformComponent transform = comp.entity.GetComponent<TransformComponent>();
-			assert(transform);
+			TransformComponent transform = e.GetComponent<TransformComponent>();
+			if (transform)
+			{
+				comp.worldMatrix = transform->GetWorldTransform().GetMatrix();
+			}
+		});
+
+		lastUpdateFrame = ChangeTracking::GetFrame();
+
+		// fill in transform matrix for active renderables,
+		// ones beyond what transform buffer holds are not drawn
+		View<RenderingComponent, TransformComponent>().Each([&](Entity, RenderingComponentData& comp, TransformComponentData&)
+		{
+			if (numActiveRenderables >= MAX_RENDERABLES)
+			{
+				return;
+			}
 
 			// TODO culling
 
 			uint32_t idx = numActiveRenderables++;
-			activeRenderables[idx] = i;
-			transformArray[idx * 4] = transform->GetWorldTransform().GetMatrix();
-		}
+			activeRenderables[idx] = &comp;
+			transformArray[idx * 4] = comp.worldMatrix;
+		});
 
 		// upload transform matrices
 		if (numActiveRenderables > 0)
@@ -371,27 +481,29 @@ namespace tofu
 		}
 
 		// update skinned mesh animation bone matrices
-		AnimationComponentData* animComps = AnimationComponent::GetAllComponents();
-		uint32_t animCompCount = AnimationComponent::GetNumComponents();
+		int32_t animErr = TF_OK;
 
-		for (uint32_t i = 0; i < animCompCount; i++)
+		View<AnimationComponent, RenderingComponent>().Each([&](Entity, AnimationComponentData& anim, RenderingComponentData& r)
 		{
-			AnimationComponentData& anim = animComps[i];
-			RenderingComponent r = anim.entity.GetComponent<RenderingComponent>();
+			if (TF_OK != animErr)
+			{
+				return;
+			}
 
-			if (!r || nullptr == r->model || !r->model->HasAnimation())
+			if (nullptr == r.model || !r.model->HasAnimation())
 			{
-				return TF_UNKNOWN_ERR;
+				animErr = TF_UNKNOWN_ERR;
+				return;
 			}
 
 			// re-alloc constant buffer if model changed (or firstly set)
-			if (anim.model != r->model)
+			if (anim.model != r.model)
 			{
-				anim.model = r->model;
-				int32_t err = ReallocAnimationResources(anim);
-				if (TF_OK != err)
+				anim.model = r.model;
+				animErr = ReallocAnimationResources(anim);
+				if (TF_OK != animErr)
 				{
-					return err;
+					return;
 				}
 			}
 
@@ -409,12 +521,17 @@ namespace tofu
 			params->size = anim.boneMatricesBufferSize;
 
 			cmdBuf->Add(RendererCommand::UpdateBuffer, params);
+		});
+
+		if (TF_OK != animErr)
+		{
+			return animErr;
 		}
 
 		// generate draw call for active renderables in command buffer
 		for (uint32_t i = 0; i < numActiveRenderables; ++i)
 		{
-			RenderingComponentData& comp = renderables[activeRenderables[i]];
+			RenderingComponentData& comp = *activeRenderables[i];
 
 			assert(nullptr != comp.model && nullptr != comp.material);
 
@@ -424,7 +541,7 @@ namespace tofu
 			for (uint32_t iMesh = 0; iMesh < model.numMeshes; ++iMesh)
 			{
 				assert(model.meshes[iMesh]);
-				Mesh& mesh = meshes[model.meshes[iMesh].id];
+				Mesh& mesh = meshes[model.meshes[iMesh].Index()];
 
 				DrawParams* params = MemoryAllocator::Allocate<DrawParams>(allocNo);
 				params->pipelineState = materialPSOs[mat->type];
@@ -479,6 +596,13 @@ namespace tofu
 		// submit command buffer
 		CHECKED(renderer->Submit(cmdBuf));
 
+		// file data of submitted commands is not needed anymore
+		for (uint32_t i = 0; i < numUploadBuffers; i++)
+		{
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(uploadBuffers[i]);
+		}
+		numUploadBuffers = 0;
+
 		// back buffer swap
 		renderer->Present();
 
@@ -489,58 +613,166 @@ namespace tofu
 		return TF_OK;
 	}
 
+	int32_t RenderingSystem::Defragment(uint32_t budget)
+	{
+		// pipeline state, then material, then model, so draws of the same state are next to each other
+		CHECKED(renderingSorter.Update(budget, [](Entity e, const RenderingComponentData& r)
+		{
+			uint64_t mat = nullptr != r.material ? (static_cast<uint64_t>(r.material->type) << 10 | r.material->handle.Index()) : 0xffffff;
+			uint64_t model = nullptr != r.model ? r.model->handle.Index() : HANDLE_INDEX_MASK;
+			return mat << 40 | model << HANDLE_INDEX_BITS | e.Index();
+		}));
+
+		CHECKED(transformSorter.Update(budget, [](Entity e, const TransformComponentData& t)
+		{
+			return follow_rendering_key(e, transform_depth(t));
+		}));
+
+		return animationSorter.Update(budget, [](Entity e, const AnimationComponentData&)
+		{
+			return follow_rendering_key(e, 0);
+		});
+	}
+
 	Model* RenderingSystem::CreateModel(const char* filename)
 	{
-		std::string strFilename(filename);
+		TF_MEMORY_TAG("RenderingSystem::CreateModel");
+
+		uint64_t pathHash = pak::HashPath(filename);
 
 		{
-			auto iter = modelTable.find(strFilename);
-			if (iter != modelTable.end())
+			auto iter = modelTable->find(pathHash);
+			if (iter != modelTable->end())
 			{
-				return &models[iter->second];
+				Model* cached = &models[iter->second.Index()];
+				if (pak::SamePath(cached->path, filename))
+				{
+					return cached;
+				}
+
+				// another path with the same hash owns the table entry, models of
+				// colliding paths are only found by their path
+				for (uint32_t i = 0; i < modelHandleAlloc.GetNumInUse(); i++)
+				{
+					Model& model = models[modelHandleAlloc.GetHandle(i).Index()];
+					if (pak::SamePath(model.path, filename))
+					{
+						return &model;
+					}
+				}
 			}
 		}
 
-		uint8_t* data = nullptr;
-		size_t size = 0u;
-		int32_t err = FileIO::ReadFile(filename, reinterpret_cast<void**>(&data), &size, 4, ALLOC_FRAME_BASED_MEM);
-		if (TF_OK != err)
+		// header and mesh list are small, the rest is read in place where it is used
+		model::ModelHeader header = {};
+		if (TF_OK != FileIO::ReadRange(filename, 0, sizeof(header), &header))
 		{
 			return nullptr;
 		}
 
-		// read header
-		model::ModelHeader* header = reinterpret_cast<model::ModelHeader*>(data);
+		assert(header.Magic == model::MODEL_FILE_MAGIC);
+		assert(header.StructOfArray == 0);
+		assert(header.HasIndices == 1);
+		assert(header.HasTangent == 1);
+		assert(header.NumTexcoordChannels == 1);
 
-		assert(header->Magic == model::MODEL_FILE_MAGIC);
-		assert(header->StructOfArray == 0);
-		assert(header->HasIndices == 1);
-		assert(header->HasTangent == 1);
-		assert(header->NumTexcoordChannels == 1);
-
-		if (header->NumMeshes == 0)
+		if (header.NumMeshes == 0 || header.NumMeshes > MAX_MESHES_PER_MODEL)
 		{
 			return nullptr;
 		}
 
+		size_t offset = sizeof(header);
+
 		// get mesh info list
-		model::ModelMesh* meshInfos = reinterpret_cast<model::ModelMesh*>(header + 1);
+		model::ModelMesh meshInfos[MAX_MESHES_PER_MODEL];
+		if (TF_OK != FileIO::ReadRange(filename, offset, sizeof(model::ModelMesh) * header.NumMeshes, meshInfos))
+		{
+			return nullptr;
+		}
+		offset += sizeof(model::ModelMesh) * header.NumMeshes;
 
 		uint32_t verticesCount = 0;
 		uint32_t indicesCount = 0;
 
-		assert(header->NumMeshes <= MAX_MESHES_PER_MODEL);
+		for (uint32_t i = 0; i < header.NumMeshes; ++i)
+		{
+			verticesCount += meshInfos[i].NumVertices;
+			indicesCount += meshInfos[i].NumIndices;
+		}
+
+		// aligned to dword
+		if (indicesCount % 2 != 0)
+		{
+			indicesCount += 1;
+		}
+
+		// 
+		uint32_t vertexBufferSize = verticesCount * header.CalculateVertexSize();
+		uint32_t indexBufferSize = indicesCount * sizeof(uint16_t);
+
+		// vertices and indices are read right into the memory of buffer creation commands,
+		// which lives as long as this frame
+		void* vertices = MemoryAllocator::Allocators[allocNo].Allocate(vertexBufferSize, 16);
+		void* indices = MemoryAllocator::Allocators[allocNo].Allocate(indexBufferSize, 16);
+		if (nullptr == vertices || nullptr == indices
+			|| TF_OK != FileIO::ReadRange(filename, offset, vertexBufferSize, vertices)
+			|| TF_OK != FileIO::ReadRange(filename, offset + vertexBufferSize, indexBufferSize, indices))
+		{
+			return nullptr;
+		}
+		offset += vertexBufferSize + indexBufferSize;
+
+		// bones, animations and channels are kept with the model, frames are read on first use
+		size_t bonesSize = sizeof(model::ModelBone) * header.NumBones;
+		size_t animationsSize = 0;
+		size_t channelsSize = 0;
+		if (header.NumBones > 0 && header.HasAnimation)
+		{
+			animationsSize = sizeof(model::ModelAnimation) * header.NumAnimations;
+			channelsSize = sizeof(model::ModelAnimChannel) * header.NumAnimChannels;
+		}
+
+		// path goes first, frames are read from the same file later
+		size_t pathLength = strlen(filename) + 1;
+		size_t pathSize = (pathLength + 15) & ~static_cast<size_t>(15);
+		char* path = reinterpret_cast<char*>(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Allocate(
+			pathSize + bonesSize + animationsSize + channelsSize, 16));
+		if (nullptr == path)
+		{
+			return nullptr;
+		}
+
+		memcpy(path, filename, pathLength);
+		uint8_t* modelData = reinterpret_cast<uint8_t*>(path + pathSize);
+
+		if (TF_OK != FileIO::ReadRange(filename, offset, bonesSize + animationsSize + channelsSize, modelData))
+		{
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(path);
+			return nullptr;
+		}
+
 		ModelHandle modelHandle = modelHandleAlloc.Allocate();
 		assert(modelHandle);
-		Model& model = models[modelHandle.id];
+		Model& model = models[modelHandle.Index()];
 
 		model = Model();
 		model.handle = modelHandle;
-		model.numMeshes = header->NumMeshes;
-		model.vertexSize = header->CalculateVertexSize();
-		model.rawData = data;
-		model.rawDataSize = size;
+		model.numMeshes = header.NumMeshes;
+		model.vertexSize = header.CalculateVertexSize();
 		model.header = header;
+		model.path = path;
+
+		// keep pointers to bone and animation structures
+		if (header.NumBones > 0)
+		{
+			model.bones = reinterpret_cast<model::ModelBone*>(modelData);
+			if (header.HasAnimation)
+			{
+				model.animations = reinterpret_cast<model::ModelAnimation*>(modelData + bonesSize);
+				model.channels = reinterpret_cast<model::ModelAnimChannel*>(modelData + bonesSize + animationsSize);
+				model.framesOffset = offset + bonesSize + animationsSize + channelsSize;
+			}
+		}
 
 		// allocate vertex buffer and index buffer
 		BufferHandle vbHandle = bufferHandleAlloc.Allocate();
@@ -548,11 +780,14 @@ namespace tofu
 		assert(vbHandle && ibHandle);
 
 		// store mesh infos
-		for (uint32_t i = 0; i < header->NumMeshes; ++i)
+		verticesCount = 0;
+		indicesCount = 0;
+
+		for (uint32_t i = 0; i < header.NumMeshes; ++i)
 		{
 			model.meshes[i] = meshHandleAlloc.Allocate();
 			assert(model.meshes[i]);
-			uint32_t id = model.meshes[i].id;
+			uint32_t id = model.meshes[i].Index();
 			meshes[id] = Mesh();
 			meshes[id].VertexBuffer = vbHandle;
 			meshes[id].IndexBuffer = ibHandle;
@@ -565,61 +800,20 @@ namespace tofu
 			indicesCount += meshInfos[i].NumIndices;
 		}
 
-		// aligned to dword
-		if (indicesCount % 2 != 0)
-		{
-			indicesCount += 1;
-		}
-
-		// 
-		uint32_t vertexBufferSize = verticesCount * header->CalculateVertexSize();
-		uint32_t indexBufferSize = indicesCount * sizeof(uint16_t);
-
-		uint8_t* vertices = reinterpret_cast<uint8_t*>(meshInfos + header->NumMeshes);
-		uint8_t* indices = vertices + vertexBufferSize;
-
-		// keep pointers to bone and animation structures
-		if (header->NumBones > 0)
-		{
-			model.bones = reinterpret_cast<model::ModelBone*>(indices + indexBufferSize);
-			if (header->HasAnimation)
-			{
-				model.animations = reinterpret_cast<model::ModelAnimation*>(
-					model.bones + header->NumBones
-					);
-
-				model.channels = reinterpret_cast<model::ModelAnimChannel*>(
-					model.animations + header->NumAnimations
-					);
-
-				model.translationFrames = reinterpret_cast<model::ModelFloat3Frame*>(
-					model.channels + header->NumAnimChannels
-					);
-
-				model.rotationFrames = reinterpret_cast<model::ModelQuatFrame*>(
-					model.translationFrames + header->NumTotalTranslationFrames
-					);
-
-				model.scaleFrames = reinterpret_cast<model::ModelFloat3Frame*>(
-					model.rotationFrames + header->NumTotalRotationFrames
-					);
-			}
-		}
-
 		// upload vertices and indices to vertex buffer and index buffer
 		{
-			CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(ALLOC_FRAME_BASED_MEM);
+			CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(allocNo);
 			params->handle = vbHandle;
 			params->bindingFlags = BINDING_VERTEX_BUFFER;
 			params->data = vertices;
 			params->size = vertexBufferSize;
-			params->stride = header->CalculateVertexSize();
+			params->stride = header.CalculateVertexSize();
 
 			cmdBuf->Add(RendererCommand::CreateBuffer, params);
 		}
 
 		{
-			CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(ALLOC_FRAME_BASED_MEM);
+			CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(allocNo);
 			params->handle = ibHandle;
 			params->bindingFlags = BINDING_INDEX_BUFFER;
 			params->data = indices;
@@ -628,37 +822,73 @@ namespace tofu
 			cmdBuf->Add(RendererCommand::CreateBuffer, params);
 		}
 
+		// the first model of a hash keeps the entry
+		modelTable->emplace(pathHash, modelHandle);
+
 		return &model;
 	}
 
 	TextureHandle RenderingSystem::CreateTexture(const char* filename)
 	{
-		void* data = nullptr;
-		size_t size = 0;
-		int32_t err = FileIO::ReadFile(filename, &data, &size, 4, allocNo);
-
-		if (TF_OK != err)
+		TextureHandle handle = textureHandleAlloc.Allocate();
+		if (!handle)
 		{
 			return TextureHandle();
 		}
 
-		TextureHandle handle = textureHandleAlloc.Allocate();
-		if (!handle)
+		// handle can be bound at once, texture is created when the file is read
+		IORequestHandle request = IOSystem::instance()->ReadAsync(
+			filename,
+			ALLOC_LEVEL_BASED_HEAP,
+			4,
+			IO_PRIORITY_NORMAL,
+			&RenderingSystem::OnTextureRead,
+			reinterpret_cast<void*>(static_cast<uintptr_t>(handle.id)));
+
+		if (!request)
 		{
+			textureHandleAlloc.Free(handle);
 			return TextureHandle();
 		}
 
-		CreateTextureParams* params = MemoryAllocator::Allocate<CreateTextureParams>(allocNo);
+		return handle;
+	}
+
+	void RenderingSystem::OnTextureRead(const IOResult& result)
+	{
+		TF_MEMORY_TAG("RenderingSystem::CreateTexture");
+
+		RenderingSystem* self = RenderingSystem::instance();
+		TextureHandle handle(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(result.userData)));
+
+		// texture stays empty if file can't be read,
+		// and there's nothing to create if the handle was freed in the meantime
+		if (TF_OK != result.err || !self->textureHandleAlloc.IsValid(handle))
+		{
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(result.data);
+			return;
+		}
+
+		assert(nullptr != self->cmdBuf);
+
+		if (self->numUploadBuffers >= MAX_IO_REQUESTS)
+		{
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(result.data);
+			return;
+		}
+
+		// freed once the command is submitted
+		self->uploadBuffers[self->numUploadBuffers++] = result.data;
+
+		CreateTextureParams* params = MemoryAllocator::Allocate<CreateTextureParams>(self->allocNo);
 
 		params->handle = handle;
 		params->bindingFlags = BINDING_SHADER_RESOURCE;
 		params->isFile = 1;
-		params->data = data;
-		params->width = static_cast<uint32_t>(size);
+		params->data = result.data;
+		params->width = static_cast<uint32_t>(result.size);
 
-		cmdBuf->Add(RendererCommand::CreateTexture, params);
-
-		return handle;
+		self->cmdBuf->Add(RendererCommand::CreateTexture, params);
 	}
 
 	Material* RenderingSystem::CreateMaterial(MaterialType type)
@@ -669,15 +899,28 @@ namespace tofu
 			return nullptr;
 		}
 
-		Material* mat = &(materials[handle.id]);
+		Material* mat = &(materials[handle.Index()]);
 		new (mat) Material(type);
 		mat->handle = handle;
 
 		return mat;
 	}
 
+	int32_t RenderingSystem::AddSnapshotAssets(SceneSnapshot& snapshot)
+	{
+		for (uint32_t i = 0; i < modelHandleAlloc.GetNumInUse(); i++)
+		{
+			Model& model = models[modelHandleAlloc.GetHandle(i).Index()];
+			CHECKED(snapshot.AddAsset(pak::HashPath(model.path), &model));
+		}
+
+		return TF_OK;
+	}
+
 	int32_t RenderingSystem::InitBuiltinShader(MaterialType matType, const char * vsFile, const char * psFile)
 	{
+		TF_MEMORY_TAG("RenderingSystem::InitBuiltinShader");
+
 		if (materialVSs[matType] || materialPSs[matType])
 			return TF_UNKNOWN_ERR;
 		
@@ -730,19 +973,61 @@ namespace tofu
 		return TF_OK;
 	}
 
+	int32_t RenderingSystem::LoadAnimationFrames(Model& model)
+	{
+		if (nullptr != model.translationFrames)
+		{
+			return TF_OK;
+		}
+
+		const model::ModelHeader& header = model.header;
+		size_t translationSize = sizeof(model::ModelFloat3Frame) * header.NumTotalTranslationFrames;
+		size_t rotationSize = sizeof(model::ModelQuatFrame) * header.NumTotalRotationFrames;
+		size_t scaleSize = sizeof(model::ModelFloat3Frame) * header.NumTotalScaleFrames;
+
+		// frame arrays are next to each other in the file, they are read as a whole
+		uint8_t* frames = reinterpret_cast<uint8_t*>(MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Allocate(
+			translationSize + rotationSize + scaleSize, 16));
+		if (nullptr == frames)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (TF_OK != FileIO::ReadRange(model.path, model.framesOffset, translationSize + rotationSize + scaleSize, frames))
+		{
+			MemoryAllocator::Allocators[ALLOC_LEVEL_BASED_HEAP].Deallocate(frames);
+			return TF_UNKNOWN_ERR;
+		}
+
+		model.translationFrames = reinterpret_cast<model::ModelFloat3Frame*>(frames);
+		model.rotationFrames = reinterpret_cast<model::ModelQuatFrame*>(frames + translationSize);
+		model.scaleFrames = reinterpret_cast<model::ModelFloat3Frame*>(frames + translationSize + rotationSize);
+
+		return TF_OK;
+	}
+
 	int32_t RenderingSystem::ReallocAnimationResources(AnimationComponentData & c)
 	{
 		if (c.boneMatricesBuffer)
 		{
-			// TODO dealloc
+			BufferHandle* params = MemoryAllocator::Allocate<BufferHandle>(allocNo);
+			assert(nullptr != params);
+			*params = c.boneMatricesBuffer;
+
+			cmdBuf->Add(RendererCommand::DestroyBuffer, params);
+
+			bufferHandleAlloc.Free(c.boneMatricesBuffer);
+			c.boneMatricesBuffer = BufferHandle();
 		}
 
 		Model* model = c.model;
-		if (nullptr == model || nullptr == model->header || !model->HasAnimation() || 0 == model->header->NumBones)
+		if (nullptr == model || !model->HasAnimation() || 0 == model->header.NumBones)
 		{
 			return TF_UNKNOWN_ERR;
 		}
 
+		CHECKED(LoadAnimationFrames(*model));
+
 		BufferHandle bufferHandle = bufferHandleAlloc.Allocate();
 		if (!bufferHandle)
 		{
@@ -750,7 +1035,7 @@ namespace tofu
 		}
 
 		c.boneMatricesBuffer = bufferHandle;
-		c.boneMatricesBufferSize = static_cast<uint32_t>(sizeof(math::float4x4)) * model->header->NumBones;
+		c.boneMatricesBufferSize = static_cast<uint32_t>(sizeof(math::float4x4)) * model->header.NumBones;
 
 		CreateBufferParams* params = MemoryAllocator::Allocate<CreateBufferParams>(allocNo);
 		assert(nullptr != params);
@@ -7,14 +7,18 @@
 
 #include "Renderer.h"
 
+#include "ComponentSorter.h"
+#include "ConcurrentHandleAllocator.h"
 #include "HandleAllocator.h"
-
-#include <unordered_map>
-#include <string>
+#include "StlAllocator.h"
 
 namespace tofu
 {
 	class AnimationComponentData;
+	class RenderingComponentData;
+	class SceneSnapshot;
+	class TransformComponentData;
+	struct IOResult;
 
 	struct Mesh
 	{
@@ -47,29 +51,49 @@ namespace tofu
 		// submit all render commands to backend
 		int32_t EndFrame();
 
+		// put renderables in order of material and model, and transforms and animations
+		// of the same entities in that order too, a few steps every frame (see ComponentSorter).
+		// call with no system running, after entities are flushed
+		int32_t Defragment(uint32_t budget);
+
 		Model* CreateModel(const char* filename);
 
 		TextureHandle CreateTexture(const char* filename);
 
 		Material* CreateMaterial(MaterialType type);
 
+		// models created so far as snapshot assets, by hash of their path, so a scene loads
+		// once the models it uses are created. materials have no path, add them with
+		// SceneSnapshot::AddAsset() under ids of your own
+		int32_t AddSnapshotAssets(SceneSnapshot& snapshot);
+
 	private:
 
 		int32_t InitBuiltinShader(MaterialType matType, const char* vsFile, const char* psFile);
 
 		int32_t ReallocAnimationResources(AnimationComponentData& c);
 
+		// read animation frames of a model, if not read yet
+		int32_t LoadAnimationFrames(Model& model);
+
+		// completion of an asynchronous texture read
+		static void OnTextureRead(const IOResult& result);
+
 	private:
 		Renderer*	renderer;
 
 		HandleAllocator<ModelHandle, MAX_MODELS>			modelHandleAlloc;
-		HandleAllocator<MeshHandle, MAX_MESHES>				meshHandleAlloc;
+		ConcurrentHandleAllocator<MeshHandle, MAX_MESHES>	meshHandleAlloc;
 		HandleAllocator<MaterialHandle, MAX_MATERIALS>		materialHandleAlloc;
 
-		std::unordered_map<std::string, ModelHandle>		modelTable;
+		// created on level heap in Init(), so it goes before the heap shuts down,
+		// keyed by path hash (pak::HashPath) so lookups don't allocate
+		typedef UnorderedMap<uint64_t, ModelHandle> ModelTable;
+		ModelTable*											modelTable;
 
-		HandleAllocator<BufferHandle, MAX_BUFFERS>					bufferHandleAlloc;
-		HandleAllocator<TextureHandle, MAX_TEXTURES>				textureHandleAlloc;
+		// loaders may create these on worker threads
+		ConcurrentHandleAllocator<BufferHandle, MAX_BUFFERS>		bufferHandleAlloc;
+		ConcurrentHandleAllocator<TextureHandle, MAX_TEXTURES>		textureHandleAlloc;
 		HandleAllocator<SamplerHandle, MAX_SAMPLERS>				samplerHandleAlloc;
 		HandleAllocator<VertexShaderHandle, MAX_VERTEX_SHADERS>		vertexShaderHandleAlloc;
 		HandleAllocator<PixelShaderHandle, MAX_PIXEL_SHADERS>		pixelShaderHandleAlloc;
@@ -78,6 +102,9 @@ namespace tofu
 		size_t					frameNo;
 		uint32_t				allocNo;
 
+		// ChangeTracking::GetFrame() of last Update(), world matrices are refreshed for changes since
+		uint32_t				lastUpdateFrame;
+
 		BufferHandle			transformBuffer;
 		uint32_t				transformBufferSize;
 
@@ -94,7 +121,15 @@ namespace tofu
 
 		Model*					builtinCube;
 
+		ComponentSorter<RenderingComponentData>		renderingSorter;
+		ComponentSorter<TransformComponentData>		transformSorter;
+		ComponentSorter<AnimationComponentData>		animationSorter;
+
 		RendererCommandBuffer*	cmdBuf;
+
+		// heap blocks of files read by io system, freed after this frame is submitted
+		void*					uploadBuffers[MAX_IO_REQUESTS];
+		uint32_t				numUploadBuffers;
 	};
 
 }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tofu
+{
+	namespace scene
+	{
+
+		constexpr uint32_t SCENE_FILE_MAGIC = 0x4E435354; // "TSCN"
+		constexpr uint32_t SCENE_FILE_VERSION = 0x00000001;
+
+		// every array below starts on this boundary, so component arrays
+		// can be copied out of a mapped file as they are
+		constexpr uint32_t SCENE_BLOB_ALIGNMENT = 16;
+
+		// kinds of SceneFixup
+		constexpr uint32_t SCENE_FIXUP_ENTITY = 0;
+		constexpr uint32_t SCENE_FIXUP_ASSET = 1;
+
+		// offsets are from beginning of the file
+		struct SceneHeader
+		{
+			uint32_t			Magic;
+			uint32_t			Version;
+			// asset fields are pointers, files are only loaded where they are the same size
+			uint32_t			PointerSize;
+			uint32_t			NumEntities;
+			uint32_t			NumAssets;
+			uint32_t			NumBlobs;
+			uint64_t			EntitiesOffset;
+			uint64_t			AssetsOffset;
+			uint64_t			BlobsOffset;
+		};
+
+		// ... entity ids when saved, uint32_t[NumEntities], in increasing index order
+
+		// ... asset ids, uint64_t[NumAssets], asset fields hold an index to them plus one, 0 for none
+
+		// ... an array of SceneBlob, one for each component type
+
+		struct SceneBlob
+		{
+			// hash of type name
+			uint64_t			TypeId;
+			uint32_t			ElementSize;
+			uint32_t			NumElements;
+			uint32_t			NumFixups;
+			uint32_t			_reserved;
+			// components as they were in memory, or records of them, with asset fields replaced
+			uint64_t			DataOffset;
+			// owner of each element, as index to entity ids, uint32_t[NumElements]
+			uint64_t			OwnersOffset;
+			// SceneFixup[NumFixups], fields to patch in every element
+			uint64_t			FixupsOffset;
+		};
+
+		struct SceneFixup
+		{
+			// from beginning of an element
+			uint32_t			Offset;
+			uint32_t			Kind;
+		};
+	}
+}
@@ -0,0 +1,487 @@
+#include "SceneSnapshot.h"
+
+#include "FileIO.h"
+#include "PageAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	using namespace tofu::scene;
+
+	TF_INLINE size_t align_blob(size_t size)
+	{
+		return (size + SCENE_BLOB_ALIGNMENT - 1) & ~static_cast<size_t>(SCENE_BLOB_ALIGNMENT - 1);
+	}
+
+	// an array of file is inside it, and aligned
+	TF_INLINE bool in_file(uint64_t offset, uint64_t bytes, size_t fileSize)
+	{
+		return 0 == offset % SCENE_BLOB_ALIGNMENT && offset <= fileSize && bytes <= fileSize - offset;
+	}
+}
+
+namespace tofu
+{
+	SceneSnapshot::SceneSnapshot()
+		:
+		types(),
+		numTypes(0),
+		numAssets(0),
+		numLoaded(0)
+	{
+	}
+
+	int32_t SceneSnapshot::AddAsset(uint64_t id, const void* asset)
+	{
+		if (nullptr == asset)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		if (!assets.IsReserved())
+		{
+			CHECKED(assets.Reserve(MAX_SNAPSHOT_ASSETS));
+		}
+
+		for (uint32_t i = 0; i < numAssets; i++)
+		{
+			if (assets[i].id == id)
+			{
+				assets[i].ptr = asset;
+				return TF_OK;
+			}
+		}
+
+		CHECKED(assets.Grow(numAssets + 1));
+		assets[numAssets++] = { id, asset, 0 };
+
+		return TF_OK;
+	}
+
+	int32_t SceneSnapshot::Save(const char* file)
+	{
+		CHECKED(ReserveScratch());
+
+		// entities owning any component saved, in index order
+		uint32_t numEntities = 0;
+		for (uint32_t t = 0; t < numTypes; t++)
+		{
+			const Entity* owners = types[t].getOwners();
+			uint32_t count = types[t].getCount();
+
+			uint32_t maxIndex = 0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				maxIndex = owners[i].Index() > maxIndex ? owners[i].Index() : maxIndex;
+			}
+
+			if (count > 0)
+			{
+				CHECKED(byIndex.Grow(maxIndex + 1));
+				CHECKED(savedSet.Grow(maxIndex + 1));
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				byIndex[owners[i].Index()] = owners[i].id;
+				if (savedSet.Add(owners[i].Index()))
+				{
+					numEntities++;
+				}
+			}
+		}
+
+		CHECKED(entities.Grow(numEntities));
+
+		// by index, where an entity is in the table from now on
+		uint32_t numSaved = 0;
+		savedSet.ForEach([&](uint32_t idx)
+		{
+			entities[numSaved] = Entity(byIndex[idx]);
+			byIndex[idx] = numSaved++;
+		});
+		savedSet.Clear();
+
+		// asset fields are looked up by pointer
+		Asset* assetData = assets.GetData();
+		std::sort(assetData, assetData + numAssets, [](const Asset& a, const Asset& b) { return a.ptr < b.ptr; });
+		for (uint32_t i = 0; i < numAssets; i++)
+		{
+			assetData[i].fileIndex = 0;
+		}
+
+		// layout, assets go last since only referenced ones are saved
+		size_t entitiesOffset = align_blob(sizeof(SceneHeader));
+		size_t blobsOffset = entitiesOffset + align_blob(sizeof(uint32_t) * numEntities);
+		size_t size = blobsOffset + align_blob(sizeof(SceneBlob) * numTypes);
+
+		for (uint32_t t = 0; t < numTypes; t++)
+		{
+			uint32_t count = types[t].getCount();
+			size += align_blob(static_cast<size_t>(types[t].size) * count)
+				+ align_blob(sizeof(uint32_t) * count)
+				+ align_blob(sizeof(SceneFixup) * types[t].numFields);
+		}
+
+		size_t assetsOffset = size;
+		size_t maxSize = assetsOffset + sizeof(uint64_t) * numAssets;
+
+		// fresh pages are zeroed, padding doesn't need clearing
+		uint8_t* buffer = reinterpret_cast<uint8_t*>(PageAllocator().Allocate(maxSize, PageAllocator::GetPageSize()));
+		if (nullptr == buffer)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		uint32_t* entityIds = reinterpret_cast<uint32_t*>(buffer + entitiesOffset);
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			entityIds[i] = entities[i].id;
+		}
+
+		SceneBlob* blobs = reinterpret_cast<SceneBlob*>(buffer + blobsOffset);
+		size_t offset = blobsOffset + align_blob(sizeof(SceneBlob) * numTypes);
+		uint32_t numFileAssets = 0;
+		int32_t err = TF_OK;
+
+		for (uint32_t t = 0; t < numTypes && TF_OK == err; t++)
+		{
+			const Type& type = types[t];
+			uint32_t count = type.getCount();
+			size_t dataSize = static_cast<size_t>(type.size) * count;
+
+			SceneBlob& blob = blobs[t];
+			blob.TypeId = type.id;
+			blob.ElementSize = type.size;
+			blob.NumElements = count;
+			blob.NumFixups = type.numFields;
+			blob.DataOffset = offset;
+			blob.OwnersOffset = blob.DataOffset + align_blob(dataSize);
+			blob.FixupsOffset = blob.OwnersOffset + align_blob(sizeof(uint32_t) * count);
+			offset = blob.FixupsOffset + align_blob(sizeof(SceneFixup) * type.numFields);
+
+			uint8_t* dst = buffer + blob.DataOffset;
+			if (count > 0 && nullptr != type.save)
+			{
+				type.save(type.getData(), count, dst);
+			}
+			else if (count > 0)
+			{
+				memcpy(dst, type.getData(), dataSize);
+			}
+
+			// asset pointers become indices to asset table
+			for (uint32_t f = 0; f < type.numFields && TF_OK == err; f++)
+			{
+				if (SCENE_FIXUP_ASSET != type.fields[f].kind)
+				{
+					continue;
+				}
+
+				uint8_t* field = dst + type.fields[f].offset;
+				for (uint32_t i = 0; i < count; i++, field += type.size)
+				{
+					const void* ptr;
+					memcpy(&ptr, field, sizeof(ptr));
+
+					uintptr_t value = 0;
+					if (nullptr != ptr)
+					{
+						Asset* asset = std::lower_bound(assetData, assetData + numAssets, ptr, [](const Asset& a, const void* p) { return a.ptr < p; });
+						if (asset == assetData + numAssets || asset->ptr != ptr)
+						{
+							// not added with AddAsset()
+							err = TF_UNKNOWN_ERR;
+							break;
+						}
+
+						if (0 == asset->fileIndex)
+						{
+							asset->fileIndex = ++numFileAssets;
+						}
+						value = asset->fileIndex;
+					}
+
+					memcpy(field, &value, sizeof(value));
+				}
+			}
+
+			const Entity* owners = type.getOwners();
+			uint32_t* ownerPositions = reinterpret_cast<uint32_t*>(buffer + blob.OwnersOffset);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				ownerPositions[i] = byIndex[owners[i].Index()];
+			}
+
+			SceneFixup* fixups = reinterpret_cast<SceneFixup*>(buffer + blob.FixupsOffset);
+			for (uint32_t f = 0; f < type.numFields; f++)
+			{
+				fixups[f] = { type.fields[f].offset, type.fields[f].kind };
+			}
+		}
+
+		uint64_t* assetIds = reinterpret_cast<uint64_t*>(buffer + assetsOffset);
+		for (uint32_t i = 0; i < numAssets; i++)
+		{
+			if (0 != assetData[i].fileIndex)
+			{
+				assetIds[assetData[i].fileIndex - 1] = assetData[i].id;
+			}
+		}
+
+		SceneHeader* header = reinterpret_cast<SceneHeader*>(buffer);
+		header->Magic = SCENE_FILE_MAGIC;
+		header->Version = SCENE_FILE_VERSION;
+		header->PointerSize = sizeof(void*);
+		header->NumEntities = numEntities;
+		header->NumAssets = numFileAssets;
+		header->NumBlobs = numTypes;
+		header->EntitiesOffset = entitiesOffset;
+		header->AssetsOffset = assetsOffset;
+		header->BlobsOffset = blobsOffset;
+
+		if (TF_OK == err)
+		{
+			err = FileIO::WriteFile(file, buffer, assetsOffset + sizeof(uint64_t) * numFileAssets);
+		}
+
+		PageAllocator().Deallocate(buffer, maxSize);
+		return err;
+	}
+
+	int32_t SceneSnapshot::Load(const char* file)
+	{
+		numLoaded = 0;
+
+		FileMapping mapping = {};
+		CHECKED(FileIO::MapFile(file, &mapping));
+
+		int32_t err = LoadMapped(reinterpret_cast<const uint8_t*>(mapping.data), mapping.size);
+
+		FileIO::UnmapFile(&mapping);
+		return err;
+	}
+
+	int32_t SceneSnapshot::ReserveScratch()
+	{
+		if (entities.IsReserved())
+		{
+			return TF_OK;
+		}
+
+		uint32_t capacity = Entity::GetCapacity();
+		CHECKED(byIndex.Reserve(HANDLE_INDEX_MASK + 1));
+		CHECKED(entities.Reserve(capacity));
+		CHECKED(owners.Reserve(capacity));
+		CHECKED(filePointers.Reserve(MAX_SNAPSHOT_ASSETS));
+		CHECKED(records.Reserve(capacity * MAX_SNAPSHOT_RECORD_SIZE));
+		return savedSet.Reserve(capacity);
+	}
+
+	int32_t SceneSnapshot::LoadMapped(const uint8_t* data, size_t size)
+	{
+		if (size < sizeof(SceneHeader))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		const SceneHeader* header = reinterpret_cast<const SceneHeader*>(data);
+		if (SCENE_FILE_MAGIC != header->Magic || SCENE_FILE_VERSION != header->Version || sizeof(void*) != header->PointerSize
+			|| header->NumBlobs > MAX_SNAPSHOT_TYPES || header->NumAssets > MAX_SNAPSHOT_ASSETS
+			|| !in_file(header->EntitiesOffset, sizeof(uint32_t) * static_cast<uint64_t>(header->NumEntities), size)
+			|| !in_file(header->AssetsOffset, sizeof(uint64_t) * static_cast<uint64_t>(header->NumAssets), size)
+			|| !in_file(header->BlobsOffset, sizeof(SceneBlob) * static_cast<uint64_t>(header->NumBlobs), size))
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		CHECKED(ReserveScratch());
+
+		// every asset of file is added
+		const uint64_t* assetIds = reinterpret_cast<const uint64_t*>(data + header->AssetsOffset);
+		Asset* assetData = assets.GetData();
+		std::sort(assetData, assetData + numAssets, [](const Asset& a, const Asset& b) { return a.id < b.id; });
+
+		CHECKED(filePointers.Grow(header->NumAssets));
+		for (uint32_t i = 0; i < header->NumAssets; i++)
+		{
+			Asset* asset = std::lower_bound(assetData, assetData + numAssets, assetIds[i], [](const Asset& a, uint64_t id) { return a.id < id; });
+			if (asset == assetData + numAssets || asset->id != assetIds[i])
+			{
+				return TF_UNKNOWN_ERR;
+			}
+			filePointers[i] = asset->ptr;
+		}
+
+		// and every type, laid out as it is now
+		const SceneBlob* blobs = reinterpret_cast<const SceneBlob*>(data + header->BlobsOffset);
+		uint32_t blobTypes[MAX_SNAPSHOT_TYPES];
+
+		for (uint32_t b = 0; b < header->NumBlobs; b++)
+		{
+			const SceneBlob& blob = blobs[b];
+
+			blobTypes[b] = UINT32_MAX;
+			for (uint32_t t = 0; t < numTypes; t++)
+			{
+				if (types[t].id == blob.TypeId) blobTypes[b] = t;
+			}
+
+			if (UINT32_MAX == blobTypes[b] || types[blobTypes[b]].size != blob.ElementSize
+				|| !in_file(blob.DataOffset, static_cast<uint64_t>(blob.ElementSize) * blob.NumElements, size)
+				|| !in_file(blob.OwnersOffset, sizeof(uint32_t) * static_cast<uint64_t>(blob.NumElements), size)
+				|| !in_file(blob.FixupsOffset, sizeof(SceneFixup) * static_cast<uint64_t>(blob.NumFixups), size))
+			{
+				return TF_UNKNOWN_ERR;
+			}
+
+			const SceneFixup* fixups = reinterpret_cast<const SceneFixup*>(data + blob.FixupsOffset);
+			for (uint32_t f = 0; f < blob.NumFixups; f++)
+			{
+				uint32_t fieldSize = SCENE_FIXUP_ENTITY == fixups[f].Kind ? sizeof(uint32_t) : sizeof(void*);
+				if (fixups[f].Kind > SCENE_FIXUP_ASSET || fixups[f].Offset > blob.ElementSize || fieldSize > blob.ElementSize - fixups[f].Offset)
+				{
+					return TF_UNKNOWN_ERR;
+				}
+			}
+		}
+
+		// new entities, found by their saved index
+		uint32_t numEntities = header->NumEntities;
+		const uint32_t* savedIds = reinterpret_cast<const uint32_t*>(data + header->EntitiesOffset);
+
+		uint32_t maxIndex = 0;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			uint32_t idx = savedIds[i] & HANDLE_INDEX_MASK;
+			maxIndex = idx > maxIndex ? idx : maxIndex;
+		}
+
+		CHECKED(entities.Grow(numEntities));
+		CHECKED(byIndex.Grow(maxIndex + 1));
+		CHECKED(Entity::CreateBatch(entities.GetData(), numEntities));
+		numLoaded = numEntities;
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			byIndex[savedIds[i] & HANDLE_INDEX_MASK] = i;
+		}
+
+		int32_t err = TF_OK;
+
+		for (uint32_t b = 0; b < header->NumBlobs && TF_OK == err; b++)
+		{
+			const SceneBlob& blob = blobs[b];
+			const Type& type = types[blobTypes[b]];
+			uint32_t count = blob.NumElements;
+
+			if (0 == count)
+			{
+				continue;
+			}
+
+			err = owners.Grow(count);
+
+			const uint32_t* ownerPositions = reinterpret_cast<const uint32_t*>(data + blob.OwnersOffset);
+			for (uint32_t i = 0; i < count && TF_OK == err; i++)
+			{
+				if (ownerPositions[i] >= numEntities)
+				{
+					err = TF_UNKNOWN_ERR;
+					break;
+				}
+				owners[i] = entities[ownerPositions[i]];
+			}
+
+			if (TF_OK != err)
+			{
+				break;
+			}
+
+			const SceneFixup* fixups = reinterpret_cast<const SceneFixup*>(data + blob.FixupsOffset);
+			size_t dataSize = static_cast<size_t>(type.size) * count;
+
+			if (nullptr != type.save)
+			{
+				// mapping is read only, records are patched in a copy
+				err = records.Grow(static_cast<uint32_t>(dataSize));
+				if (TF_OK == err)
+				{
+					memcpy(records.GetData(), data + blob.DataOffset, dataSize);
+					PatchFixups(records.GetData(), type.size, count, fixups, blob.NumFixups, savedIds, numEntities, header->NumAssets);
+					err = type.create(owners.GetData(), count, records.GetData());
+				}
+				continue;
+			}
+
+			err = type.create(owners.GetData(), count, data + blob.DataOffset);
+			if (TF_OK != err)
+			{
+				break;
+			}
+
+			// new components are at end of the array
+			uint8_t* base = reinterpret_cast<uint8_t*>(type.getData()) + static_cast<size_t>(type.getCount() - count) * type.size;
+			PatchFixups(base, type.size, count, fixups, blob.NumFixups, savedIds, numEntities, header->NumAssets);
+		}
+
+		if (TF_OK != err)
+		{
+			// components added so far go with them at end of frame
+			for (uint32_t i = 0; i < numLoaded; i++)
+			{
+				entities[i].Destroy();
+			}
+			numLoaded = 0;
+		}
+
+		return err;
+	}
+
+	void SceneSnapshot::PatchFixups(uint8_t* base, uint32_t stride, uint32_t count, const SceneFixup* fixups, uint32_t numFixups,
+		const uint32_t* savedIds, uint32_t numSaved, uint32_t numFileAssets) const
+	{
+		for (uint32_t f = 0; f < numFixups; f++)
+		{
+			uint8_t* field = base + fixups[f].Offset;
+
+			if (SCENE_FIXUP_ENTITY == fixups[f].Kind)
+			{
+				for (uint32_t i = 0; i < count; i++, field += stride)
+				{
+					uint32_t id;
+					memcpy(&id, field, sizeof(id));
+					id = Remap(savedIds, numSaved, id).id;
+					memcpy(field, &id, sizeof(id));
+				}
+			}
+			else
+			{
+				for (uint32_t i = 0; i < count; i++, field += stride)
+				{
+					uintptr_t value;
+					memcpy(&value, field, sizeof(value));
+
+					// a bad index gets no asset
+					const void* ptr = value > 0 && value <= numFileAssets ? filePointers[static_cast<uint32_t>(value - 1)] : nullptr;
+					memcpy(field, &ptr, sizeof(ptr));
+				}
+			}
+		}
+	}
+
+	Entity SceneSnapshot::Remap(const uint32_t* savedIds, uint32_t numSaved, uint32_t id) const
+	{
+		uint32_t idx = id & HANDLE_INDEX_MASK;
+		if (UINT32_MAX == id || idx >= byIndex.GetNumCommitted())
+		{
+			return Entity();
+		}
+
+		// entries of earlier loads are left in table, they don't match
+		uint32_t pos = byIndex[idx];
+		return pos < numSaved && savedIds[pos] == id ? entities[pos] : Entity();
+	}
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "Common.h"
+#include "ChangeTracking.h"
+#include "Component.h"
+#include "Entity.h"
+#include "PagedArray.h"
+#include "PakFormat.h"
+#include "SceneFormat.h"
+
+#include <type_traits>
+
+namespace tofu
+{
+	// field of a saved component that has to be patched at load
+	struct SnapshotField
+	{
+		// from beginning of the component
+		uint32_t	offset;
+		// scene::SCENE_FIXUP_ENTITY for an Entity, it is given the new id of that entity at load,
+		// or no entity if it wasn't saved. scene::SCENE_FIXUP_ASSET for a pointer to an asset added with AddAsset()
+		uint32_t	kind;
+	};
+
+	// binary snapshot of components of some types (SceneFormat.h).
+	// component arrays are saved as they are in memory, with a table of fields holding entities and assets,
+	// so loading is one file mapping, one copy per array and patching those fields.
+	// components that own memory are converted to and from records on the way (AddType()).
+	// loaded entities get new ids, a snapshot can be loaded into a running world, and more than once
+	class SceneSnapshot
+	{
+	public:
+		SceneSnapshot();
+
+		SceneSnapshot(const SceneSnapshot&) = delete;
+		SceneSnapshot& operator = (const SceneSnapshot&) = delete;
+
+		// T is a handle type, like RenderingComponent. components are copied bitwise,
+		// so they can't own memory, and any pointer in them must be an asset field.
+		// name identifies the type in files.
+		// a component that owns memory, like TransformComponentData, is saved as a Record instead,
+		// a trivially copyable struct fields are in, with hooks converting whole arrays:
+		//   static void Save(const data_t* components, uint32_t count, Record* records);
+		//   static void Load(data_t* components, const Record* records, uint32_t count);
+		// Load() is given new components of all owners in file, and records with fields patched
+		template<class T, class Record = typename T::component_data_t>
+		int32_t AddType(const char* name, const SnapshotField* fields = nullptr, uint32_t numFields = 0);
+
+		// asset pointed to by asset fields. id must stay the same between runs, like hash of its path
+		int32_t AddAsset(uint64_t id, const void* asset);
+
+		// components of all types added, and entities owning them
+		int32_t Save(const char* file);
+
+		// create entities of a snapshot with their components, every type and asset in it must be added.
+		// entities it created are destroyed if it fails
+		int32_t Load(const char* file);
+
+		// entities created by last Load(), in order of their ids when saved
+		TF_INLINE const Entity* GetLoadedEntities() const { return entities.GetData(); }
+		TF_INLINE uint32_t GetNumLoaded() const { return numLoaded; }
+
+	private:
+		struct Type
+		{
+			uint64_t		id;
+			uint32_t		size;
+			uint32_t		numFields;
+			SnapshotField	fields[MAX_SNAPSHOT_FIELDS];
+
+			uint32_t		(*getCount)();
+			void*			(*getData)();
+			const Entity*	(*getOwners)();
+			// records to components, or a bitwise copy of values
+			int32_t			(*create)(const Entity* entities, uint32_t count, const void* values);
+			// components to records, nullptr if they are saved bitwise
+			void			(*save)(const void* components, uint32_t count, void* records);
+		};
+
+		struct Asset
+		{
+			uint64_t		id;
+			const void*		ptr;
+			// in file being saved, 0 if not referenced
+			uint32_t		fileIndex;
+		};
+
+		typedef void(*SaveFunc)(const void* components, uint32_t count, void* records);
+
+		template<class T>
+		struct ArrayOps
+		{
+			static uint32_t GetCount() { return Component<T>::GetNumComponents(); }
+			static void* GetData() { return Component<T>::GetAllComponents(); }
+			static const Entity* GetOwners() { return Component<T>::GetAllEntities(); }
+		};
+
+		template<class T, class Record>
+		struct Ops : ArrayOps<T>
+		{
+			static SaveFunc GetSave() { return &Save; }
+
+			static void Save(const void* components, uint32_t count, void* records)
+			{
+				Record::Save(reinterpret_cast<const T*>(components), count, reinterpret_cast<Record*>(records));
+			}
+
+			static int32_t Create(const Entity* entities, uint32_t count, const void* records)
+			{
+				CHECKED(Component<T>::CreateBatch(entities, count, T()));
+
+				// appended to the array
+				T* created = Component<T>::GetAllComponents() + (Component<T>::GetNumComponents() - count);
+				Record::Load(created, reinterpret_cast<const Record*>(records), count);
+				return TF_OK;
+			}
+		};
+
+		template<class T>
+		struct Ops<T, T> : ArrayOps<T>
+		{
+			static SaveFunc GetSave() { return nullptr; }
+
+			static int32_t Create(const Entity* entities, uint32_t count, const void* values)
+			{
+				return Component<T>::CreateBatch(entities, count, reinterpret_cast<const T*>(values));
+			}
+		};
+
+		int32_t ReserveScratch();
+
+		// entity fields are given loaded entities, asset fields pointers of assets
+		void PatchFixups(uint8_t* base, uint32_t stride, uint32_t count, const scene::SceneFixup* fixups, uint32_t numFixups,
+			const uint32_t* savedIds, uint32_t numSaved, uint32_t numFileAssets) const;
+
+		int32_t LoadMapped(const uint8_t* data, size_t size);
+
+		// loaded entity of a saved id
+		Entity Remap(const uint32_t* savedIds, uint32_t numSaved, uint32_t id) const;
+
+	private:
+		Type				types[MAX_SNAPSHOT_TYPES];
+		uint32_t			numTypes;
+
+		PagedArray<Asset>	assets;
+		uint32_t			numAssets;
+
+		// by entity index, id of entity being saved, or where a saved one is in file when loading
+		PagedArray<uint32_t>	byIndex;
+		// saved entities, or loaded ones
+		PagedArray<Entity>		entities;
+		uint32_t				numLoaded;
+		// owners of a component array
+		PagedArray<Entity>		owners;
+		// pointers of assets in file being loaded
+		PagedArray<const void*>	filePointers;
+		// records of a type being loaded, patched before they are handed to Load()
+		PagedArray<uint8_t>		records;
+		ChangeSet				savedSet;
+	};
+
+	template<class T, class Record>
+	int32_t SceneSnapshot::AddType(const char* name, const SnapshotField* fields, uint32_t numFields)
+	{
+		typedef typename T::component_data_t data_t;
+
+		static_assert(std::is_trivially_copyable<Record>::value, "components are saved bitwise, or as records that are");
+		static_assert(alignof(Record) <= scene::SCENE_BLOB_ALIGNMENT, "component is over aligned");
+		static_assert(sizeof(Record) <= MAX_SNAPSHOT_RECORD_SIZE || std::is_same<Record, data_t>::value, "record is too large");
+
+		if (numTypes >= MAX_SNAPSHOT_TYPES || numFields > MAX_SNAPSHOT_FIELDS)
+		{
+			return TF_UNKNOWN_ERR;
+		}
+
+		Type& type = types[numTypes];
+		type.id = pak::HashPath(name);
+		type.size = sizeof(Record);
+		type.numFields = numFields;
+
+		for (uint32_t i = 0; i < numTypes; i++)
+		{
+			if (types[i].id == type.id)
+			{
+				return TF_UNKNOWN_ERR;
+			}
+		}
+
+		for (uint32_t i = 0; i < numFields; i++)
+		{
+			uint32_t fieldSize = scene::SCENE_FIXUP_ENTITY == fields[i].kind ? sizeof(Entity) : sizeof(void*);
+			if (fields[i].kind > scene::SCENE_FIXUP_ASSET || fields[i].offset + fieldSize > sizeof(Record))
+			{
+				return TF_UNKNOWN_ERR;
+			}
+			type.fields[i] = fields[i];
+		}
+
+		type.getCount = &Ops<data_t, Record>::GetCount;
+		type.getData = &Ops<data_t, Record>::GetData;
+		type.getOwners = &Ops<data_t, Record>::GetOwners;
+		type.create = &Ops<data_t, Record>::Create;
+		type.save = Ops<data_t, Record>::GetSave();
+
+		numTypes++;
+		return TF_OK;
+	}
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Common.h"
+#include "MemoryAllocator.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tofu
+{
+	// allocNo of containers on system heap (malloc/free), for ones that may outlive
+	// engine allocators, like other static objects. components are emptied by the engine
+	// before its allocators shut down (ComponentRegistry::RemoveAll()), so members of
+	// components can be on level heap
+	constexpr uint32_t ALLOC_SYSTEM_HEAP = UINT32_MAX;
+
+	// standard library allocator taking memory from allocator[allocNo].
+	// containers must be emptied before their allocator shuts down,
+	// ones needed before it is initialized or after it shuts down (static objects)
+	// must be on ALLOC_SYSTEM_HEAP, memory is never guessed to be from system heap
+	template<class T>
+	class StlAllocator
+	{
+	public:
+		typedef T value_type;
+
+		template<class U>
+		struct rebind
+		{
+			typedef StlAllocator<U> other;
+		};
+
+		StlAllocator() noexcept : allocNo(ALLOC_LEVEL_BASED_HEAP) {}
+
+		explicit StlAllocator(uint32_t allocNo) noexcept : allocNo(allocNo) {}
+
+		template<class U>
+		StlAllocator(const StlAllocator<U>& other) noexcept : allocNo(other.GetAllocNo()) {}
+
+		T* allocate(size_t n)
+		{
+			void* ptr = nullptr;
+			if (ALLOC_SYSTEM_HEAP == allocNo)
+			{
+				ptr = std::malloc(sizeof(T) * n);
+			}
+			else
+			{
+				MemoryAllocator& alloc = MemoryAllocator::Allocators[allocNo];
+				assert(alloc.IsInitialized() && "allocator is not initialized, use ALLOC_SYSTEM_HEAP");
+				if (alloc.IsInitialized())
+				{
+					ptr = alloc.Allocate(sizeof(T) * n, alignof(T));
+				}
+			}
+
+			if (nullptr == ptr)
+			{
+				throw std::bad_alloc();
+			}
+			return reinterpret_cast<T*>(ptr);
+		}
+
+		void deallocate(T* ptr, size_t)
+		{
+			if (ALLOC_SYSTEM_HEAP == allocNo)
+			{
+				std::free(ptr);
+				return;
+			}
+
+			// memory of an allocator shut down already is gone with it, it is not freed again
+			MemoryAllocator& alloc = MemoryAllocator::Allocators[allocNo];
+			assert(alloc.Owns(ptr) && "container outlived its allocator");
+			if (alloc.Owns(ptr))
+			{
+				alloc.Deallocate(ptr);
+			}
+		}
+
+		uint32_t GetAllocNo() const { return allocNo; }
+
+	private:
+		uint32_t	allocNo;
+	};
+
+	template<class T, class U>
+	bool operator == (const StlAllocator<T>& a, const StlAllocator<U>& b) { return a.GetAllocNo() == b.GetAllocNo(); }
+
+	template<class T, class U>
+	bool operator != (const StlAllocator<T>& a, const StlAllocator<U>& b) { return a.GetAllocNo() != b.GetAllocNo(); }
+
+	// containers on engine allocators, level heap by default,
+	// pass StlAllocator<T>(allocNo) to constructor for another one
+	template<class T>
+	using Vector = std::vector<T, StlAllocator<T>>;
+
+	typedef std::basic_string<char, std::char_traits<char>, StlAllocator<char>> String;
+
+	// FNV-1a, std::hash has no specialization for strings with custom allocator
+	struct StringHash
+	{
+		size_t operator () (const String& str) const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (char c : str)
+			{
+				hash ^= static_cast<uint8_t>(c);
+				hash *= 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	template<class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+	using UnorderedMap = std::unordered_map<Key, Value, Hash, KeyEqual, StlAllocator<std::pair<const Key, Value>>>;
+}
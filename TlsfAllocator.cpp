@@ -0,0 +1,537 @@
+#include "TlsfAllocator.h"
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tofu
+{
+	// block layout:
+	// prevPhysBlock is stored at the end of previous block, only valid when previous block is free
+	// size is the only field of a used block, the user memory starts right after it
+	// nextFree and prevFree are stored in user memory when the block is free
+	struct TlsfAllocator::BlockHeader
+	{
+		BlockHeader*	prevPhysBlock;
+
+		// size of user memory, lowest 2 bits are free / previous free flags
+		size_t			size;
+
+		BlockHeader*	nextFree;
+		BlockHeader*	prevFree;
+	};
+}
+
+namespace
+{
+	using tofu::TlsfAllocator;
+	typedef TlsfAllocator::BlockHeader BlockHeader;
+
+	constexpr size_t BlockFreeBit = 1u << 0;
+	constexpr size_t BlockPrevFreeBit = 1u << 1;
+
+	// only size field is an overhead of a used block
+	constexpr size_t BlockOverhead = sizeof(size_t);
+
+	constexpr size_t BlockStartOffset = offsetof(BlockHeader, size) + sizeof(size_t);
+
+	// a free block must be able to hold the free list pointers
+	constexpr size_t BlockSizeMin = sizeof(BlockHeader) - sizeof(BlockHeader*);
+	constexpr size_t BlockSizeMax = size_t(1) << TlsfAllocator::FL_INDEX_MAX;
+
+	static_assert(TlsfAllocator::FL_INDEX_MAX < sizeof(size_t) * 8, "largest block size doesn't fit size_t");
+	static_assert(sizeof(uint32_t) * 8 >= TlsfAllocator::SL_INDEX_COUNT, "sl bitmap is too small");
+	static_assert(sizeof(uint32_t) * 8 >= TlsfAllocator::FL_INDEX_COUNT, "fl bitmap is too small");
+	static_assert(TlsfAllocator::ALIGN_SIZE == TlsfAllocator::SMALL_BLOCK_SIZE / TlsfAllocator::SL_INDEX_COUNT, "invalid alignment");
+
+	// index of least significant set bit
+	TF_INLINE int32_t ffs(uint32_t word)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		return _BitScanForward(&index, word) ? static_cast<int32_t>(index) : -1;
+#else
+		return word ? __builtin_ctz(word) : -1;
+#endif
+	}
+
+	// index of most significant set bit
+	TF_INLINE int32_t fls(size_t size)
+	{
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long index;
+		return _BitScanReverse64(&index, size) ? static_cast<int32_t>(index) : -1;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		return _BitScanReverse(&index, size) ? static_cast<int32_t>(index) : -1;
+#else
+		return size ? static_cast<int32_t>(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(size)) : -1;
+#endif
+	}
+
+	TF_INLINE size_t align_up(size_t x, size_t align)
+	{
+		return (x + (align - 1)) & ~(align - 1);
+	}
+
+	TF_INLINE size_t align_down(size_t x, size_t align)
+	{
+		return x - (x & (align - 1));
+	}
+
+	TF_INLINE uint8_t* align_ptr(uint8_t* ptr, size_t align)
+	{
+		return reinterpret_cast<uint8_t*>(align_up(reinterpret_cast<uintptr_t>(ptr), align));
+	}
+
+	TF_INLINE size_t block_size(const BlockHeader* block)
+	{
+		return block->size & ~(BlockFreeBit | BlockPrevFreeBit);
+	}
+
+	TF_INLINE void block_set_size(BlockHeader* block, size_t size)
+	{
+		block->size = size | (block->size & (BlockFreeBit | BlockPrevFreeBit));
+	}
+
+	// the sentinel at the end of heap has zero size
+	TF_INLINE bool block_is_last(const BlockHeader* block)
+	{
+		return block_size(block) == 0;
+	}
+
+	TF_INLINE bool block_is_free(const BlockHeader* block)
+	{
+		return (block->size & BlockFreeBit) != 0;
+	}
+
+	TF_INLINE void block_set_free(BlockHeader* block, bool free)
+	{
+		block->size = free ? (block->size | BlockFreeBit) : (block->size & ~BlockFreeBit);
+	}
+
+	TF_INLINE bool block_is_prev_free(const BlockHeader* block)
+	{
+		return (block->size & BlockPrevFreeBit) != 0;
+	}
+
+	TF_INLINE void block_set_prev_free(BlockHeader* block, bool free)
+	{
+		block->size = free ? (block->size | BlockPrevFreeBit) : (block->size & ~BlockPrevFreeBit);
+	}
+
+	TF_INLINE BlockHeader* block_from_ptr(const void* ptr)
+	{
+		return reinterpret_cast<BlockHeader*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(ptr)) - BlockStartOffset);
+	}
+
+	TF_INLINE uint8_t* block_to_ptr(const BlockHeader* block)
+	{
+		return const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(block)) + BlockStartOffset;
+	}
+
+	TF_INLINE BlockHeader* offset_to_block(const void* ptr, ptrdiff_t offset)
+	{
+		return reinterpret_cast<BlockHeader*>(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(ptr)) + offset);
+	}
+
+	TF_INLINE BlockHeader* block_prev(const BlockHeader* block)
+	{
+		assert(block_is_prev_free(block));
+		return block->prevPhysBlock;
+	}
+
+	TF_INLINE BlockHeader* block_next(const BlockHeader* block)
+	{
+		assert(!block_is_last(block));
+		return offset_to_block(block_to_ptr(block), block_size(block) - BlockOverhead);
+	}
+
+	TF_INLINE BlockHeader* block_link_next(BlockHeader* block)
+	{
+		BlockHeader* next = block_next(block);
+		next->prevPhysBlock = block;
+		return next;
+	}
+
+	TF_INLINE void block_mark_as_free(BlockHeader* block)
+	{
+		BlockHeader* next = block_link_next(block);
+		block_set_prev_free(next, true);
+		block_set_free(block, true);
+	}
+
+	TF_INLINE void block_mark_as_used(BlockHeader* block)
+	{
+		BlockHeader* next = block_next(block);
+		block_set_prev_free(next, false);
+		block_set_free(block, false);
+	}
+
+	TF_INLINE bool block_can_split(const BlockHeader* block, size_t size)
+	{
+		return block_size(block) >= sizeof(BlockHeader) + size;
+	}
+
+	// split block into two, the second one is returned as a free block
+	TF_INLINE BlockHeader* block_split(BlockHeader* block, size_t size)
+	{
+		BlockHeader* remaining = offset_to_block(block_to_ptr(block), size - BlockOverhead);
+
+		size_t remainSize = block_size(block) - (size + BlockOverhead);
+		assert(block_to_ptr(remaining) + remainSize == block_to_ptr(block) + block_size(block));
+		assert(remainSize >= BlockSizeMin);
+
+		remaining->size = 0;
+		block_set_size(remaining, remainSize);
+		block_set_size(block, size);
+		block_mark_as_free(remaining);
+
+		return remaining;
+	}
+
+	// merge block into its previous physical block
+	TF_INLINE BlockHeader* block_absorb(BlockHeader* prev, BlockHeader* block)
+	{
+		assert(!block_is_last(prev));
+		prev->size += block_size(block) + BlockOverhead;
+		block_link_next(prev);
+		return prev;
+	}
+
+	// round request up to alignment, and make sure it fits in a free block
+	TF_INLINE size_t adjust_request_size(size_t size, size_t align)
+	{
+		if (size == 0)
+			return 0;
+
+		size_t aligned = align_up(size, align);
+		if (aligned >= BlockSizeMax)
+			return 0;
+
+		return aligned < BlockSizeMin ? BlockSizeMin : aligned;
+	}
+
+	// find list that holds blocks of this size
+	TF_INLINE void mapping_insert(size_t size, uint32_t* fl, uint32_t* sl)
+	{
+		if (size < TlsfAllocator::SMALL_BLOCK_SIZE)
+		{
+			*fl = 0;
+			*sl = static_cast<uint32_t>(size) / (TlsfAllocator::SMALL_BLOCK_SIZE / TlsfAllocator::SL_INDEX_COUNT);
+		}
+		else
+		{
+			int32_t f = fls(size);
+			*sl = static_cast<uint32_t>(size >> (f - TlsfAllocator::SL_INDEX_COUNT_LOG2)) ^ TlsfAllocator::SL_INDEX_COUNT;
+			*fl = static_cast<uint32_t>(f - (TlsfAllocator::FL_INDEX_SHIFT - 1));
+		}
+	}
+
+	// find list that every block in it is large enough for this size
+	TF_INLINE void mapping_search(size_t size, uint32_t* fl, uint32_t* sl)
+	{
+		if (size >= TlsfAllocator::SMALL_BLOCK_SIZE)
+		{
+			size_t round = (size_t(1) << (fls(size) - TlsfAllocator::SL_INDEX_COUNT_LOG2)) - 1;
+			size += round;
+		}
+		mapping_insert(size, fl, sl);
+	}
+}
+
+namespace tofu
+{
+	TlsfAllocator::TlsfAllocator()
+		:
+		flBitmap(0),
+		slBitmap(),
+		blocks(),
+		firstBlock(nullptr)
+	{
+	}
+
+	TlsfAllocator* TlsfAllocator::Create(void* memory, size_t size)
+	{
+		if (nullptr == memory || (reinterpret_cast<uintptr_t>(memory) & (ALIGN_SIZE - 1)) != 0)
+		{
+			return nullptr;
+		}
+
+		// control structure, then room for first block's prevPhysBlock (never used)
+		size_t controlSize = align_up(sizeof(TlsfAllocator), ALIGN_SIZE) + ALIGN_SIZE;
+
+		// heap is closed by a zero sized sentinel block
+		if (size < controlSize + 2 * BlockOverhead + BlockSizeMin)
+		{
+			return nullptr;
+		}
+
+		size_t heapSize = align_down(size - controlSize - 2 * BlockOverhead, ALIGN_SIZE);
+		if (heapSize > BlockSizeMax - ALIGN_SIZE)
+		{
+			heapSize = BlockSizeMax - ALIGN_SIZE;
+		}
+
+		TlsfAllocator* alloc = new (memory) TlsfAllocator();
+
+		uint8_t* heap = reinterpret_cast<uint8_t*>(memory) + controlSize;
+
+		// size field of first block is at the very beginning of heap
+		BlockHeader* block = offset_to_block(heap, -static_cast<ptrdiff_t>(BlockOverhead));
+		block->size = 0;
+		block_set_size(block, heapSize);
+		block_set_free(block, true);
+		block_set_prev_free(block, false);
+		alloc->InsertFreeBlock(block);
+
+		BlockHeader* sentinel = block_link_next(block);
+		sentinel->size = 0;
+		block_set_free(sentinel, false);
+		block_set_prev_free(sentinel, true);
+
+		alloc->firstBlock = block;
+
+		return alloc;
+	}
+
+	void* TlsfAllocator::Allocate(size_t size, size_t alignment)
+	{
+		size_t adjust = adjust_request_size(size, ALIGN_SIZE);
+		if (adjust == 0)
+		{
+			return nullptr;
+		}
+
+		if (alignment <= ALIGN_SIZE)
+		{
+			return PrepareUsed(FindFreeBlock(adjust), adjust);
+		}
+
+		// leading gap has to be large enough to become a free block
+		constexpr size_t gapMinimum = sizeof(BlockHeader);
+		size_t sizeWithGap = adjust_request_size(adjust + alignment + gapMinimum, alignment);
+		if (sizeWithGap == 0)
+		{
+			return nullptr;
+		}
+
+		BlockHeader* block = FindFreeBlock(sizeWithGap);
+		if (nullptr == block)
+		{
+			return nullptr;
+		}
+
+		uint8_t* ptr = block_to_ptr(block);
+		uint8_t* aligned = align_ptr(ptr, alignment);
+		size_t gap = aligned - ptr;
+
+		// gap is too small, move to next aligned address
+		if (gap != 0 && gap < gapMinimum)
+		{
+			size_t gapRemain = gapMinimum - gap;
+			size_t offset = gapRemain > alignment ? gapRemain : alignment;
+			aligned = align_ptr(aligned + offset, alignment);
+			gap = aligned - ptr;
+		}
+
+		if (gap != 0)
+		{
+			assert(gap >= gapMinimum);
+			block = TrimFreeLeading(block, gap);
+		}
+
+		return PrepareUsed(block, adjust);
+	}
+
+	void TlsfAllocator::Deallocate(void* ptr)
+	{
+		if (nullptr == ptr)
+		{
+			return;
+		}
+
+		BlockHeader* block = block_from_ptr(ptr);
+		assert(!block_is_free(block) && "block already freed");
+
+		block_mark_as_free(block);
+		block = MergePrev(block);
+		block = MergeNext(block);
+		InsertFreeBlock(block);
+	}
+
+	size_t TlsfAllocator::GetBlockSize(void* ptr)
+	{
+		return nullptr != ptr ? block_size(block_from_ptr(ptr)) : 0;
+	}
+
+	void TlsfAllocator::GetFreeSpace(size_t* totalFree, size_t* largestFree) const
+	{
+		size_t total = 0;
+		size_t largest = 0;
+
+		for (BlockHeader* block = firstBlock; !block_is_last(block); block = block_next(block))
+		{
+			if (block_is_free(block))
+			{
+				size_t size = block_size(block);
+				total += size;
+				if (size > largest) largest = size;
+			}
+		}
+
+		if (nullptr != totalFree) *totalFree = total;
+		if (nullptr != largestFree) *largestFree = largest;
+	}
+
+	void TlsfAllocator::InsertFreeBlock(BlockHeader* block)
+	{
+		uint32_t fl, sl;
+		mapping_insert(block_size(block), &fl, &sl);
+
+		BlockHeader* head = blocks[fl][sl];
+		block->nextFree = head;
+		block->prevFree = nullptr;
+		if (nullptr != head)
+		{
+			head->prevFree = block;
+		}
+
+		blocks[fl][sl] = block;
+		flBitmap |= (1u << fl);
+		slBitmap[fl] |= (1u << sl);
+	}
+
+	void TlsfAllocator::RemoveFreeBlock(BlockHeader* block)
+	{
+		uint32_t fl, sl;
+		mapping_insert(block_size(block), &fl, &sl);
+
+		BlockHeader* prev = block->prevFree;
+		BlockHeader* next = block->nextFree;
+
+		if (nullptr != next)
+		{
+			next->prevFree = prev;
+		}
+
+		if (nullptr != prev)
+		{
+			prev->nextFree = next;
+		}
+		else
+		{
+			assert(blocks[fl][sl] == block);
+			blocks[fl][sl] = next;
+
+			// list is empty now, clear bitmaps
+			if (nullptr == next)
+			{
+				slBitmap[fl] &= ~(1u << sl);
+				if (0 == slBitmap[fl])
+				{
+					flBitmap &= ~(1u << fl);
+				}
+			}
+		}
+	}
+
+	TlsfAllocator::BlockHeader* TlsfAllocator::FindFreeBlock(size_t size)
+	{
+		uint32_t fl, sl;
+		mapping_search(size, &fl, &sl);
+
+		if (fl >= FL_INDEX_COUNT)
+		{
+			return nullptr;
+		}
+
+		// first try rest of the second level lists in this first level
+		uint32_t slMap = slBitmap[fl] & (~0u << sl);
+		if (0 == slMap)
+		{
+			// then larger first levels
+			uint32_t flMap = (fl + 1 < 32) ? (flBitmap & (~0u << (fl + 1))) : 0u;
+			if (0 == flMap)
+			{
+				return nullptr;
+			}
+
+			fl = static_cast<uint32_t>(ffs(flMap));
+			slMap = slBitmap[fl];
+		}
+
+		assert(0 != slMap);
+		sl = static_cast<uint32_t>(ffs(slMap));
+
+		BlockHeader* block = blocks[fl][sl];
+		assert(nullptr != block && block_size(block) >= size);
+
+		RemoveFreeBlock(block);
+		return block;
+	}
+
+	TlsfAllocator::BlockHeader* TlsfAllocator::MergePrev(BlockHeader* block)
+	{
+		if (block_is_prev_free(block))
+		{
+			BlockHeader* prev = block_prev(block);
+			assert(block_is_free(prev));
+			RemoveFreeBlock(prev);
+			block = block_absorb(prev, block);
+		}
+		return block;
+	}
+
+	TlsfAllocator::BlockHeader* TlsfAllocator::MergeNext(BlockHeader* block)
+	{
+		BlockHeader* next = block_next(block);
+		if (block_is_free(next))
+		{
+			assert(!block_is_last(next));
+			RemoveFreeBlock(next);
+			block = block_absorb(block, next);
+		}
+		return block;
+	}
+
+	void TlsfAllocator::TrimFree(BlockHeader* block, size_t size)
+	{
+		assert(block_is_free(block));
+		if (block_can_split(block, size))
+		{
+			BlockHeader* remaining = block_split(block, size);
+			block_link_next(block);
+			block_set_prev_free(remaining, true);
+			InsertFreeBlock(remaining);
+		}
+	}
+
+	TlsfAllocator::BlockHeader* TlsfAllocator::TrimFreeLeading(BlockHeader* block, size_t size)
+	{
+		BlockHeader* remaining = block;
+		if (block_can_split(block, size))
+		{
+			remaining = block_split(block, size - BlockOverhead);
+			block_set_prev_free(remaining, true);
+			block_link_next(block);
+			InsertFreeBlock(block);
+		}
+		return remaining;
+	}
+
+	void* TlsfAllocator::PrepareUsed(BlockHeader* block, size_t size)
+	{
+		if (nullptr == block)
+		{
+			return nullptr;
+		}
+
+		TrimFree(block, size);
+		block_mark_as_used(block);
+		return block_to_ptr(block);
+	}
+}
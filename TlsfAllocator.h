@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+namespace tofu
+{
+	// Two-Level Segregated Fit allocator, allocate and deallocate at O(1)
+	// with bounded fragmentation, it lives inside the memory block it manages.
+	// idea is from http://www.gii.upv.es/tlsf/
+	class TlsfAllocator
+	{
+	public:
+		// 2^5 second level lists for each power of 2
+		static constexpr uint32_t SL_INDEX_COUNT_LOG2 = 5;
+		static constexpr uint32_t SL_INDEX_COUNT = 1u << SL_INDEX_COUNT_LOG2;
+
+		// every block is aligned to 8 bytes
+		static constexpr uint32_t ALIGN_SIZE_LOG2 = 3;
+		static constexpr size_t ALIGN_SIZE = size_t(1) << ALIGN_SIZE_LOG2;
+
+		// blocks smaller than this are all in first level list 0
+		static constexpr uint32_t FL_INDEX_SHIFT = SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2;
+		static constexpr size_t SMALL_BLOCK_SIZE = size_t(1) << FL_INDEX_SHIFT;
+
+		// largest block is 4GB, 1GB where size_t is 32 bits
+		static constexpr uint32_t FL_INDEX_MAX = sizeof(size_t) == 8 ? 32 : 30;
+		static constexpr uint32_t FL_INDEX_COUNT = FL_INDEX_MAX - FL_INDEX_SHIFT + 1;
+
+		struct BlockHeader;
+
+	public:
+		// build an allocator at the beginning of given memory block,
+		// the rest of the block becomes the heap.
+		// return nullptr if the block is too small
+		static TlsfAllocator* Create(void* memory, size_t size);
+
+		void* Allocate(size_t size, size_t alignment);
+
+		void Deallocate(void* ptr);
+
+		// usable size of an allocated block
+		static size_t GetBlockSize(void* ptr);
+
+		// walk through all blocks physically, O(n), for diagnostics only
+		void GetFreeSpace(size_t* totalFree, size_t* largestFree) const;
+
+	private:
+		TlsfAllocator();
+
+		TlsfAllocator(const TlsfAllocator&) = delete;
+		TlsfAllocator& operator = (const TlsfAllocator&) = delete;
+
+		void			InsertFreeBlock(BlockHeader* block);
+		void			RemoveFreeBlock(BlockHeader* block);
+
+		BlockHeader*	FindFreeBlock(size_t size);
+		BlockHeader*	MergePrev(BlockHeader* block);
+		BlockHeader*	MergeNext(BlockHeader* block);
+
+		// split a free block (already removed from lists), put the remainder back
+		void			TrimFree(BlockHeader* block, size_t size);
+
+		// give the leading gap of a free block back to the heap
+		BlockHeader*	TrimFreeLeading(BlockHeader* block, size_t size);
+
+		void*			PrepareUsed(BlockHeader* block, size_t size);
+
+	private:
+		// bit i set if first level list i is not empty
+		uint32_t		flBitmap;
+		// bit j of slBitmap[i] set if blocks[i][j] is not empty
+		uint32_t		slBitmap[FL_INDEX_COUNT];
+
+		// heads of free lists, nullptr if empty
+		BlockHeader*	blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+		// first physical block of the heap
+		BlockHeader*	firstBlock;
+	};
+}
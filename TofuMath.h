@@ -150,7 +150,7 @@ namespace tofu
 
 		TF_INLINE float length(const float2& a)
 		{
-			return std::sqrtf(a.x * a.x + a.y * a.y);
+			return std::sqrt(a.x * a.x + a.y * a.y);
 		}
 
 		TF_INLINE float2 normalize(const float2& a)
@@ -257,7 +257,7 @@ namespace tofu
 
 		TF_INLINE float length(const float3& a)
 		{
-			return std::sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+			return std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z);
 		}
 
 		TF_INLINE float3 normalize(const float3& a)
@@ -364,13 +364,14 @@ namespace tofu
 			return float4{
 				a.y * b.z - a.z * b.y,
 				a.z * b.x - a.x * b.z,
-				a.x * b.y - a.y * b.x
+				a.x * b.y - a.y * b.x,
+				0.0f
 			};
 		}
 
 		TF_INLINE float length(const float4& a)
 		{
-			return std::sqrtf(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
+			return std::sqrt(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w);
 		}
 
 		TF_INLINE float4 normalize(const float4& a)
@@ -418,8 +419,8 @@ namespace tofu
 
 			TF_INLINE quat(float theta, const float3& axis)
 			{
-				float s = std::sinf(theta * 0.5f);
-				float c = std::cosf(theta * 0.5f);
+				float s = std::sin(theta * 0.5f);
+				float c = std::cos(theta * 0.5f);
 				x = s * axis.x;
 				y = s * axis.y;
 				z = s * axis.z;
@@ -429,12 +430,12 @@ namespace tofu
 			// order : roll, pitch, yaw
 			TF_INLINE quat(float pitch, float yaw, float roll)
 			{
-				float cp = std::cosf(pitch * 0.5f);
-				float sp = std::sinf(pitch * 0.5f);
-				float cy = std::cosf(yaw * 0.5f);
-				float sy = std::sinf(yaw * 0.5f);
-				float cr = std::cosf(roll * 0.5f);
-				float sr = std::sinf(roll * 0.5f);
+				float cp = std::cos(pitch * 0.5f);
+				float sp = std::sin(pitch * 0.5f);
+				float cy = std::cos(yaw * 0.5f);
+				float sy = std::sin(yaw * 0.5f);
+				float cr = std::cos(roll * 0.5f);
+				float sr = std::sin(roll * 0.5f);
 
 				x = sy * cp * sr + cy * sp * cr;
 				y = sy * cp * cr - cy * sp * sr;
@@ -498,9 +499,9 @@ namespace tofu
 				return lerp(a, b, t);
 			}
 
-			float omega = std::acosf(cosAB);
+			float omega = std::acos(cosAB);
 
-			return (std::sinf((1.0f - t) * omega) * a + std::sinf(t * omega) * c) / std::sinf(omega);
+			return (std::sin((1.0f - t) * omega) * a + std::sin(t * omega) * c) / std::sin(omega);
 		}
 
 		// float4x4
@@ -693,7 +694,7 @@ namespace tofu
 
 			TF_INLINE float4x4 perspective(float fov, float aspect, float zNear, float zFar)
 			{
-				float yScale = 1.0f / std::tanf(fov * 0.5f);
+				float yScale = 1.0f / std::tan(fov * 0.5f);
 				float xScale = yScale / aspect;
 				float zScale = zFar / (zFar - zNear);
 				float zOffset = zFar * zNear / (zNear - zFar);
@@ -1,10 +1,40 @@
 #include "TransformComponent.h"
 
+#include "SceneSnapshot.h"
+
+#include <cstddef>
+
 namespace tofu
 {
+	void TransformComponentData::SetParent(TransformComponent p)
+	{
+		if (parent)
+		{
+			Vector<TransformComponent>& siblings = parent->children;
+			for (auto i = siblings.begin(); i != siblings.end(); ++i)
+			{
+				if (*i && (*i)->entity.id == entity.id)
+				{
+					siblings.erase(i);
+					break;
+				}
+			}
+		}
+
+		parent = p;
+
+		if (parent)
+		{
+			parent->children.push_back(TransformComponent(entity));
+		}
+
+		UpdateTransfromInHierachy();
+	}
 
 	void TransformComponentData::UpdateTransfromInHierachy()
 	{
+		TransformComponent::MarkChanged(entity);
+
 		if (parent)
 		{
 			worldTransform = localTransform * parent->GetWorldTransform();
@@ -14,11 +44,54 @@ namespace tofu
 			worldTransform = localTransform;
 		}
 
+		// a destroyed child is skipped
 		for (auto i = children.begin(); i != children.end(); ++i)
 		{
-			(*i)->UpdateTransfromInHierachy();
+			if (*i)
+			{
+				(*i)->UpdateTransfromInHierachy();
+			}
 		}
 	}
 
+	void TransformComponentData::SnapshotRecord::Save(const TransformComponentData* components, uint32_t count, SnapshotRecord* records)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			records[i].parent = components[i].parent ? components[i].parent->entity : Entity();
+			records[i].localTransform = components[i].localTransform;
+		}
+	}
+
+	void TransformComponentData::SnapshotRecord::Load(TransformComponentData* components, const SnapshotRecord* records, uint32_t count)
+	{
+		// parents are among loaded components, or weren't saved
+		for (uint32_t i = 0; i < count; i++)
+		{
+			components[i].localTransform = records[i].localTransform;
+			components[i].parent = TransformComponent(records[i].parent);
+
+			if (components[i].parent)
+			{
+				components[i].parent->children.push_back(TransformComponent(components[i].entity));
+			}
+		}
+
+		// world transforms from roots down
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!components[i].parent)
+			{
+				components[i].UpdateTransfromInHierachy();
+			}
+		}
+	}
+
+	int32_t TransformComponentData::AddSnapshotType(SceneSnapshot& snapshot)
+	{
+		const SnapshotField fields[] = { { offsetof(SnapshotRecord, parent), scene::SCENE_FIXUP_ENTITY } };
+		return snapshot.AddType<TransformComponent, SnapshotRecord>("TransformComponent", fields, 1);
+	}
+
 }
 
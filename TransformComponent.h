@@ -2,16 +2,22 @@
 
 #include "Component.h"
 #include "Transform.h"
-#include <vector>
+#include "StlAllocator.h"
+
+#include <cfloat>
+#include <cmath>
 
 namespace tofu
 {
+	class SceneSnapshot;
 	class TransformComponentData;
 
 	typedef Component<TransformComponentData> TransformComponent;
 
 	class TransformComponentData
 	{
+		template<class> friend class Component;
+
 	public:
 		TransformComponentData() : TransformComponentData(Entity()) {}
 
@@ -19,14 +25,12 @@ namespace tofu
 			: 
 			entity(e),
 			parent(),
+			children(StlAllocator<TransformComponent>(ALLOC_LEVEL_BASED_HEAP)),
 			dirty(1)
 		{}
 
-		TF_INLINE void					SetParent(TransformComponent parent)
-		{
-			// TODO
-			UpdateTransfromInHierachy();
-		}
+		// no parent if it has no component
+		void							SetParent(TransformComponent parent);
 
 		TF_INLINE TransformComponent	GetParent() const { return parent; }
 
@@ -108,17 +112,32 @@ namespace tofu
 			float cosTheta = math::dot(fwd, newDir);
 			math::float3 axis = math::normalize(math::cross(fwd, newDir));
 
-			if (std::fabsf(cosTheta) >= 1.0 - FLT_EPSILON)
+			if (std::fabs(cosTheta) >= 1.0 - FLT_EPSILON)
 			{
 				axis = math::float3{ 0, 1, 0 };
 			}
 
-			float theta = std::acosf(cosTheta);
+			float theta = std::acos(cosTheta);
 			math::quat q(theta, axis);
 			assert(math::length(q) > 0.9995f);
 			SetLocalRotation(q);
 		}
 
+	public:
+
+		// a transform in a scene snapshot is its parent and local transform,
+		// children are found again from parents of loaded ones
+		struct SnapshotRecord
+		{
+			Entity						parent;
+			Transform					localTransform;
+
+			static void Save(const TransformComponentData* components, uint32_t count, SnapshotRecord* records);
+			static void Load(TransformComponentData* components, const SnapshotRecord* records, uint32_t count);
+		};
+
+		static int32_t					AddSnapshotType(SceneSnapshot& snapshot);
+
 	private:
 
 		void							UpdateTransfromInHierachy();
@@ -126,7 +145,7 @@ namespace tofu
 	private:
 		Entity							entity;
 		TransformComponent				parent;
-		std::vector<TransformComponent>	children;
+		Vector<TransformComponent>		children;
 
 		Transform						localTransform;
 		Transform						worldTransform;
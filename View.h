@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Common.h"
+#include "Component.h"
+
+#include <tuple>
+#include <utility>
+
+namespace tofu
+{
+	// component types a view leaves out, see View<...>::Without
+	template<class... Xs>
+	struct Exclude {};
+
+	template<class Excluded, class... Ts>
+	class BasicView;
+
+	// entities having every component of Ts (handle types, like TransformComponent) and none of Xs.
+	// the smallest array of Ts is walked, the other components are looked up by entity index,
+	// and fn(Entity, T::component_data_t&...) gets them with no further checks.
+	// a range of the walked array can go to each thread, as long as
+	// no component of these types is created or destroyed meanwhile
+	template<class... Xs, class... Ts>
+	class BasicView<Exclude<Xs...>, Ts...>
+	{
+		static_assert(sizeof...(Ts) > 0, "no component type given");
+
+	public:
+		template<class... Ys>
+		using Without = BasicView<Exclude<Xs..., Ys...>, Ts...>;
+
+		BasicView()
+			:
+			driver(0),
+			size(0)
+		{
+			const uint32_t sizes[] = { Component<typename Ts::component_data_t>::GetNumComponents()... };
+
+			size = sizes[0];
+			for (uint32_t i = 1; i < sizeof...(Ts); ++i)
+			{
+				if (sizes[i] < size)
+				{
+					size = sizes[i];
+					driver = i;
+				}
+			}
+		}
+
+		// length of the walked array, no more entities than this are in view
+		TF_INLINE uint32_t Size() const { return size; }
+
+		template<class Func>
+		TF_INLINE void Each(Func fn) const
+		{
+			Each(0, size, fn);
+		}
+
+		// entities at [begin, end) of the walked array
+		template<class Func>
+		TF_INLINE void Each(uint32_t begin, uint32_t end, Func fn) const
+		{
+			if (end > size) end = size;
+			Dispatch(begin, end, fn, std::index_sequence_for<Ts...>());
+		}
+
+	private:
+		template<class T>
+		struct Table
+		{
+			const ComponentIndex*	indices;
+			uint32_t				size;
+			uint32_t				count;
+
+			Table()
+				:
+				indices(Component<typename T::component_data_t>::GetIndexTable()),
+				size(Component<typename T::component_data_t>::GetIndexTableSize()),
+				count(Component<typename T::component_data_t>::GetNumComponents())
+			{}
+
+			// component index of entity, count or more if it has none
+			TF_INLINE uint32_t Find(uint32_t entityIdx) const
+			{
+				return entityIdx < size ? indices[entityIdx].idx : UINT32_MAX;
+			}
+		};
+
+		template<class Func, size_t... I>
+		TF_INLINE void Dispatch(uint32_t begin, uint32_t end, Func& fn, std::index_sequence<I...> seq) const
+		{
+			// one loop per walked type, so it is known at compile time inside the loop
+			int unused[] = { (I == driver ? (Walk<I>(begin, end, fn, seq), 0) : 0)... };
+			(void)unused;
+		}
+
+		template<size_t D, class Func, size_t... I>
+		static void Walk(uint32_t begin, uint32_t end, Func& fn, std::index_sequence<I...>)
+		{
+			typedef typename std::tuple_element<D, std::tuple<Ts...>>::type::component_data_t walked_t;
+
+			const Entity* entities = Component<walked_t>::GetAllEntities();
+			const std::tuple<typename Ts::component_data_t*...> arrays(Component<typename Ts::component_data_t>::GetAllComponents()...);
+			const std::tuple<Table<Ts>...> tables;
+			const std::tuple<Table<Xs>...> excluded;
+
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				Entity e = entities[i];
+				uint32_t idx = e.Index();
+
+				const uint32_t loc[] = { (I == D ? i : std::get<I>(tables).Find(idx))... };
+
+				bool found = true;
+				int unused[] = { (found &= loc[I] < std::get<I>(tables).count, 0)... };
+				(void)unused;
+
+				if (found && !IsExcluded(excluded, idx, std::index_sequence_for<Xs...>()))
+				{
+					fn(e, std::get<I>(arrays)[loc[I]]...);
+				}
+			}
+		}
+
+		template<size_t... J>
+		static TF_INLINE bool IsExcluded(const std::tuple<Table<Xs>...>& excluded, uint32_t idx, std::index_sequence<J...>)
+		{
+			bool any = false;
+			int unused[] = { 0, (any |= std::get<J>(excluded).Find(idx) < std::get<J>(excluded).count, 0)... };
+			(void)unused;
+			// not read when nothing is excluded
+			(void)idx;
+			return any;
+		}
+
+	private:
+		// which of Ts is walked
+		uint32_t	driver;
+		uint32_t	size;
+	};
+
+	template<class... Ts>
+	using View = BasicView<Exclude<>, Ts...>;
+}
@@ -7,11 +7,30 @@
 #include "Engine.h"
 #include <Windows.h>
 #include <cassert>
+#include <cstdio>
 
 #include "TestGame.h"
 
 using tofu::TF_OK;
 
+namespace
+{
+	// core utilization to debugger output, about once a second
+	void log_frame_stats(const tofu::FrameStats& stats, void* userData)
+	{
+		uint32_t& frame = *reinterpret_cast<uint32_t*>(userData);
+		if (0 != frame++ % 60)
+		{
+			return;
+		}
+
+		char line[128];
+		snprintf(line, sizeof(line), "frame %.1f ms, cores %.0f%% of %u threads, %u modules in parallel\n",
+			stats.deltaTime * 1000.0f, stats.coreUtilization * 100.0f, stats.numThreads, stats.maxParallelism);
+		OutputDebugStringA(line);
+	}
+}
+
 int CALLBACK WinMain(
 	_In_ HINSTANCE hInstance,
 	_In_ HINSTANCE hPrevInstance,
@@ -26,5 +45,9 @@ int CALLBACK WinMain(
 	tofu::Engine engine;
 	CHECKED(engine.Init("config.lua"));
 	CHECKED(engine.AddModule(new TestGame()));
+
+	uint32_t frame = 0;
+	engine.SetFrameStatsCallback(&log_frame_stats, &frame);
+
 	return engine.Run();
 }
@@ -2,9 +2,25 @@
 #define CHECK(x) {int ret = 0; if ((ret = (x)) != 0) return ret; }
 
 extern int test_math();
+extern int test_memory();
+extern int test_fileio();
+extern int test_handle();
+extern int test_component();
+extern int test_archetype();
+extern int test_view();
+extern int test_job();
+extern int test_snapshot();
 
 int main()
 {
 	CHECK(test_math());
+	CHECK(test_memory());
+	CHECK(test_fileio());
+	CHECK(test_handle());
+	CHECK(test_component());
+	CHECK(test_archetype());
+	CHECK(test_view());
+	CHECK(test_job());
+	CHECK(test_snapshot());
 	return 0;
 }
\ No newline at end of file
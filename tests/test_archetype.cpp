@@ -0,0 +1,229 @@
+#include "../ArchetypeStorage.h"
+
+#include <random>
+#include <vector>
+
+using tofu::ArchetypeStorage;
+using tofu::Entity;
+
+namespace
+{
+	struct Position
+	{
+		float		x, y, z;
+
+		Position(Entity e) : x(float(e.Index())), y(0), z(0) {}
+	};
+
+	struct Velocity
+	{
+		float		x, y, z;
+
+		Velocity(Entity) : x(1), y(2), z(3) {}
+	};
+
+	// counts live instances, so leaked or twice destructed components show up
+	struct Tracked
+	{
+		uint32_t	value;
+		static int	numAlive;
+
+		Tracked(Entity e) : value(e.Index()) { numAlive++; }
+		Tracked(Tracked&& other) : value(other.value) { numAlive++; }
+		~Tracked() { numAlive--; }
+	};
+
+	int Tracked::numAlive = 0;
+
+	// big enough that only a few fit into a chunk
+	struct Big
+	{
+		uint32_t	data[500];
+
+		Big(Entity e) { data[0] = e.Index(); }
+	};
+
+	int test_archetype_moves()
+	{
+		{
+			ArchetypeStorage storage;
+			if (tofu::TF_OK != storage.Init(1024))
+				return __LINE__;
+
+			Entity a(1), b(2), c(3);
+
+			Position* pa = storage.Add<Position>(a);
+			if (nullptr == pa || pa->x != 1.0f || !storage.Has<Position>(a) || storage.Has<Velocity>(a))
+				return __LINE__;
+			pa->y = 5.0f;
+
+			// adding the same type again returns the same component
+			if (storage.Add<Position>(a) != storage.Get<Position>(a))
+				return __LINE__;
+
+			// moving to another archetype keeps values
+			if (nullptr == storage.Add<Velocity>(a) || nullptr == storage.Add<Tracked>(a))
+				return __LINE__;
+			if (storage.Get<Position>(a)->y != 5.0f || storage.Get<Tracked>(a)->value != 1 || storage.GetNumArchetypes() != 3)
+				return __LINE__;
+
+			storage.Add<Position>(b);
+			storage.Add<Velocity>(b);
+			storage.Add<Tracked>(c);
+
+			uint32_t count = 0;
+			storage.ForEach<Position, Velocity>([&count](Entity, Position& p, Velocity& v)
+			{
+				p.x += v.x;
+				count++;
+			});
+
+			if (count != 2 || storage.Get<Position>(a)->x != 2.0f || storage.Get<Position>(b)->x != 3.0f)
+				return __LINE__;
+
+			if (tofu::TF_OK != storage.Remove<Velocity>(a) || storage.Has<Velocity>(a) || storage.Get<Position>(a)->y != 5.0f || storage.Get<Tracked>(a)->value != 1)
+				return __LINE__;
+
+			if (tofu::TF_OK == storage.Remove<Velocity>(a) || tofu::TF_OK == storage.Remove<Velocity>(c))
+				return __LINE__;
+
+			// an older generation of a stored entity is not the same entity
+			Entity stale(a.id + (1u << tofu::HANDLE_INDEX_BITS));
+			if (storage.Has<Position>(stale) || nullptr != storage.Add<Position>(stale) || tofu::TF_OK == storage.RemoveAll(stale))
+				return __LINE__;
+
+			// outside of capacity
+			if (nullptr != storage.Add<Position>(Entity(1024)))
+				return __LINE__;
+
+			if (Tracked::numAlive != 2)
+				return __LINE__;
+
+			if (tofu::TF_OK != storage.RemoveAll(c) || storage.Has<Tracked>(c) || Tracked::numAlive != 1)
+				return __LINE__;
+
+			// large components get fewer rows per chunk
+			storage.Add<Big>(b);
+			if (storage.Get<Big>(b)->data[0] != 2 || storage.Get<Position>(b)->x != 3.0f)
+				return __LINE__;
+
+			for (uint32_t i = 0; i < storage.GetNumArchetypes(); i++)
+			{
+				if (storage.GetArchetype(i).GetChunkCapacity() == 0)
+					return __LINE__;
+			}
+		}
+
+		// storage going away destructs what is left
+		if (Tracked::numAlive != 0)
+			return __LINE__;
+
+		return 0;
+	}
+
+	// random adds and removes against a plain table of which entity has what
+	int test_archetype_random()
+	{
+		constexpr uint32_t numEntities = 5000;
+
+		ArchetypeStorage storage;
+		if (tofu::TF_OK != storage.Init(numEntities))
+			return __LINE__;
+
+		std::vector<uint32_t> has(numEntities, 0);
+		std::default_random_engine rng;
+
+		for (uint32_t step = 0; step < 100000; step++)
+		{
+			Entity e(rng() % numEntities);
+			uint32_t bit = 1u << (rng() % 3);
+			bool add = rng() % 3 != 0;
+
+			if (rng() % 50 == 0)
+			{
+				storage.RemoveAll(e);
+				has[e.Index()] = 0;
+			}
+			else if (add)
+			{
+				void* ptr = bit == 1 ? static_cast<void*>(storage.Add<Position>(e))
+					: bit == 2 ? static_cast<void*>(storage.Add<Velocity>(e))
+					: static_cast<void*>(storage.Add<Tracked>(e));
+				if (nullptr == ptr)
+					return __LINE__;
+				has[e.Index()] |= bit;
+			}
+			else
+			{
+				int32_t ret = bit == 1 ? storage.Remove<Position>(e)
+					: bit == 2 ? storage.Remove<Velocity>(e)
+					: storage.Remove<Tracked>(e);
+				if ((tofu::TF_OK == ret) != (0 != (has[e.Index()] & bit)))
+					return __LINE__;
+				has[e.Index()] &= ~bit;
+			}
+		}
+
+		uint32_t expected[8] = {};
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e(i);
+			uint32_t mask = (storage.Has<Position>(e) ? 1 : 0) | (storage.Has<Velocity>(e) ? 2 : 0) | (storage.Has<Tracked>(e) ? 4 : 0);
+			if (mask != has[i])
+				return __LINE__;
+
+			// values follow the entity whichever archetype it's in
+			if (storage.Has<Position>(e) && storage.Get<Position>(e)->x != float(i))
+				return __LINE__;
+			if (storage.Has<Tracked>(e) && storage.Get<Tracked>(e)->value != i)
+				return __LINE__;
+
+			for (uint32_t m = 1; m < 8; m++)
+			{
+				if ((has[i] & m) == m)
+					expected[m]++;
+			}
+		}
+
+		uint32_t counted = 0;
+		storage.ForEach<Position, Tracked>([&counted](Entity e, Position& p, Tracked& t)
+		{
+			if (p.x == float(e.Index()) && t.value == e.Index())
+				counted++;
+		});
+		if (counted != expected[5] || Tracked::numAlive != int(expected[4]))
+			return __LINE__;
+
+		// chunks are packed, only the last one of an archetype has room
+		for (uint32_t i = 0; i < storage.GetNumArchetypes(); i++)
+		{
+			const tofu::Archetype& arch = storage.GetArchetype(i);
+			uint32_t rows = 0;
+			for (uint32_t c = 0; c < arch.GetNumChunks(); c++)
+			{
+				uint32_t count = arch.GetChunk(c)->count;
+				if (count == 0 || (c + 1 < arch.GetNumChunks() && count != arch.GetChunkCapacity()))
+					return __LINE__;
+				rows += count;
+			}
+			if (rows != arch.GetNumEntities())
+				return __LINE__;
+		}
+
+		storage.Release();
+		if (Tracked::numAlive != 0)
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int test_archetype()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_archetype_moves())) return ret;
+	if (0 != (ret = test_archetype_random())) return ret;
+
+	return 0;
+}
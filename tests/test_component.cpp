@@ -0,0 +1,637 @@
+#include "../Component.h"
+#include "../ComponentSorter.h"
+#include "../Entity.h"
+#include "../EntityCommandBuffer.h"
+#include "../JobSystem.h"
+#include "../Prefab.h"
+
+#include <vector>
+
+using tofu::ChangeTracking;
+using tofu::Component;
+using tofu::ComponentSorter;
+using tofu::Entity;
+using tofu::EntityCommands;
+using tofu::JobSystem;
+using tofu::Prefab;
+
+namespace
+{
+	struct CountComponentData
+	{
+		Entity		entity;
+		uint32_t	value;
+
+		CountComponentData() : CountComponentData(Entity()) {}
+		CountComponentData(Entity e) : entity(e), value(0) {}
+	};
+
+	typedef Component<CountComponentData> CountComponent;
+
+	// never added to any entity
+	struct UnusedComponentData
+	{
+		Entity		entity;
+		float		data[64];
+
+		UnusedComponentData() : UnusedComponentData(Entity()) {}
+		UnusedComponentData(Entity e) : entity(e), data() {}
+	};
+
+	typedef Component<UnusedComponentData> UnusedComponent;
+
+	// marks itself changed like engine components do
+	struct MovingComponentData
+	{
+		Entity		entity;
+		uint32_t	position;
+
+		MovingComponentData() : MovingComponentData(Entity()) {}
+		MovingComponentData(Entity e) : entity(e), position(0) {}
+
+		void Move(uint32_t p)
+		{
+			position = p;
+			Component<MovingComponentData>::MarkChanged(entity);
+		}
+	};
+
+	typedef Component<MovingComponentData> MovingComponent;
+
+	// ordered by ComponentSorter
+	struct SortedComponentData
+	{
+		Entity		entity;
+		uint32_t	key;
+
+		SortedComponentData() : SortedComponentData(Entity()) {}
+		SortedComponentData(Entity e) : entity(e), key(0) {}
+	};
+
+	typedef Component<SortedComponentData> SortedComponent;
+
+	// more entities than the default capacity, component storage grows with them
+	int test_component_storage()
+	{
+		constexpr uint32_t numEntities = tofu::MAX_ENTITIES * 3;
+
+		// leaves room for entities of later tests
+		constexpr uint32_t capacity = numEntities + tofu::MAX_ENTITIES;
+
+		if (tofu::TF_OK != Entity::SetCapacity(capacity) || Entity::GetCapacity() != capacity)
+			return __LINE__;
+
+		if (CountComponent::GetMemoryUsage() != 0 || CountComponent::GetNumComponents() != 0)
+			return __LINE__;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e)
+				return __LINE__;
+			entities.push_back(e);
+		}
+
+		// capacity is fixed once entities exist
+		if (tofu::TF_OK == Entity::SetCapacity(capacity * 2))
+			return __LINE__;
+
+		// every other entity gets a component
+		for (uint32_t i = 0; i < numEntities; i += 2)
+		{
+			CountComponent c = entities[i].AddComponent<CountComponent>();
+			if (!c)
+				return __LINE__;
+			c->value = i;
+		}
+
+		if (CountComponent::GetNumComponents() != numEntities / 2)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			CountComponent c = entities[i].GetComponent<CountComponent>();
+			if (bool(c) != (i % 2 == 0) || (c && c->value != i))
+				return __LINE__;
+
+			if (entities[i].GetComponent<UnusedComponent>())
+				return __LINE__;
+		}
+
+		// components are contiguous
+		CountComponentData* all = CountComponent::GetAllComponents();
+		for (uint32_t i = 0; i < CountComponent::GetNumComponents(); i++)
+		{
+			if (all[i].value % 2 != 0 || all[i].entity.GetComponent<CountComponent>()->value != all[i].value)
+				return __LINE__;
+		}
+
+		// removing moves the last one into the hole
+		for (uint32_t i = 0; i < numEntities; i += 4)
+		{
+			entities[i].GetComponent<CountComponent>().Destroy();
+		}
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			CountComponent c = entities[i].GetComponent<CountComponent>();
+			if (bool(c) != (i % 4 == 2) || (c && c->value != i))
+				return __LINE__;
+		}
+
+		// a type nobody uses takes no memory
+		if (UnusedComponent::GetMemoryUsage() != 0 || CountComponent::GetMemoryUsage() == 0)
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_change_tracking()
+	{
+		constexpr uint32_t numEntities = 300;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e || !e.AddComponent<MovingComponent>())
+				return __LINE__;
+			entities.push_back(e);
+		}
+
+		auto count_changed = [](uint32_t since)
+		{
+			uint32_t count = 0;
+			MovingComponent::ForEachChanged(since, [&](Entity e, MovingComponentData& m)
+			{
+				if (m.entity.id == e.id) count++;
+			});
+			return count;
+		};
+
+		// new components are changes
+		uint32_t created = ChangeTracking::GetFrame();
+		if (count_changed(created) != numEntities)
+			return __LINE__;
+
+		ChangeTracking::NextFrame();
+		ChangeTracking::NextFrame();
+		uint32_t frame = ChangeTracking::GetFrame();
+
+		if (count_changed(frame) != 0 || count_changed(frame - 1) != 0)
+			return __LINE__;
+
+		// nothing moved in frames kept, so changes since frames before are found by walking all
+		if (count_changed(created) != numEntities || count_changed(created + 1) != 0)
+			return __LINE__;
+
+		// only what moved is visited, once even if it moved in both frames
+		uint32_t version = MovingComponent::GetVersion(entities[7]);
+		entities[7].GetComponent<MovingComponent>()->Move(1);
+		entities[7].GetComponent<MovingComponent>()->Move(2);
+		entities[100].GetComponent<MovingComponent>()->Move(1);
+		if (MovingComponent::GetVersion(entities[7]) != version + 2 || count_changed(frame) != 2)
+			return __LINE__;
+
+		ChangeTracking::NextFrame();
+		entities[7].GetComponent<MovingComponent>()->Move(3);
+		entities[299].GetComponent<MovingComponent>()->Move(1);
+
+		if (count_changed(frame) != 3 || count_changed(frame + 1) != 2)
+			return __LINE__;
+
+		// removed components are not visited
+		entities[299].GetComponent<MovingComponent>().Destroy();
+		if (count_changed(frame) != 2)
+			return __LINE__;
+
+		// changes of the frame before last are dropped
+		ChangeTracking::NextFrame();
+		if (count_changed(frame + 2) != 0 || count_changed(frame + 1) != 1)
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_entity_destroy()
+	{
+		constexpr uint32_t numEntities = 200;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e)
+				return __LINE__;
+			entities.push_back(e);
+
+			CountComponent c = e.AddComponent<CountComponent>();
+			c->value = i;
+			if (i % 2 == 0) e.AddComponent<MovingComponent>()->position = i;
+		}
+
+		uint32_t numCounts = CountComponent::GetNumComponents();
+		uint32_t numMoving = MovingComponent::GetNumComponents();
+
+		// every third one, in reverse so the batch is not sorted, some twice
+		for (uint32_t i = numEntities; i-- > 0;)
+		{
+			if (i % 3 != 0) continue;
+			if (tofu::TF_OK != entities[i].Destroy() || tofu::TF_OK != entities[i].Destroy())
+				return __LINE__;
+		}
+
+		// nothing happens before flush
+		uint32_t numDestroyed = (numEntities + 2) / 3;
+		if (Entity::GetNumPendingDestroy() != numDestroyed || !entities[0] || !entities[0].GetComponent<CountComponent>())
+			return __LINE__;
+
+		if (tofu::TF_OK != Entity::FlushDestroyed() || Entity::GetNumPendingDestroy() != 0)
+			return __LINE__;
+
+		uint32_t numMovingDestroyed = (numEntities + 5) / 6;
+		if (CountComponent::GetNumComponents() != numCounts - numDestroyed
+			|| MovingComponent::GetNumComponents() != numMoving - numMovingDestroyed)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = entities[i];
+			if (bool(e) == (i % 3 == 0))
+				return __LINE__;
+
+			if (i % 3 == 0)
+				continue;
+
+			CountComponent c = e.GetComponent<CountComponent>();
+			MovingComponent m = e.GetComponent<MovingComponent>();
+			if (!c || c->value != i || bool(m) != (i % 2 == 0) || (m && m->position != i))
+				return __LINE__;
+		}
+
+		// stale entities can't be destroyed again
+		if (tofu::TF_OK == entities[0].Destroy() || Entity::GetNumPendingDestroy() != 0)
+			return __LINE__;
+
+		// slots are reused by new entities, which have no components
+		bool reused = false;
+		for (uint32_t i = 0; i < numDestroyed; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e || e.GetComponent<CountComponent>() || e.GetComponent<MovingComponent>())
+				return __LINE__;
+
+			reused |= e.Index() == entities[0].Index();
+		}
+		if (!reused)
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_command_buffers()
+	{
+		constexpr uint32_t numEntities = 1000;
+
+		JobSystem jobs;
+		if (tofu::TF_OK != jobs.Init(4))
+			return __LINE__;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			entities.push_back(Entity::Create());
+		}
+
+		uint32_t numCounts = CountComponent::GetNumComponents();
+
+		// jobs add components, and spawn an entity every 10
+		std::vector<Entity> spawned(numEntities / 10);
+		jobs.ParallelFor(numEntities, 10, [&](uint32_t begin, uint32_t end)
+		{
+			tofu::EntityCommandBuffer& cmds = EntityCommands::Get();
+			cmds.SetSortKey(begin);
+
+			for (uint32_t i = begin; i < end; i++)
+			{
+				cmds.AddComponent<CountComponent>(entities[i], [i](CountComponentData& c) { c.value = i; });
+				if (i % 10 == 0)
+				{
+					Entity e = cmds.CreateEntity();
+					cmds.AddComponent<MovingComponent>(e);
+					spawned[i / 10] = e;
+				}
+			}
+		});
+
+		// nothing is added before playback
+		if (CountComponent::GetNumComponents() != numCounts || entities[0].GetComponent<CountComponent>())
+			return __LINE__;
+
+		if (tofu::TF_OK != EntityCommands::Playback())
+			return __LINE__;
+
+		// replayed in order of sort key, whichever thread recorded them
+		CountComponentData* all = CountComponent::GetAllComponents();
+		if (CountComponent::GetNumComponents() != numCounts + numEntities)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			if (all[numCounts + i].value != i || all[numCounts + i].entity.id != entities[i].id)
+				return __LINE__;
+		}
+
+		for (Entity e : spawned)
+		{
+			if (!e || !e.GetComponent<MovingComponent>())
+				return __LINE__;
+		}
+
+		// removing components and destroying entities
+		jobs.ParallelFor(numEntities, 10, [&](uint32_t begin, uint32_t end)
+		{
+			tofu::EntityCommandBuffer& cmds = EntityCommands::Get();
+			cmds.SetSortKey(begin);
+
+			for (uint32_t i = begin; i < end; i++)
+			{
+				if (i % 2 == 0)
+				{
+					cmds.RemoveComponent<CountComponent>(entities[i]);
+				}
+				else
+				{
+					cmds.DestroyEntity(entities[i]);
+					cmds.AddComponent<MovingComponent>(entities[i]);
+				}
+			}
+		});
+
+		if (tofu::TF_OK != EntityCommands::Playback() || tofu::TF_OK != Entity::FlushDestroyed())
+			return __LINE__;
+
+		if (CountComponent::GetNumComponents() != numCounts)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			if (bool(entities[i]) != (i % 2 == 0))
+				return __LINE__;
+		}
+
+		// commands of entities destroyed before replay are dropped
+		uint32_t numMoving = MovingComponent::GetNumComponents();
+		if (tofu::TF_OK != EntityCommands::Get().AddComponent<MovingComponent>(entities[1]) || EntityCommands::Get().GetNumCommands() != 1)
+			return __LINE__;
+
+		if (tofu::TF_OK != EntityCommands::Playback() || MovingComponent::GetNumComponents() != numMoving)
+			return __LINE__;
+
+		// empty playback does nothing
+		if (tofu::TF_OK != EntityCommands::Playback() || EntityCommands::Get().GetNumCommands() != 0)
+			return __LINE__;
+
+		// a key set by one job doesn't carry over to later jobs on the same thread,
+		// those keep the key of their ParallelFor range
+		std::vector<Entity> more;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			more.push_back(Entity::Create());
+		}
+
+		numCounts = CountComponent::GetNumComponents();
+
+		jobs.ParallelFor(numEntities, 10, [&](uint32_t begin, uint32_t end)
+		{
+			tofu::EntityCommandBuffer& cmds = EntityCommands::Get();
+			cmds.SetSortKey(UINT32_MAX - begin);
+
+			for (uint32_t i = begin; i < end; i++)
+				cmds.AddComponent<MovingComponent>(more[i]);
+		});
+
+		jobs.ParallelFor(numEntities, 10, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+				EntityCommands::Get().AddComponent<CountComponent>(more[i], [i](CountComponentData& c) { c.value = i; });
+		});
+
+		if (tofu::TF_OK != EntityCommands::Playback() || CountComponent::GetNumComponents() != numCounts + numEntities)
+			return __LINE__;
+
+		all = CountComponent::GetAllComponents();
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			if (all[numCounts + i].value != i)
+				return __LINE__;
+		}
+
+		for (Entity e : more)
+			e.Destroy();
+		if (tofu::TF_OK != Entity::FlushDestroyed())
+			return __LINE__;
+
+		if (tofu::TF_OK != jobs.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_spawn_batch()
+	{
+		// more than one batch of entities
+		constexpr uint32_t numSpawned = tofu::SPAWN_BATCH_SIZE + 100;
+
+		uint32_t numCounts = CountComponent::GetNumComponents();
+		uint32_t numMoving = MovingComponent::GetNumComponents();
+
+		CountComponentData count;
+		count.value = 7;
+		MovingComponentData moving;
+		moving.position = 3;
+
+		Prefab prefab;
+		if (tofu::TF_OK != prefab.Add<CountComponent>(count)
+			|| tofu::TF_OK != prefab.Add<MovingComponent>()
+			|| tofu::TF_OK != prefab.Add<MovingComponent>(moving)
+			|| prefab.GetNumComponents() != 2)
+			return __LINE__;
+
+		uint32_t frame = ChangeTracking::GetFrame();
+
+		std::vector<Entity> spawned;
+		int32_t err = tofu::SpawnBatch(prefab, numSpawned, [&](Entity e, uint32_t i)
+		{
+			if (i == spawned.size()) spawned.push_back(e);
+			e.GetComponent<CountComponent>()->value += i;
+		});
+
+		if (tofu::TF_OK != err || spawned.size() != numSpawned)
+			return __LINE__;
+
+		if (CountComponent::GetNumComponents() != numCounts + numSpawned || MovingComponent::GetNumComponents() != numMoving + numSpawned)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numSpawned; i++)
+		{
+			Entity e = spawned[i];
+			CountComponent c = e.GetComponent<CountComponent>();
+			MovingComponent m = e.GetComponent<MovingComponent>();
+
+			// copies are owned by their entities
+			if (!e || !c || !m || c->value != 7 + i || m->position != 3 || c->entity.id != e.id || m->entity.id != e.id)
+				return __LINE__;
+
+			for (uint32_t j = 0; j < i; j += 97)
+			{
+				if (spawned[j].id == e.id)
+					return __LINE__;
+			}
+		}
+
+		// spawning counts as a change
+		uint32_t numChanged = 0;
+		MovingComponent::ForEachChanged(frame, [&](Entity, MovingComponentData& m) { if (m.position == 3) numChanged++; });
+		if (numChanged != numSpawned)
+			return __LINE__;
+
+		// no entity is created if not all of them fit
+		std::vector<Entity> tooMany(Entity::GetCapacity());
+		if (tofu::TF_OK == Entity::CreateBatch(tooMany.data(), Entity::GetCapacity()))
+			return __LINE__;
+
+		for (Entity e : spawned)
+			e.Destroy();
+		if (tofu::TF_OK != Entity::FlushDestroyed() || CountComponent::GetNumComponents() != numCounts || MovingComponent::GetNumComponents() != numMoving)
+			return __LINE__;
+
+		// ids freed by the failed batch are given out again
+		if (tofu::TF_OK != Entity::CreateBatch(tooMany.data(), numSpawned))
+			return __LINE__;
+		for (uint32_t i = 0; i < numSpawned; i++)
+		{
+			if (!tooMany[i])
+				return __LINE__;
+			tooMany[i].Destroy();
+		}
+		Entity::FlushDestroyed();
+
+		return 0;
+	}
+
+	uint64_t sorted_key(Entity e, const SortedComponentData& c)
+	{
+		return static_cast<uint64_t>(c.key) << tofu::HANDLE_INDEX_BITS | e.Index();
+	}
+
+	// components in order of key, and each still found from its entity
+	bool check_sorted(const std::vector<Entity>& entities)
+	{
+		const SortedComponentData* comps = SortedComponent::GetAllComponents();
+		const Entity* owners = SortedComponent::GetAllEntities();
+
+		for (uint32_t i = 0; i < SortedComponent::GetNumComponents(); i++)
+		{
+			if (comps[i].entity.id != owners[i].id || SortedComponent::GetIndexTable()[owners[i].Index()].idx != i)
+				return false;
+			if (i > 0 && sorted_key(owners[i - 1], comps[i - 1]) > sorted_key(owners[i], comps[i]))
+				return false;
+		}
+
+		for (Entity e : entities)
+		{
+			SortedComponent c = e.GetComponent<SortedComponent>();
+			if (!c || c->entity.id != e.id || c->key != (e.Index() * 2654435761u) % 1000)
+				return false;
+		}
+
+		return true;
+	}
+
+	int test_component_sorter()
+	{
+		constexpr uint32_t budget = 256;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < 2000; i++)
+		{
+			Entity e = Entity::Create();
+			SortedComponent c = e ? e.AddComponent<SortedComponent>() : SortedComponent();
+			if (!c)
+				return __LINE__;
+			c->key = (e.Index() * 2654435761u) % 1000;
+			entities.push_back(e);
+		}
+
+		ComponentSorter<SortedComponentData> sorter;
+
+		// takes many small steps
+		uint32_t numUpdates = 0;
+		while (!sorter.IsSorted() && numUpdates < 1000)
+		{
+			if (tofu::TF_OK != sorter.Update(budget, &sorted_key))
+				return __LINE__;
+			numUpdates++;
+		}
+
+		if (!sorter.IsSorted() || numUpdates < 2000 / budget || !check_sorted(entities))
+			return __LINE__;
+
+		// array changing in the middle of a pass is put in order by the next one
+		for (uint32_t i = 0; i < 4; i++)
+			sorter.Update(budget, &sorted_key);
+
+		for (uint32_t i = 0; i < entities.size(); i += 3)
+			entities[i].Destroy();
+		Entity::FlushDestroyed();
+
+		std::vector<Entity> alive;
+		for (uint32_t i = 0; i < entities.size(); i++)
+		{
+			if (i % 3 != 0) alive.push_back(entities[i]);
+		}
+
+		for (uint32_t i = 0; i < 400; i++)
+		{
+			Entity e = Entity::Create();
+			SortedComponent c = e ? e.AddComponent<SortedComponent>() : SortedComponent();
+			if (!c)
+				return __LINE__;
+			c->key = (e.Index() * 2654435761u) % 1000;
+			alive.push_back(e);
+		}
+
+		numUpdates = 0;
+		do
+		{
+			if (tofu::TF_OK != sorter.Update(budget, &sorted_key))
+				return __LINE__;
+			numUpdates++;
+		} while (!sorter.IsSorted() && numUpdates < 1000);
+
+		if (!sorter.IsSorted() || SortedComponent::GetNumComponents() != alive.size() || !check_sorted(alive))
+			return __LINE__;
+
+		for (Entity e : alive)
+			e.Destroy();
+		Entity::FlushDestroyed();
+
+		return 0;
+	}
+}
+
+int test_component()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_component_storage())) return ret;
+	if (0 != (ret = test_change_tracking())) return ret;
+	if (0 != (ret = test_entity_destroy())) return ret;
+	if (0 != (ret = test_command_buffers())) return ret;
+	if (0 != (ret = test_spawn_batch())) return ret;
+	if (0 != (ret = test_component_sorter())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,581 @@
+#include "../Compression.h"
+#include "../FileIO.h"
+#include "../IOSystem.h"
+#include "../MemoryAllocator.h"
+#include "../tools/pak_builder/pak_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using tofu::Compression;
+using tofu::FileIO;
+using tofu::FileMapping;
+using tofu::IOResult;
+using tofu::IOSystem;
+using tofu::MemoryAllocator;
+using tofu::TF_OK;
+
+namespace
+{
+	constexpr uint32_t TestAllocNo = tofu::ALLOC_FRAME_BASED_MEM;
+	constexpr size_t TestMemSize = 4 * 1024 * 1024;
+
+	const char* TestFile = "test_fileio.tmp";
+	const char* EmptyFile = "test_fileio_empty.tmp";
+
+	bool write_file(const char* file, const std::vector<uint8_t>& content)
+	{
+		FILE* fp = fopen(file, "wb");
+		if (nullptr == fp)
+			return false;
+
+		bool ok = content.empty() || 1 == fwrite(content.data(), content.size(), 1, fp);
+		return 0 == fclose(fp) && ok;
+	}
+
+	std::vector<uint8_t> make_content(size_t size)
+	{
+		std::vector<uint8_t> content(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			content[i] = static_cast<uint8_t>(i * 31 + (i >> 8));
+		}
+		return content;
+	}
+
+	int test_read_file()
+	{
+		// not a multiple of page size
+		std::vector<uint8_t> content = make_content(300 * 1024 + 17);
+		if (!write_file(TestFile, content))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != alloc.Init(TestMemSize, 4096))
+			return __LINE__;
+
+		void* data = nullptr;
+		size_t size = 0;
+		if (TF_OK != FileIO::ReadFile(TestFile, &data, &size, 64, TestAllocNo))
+			return __LINE__;
+
+		if (size != content.size() || (reinterpret_cast<uintptr_t>(data) & 63u) != 0u)
+			return __LINE__;
+
+		if (0 != memcmp(data, content.data(), size))
+			return __LINE__;
+
+		if (TF_OK == FileIO::ReadFile("no_such_file.tmp", &data, &size, 4, TestAllocNo))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		remove(TestFile);
+		return 0;
+	}
+
+	int test_map_file()
+	{
+		std::vector<uint8_t> content = make_content(1024 * 1024 + 123);
+		if (!write_file(TestFile, content) || !write_file(EmptyFile, std::vector<uint8_t>()))
+			return __LINE__;
+
+		FileMapping mapping = {};
+		if (TF_OK != FileIO::MapFile(TestFile, &mapping))
+			return __LINE__;
+
+		if (nullptr == mapping.data || mapping.size != content.size())
+			return __LINE__;
+
+		if (0 != memcmp(mapping.data, content.data(), mapping.size))
+			return __LINE__;
+
+		// a second view of the same file is independent
+		FileMapping other = {};
+		if (TF_OK != FileIO::MapFile(TestFile, &other) || other.data == mapping.data)
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmapFile(&mapping) || nullptr != mapping.data || 0 != mapping.size)
+			return __LINE__;
+
+		if (0 != memcmp(other.data, content.data(), other.size))
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmapFile(&other))
+			return __LINE__;
+
+		// unmapping twice is harmless
+		if (TF_OK != FileIO::UnmapFile(&other))
+			return __LINE__;
+
+		if (TF_OK == FileIO::MapFile("no_such_file.tmp", &mapping) || nullptr != mapping.data)
+			return __LINE__;
+
+		if (TF_OK == FileIO::MapFile(EmptyFile, &mapping) || nullptr != mapping.data)
+			return __LINE__;
+
+		remove(TestFile);
+		remove(EmptyFile);
+		return 0;
+	}
+
+	struct AsyncReads
+	{
+		uint32_t		numCallbacks;
+		uint32_t		numCancelled;
+		uint32_t		numFailed;
+		uint32_t		numMismatches;
+		const std::vector<uint8_t>*	content;
+	};
+
+	void on_read(const IOResult& result)
+	{
+		AsyncReads* reads = reinterpret_cast<AsyncReads*>(result.userData);
+		reads->numCallbacks++;
+
+		if (tofu::TF_CANCELLED == result.err)
+		{
+			reads->numCancelled++;
+			if (nullptr != result.data)
+				reads->numMismatches++;
+			return;
+		}
+
+		if (TF_OK != result.err)
+		{
+			reads->numFailed++;
+			return;
+		}
+
+		if (result.size != reads->content->size() || 0 != memcmp(result.data, reads->content->data(), result.size))
+			reads->numMismatches++;
+
+		MemoryAllocator::Allocators[TestAllocNo].Deallocate(result.data);
+	}
+
+	int test_async_read()
+	{
+		constexpr uint32_t numReads = 64;
+
+		std::vector<uint8_t> content = make_content(64 * 1024 + 5);
+		if (!write_file(TestFile, content))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != alloc.Init(TestMemSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF | tofu::ALLOC_FLAG_CONCURRENT))
+			return __LINE__;
+
+		IOSystem io;
+		if (TF_OK != io.Init())
+			return __LINE__;
+
+		AsyncReads reads = {};
+		reads.content = &content;
+
+		tofu::IORequestHandle handles[numReads];
+		for (uint32_t i = 0; i < numReads; i++)
+		{
+			tofu::IOPriority priority = static_cast<tofu::IOPriority>(i % tofu::MAX_IO_PRIORITIES);
+			handles[i] = io.ReadAsync(TestFile, TestAllocNo, 16, priority, on_read, &reads);
+			if (!handles[i])
+				return __LINE__;
+		}
+
+		// cancelled requests still get their callback, unless they are already finished
+		uint32_t numCancelRequests = 0;
+		for (uint32_t i = numReads / 2; i < numReads; i++)
+		{
+			if (TF_OK == io.Cancel(handles[i]))
+				numCancelRequests++;
+		}
+
+		if (!io.ReadAsync("no_such_file.tmp", TestAllocNo, 16, tofu::IO_PRIORITY_HIGH, on_read, &reads))
+			return __LINE__;
+
+		// callbacks only come from Update(), like once per frame
+		for (uint32_t frame = 0; frame < 5000 && reads.numCallbacks < numReads + 1; frame++)
+		{
+			if (TF_OK != io.Update())
+				return __LINE__;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (reads.numCallbacks != numReads + 1 || reads.numFailed != 1 || reads.numMismatches != 0)
+			return __LINE__;
+
+		if (reads.numCancelled != numCancelRequests)
+			return __LINE__;
+
+		// handles of finished requests are stale, even after their slots are reused
+		tofu::IORequestHandle reused = io.ReadAsync(TestFile, TestAllocNo, 16, tofu::IO_PRIORITY_LOW, on_read, &reads);
+		if (!reused)
+			return __LINE__;
+
+		for (uint32_t i = 0; i < numReads; i++)
+		{
+			if (handles[i].id == reused.id || TF_OK == io.Cancel(handles[i]))
+				return __LINE__;
+		}
+
+		for (uint32_t frame = 0; frame < 5000 && reads.numCallbacks < numReads + 2; frame++)
+		{
+			if (TF_OK != io.Update())
+				return __LINE__;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (reads.numCallbacks != numReads + 2 || reads.numMismatches != 0)
+			return __LINE__;
+
+		if (TF_OK != io.Shutdown())
+			return __LINE__;
+
+		// everything read is given back
+		if (nullptr == alloc.Allocate(TestMemSize / 4 * 3, 16))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		remove(TestFile);
+		return 0;
+	}
+
+	int test_pak()
+	{
+		const char* pakFile = "test_fileio.pak";
+		const char* looseFile = "test_fileio_loose.tmp";
+
+		std::vector<uint8_t> model = make_content(200 * 1024 + 3);
+		std::vector<uint8_t> shader = make_content(1000);
+		std::vector<uint8_t> loose = make_content(5000);
+
+		const tofu::pak::PakSource sources[] = {
+			{ "test_assets/Cube.model", model.data(), model.size() },
+			{ "test_assets/opaque_vs.shader", shader.data(), shader.size() },
+		};
+
+		if (0 != tofu::pak::WritePak(pakFile, sources, 2) || !write_file(looseFile, loose))
+			return __LINE__;
+
+		// not an archive
+		if (TF_OK == FileIO::MountPak(looseFile))
+			return __LINE__;
+
+		if (TF_OK != FileIO::MountPak(pakFile))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != alloc.Init(TestMemSize, 4096))
+			return __LINE__;
+
+		// case and slashes don't matter
+		void* data = nullptr;
+		size_t size = 0;
+		if (TF_OK != FileIO::ReadFile("test_assets\\cube.model", &data, &size, 16, TestAllocNo))
+			return __LINE__;
+
+		if (size != model.size() || 0 != memcmp(data, model.data(), size))
+			return __LINE__;
+
+		// paths whose hashes collide are told apart by the same rules
+		if (!tofu::pak::SamePath("test_assets\\cube.model", "test_assets/Cube.model")
+			|| tofu::pak::SamePath("test_assets/cube.model", "test_assets/cube.mode")
+			|| tofu::pak::SamePath("test_assets/cube.model", "test_assets/cone.model"))
+			return __LINE__;
+
+		FileMapping mapping = {};
+		if (TF_OK != FileIO::MapFile("test_assets/opaque_vs.shader", &mapping))
+			return __LINE__;
+
+		if (mapping.size != shader.size() || 0 != memcmp(mapping.data, shader.data(), mapping.size))
+			return __LINE__;
+
+		if ((reinterpret_cast<uintptr_t>(mapping.data) & (tofu::pak::PAK_ENTRY_ALIGNMENT - 1)) != 0)
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmapFile(&mapping) || nullptr != mapping.data)
+			return __LINE__;
+
+		// files not in the archive are still read from disk
+		if (TF_OK != FileIO::MapFile(looseFile, &mapping) || mapping.size != loose.size())
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmapFile(&mapping))
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmountPaks())
+			return __LINE__;
+
+		if (TF_OK == FileIO::MapFile("test_assets/opaque_vs.shader", &mapping))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		remove(pakFile);
+		remove(looseFile);
+		return 0;
+	}
+
+	// vertex like data, floats that repeat with small changes
+	std::vector<uint8_t> make_compressible(size_t size)
+	{
+		std::vector<uint8_t> content(size);
+		std::default_random_engine rng;
+		for (size_t i = 0; i + sizeof(float) <= size; i += sizeof(float))
+		{
+			float v = static_cast<float>((i / 48) % 64) * 0.25f + ((rng() % 16 == 0) ? 1.0f : 0.0f);
+			memcpy(&content[i], &v, sizeof(float));
+		}
+		return content;
+	}
+
+	int test_compression()
+	{
+		// blocks of every kind: empty, shorter than a match, random, repetitive, overlapping match
+		std::vector<std::vector<uint8_t>> inputs;
+		inputs.push_back(std::vector<uint8_t>());
+		inputs.push_back(std::vector<uint8_t>(7, 'a'));
+		inputs.push_back(std::vector<uint8_t>(100000, 'b'));
+		inputs.push_back(make_compressible(70000));
+
+		std::vector<uint8_t> noise(50000);
+		std::default_random_engine rng(7);
+		for (uint8_t& b : noise)
+			b = static_cast<uint8_t>(rng());
+		inputs.push_back(noise);
+
+		for (const std::vector<uint8_t>& input : inputs)
+		{
+			std::vector<uint8_t> compressed(Compression::CompressBlockBound(input.size()));
+			size_t compressedSize = Compression::CompressBlock(input.data(), input.size(), compressed.data(), compressed.size());
+			if (0 == compressedSize)
+				return __LINE__;
+
+			std::vector<uint8_t> output(input.size() + 1);
+			if (TF_OK != Compression::DecompressBlock(compressed.data(), compressedSize, output.data(), input.size()))
+				return __LINE__;
+
+			if (!input.empty() && 0 != memcmp(output.data(), input.data(), input.size()))
+				return __LINE__;
+
+			// wrong size or cut off input is detected
+			if (TF_OK == Compression::DecompressBlock(compressed.data(), compressedSize, output.data(), input.size() + 1))
+				return __LINE__;
+
+			if (compressedSize > 1 && TF_OK == Compression::DecompressBlock(compressed.data(), compressedSize - 1, output.data(), input.size()))
+				return __LINE__;
+		}
+
+		if (Compression::CompressBlock(inputs[2].data(), inputs[2].size(), std::vector<uint8_t>(16).data(), 16) != 0)
+			return __LINE__;
+
+		// file of many blocks, some stored, decoded on several threads
+		std::vector<uint8_t> content = make_compressible(tofu::COMPRESSED_BLOCK_SIZE * 5 + 123);
+		memcpy(&content[tofu::COMPRESSED_BLOCK_SIZE], noise.data(), noise.size());
+
+		std::vector<uint8_t> file(Compression::CompressFileBound(content.size()));
+		size_t fileSize = Compression::CompressFile(content.data(), content.size(), file.data(), file.size());
+		if (0 == fileSize || fileSize >= content.size() / 2)
+			return __LINE__;
+
+		if (!Compression::IsCompressedFile(file.data(), fileSize) || Compression::IsCompressedFile(content.data(), content.size()))
+			return __LINE__;
+
+		if (Compression::GetUncompressedSize(file.data()) != content.size())
+			return __LINE__;
+
+		for (uint32_t numThreads = 1; numThreads <= 4; numThreads++)
+		{
+			std::vector<uint8_t> output(content.size());
+			if (TF_OK != Compression::DecompressFile(file.data(), fileSize, output.data(), output.size(), numThreads))
+				return __LINE__;
+
+			if (output != content)
+				return __LINE__;
+		}
+
+		// FileIO decodes compressed files by itself
+		if (!write_file(TestFile, std::vector<uint8_t>(file.begin(), file.begin() + fileSize)))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != alloc.Init(TestMemSize, 4096))
+			return __LINE__;
+
+		void* data = nullptr;
+		size_t size = 0;
+		if (TF_OK != FileIO::ReadFile(TestFile, &data, &size, 16, TestAllocNo))
+			return __LINE__;
+
+		if (size != content.size() || 0 != memcmp(data, content.data(), size))
+			return __LINE__;
+
+		FileMapping mapping = {};
+		if (TF_OK != FileIO::MapFile(TestFile, &mapping) || !mapping.decoded)
+			return __LINE__;
+
+		if (mapping.size != content.size() || 0 != memcmp(mapping.data, content.data(), mapping.size))
+			return __LINE__;
+
+		if (TF_OK != FileIO::UnmapFile(&mapping) || nullptr != mapping.data)
+			return __LINE__;
+
+		// corrupted block
+		file[fileSize - 10] ^= 0x5A;
+		std::vector<uint8_t> output(content.size());
+		if (TF_OK == Compression::DecompressFile(file.data(), fileSize, output.data(), output.size(), 2))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		remove(TestFile);
+		return 0;
+	}
+
+	struct StreamState
+	{
+		const std::vector<uint8_t>*	content;
+		size_t						nextOffset;
+		uint32_t					numChunks;
+		uint32_t					stopAt;
+	};
+
+	int32_t check_chunk(const void* data, size_t offset, size_t size, void* userData)
+	{
+		StreamState* state = reinterpret_cast<StreamState*>(userData);
+
+		if (offset != state->nextOffset || 0 != memcmp(data, state->content->data() + offset, size))
+			return tofu::TF_UNKNOWN_ERR;
+
+		state->nextOffset += size;
+		if (++state->numChunks == state->stopAt)
+			return tofu::TF_CANCELLED;
+
+		return TF_OK;
+	}
+
+	// compares ranges of a file with its content, at block boundaries and across them
+	int check_ranges(const char* file, const std::vector<uint8_t>& content)
+	{
+		size_t size = 0;
+		if (TF_OK != FileIO::GetFileSize(file, &size) || size != content.size())
+			return __LINE__;
+
+		const size_t block = tofu::COMPRESSED_BLOCK_SIZE;
+		const size_t ranges[][2] = {
+			{ 0, content.size() },
+			{ 0, 16 },
+			{ 100, 1000 },
+			{ block - 10, 20 },
+			{ block, block },
+			{ block / 2, block * 2 },
+			{ content.size() - 3, 3 },
+			{ content.size(), 0 },
+		};
+
+		for (const size_t* range : ranges)
+		{
+			std::vector<uint8_t> output(range[1] + 1, 0xCD);
+			if (TF_OK != FileIO::ReadRange(file, range[0], range[1], output.data()))
+				return __LINE__;
+
+			if (0 != memcmp(output.data(), content.data() + range[0], range[1]) || 0xCD != output[range[1]])
+				return __LINE__;
+		}
+
+		uint8_t byte = 0;
+		if (TF_OK == FileIO::ReadRange(file, content.size() - 1, 2, &byte) || TF_OK == FileIO::ReadRange(file, SIZE_MAX, 1, &byte))
+			return __LINE__;
+
+		// chunks smaller and bigger than a block, all through one buffer
+		const size_t chunkSizes[] = { 4096 + 3, block * 3 / 2 };
+		for (size_t chunkSize : chunkSizes)
+		{
+			std::vector<uint8_t> buffer(chunkSize);
+
+			StreamState state = { &content, 17, 0, 0 };
+			if (TF_OK != FileIO::StreamFile(file, 17, content.size() - 17, buffer.data(), chunkSize, check_chunk, &state))
+				return __LINE__;
+
+			if (state.nextOffset != content.size() || state.numChunks != (content.size() - 17 + chunkSize - 1) / chunkSize)
+				return __LINE__;
+		}
+
+		// callback stops the stream with its error
+		std::vector<uint8_t> buffer(4096);
+		StreamState state = { &content, 0, 0, 2 };
+		if (tofu::TF_CANCELLED != FileIO::StreamFile(file, 0, content.size(), buffer.data(), buffer.size(), check_chunk, &state) || 2 != state.numChunks)
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_read_range()
+	{
+		std::vector<uint8_t> content = make_compressible(tofu::COMPRESSED_BLOCK_SIZE * 3 + 4321);
+
+		std::vector<uint8_t> compressed(Compression::CompressFileBound(content.size()));
+		compressed.resize(Compression::CompressFile(content.data(), content.size(), compressed.data(), compressed.size()));
+		if (compressed.empty())
+			return __LINE__;
+
+		const char* compressedFile = "test_fileio_compressed.tmp";
+		if (!write_file(TestFile, content) || !write_file(compressedFile, compressed))
+			return __LINE__;
+
+		int ret = 0;
+
+		// loose files, stored as they are and compressed
+		if (0 != (ret = check_ranges(TestFile, content))) return ret;
+		if (0 != (ret = check_ranges(compressedFile, content))) return ret;
+
+		// the same from an archive
+		const char* pakFile = "test_fileio_range.pak";
+		tofu::pak::PakSource sources[2] = {
+			{ "test_assets/raw.bin", content.data(), content.size() },
+			{ "test_assets/compressed.bin", compressed.data(), compressed.size() },
+		};
+		if (0 != tofu::pak::WritePak(pakFile, sources, 2))
+			return __LINE__;
+
+		if (TF_OK != FileIO::MountPak(pakFile))
+			return __LINE__;
+
+		if (0 != (ret = check_ranges("test_assets/raw.bin", content))) return ret;
+		if (0 != (ret = check_ranges("test_assets/compressed.bin", content))) return ret;
+
+		if (TF_OK != FileIO::UnmountPaks())
+			return __LINE__;
+
+		size_t size = 0;
+		if (TF_OK == FileIO::GetFileSize("test_fileio_missing.tmp", &size))
+			return __LINE__;
+
+		remove(TestFile);
+		remove(compressedFile);
+		remove(pakFile);
+		return 0;
+	}
+}
+
+int test_fileio()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_read_file())) return ret;
+	if (0 != (ret = test_map_file())) return ret;
+	if (0 != (ret = test_async_read())) return ret;
+	if (0 != (ret = test_pak())) return ret;
+	if (0 != (ret = test_compression())) return ret;
+	if (0 != (ret = test_read_range())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,381 @@
+#include "../ConcurrentHandleAllocator.h"
+#include "../HandleAllocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using tofu::ConcurrentHandleAllocator;
+using tofu::HandleAllocator;
+
+namespace
+{
+	HANDLE_DECL(Test);
+
+	int test_stale_handles()
+	{
+		HandleAllocator<TestHandle, 4> alloc;
+
+		TestHandle a = alloc.Allocate();
+		TestHandle b = alloc.Allocate();
+		if (!a || !b || a.Index() == b.Index() || !alloc.IsValid(a) || !alloc.IsValid(b))
+			return __LINE__;
+
+		// slot of a is reused, the old handle must not alias the new one
+		alloc.Free(a);
+		if (alloc.IsValid(a) || !alloc.IsValid(b))
+			return __LINE__;
+
+		TestHandle c = alloc.Allocate();
+		TestHandle d = alloc.Allocate();
+		TestHandle e = alloc.Allocate();
+		if (!c || !d || !e || alloc.IsValid(a))
+			return __LINE__;
+
+		bool reused = a.Index() == c.Index() || a.Index() == d.Index() || a.Index() == e.Index();
+		if (!reused || a.id == c.id || a.id == d.id || a.id == e.id)
+			return __LINE__;
+
+		// full
+		if (alloc.Allocate())
+			return __LINE__;
+
+		// invalid and out of range handles are rejected, not read out of bounds
+		if (alloc.IsValid(TestHandle()) || alloc.IsValid(TestHandle(4)) || alloc.IsValid(TestHandle(tofu::HANDLE_INDEX_MASK)))
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_generation_wrap()
+	{
+		HandleAllocator<TestHandle, 1> alloc;
+
+		TestHandle first = alloc.Allocate();
+		alloc.Free(first);
+
+		// generation has 12 bits, the same id comes back after 4096 reuses
+		uint32_t reuses = 1;
+		for (TestHandle h = alloc.Allocate(); h.id != first.id; h = alloc.Allocate(), reuses++)
+		{
+			if (!h || h.Index() != first.Index() || !alloc.IsValid(h) || alloc.IsValid(first))
+				return __LINE__;
+			alloc.Free(h);
+		}
+
+		if (reuses != 1u << (32 - tofu::HANDLE_INDEX_BITS))
+			return __LINE__;
+
+		return 0;
+	}
+
+	// as RenderingSystem::ReallocAnimationResources() does, a buffer is freed and its slot allocated
+	// again before the renderer runs DestroyBuffer for the old handle. resource arrays of the renderer
+	// are indexed with Index(), the id carries generation bits and is past the array
+	int test_recycled_resource_slot()
+	{
+		ConcurrentHandleAllocator<tofu::BufferHandle, tofu::MAX_BUFFERS> alloc;
+
+		// stands for the renderer's buffers[], with a live flag for buf
+		std::vector<bool> buffers(tofu::MAX_BUFFERS);
+
+		tofu::BufferHandle old = alloc.Allocate();
+		buffers[old.Index()] = true;
+
+		alloc.Free(old);
+		tofu::BufferHandle recycled = alloc.Allocate();
+		if (!recycled || recycled.Index() != old.Index() || recycled.id < tofu::MAX_BUFFERS)
+			return __LINE__;
+		buffers[recycled.Index()] = true;
+
+		// DestroyBuffer of the recycled handle frees its slot
+		if (recycled.Index() >= buffers.size() || !buffers[recycled.Index()])
+			return __LINE__;
+		buffers[recycled.Index()] = false;
+
+		alloc.Free(recycled);
+		return 0;
+	}
+
+	// random allocate/free, live handles are exactly the ones iterated
+	int test_dense_iteration()
+	{
+		constexpr uint32_t count = 256;
+
+		HandleAllocator<TestHandle, count> alloc;
+		std::vector<TestHandle> live;
+		std::vector<TestHandle> dead;
+		std::default_random_engine rng;
+
+		for (uint32_t step = 0; step < 20000; step++)
+		{
+			if (live.size() < count && (live.empty() || rng() % 3 != 0))
+			{
+				TestHandle h = alloc.Allocate();
+				if (!h)
+					return __LINE__;
+				live.push_back(h);
+			}
+			else
+			{
+				size_t i = rng() % live.size();
+				alloc.Free(live[i]);
+				dead.push_back(live[i]);
+				live[i] = live.back();
+				live.pop_back();
+			}
+
+			if (alloc.GetNumInUse() != live.size())
+				return __LINE__;
+		}
+
+		std::vector<uint32_t> iterated;
+		for (uint32_t i = 0; i < alloc.GetNumInUse(); i++)
+		{
+			if (!alloc.IsValid(alloc.GetHandle(i)))
+				return __LINE__;
+			iterated.push_back(alloc.GetHandle(i).id);
+		}
+
+		std::vector<uint32_t> expected;
+		for (TestHandle h : live)
+			expected.push_back(h.id);
+
+		std::sort(iterated.begin(), iterated.end());
+		std::sort(expected.begin(), expected.end());
+		if (iterated != expected)
+			return __LINE__;
+
+		// a freed handle never comes back valid within 4096 reuses of its slot
+		for (TestHandle h : dead)
+		{
+			if (alloc.IsValid(h) && std::find(expected.begin(), expected.end(), h.id) == expected.end())
+				return __LINE__;
+		}
+
+		return 0;
+	}
+
+	// tables grow by pages, capacity can be raised past Count before first use
+	int test_paged_growth()
+	{
+		constexpr uint32_t capacity = tofu::STORAGE_PAGE_SIZE * 2 + 100;
+
+		HandleAllocator<TestHandle, 4> alloc;
+		if (alloc.IsValid(TestHandle(0)) || alloc.GetCapacity() != 4)
+			return __LINE__;
+
+		if (tofu::TF_OK == alloc.SetCapacity(0) || tofu::TF_OK == alloc.SetCapacity(tofu::HANDLE_INDEX_MASK + 1))
+			return __LINE__;
+
+		if (tofu::TF_OK != alloc.SetCapacity(capacity))
+			return __LINE__;
+
+		std::vector<TestHandle> handles;
+		for (TestHandle h = alloc.Allocate(); h; h = alloc.Allocate())
+		{
+			if (!alloc.IsValid(h))
+				return __LINE__;
+			handles.push_back(h);
+		}
+
+		if (handles.size() != capacity || alloc.GetNumInUse() != capacity)
+			return __LINE__;
+
+		// capacity is fixed once slots are taken
+		if (tofu::TF_OK == alloc.SetCapacity(capacity * 2))
+			return __LINE__;
+
+		for (TestHandle h : handles)
+		{
+			if (!alloc.IsValid(h))
+				return __LINE__;
+			alloc.Free(h);
+		}
+
+		// reset gives memory back, capacity stays
+		alloc.Reset();
+		if (alloc.GetNumInUse() != 0 || alloc.IsValid(handles[0]) || alloc.GetCapacity() != capacity)
+			return __LINE__;
+
+		if (!alloc.Allocate())
+			return __LINE__;
+
+		return 0;
+	}
+
+	constexpr uint32_t StressCount = 1024;
+
+	// slot owners, a slot given to two threads at once shows up here
+	std::atomic<uint32_t> owners[StressCount];
+
+	// threads allocate and free at random, keeping up to 64 handles each,
+	// handles are only valid between their allocation and free
+	int test_concurrent_handles()
+	{
+		constexpr uint32_t numThreads = 8;
+		constexpr uint32_t numSteps = 100000;
+
+		static ConcurrentHandleAllocator<TestHandle, StressCount> alloc;
+		for (std::atomic<uint32_t>& owner : owners)
+			owner.store(0);
+
+		std::atomic<uint32_t> errors(0);
+		std::atomic<uint32_t> numFull(0);
+
+		auto worker = [&](uint32_t threadId)
+		{
+			std::default_random_engine rng(threadId);
+			std::vector<TestHandle> live;
+			std::vector<TestHandle> dead;
+
+			for (uint32_t step = 0; step < numSteps; step++)
+			{
+				if (live.size() < 64 && (live.empty() || rng() % 2 == 0))
+				{
+					TestHandle h = alloc.Allocate();
+					if (!h)
+					{
+						numFull++;
+						continue;
+					}
+
+					uint32_t expected = 0;
+					if (!alloc.IsValid(h) || !owners[h.Index()].compare_exchange_strong(expected, threadId + 1))
+						errors++;
+					live.push_back(h);
+				}
+				else
+				{
+					size_t i = rng() % live.size();
+					TestHandle h = live[i];
+					live[i] = live.back();
+					live.pop_back();
+
+					if (!alloc.IsValid(h) || owners[h.Index()].exchange(0) != threadId + 1)
+						errors++;
+					alloc.Free(h);
+
+					// only recently freed ones, a slot taken and freed 4096 times gives out an old id again
+					if (dead.size() < 64)
+						dead.push_back(h);
+					else
+						dead[step % dead.size()] = h;
+				}
+
+				// freed handles stay invalid, their slots are reused with new generations
+				if (!dead.empty() && alloc.IsValid(dead[step % dead.size()]))
+					errors++;
+			}
+
+			for (TestHandle h : live)
+			{
+				owners[h.Index()].store(0);
+				alloc.Free(h);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < numThreads; i++)
+			threads.emplace_back(worker, i);
+		for (std::thread& t : threads)
+			t.join();
+
+		if (errors.load() != 0 || alloc.GetNumInUse() != 0)
+			return __LINE__;
+
+		// 8 threads never hold more than 512 handles, it never runs out
+		if (numFull.load() != 0)
+			return __LINE__;
+
+		// every slot is back on the free stack
+		std::vector<TestHandle> all;
+		for (TestHandle h = alloc.Allocate(); h; h = alloc.Allocate())
+			all.push_back(h);
+
+		if (all.size() != StressCount)
+			return __LINE__;
+
+		for (TestHandle h : all)
+			alloc.Free(h);
+
+		return 0;
+	}
+
+	// threads empty the free stack together, so pages are added while others allocate
+	int test_concurrent_growth()
+	{
+		constexpr uint32_t numThreads = 8;
+		constexpr uint32_t perThread = tofu::STORAGE_PAGE_SIZE + 300;
+
+		static ConcurrentHandleAllocator<TestHandle, 16> alloc;
+		if (tofu::TF_OK != alloc.SetCapacity(numThreads * perThread))
+			return __LINE__;
+
+		std::vector<TestHandle> handles[numThreads];
+		std::atomic<uint32_t> errors(0);
+
+		auto worker = [&](uint32_t threadId)
+		{
+			for (uint32_t i = 0; i < perThread; i++)
+			{
+				TestHandle h = alloc.Allocate();
+				if (!h || !alloc.IsValid(h))
+				{
+					errors++;
+					continue;
+				}
+				handles[threadId].push_back(h);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < numThreads; i++)
+			threads.emplace_back(worker, i);
+		for (std::thread& t : threads)
+			t.join();
+
+		if (errors.load() != 0 || alloc.GetNumInUse() != numThreads * perThread)
+			return __LINE__;
+
+		// capacity is reached exactly, and no slot was given out twice
+		if (alloc.Allocate() || tofu::TF_OK == alloc.SetCapacity(numThreads * perThread * 2))
+			return __LINE__;
+
+		std::vector<uint32_t> slots;
+		for (std::vector<TestHandle>& list : handles)
+		{
+			for (TestHandle h : list)
+				slots.push_back(h.Index());
+		}
+
+		std::sort(slots.begin(), slots.end());
+		if (std::adjacent_find(slots.begin(), slots.end()) != slots.end() || slots.back() >= numThreads * perThread)
+			return __LINE__;
+
+		for (std::vector<TestHandle>& list : handles)
+		{
+			for (TestHandle h : list)
+				alloc.Free(h);
+		}
+
+		return 0;
+	}
+}
+
+int test_handle()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_stale_handles())) return ret;
+	if (0 != (ret = test_generation_wrap())) return ret;
+	if (0 != (ret = test_recycled_resource_slot())) return ret;
+	if (0 != (ret = test_dense_iteration())) return ret;
+	if (0 != (ret = test_paged_growth())) return ret;
+	if (0 != (ret = test_concurrent_handles())) return ret;
+	if (0 != (ret = test_concurrent_growth())) return ret;
+
+	return 0;
+}
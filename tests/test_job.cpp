@@ -0,0 +1,270 @@
+#include "../JobSystem.h"
+#include "../ModuleScheduler.h"
+#include "../Module.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using tofu::ComponentMask;
+using tofu::Job;
+using tofu::JobCounter;
+using tofu::JobSystem;
+using tofu::Module;
+using tofu::ModuleScheduler;
+
+namespace
+{
+	constexpr uint32_t NumThreads = 4;
+
+	void spin_for(std::chrono::microseconds duration)
+	{
+		auto end = std::chrono::steady_clock::now() + duration;
+		while (std::chrono::steady_clock::now() < end) {}
+	}
+
+	int test_parallel_for(JobSystem& jobs)
+	{
+		constexpr uint32_t count = 100000;
+
+		std::vector<uint32_t> visits(count, 0);
+		std::atomic<uint32_t> numRanges(0);
+
+		jobs.ParallelFor(count, 1000, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				visits[i]++;
+			}
+			numRanges++;
+		});
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (visits[i] != 1)
+				return __LINE__;
+		}
+
+		if (numRanges.load() < 2 || numRanges.load() > NumThreads * tofu::JOB_BATCHES_PER_THREAD)
+			return __LINE__;
+
+		// small counts are not split
+		numRanges = 0;
+		jobs.ParallelFor(10, 1000, [&](uint32_t begin, uint32_t end)
+		{
+			if (begin == 0 && end == 10) numRanges++;
+		});
+		if (numRanges.load() != 1)
+			return __LINE__;
+
+		return 0;
+	}
+
+	struct NestedData
+	{
+		std::atomic<uint32_t>*	leaves;
+	};
+
+	void leaf_job(void* data)
+	{
+		(*reinterpret_cast<std::atomic<uint32_t>*>(data))++;
+	}
+
+	// runs its own jobs and waits for them inside a job
+	void nested_job(void* data)
+	{
+		NestedData* nested = reinterpret_cast<NestedData*>(data);
+
+		Job leaves[16];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			leaves[i].func = &leaf_job;
+			leaves[i].data = nested->leaves;
+		}
+
+		JobCounter counter;
+		JobSystem::instance()->Run(leaves, 16, counter);
+		JobSystem::instance()->Wait(counter);
+	}
+
+	int test_counters(JobSystem& jobs)
+	{
+		std::atomic<uint32_t> leaves(0);
+		NestedData nested{ &leaves };
+
+		Job parents[64];
+		for (uint32_t i = 0; i < 64; i++)
+		{
+			parents[i].func = &nested_job;
+			parents[i].data = &nested;
+		}
+
+		JobCounter counter;
+		jobs.Run(parents, 64, counter);
+		jobs.Wait(counter);
+
+		if (!counter.IsDone() || leaves.load() != 64 * 16)
+			return __LINE__;
+
+		// threads not of job system run jobs right away
+		std::atomic<uint32_t> outside(0);
+		std::thread t([&]()
+		{
+			Job job{ &leaf_job, &outside, nullptr };
+			JobCounter c;
+			JobSystem::instance()->Run(&job, 1, c);
+			if (c.IsDone() && JobSystem::instance()->GetThreadIndex() == UINT32_MAX) outside += 10;
+		});
+		t.join();
+
+		if (outside.load() != 11)
+			return __LINE__;
+
+		return 0;
+	}
+
+	int test_stealing(JobSystem& jobs)
+	{
+		// all jobs are queued on thread 0, others only get them by stealing
+		std::atomic<uint32_t> threadMask(0);
+
+		jobs.EndFrame();
+
+		jobs.ParallelFor(64, 1, [&](uint32_t, uint32_t)
+		{
+			threadMask |= 1u << JobSystem::instance()->GetThreadIndex();
+			spin_for(std::chrono::microseconds(2000));
+		});
+
+		jobs.EndFrame();
+
+		uint32_t numUsed = 0;
+		for (uint32_t i = 0; i < NumThreads; i++)
+		{
+			if (threadMask.load() & (1u << i)) numUsed++;
+		}
+		if (numUsed < 2)
+			return __LINE__;
+
+		// threads were mostly running jobs in that frame
+		float u = jobs.GetUtilization();
+		if (u <= 0.0f || u > 1.0f || jobs.GetThreadUtilization(0) <= 0.0f)
+			return __LINE__;
+
+		jobs.EndFrame();
+		if (jobs.GetUtilization() >= u)
+			return __LINE__;
+
+		return 0;
+	}
+
+	class TestModule : public Module
+	{
+	public:
+		TestModule(ComponentMask reads, ComponentMask writes, std::atomic<uint32_t>& clock, int32_t ret = tofu::TF_OK)
+			: reads(reads), writes(writes), clock(clock), ret(ret), begin(0), end(0), numUpdates(0), thread(UINT32_MAX) {}
+
+		int32_t Init() override { return tofu::TF_OK; }
+		int32_t Shutdown() override { return tofu::TF_OK; }
+
+		int32_t Update() override
+		{
+			begin = clock++;
+			thread = JobSystem::instance()->GetThreadIndex();
+			spin_for(std::chrono::microseconds(1000));
+			end = clock++;
+			numUpdates++;
+			return ret;
+		}
+
+		ComponentMask GetReadMask() const override { return reads; }
+		ComponentMask GetWriteMask() const override { return writes; }
+
+		ComponentMask				reads;
+		ComponentMask				writes;
+		std::atomic<uint32_t>&		clock;
+		int32_t						ret;
+		uint32_t					begin;
+		uint32_t					end;
+		uint32_t					numUpdates;
+		uint32_t					thread;
+	};
+
+	int test_scheduler()
+	{
+		constexpr ComponentMask X = 1, Y = 2, Z = 4;
+
+		std::atomic<uint32_t> clock(0);
+
+		// a and b write different components, c reads both, d reads x along with c
+		TestModule a(X, X, clock);
+		TestModule b(Y, Y, clock);
+		TestModule c(X | Y, Z, clock);
+		TestModule d(X, 0, clock);
+
+		Module* modules[] = { &a, &b, &c, &d };
+
+		ModuleScheduler scheduler;
+		if (tofu::TF_OK != scheduler.Update(modules, 4))
+			return __LINE__;
+
+		if (a.numUpdates != 1 || b.numUpdates != 1 || c.numUpdates != 1 || d.numUpdates != 1)
+			return __LINE__;
+
+		// dependencies are updated first
+		if (c.begin < a.end || c.begin < b.end || d.begin < a.end)
+			return __LINE__;
+
+		// a and b, then c and d
+		if (scheduler.GetMaxParallelism() != 2)
+			return __LINE__;
+
+		// modules touching everything run one by one, in order
+		TestModule e(~ComponentMask(0), ~ComponentMask(0), clock);
+		Module* serial[] = { &a, &e, &b };
+		if (tofu::TF_OK != scheduler.Update(serial, 3) || scheduler.GetMaxParallelism() != 1)
+			return __LINE__;
+		if (e.begin < a.end || b.begin < e.end)
+			return __LINE__;
+
+		// modules touching everything are updated on main thread, even after a module run as a job
+		TestModule h(~ComponentMask(0), ~ComponentMask(0), clock);
+		Module* mixed[] = { &a, &b, &e, &c, &d, &h };
+		for (uint32_t i = 0; i < 20; i++)
+		{
+			if (tofu::TF_OK != scheduler.Update(mixed, 6) || e.thread != 0 || h.thread != 0)
+				return __LINE__;
+			if (e.begin < a.end || e.begin < b.end || c.begin < e.end || h.begin < c.end || h.begin < d.end)
+				return __LINE__;
+		}
+
+		// error of a module is returned, modules waiting for it are not updated
+		TestModule f(X, X, clock, tofu::TF_UNKNOWN_ERR);
+		TestModule g(X, X, clock);
+		Module* failing[] = { &f, &g };
+		if (tofu::TF_UNKNOWN_ERR != scheduler.Update(failing, 2) || f.numUpdates != 1 || g.numUpdates != 0)
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int test_job()
+{
+	int ret = 0;
+
+	JobSystem jobs;
+	if (tofu::TF_OK != jobs.Init(NumThreads) || jobs.GetNumThreads() != NumThreads || jobs.GetThreadIndex() != 0)
+		return __LINE__;
+
+	if (0 == ret) ret = test_parallel_for(jobs);
+	if (0 == ret) ret = test_counters(jobs);
+	if (0 == ret) ret = test_stealing(jobs);
+	if (0 == ret) ret = test_scheduler();
+
+	if (tofu::TF_OK != jobs.Shutdown() || jobs.GetThreadIndex() != UINT32_MAX)
+		return __LINE__;
+
+	return ret;
+}
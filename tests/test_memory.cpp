@@ -0,0 +1,657 @@
+#include "../MemoryAllocator.h"
+#include "../PageAllocator.h"
+#include "../StlAllocator.h"
+#include "../PoolAllocator.h"
+#include "../TlsfAllocator.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using tofu::MemoryAllocator;
+using tofu::PoolAllocator;
+using tofu::TlsfAllocator;
+using tofu::TF_OK;
+
+namespace
+{
+	constexpr uint32_t TestAllocNo = tofu::ALLOC_FRAME_BASED_MEM;
+	constexpr size_t TestMemSize = 16 * 1024 * 1024;
+
+	bool is_aligned(void* ptr, size_t alignment)
+	{
+		return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1u)) == 0u;
+	}
+
+	// every thread fills its blocks with its own id, any overlap shows up as a mismatch
+	int test_concurrent_allocation()
+	{
+		constexpr uint32_t numThreads = 4;
+		constexpr uint32_t numBlocks = 4096;
+		constexpr size_t blockSize = 48;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+
+		if (TF_OK != alloc.Init(TestMemSize, 4096, nullptr, tofu::ALLOC_FLAG_CONCURRENT))
+			return __LINE__;
+
+		std::vector<uint8_t*> blocks[numThreads];
+		std::vector<std::thread> threads;
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&alloc, &blocks, t]()
+			{
+				for (uint32_t i = 0; i < numBlocks; i++)
+				{
+					uint8_t* ptr = reinterpret_cast<uint8_t*>(alloc.Allocate(blockSize, 16));
+					if (nullptr == ptr)
+						return;
+
+					for (size_t j = 0; j < blockSize; j++)
+						ptr[j] = static_cast<uint8_t>(t + 1);
+
+					blocks[t].push_back(ptr);
+				}
+			});
+		}
+
+		for (auto& th : threads)
+			th.join();
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			if (blocks[t].size() != numBlocks)
+				return __LINE__;
+
+			for (uint8_t* ptr : blocks[t])
+			{
+				if (!is_aligned(ptr, 16))
+					return __LINE__;
+
+				for (size_t j = 0; j < blockSize; j++)
+				{
+					if (ptr[j] != t + 1)
+						return __LINE__;
+				}
+			}
+		}
+
+		// reset gives back the whole block, thread chunks included
+		if (TF_OK != alloc.Reset())
+			return __LINE__;
+
+		void* large = alloc.Allocate(TestMemSize - 4096, 4);
+		if (nullptr == large)
+			return __LINE__;
+
+		if (nullptr != alloc.Allocate(8192, 4))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	struct LiveBlock
+	{
+		uint8_t*	ptr;
+		size_t		size;
+		uint8_t		tag;
+	};
+
+	bool check_block(const LiveBlock& b)
+	{
+		for (size_t i = 0; i < b.size; i++)
+		{
+			if (b.ptr[i] != b.tag)
+				return false;
+		}
+		return true;
+	}
+
+	// random allocate / free, blocks must never overlap and heap must coalesce back in the end
+	int test_tlsf()
+	{
+		constexpr size_t heapSize = 8 * 1024 * 1024;
+		constexpr size_t alignments[] = { 4, 8, 16, 64, 256 };
+
+		std::vector<uint64_t> memory(heapSize / sizeof(uint64_t));
+		TlsfAllocator* tlsf = TlsfAllocator::Create(memory.data(), heapSize);
+		if (nullptr == tlsf)
+			return __LINE__;
+
+		size_t initialFree = 0, initialLargest = 0;
+		tlsf->GetFreeSpace(&initialFree, &initialLargest);
+		if (initialLargest == 0 || initialLargest != initialFree)
+			return __LINE__;
+
+		std::default_random_engine rand;
+		std::uniform_int_distribution<size_t> sizeDist(1, 4096);
+		std::uniform_int_distribution<size_t> alignDist(0, sizeof(alignments) / sizeof(size_t) - 1);
+		std::uniform_int_distribution<int> opDist(0, 2);
+
+		std::vector<LiveBlock> live;
+
+		for (uint32_t i = 0; i < 20000; i++)
+		{
+			if (live.empty() || opDist(rand) != 0)
+			{
+				LiveBlock b;
+				b.size = sizeDist(rand);
+				b.tag = static_cast<uint8_t>(i);
+
+				size_t alignment = alignments[alignDist(rand)];
+				b.ptr = reinterpret_cast<uint8_t*>(tlsf->Allocate(b.size, alignment));
+
+				// heap can be full, not an error
+				if (nullptr == b.ptr)
+					continue;
+
+				if (!is_aligned(b.ptr, alignment) || TlsfAllocator::GetBlockSize(b.ptr) < b.size)
+					return __LINE__;
+
+				memset(b.ptr, b.tag, b.size);
+				live.push_back(b);
+			}
+			else
+			{
+				size_t idx = sizeDist(rand) % live.size();
+				if (!check_block(live[idx]))
+					return __LINE__;
+
+				tlsf->Deallocate(live[idx].ptr);
+				live[idx] = live.back();
+				live.pop_back();
+			}
+		}
+
+		for (const LiveBlock& b : live)
+		{
+			if (!check_block(b))
+				return __LINE__;
+			tlsf->Deallocate(b.ptr);
+		}
+
+		size_t finalFree = 0, finalLargest = 0;
+		tlsf->GetFreeSpace(&finalFree, &finalLargest);
+		if (finalFree != initialFree || finalLargest != initialLargest)
+			return __LINE__;
+
+		// same heap through MemoryAllocator interface
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (TF_OK != alloc.Init(heapSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		void* a = alloc.Allocate(heapSize / 2, 16);
+		if (nullptr == a || nullptr != alloc.Allocate(heapSize / 2, 16))
+			return __LINE__;
+
+		if (TF_OK != alloc.Deallocate(a) || nullptr == alloc.Allocate(heapSize / 2, 16))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	struct alignas(64) PoolItem
+	{
+		uint32_t	value;
+		uint32_t*	destroyed;
+
+		PoolItem(uint32_t value, uint32_t* destroyed) : value(value), destroyed(destroyed) {}
+		~PoolItem() { (*destroyed)++; }
+	};
+
+	int test_pool()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (TF_OK != alloc.Init(TestMemSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		uint32_t destroyed = 0;
+
+		{
+			PoolAllocator<PoolItem, 16> pool(tofu::ALLOC_LEVEL_BASED_HEAP);
+
+			// more than one block
+			std::vector<PoolItem*> items;
+			for (uint32_t i = 0; i < 40; i++)
+			{
+				PoolItem* item = pool.Create(i, &destroyed);
+				if (nullptr == item || !is_aligned(item, 64) || item->value != i)
+					return __LINE__;
+				items.push_back(item);
+			}
+
+			if (pool.GetNumAllocated() != 40)
+				return __LINE__;
+
+			// slot freed last is handed out first
+			PoolItem* last = items[7];
+			pool.Destroy(last);
+			if (destroyed != 1 || pool.Create(100u, &destroyed) != last)
+				return __LINE__;
+
+			for (PoolItem* item : items)
+				pool.Destroy(item);
+
+			if (destroyed != 41 || pool.GetNumAllocated() != 0)
+				return __LINE__;
+
+			pool.Release();
+		}
+
+		// thread caches, objects freed on a different thread than they were created
+		{
+			constexpr uint32_t numThreads = 4;
+			constexpr uint32_t numItems = 2000;
+
+			PoolAllocator<uint64_t> pool(tofu::ALLOC_LEVEL_BASED_HEAP, true);
+			std::vector<uint64_t*> items[numThreads];
+			std::vector<std::thread> threads;
+
+			for (uint32_t t = 0; t < numThreads; t++)
+			{
+				threads.emplace_back([&pool, &items, t]()
+				{
+					for (uint32_t i = 0; i < numItems; i++)
+					{
+						uint64_t* item = pool.Create(uint64_t(t) << 32 | i);
+						if (nullptr == item)
+							return;
+						items[t].push_back(item);
+					}
+				});
+			}
+
+			for (auto& th : threads)
+				th.join();
+
+			threads.clear();
+
+			for (uint32_t t = 0; t < numThreads; t++)
+			{
+				if (items[t].size() != numItems)
+					return __LINE__;
+
+				for (uint32_t i = 0; i < numItems; i++)
+				{
+					if (*items[t][i] != (uint64_t(t) << 32 | i))
+						return __LINE__;
+				}
+			}
+
+			for (uint32_t t = 0; t < numThreads; t++)
+			{
+				threads.emplace_back([&pool, &items, t]()
+				{
+					for (uint64_t* item : items[(t + 1) % numThreads])
+						pool.Destroy(item);
+				});
+			}
+
+			for (auto& th : threads)
+				th.join();
+
+			if (pool.GetNumAllocated() != 0)
+				return __LINE__;
+		}
+
+		// two pools sharing a cache slot of this thread, slots are not lost when they take turns
+		{
+			PoolAllocator<uint32_t> a(tofu::ALLOC_LEVEL_BASED_HEAP, true);
+			PoolAllocator<uint32_t> others[PoolAllocator<uint32_t>::MAX_THREAD_CACHES - 1];
+			PoolAllocator<uint32_t> b(tofu::ALLOC_LEVEL_BASED_HEAP, true);
+			(void)others;
+
+			std::set<uint32_t*> slotsOfA;
+			for (uint32_t round = 0; round < 100; round++)
+			{
+				for (PoolAllocator<uint32_t>* pool : { &a, &b })
+				{
+					uint32_t* items[20];
+					for (uint32_t i = 0; i < 20; i++)
+					{
+						items[i] = pool->Create(i);
+						if (nullptr == items[i])
+							return __LINE__;
+						if (pool == &a)
+							slotsOfA.insert(items[i]);
+					}
+					for (uint32_t i = 0; i < 20; i++)
+						pool->Destroy(items[i]);
+				}
+			}
+
+			// all from the first block
+			if (slotsOfA.size() > 64)
+				return __LINE__;
+		}
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	// nested scopes reuse the same memory, and everything goes back at the end
+	int test_stack_marker()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_SCRATCH_MEM];
+		if (TF_OK != alloc.Init(TestMemSize, 4096))
+			return __LINE__;
+
+		tofu::MemoryMarker start = alloc.GetMarker();
+		void* inner = nullptr;
+
+		{
+			tofu::ScopedMemoryMarker outerScope(tofu::ALLOC_SCRATCH_MEM);
+
+			void* outer = alloc.Allocate(100, 16);
+			if (nullptr == outer || !is_aligned(outer, 16))
+				return __LINE__;
+
+			tofu::MemoryMarker afterOuter = alloc.GetMarker();
+
+			for (uint32_t pass = 0; pass < 3; pass++)
+			{
+				tofu::ScopedMemoryMarker innerScope(tofu::ALLOC_SCRATCH_MEM);
+
+				void* ptr = alloc.Allocate(TestMemSize / 2, 16);
+				if (nullptr == ptr)
+					return __LINE__;
+
+				// every pass gets the same block back
+				if (pass > 0 && ptr != inner)
+					return __LINE__;
+				inner = ptr;
+			}
+
+			if (alloc.GetMarker() != afterOuter)
+				return __LINE__;
+		}
+
+		if (alloc.GetMarker() != start)
+			return __LINE__;
+
+		// freeing to a marker above the top is an error
+		tofu::MemoryMarker marker = alloc.GetMarker();
+		if (nullptr == alloc.Allocate(64, 4))
+			return __LINE__;
+		tofu::MemoryMarker top = alloc.GetMarker();
+
+		if (TF_OK != alloc.FreeToMarker(marker) || TF_OK == alloc.FreeToMarker(top))
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	// every flag combination gives an aligned, writable block,
+	// huge pages fall back to normal pages when there is none
+	int test_page_allocator()
+	{
+		const uint32_t flagSets[] = {
+			tofu::PAGE_FLAG_NONE,
+			tofu::PAGE_FLAG_PREFAULT,
+			tofu::PAGE_FLAG_TRANSPARENT_HUGE_PAGES,
+			tofu::PAGE_FLAG_HUGE_PAGES | tofu::PAGE_FLAG_TRANSPARENT_HUGE_PAGES | tofu::PAGE_FLAG_PREFAULT,
+		};
+
+		for (uint32_t flags : flagSets)
+		{
+			tofu::PageAllocator pageAlloc(flags);
+
+			uint8_t* ptr = reinterpret_cast<uint8_t*>(pageAlloc.Allocate(TestMemSize + 100, tofu::HUGE_PAGE_SIZE));
+			if (nullptr == ptr || !is_aligned(ptr, tofu::HUGE_PAGE_SIZE))
+				return __LINE__;
+
+			memset(ptr, 0xAB, TestMemSize + 100);
+
+			if (TF_OK != pageAlloc.Deallocate(ptr, TestMemSize + 100))
+				return __LINE__;
+
+			// arena gives the block back to the same allocator on shutdown
+			MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+			if (TF_OK != alloc.Init(TestMemSize, tofu::HUGE_PAGE_SIZE, &pageAlloc))
+				return __LINE__;
+
+			if (nullptr == alloc.Allocate(TestMemSize, 4))
+				return __LINE__;
+
+			if (TF_OK != alloc.Shutdown())
+				return __LINE__;
+		}
+
+		return 0;
+	}
+
+	// pages are committed as the arena grows and decommitted by Reset()
+	int test_virtual_allocator()
+	{
+		constexpr size_t reserveSize = 256 * 1024 * 1024;
+		constexpr size_t commitSize = tofu::VMEM_COMMIT_SIZE;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_VMEM];
+		if (TF_OK != alloc.Init(reserveSize, tofu::HUGE_PAGE_SIZE, nullptr, tofu::ALLOC_FLAG_VIRTUAL))
+			return __LINE__;
+
+		uint8_t* first = reinterpret_cast<uint8_t*>(alloc.Allocate(100, 16));
+		if (nullptr == first || !is_aligned(first, tofu::HUGE_PAGE_SIZE))
+			return __LINE__;
+		memset(first, 0xAB, 100);
+
+		// crosses into next commit step, whole range must be writable
+		uint8_t* big = reinterpret_cast<uint8_t*>(alloc.Allocate(commitSize * 3, 16));
+		if (nullptr == big)
+			return __LINE__;
+		memset(big, 0xCD, commitSize * 3);
+
+		if (nullptr != alloc.Allocate(reserveSize, 16))
+			return __LINE__;
+
+		// keep first step committed, the rest is decommitted and reads zero when committed again
+		if (TF_OK != alloc.Reset(100))
+			return __LINE__;
+
+		uint8_t* again = reinterpret_cast<uint8_t*>(alloc.Allocate(commitSize * 2, 16));
+		if (again != first || again[0] != 0xAB || again[commitSize + 1] != 0)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		// concurrent threads committing at once
+		constexpr uint32_t numThreads = 4;
+		if (TF_OK != alloc.Init(reserveSize, tofu::HUGE_PAGE_SIZE, nullptr, tofu::ALLOC_FLAG_VIRTUAL | tofu::ALLOC_FLAG_CONCURRENT))
+			return __LINE__;
+
+		std::vector<std::thread> threads;
+		uint32_t failures[numThreads] = {};
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([&alloc, &failures, t]()
+			{
+				for (uint32_t i = 0; i < 4096; i++)
+				{
+					size_t size = (i % 16 == 0) ? 32 * 1024 : 256;
+					uint8_t* ptr = reinterpret_cast<uint8_t*>(alloc.Allocate(size, 16));
+					if (nullptr == ptr)
+					{
+						failures[t]++;
+						continue;
+					}
+					memset(ptr, static_cast<int>(t), size);
+				}
+			});
+		}
+
+		for (auto& th : threads)
+			th.join();
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			if (failures[t] != 0)
+				return __LINE__;
+		}
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	// containers on level heap give their memory back, other allocators work too
+	int test_stl_allocator()
+	{
+		MemoryAllocator& heap = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (TF_OK != heap.Init(TestMemSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		{
+			tofu::Vector<uint32_t> numbers;
+			for (uint32_t i = 0; i < 10000; i++)
+				numbers.push_back(i);
+
+			if (!heap.Owns(numbers.data()) || numbers[9999] != 9999)
+				return __LINE__;
+
+			tofu::UnorderedMap<tofu::String, uint32_t, tofu::StringHash> table;
+			for (uint32_t i = 0; i < 1000; i++)
+			{
+				char name[32];
+				snprintf(name, sizeof(name), "assets/model_%u.model", i);
+				table.emplace(tofu::String(name), i);
+			}
+
+			auto iter = table.find(tofu::String("assets/model_123.model"));
+			if (iter == table.end() || iter->second != 123)
+				return __LINE__;
+		}
+
+		// everything is freed, a block of most of the heap fits again
+		if (nullptr == heap.Allocate(TestMemSize / 4 * 3, 16))
+			return __LINE__;
+
+		if (TF_OK != heap.Shutdown())
+			return __LINE__;
+
+		// bump allocator, memory goes back on Reset()
+		MemoryAllocator& frame = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != frame.Init(TestMemSize, 4096, nullptr, tofu::ALLOC_FLAG_CONCURRENT))
+			return __LINE__;
+
+		{
+			tofu::Vector<uint64_t> frameList{ tofu::StlAllocator<uint64_t>(TestAllocNo) };
+			frameList.resize(1000, 7);
+			if (!frame.Owns(frameList.data()))
+				return __LINE__;
+		}
+
+		if (TF_OK != frame.Shutdown())
+			return __LINE__;
+
+		// containers outliving engine allocators are on system heap
+		{
+			tofu::Vector<uint32_t> early{ tofu::StlAllocator<uint32_t>(tofu::ALLOC_SYSTEM_HEAP) };
+			early.resize(100);
+			if (heap.Owns(early.data()) || early[99] != 0)
+				return __LINE__;
+
+			// copies stay on system heap
+			tofu::Vector<uint32_t> copy(early);
+			if (copy.get_allocator() != early.get_allocator())
+				return __LINE__;
+		}
+
+		return 0;
+	}
+
+#ifdef TF_MEMORY_STATS
+	int test_memory_stats()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[TestAllocNo];
+		if (TF_OK != alloc.Init(64 * 1024, 4096))
+			return __LINE__;
+
+		const char* meshTag = "mesh";
+
+		{
+			TF_MEMORY_TAG(meshTag);
+			if (nullptr == alloc.Allocate(1000, 4) || nullptr == alloc.Allocate(24, 4))
+				return __LINE__;
+		}
+
+		if (nullptr == alloc.Allocate(16, 4))
+			return __LINE__;
+
+		MemoryAllocator::RecordFrame();
+
+		// overflow is recorded with its tag
+		{
+			TF_MEMORY_TAG(meshTag);
+			if (nullptr != alloc.Allocate(128 * 1024, 4))
+				return __LINE__;
+		}
+
+		tofu::MemoryStats stats;
+		alloc.GetStats(stats);
+
+		if (stats.capacity != 64 * 1024 || stats.usedBytes != 1040 || stats.peakBytes != 1040)
+			return __LINE__;
+
+		if (stats.numAllocations != 3 || stats.numFailures != 1 ||
+			stats.largestFailedSize != 128 * 1024 || stats.lastFailedTag != meshTag)
+			return __LINE__;
+
+		tofu::MemoryTagStats tags[tofu::MAX_MEMORY_TAGS];
+		uint32_t numTags = alloc.GetTagStats(tags, tofu::MAX_MEMORY_TAGS);
+		if (numTags != 2 || tags[0].tag != meshTag || tags[0].bytes != 1024 || tags[0].count != 2 || tags[1].bytes != 16)
+			return __LINE__;
+
+		// peak of a frame is remembered after memory is reset
+		alloc.Reset();
+		MemoryAllocator::RecordFrame();
+
+		size_t history[4];
+		if (alloc.GetFrameHistory(history, 4) != 2 || history[0] != 1040 || history[1] != 1040)
+			return __LINE__;
+
+		MemoryAllocator::RecordFrame();
+		if (alloc.GetFrameHistory(history, 4) != 3 || history[2] != 0)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+#endif
+}
+
+int test_memory()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_concurrent_allocation())) return ret;
+	if (0 != (ret = test_tlsf())) return ret;
+	if (0 != (ret = test_pool())) return ret;
+	if (0 != (ret = test_stack_marker())) return ret;
+	if (0 != (ret = test_page_allocator())) return ret;
+	if (0 != (ret = test_virtual_allocator())) return ret;
+	if (0 != (ret = test_stl_allocator())) return ret;
+#ifdef TF_MEMORY_STATS
+	if (0 != (ret = test_memory_stats())) return ret;
+#endif
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+#include "../ComponentRegistry.h"
+#include "../FileIO.h"
+#include "../MemoryAllocator.h"
+#include "../RenderingComponent.h"
+#include "../SceneSnapshot.h"
+#include "../TransformComponent.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+using tofu::Component;
+using tofu::Entity;
+using tofu::RenderingComponent;
+using tofu::TransformComponent;
+using tofu::SceneSnapshot;
+using tofu::SnapshotField;
+
+namespace
+{
+	const char* TestFile = "test_snapshot.tmp";
+
+	struct TestAsset
+	{
+		uint32_t	value;
+	};
+
+	struct SnapNodeData
+	{
+		Entity				entity;
+		Entity				parent;
+		const TestAsset*	mesh;
+		uint32_t			value;
+
+		SnapNodeData() : SnapNodeData(Entity()) {}
+		SnapNodeData(Entity e) : entity(e), parent(), mesh(nullptr), value(0) {}
+	};
+
+	struct SnapTagData
+	{
+		Entity		entity;
+		uint32_t	tag;
+
+		SnapTagData() : SnapTagData(Entity()) {}
+		SnapTagData(Entity e) : entity(e), tag(0) {}
+	};
+
+	typedef Component<SnapNodeData> SnapNodeComponent;
+	typedef Component<SnapTagData> SnapTagComponent;
+
+	const SnapshotField NodeFields[] =
+	{
+		{ offsetof(SnapNodeData, parent), tofu::scene::SCENE_FIXUP_ENTITY },
+		{ offsetof(SnapNodeData, mesh), tofu::scene::SCENE_FIXUP_ASSET },
+	};
+
+	bool add_types(SceneSnapshot& snapshot)
+	{
+		return tofu::TF_OK == snapshot.AddType<SnapNodeComponent>("SnapNode", NodeFields, 2)
+			&& tofu::TF_OK == snapshot.AddType<SnapTagComponent>("SnapTag");
+	}
+
+	// the node component of value v among entities loaded
+	SnapNodeComponent find_node(const Entity* entities, uint32_t count, uint32_t v)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			SnapNodeComponent c = entities[i].GetComponent<SnapNodeComponent>();
+			if (c && c->value == v)
+				return c;
+		}
+		return SnapNodeComponent();
+	}
+
+	int test_save_load()
+	{
+		constexpr uint32_t numEntities = 100;
+
+		TestAsset meshA{ 1 }, meshB{ 2 }, unused{ 3 };
+
+		// referenced by a node, but saved with nothing
+		Entity outside = Entity::Create();
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = Entity::Create();
+			SnapNodeComponent node = e.AddComponent<SnapNodeComponent>();
+			node->value = i;
+			node->parent = 0 == i ? outside : entities[i - 1];
+			node->mesh = i % 3 == 0 ? nullptr : (i % 3 == 1 ? &meshA : &meshB);
+
+			if (i % 2 == 0)
+				e.AddComponent<SnapTagComponent>()->tag = i * 10;
+
+			entities.push_back(e);
+		}
+
+		SceneSnapshot snapshot;
+		if (!add_types(snapshot))
+			return __LINE__;
+
+		// the same name twice
+		if (tofu::TF_OK == snapshot.AddType<SnapTagComponent>("SnapTag"))
+			return __LINE__;
+
+		// a pointer not added as asset can't be saved
+		if (tofu::TF_OK == snapshot.Save(TestFile))
+			return __LINE__;
+
+		if (tofu::TF_OK != snapshot.AddAsset(100, &meshA) || tofu::TF_OK != snapshot.AddAsset(200, &meshB) || tofu::TF_OK != snapshot.AddAsset(300, &unused))
+			return __LINE__;
+
+		if (tofu::TF_OK != snapshot.Save(TestFile))
+			return __LINE__;
+
+		uint32_t numNodes = SnapNodeComponent::GetNumComponents();
+		uint32_t numTags = SnapTagComponent::GetNumComponents();
+
+		if (tofu::TF_OK != snapshot.Load(TestFile) || snapshot.GetNumLoaded() != numEntities)
+			return __LINE__;
+
+		if (SnapNodeComponent::GetNumComponents() != numNodes + numEntities || SnapTagComponent::GetNumComponents() != numTags + numEntities / 2)
+			return __LINE__;
+
+		std::vector<Entity> loaded(snapshot.GetLoadedEntities(), snapshot.GetLoadedEntities() + numEntities);
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			SnapNodeComponent node = find_node(loaded.data(), numEntities, i);
+			if (!node)
+				return __LINE__;
+
+			// new entities, fields pointing to saved entities are given loaded ones
+			Entity e = node->entity;
+			if (e.GetComponent<SnapNodeComponent>()->value != i || node->parent.id == (0 == i ? outside.id : entities[i - 1].id))
+				return __LINE__;
+
+			if (0 == i && node->parent.id != UINT32_MAX)
+				return __LINE__;
+
+			if (i > 0 && node->parent.GetComponent<SnapNodeComponent>()->value != i - 1)
+				return __LINE__;
+
+			if (node->mesh != (i % 3 == 0 ? nullptr : (i % 3 == 1 ? &meshA : &meshB)))
+				return __LINE__;
+
+			SnapTagComponent tag = e.GetComponent<SnapTagComponent>();
+			if (bool(tag) != (i % 2 == 0) || (tag && tag->tag != i * 10))
+				return __LINE__;
+		}
+
+		// another run, with assets at other addresses
+		TestAsset otherA{ 1 }, otherB{ 2 };
+		SceneSnapshot other;
+		if (!add_types(other) || tofu::TF_OK != other.AddAsset(200, &otherB))
+			return __LINE__;
+
+		// an asset is missing
+		if (tofu::TF_OK == other.Load(TestFile) || other.GetNumLoaded() != 0 || SnapNodeComponent::GetNumComponents() != numNodes + numEntities)
+			return __LINE__;
+
+		if (tofu::TF_OK != other.AddAsset(100, &otherA) || tofu::TF_OK != other.Load(TestFile) || other.GetNumLoaded() != numEntities)
+			return __LINE__;
+
+		if (find_node(other.GetLoadedEntities(), numEntities, 1)->mesh != &otherA || find_node(other.GetLoadedEntities(), numEntities, 2)->mesh != &otherB)
+			return __LINE__;
+
+		loaded.insert(loaded.end(), other.GetLoadedEntities(), other.GetLoadedEntities() + numEntities);
+
+		// a type is missing
+		SceneSnapshot nodesOnly;
+		if (tofu::TF_OK != nodesOnly.AddType<SnapNodeComponent>("SnapNode", NodeFields, 2) || tofu::TF_OK != nodesOnly.AddAsset(100, &meshA) || tofu::TF_OK != nodesOnly.AddAsset(200, &meshB))
+			return __LINE__;
+		if (tofu::TF_OK == nodesOnly.Load(TestFile))
+			return __LINE__;
+
+		// not a snapshot
+		uint32_t junk[64] = {};
+		if (tofu::TF_OK != tofu::FileIO::WriteFile(TestFile, junk, sizeof(junk)) || tofu::TF_OK == snapshot.Load(TestFile))
+			return __LINE__;
+
+		remove(TestFile);
+
+		outside.Destroy();
+		for (Entity e : entities)
+			e.Destroy();
+		for (Entity e : loaded)
+			e.Destroy();
+		tofu::Entity::FlushDestroyed();
+
+		if (SnapNodeComponent::GetNumComponents() != 0 || SnapTagComponent::GetNumComponents() != 0)
+			return __LINE__;
+
+		return 0;
+	}
+
+	bool near_x(const tofu::math::float3& p, float x)
+	{
+		return std::fabs(p.x - x) < 0.001f && std::fabs(p.y) < 0.001f && std::fabs(p.z) < 0.001f;
+	}
+
+	// transforms own their children, they are saved as records and linked again at load
+	int test_engine_components()
+	{
+		// children of transforms are on level heap
+		tofu::MemoryAllocator& heap = tofu::MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (tofu::TF_OK != heap.Init(16 * 1024 * 1024, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		// only ever compared, assets are opaque to the snapshot
+		TestAsset modelData{ 1 }, materialData{ 2 };
+		tofu::Model* model = reinterpret_cast<tofu::Model*>(&modelData);
+		tofu::Material* material = reinterpret_cast<tofu::Material*>(&materialData);
+
+		// root at 1, children at 2 and 3, a grandchild at 4 under the first child
+		Entity saved[4];
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			saved[i] = Entity::Create();
+			saved[i].AddComponent<TransformComponent>()->SetLocalPosition(tofu::math::float3{ 1.0f, 0, 0 });
+		}
+		saved[1].GetComponent<TransformComponent>()->SetParent(saved[0].GetComponent<TransformComponent>());
+		saved[2].GetComponent<TransformComponent>()->SetParent(saved[0].GetComponent<TransformComponent>());
+		saved[3].GetComponent<TransformComponent>()->SetParent(saved[2].GetComponent<TransformComponent>());
+		saved[3].GetComponent<TransformComponent>()->SetParent(saved[1].GetComponent<TransformComponent>());
+
+		RenderingComponent r = saved[3].AddComponent<RenderingComponent>();
+		r->SetModel(model);
+		r->SetMaterial(material);
+
+		if (!near_x(saved[3].GetComponent<TransformComponent>()->GetWorldPosition(), 3.0f))
+			return __LINE__;
+
+		SceneSnapshot snapshot;
+		if (tofu::TF_OK != tofu::TransformComponentData::AddSnapshotType(snapshot)
+			|| tofu::TF_OK != tofu::RenderingComponentData::AddSnapshotType(snapshot)
+			|| tofu::TF_OK != snapshot.AddAsset(tofu::pak::HashPath("assets/test.model"), model)
+			|| tofu::TF_OK != snapshot.AddAsset(tofu::pak::HashPath("test material"), material))
+			return __LINE__;
+
+		if (tofu::TF_OK != snapshot.Save(TestFile) || tofu::TF_OK != snapshot.Load(TestFile) || snapshot.GetNumLoaded() != 4)
+			return __LINE__;
+
+		// loaded in order of saved indices, loaded[i] is the one of saved[i]
+		std::vector<Entity> loaded(4);
+		TransformComponent t[4];
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			uint32_t pos = 0;
+			for (uint32_t j = 0; j < 4; j++)
+				pos += saved[j].Index() < saved[i].Index() ? 1 : 0;
+
+			loaded[i] = snapshot.GetLoadedEntities()[pos];
+			t[i] = loaded[i].GetComponent<TransformComponent>();
+			if (!t[i])
+				return __LINE__;
+		}
+
+		if (t[0]->GetParent() || t[1]->GetParent()->GetWorldTransform().GetTranslation().x != t[0]->GetWorldTransform().GetTranslation().x)
+			return __LINE__;
+
+		if (!near_x(t[1]->GetWorldPosition(), 2.0f) || !near_x(t[2]->GetWorldPosition(), 2.0f) || !near_x(t[3]->GetWorldPosition(), 3.0f))
+			return __LINE__;
+
+		// children came back, moving the loaded root moves all of them, and not the saved ones
+		t[0]->SetLocalPosition(tofu::math::float3{ 5.0f, 0, 0 });
+		if (!near_x(t[2]->GetWorldPosition(), 6.0f) || !near_x(t[3]->GetWorldPosition(), 7.0f))
+			return __LINE__;
+
+		if (!near_x(saved[3].GetComponent<TransformComponent>()->GetWorldPosition(), 3.0f))
+			return __LINE__;
+
+		// the grandchild was moved from the second child to the first
+		t[2]->SetLocalPosition(tofu::math::float3{ 0, 0, 0 });
+		if (!near_x(t[3]->GetWorldPosition(), 7.0f))
+			return __LINE__;
+
+		RenderingComponent loadedRendering = loaded[3].GetComponent<RenderingComponent>();
+		if (!loadedRendering || loadedRendering->GetModel() != model || loadedRendering->GetMaterial() != material
+			|| loaded[0].GetComponent<RenderingComponent>())
+			return __LINE__;
+
+		remove(TestFile);
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			saved[i].Destroy();
+			loaded[i].Destroy();
+		}
+		tofu::Entity::FlushDestroyed();
+
+		if (TransformComponent::GetNumComponents() != 0 || RenderingComponent::GetNumComponents() != 0)
+			return __LINE__;
+
+		// as engine shutdown does, components still alive give their memory back before the heap goes
+		Entity parent = Entity::Create();
+		Entity child = Entity::Create();
+		child.AddComponent<TransformComponent>()->SetParent(parent.AddComponent<TransformComponent>());
+
+		tofu::ComponentRegistry::RemoveAll();
+		if (TransformComponent::GetNumComponents() != 0 || parent.GetComponent<TransformComponent>())
+			return __LINE__;
+
+		if (tofu::TF_OK != heap.Shutdown())
+			return __LINE__;
+
+		parent.Destroy();
+		child.Destroy();
+		tofu::Entity::FlushDestroyed();
+
+		return 0;
+	}
+}
+
+int test_snapshot()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_save_load())) return ret;
+	if (0 != (ret = test_engine_components())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include "../View.h"
+
+#include <vector>
+
+using tofu::Component;
+using tofu::Entity;
+using tofu::View;
+
+namespace
+{
+	struct ViewAData
+	{
+		Entity		entity;
+		uint32_t	value;
+
+		ViewAData() : ViewAData(Entity()) {}
+		ViewAData(Entity e) : entity(e), value(e.Index()) {}
+	};
+
+	struct ViewBData
+	{
+		Entity		entity;
+		uint32_t	value;
+
+		ViewBData() : ViewBData(Entity()) {}
+		ViewBData(Entity e) : entity(e), value(e.Index() * 2) {}
+	};
+
+	struct ViewCData
+	{
+		Entity		entity;
+
+		ViewCData() : ViewCData(Entity()) {}
+		ViewCData(Entity e) : entity(e) {}
+	};
+
+	typedef Component<ViewAData> ViewAComponent;
+	typedef Component<ViewBData> ViewBComponent;
+	typedef Component<ViewCData> ViewCComponent;
+
+	int test_view_join()
+	{
+		constexpr uint32_t numEntities = 1000;
+
+		// every entity has A, every 3rd has B, every 5th has C
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e)
+				return __LINE__;
+			entities.push_back(e);
+
+			e.AddComponent<ViewAComponent>();
+			if (i % 3 == 0) e.AddComponent<ViewBComponent>();
+			if (i % 5 == 0) e.AddComponent<ViewCComponent>();
+		}
+
+		// smallest array is walked, whichever order types are given in
+		View<ViewAComponent, ViewBComponent> ab;
+		View<ViewBComponent, ViewAComponent> ba;
+		if (ab.Size() != ViewBComponent::GetNumComponents() || ba.Size() != ab.Size())
+			return __LINE__;
+
+		uint32_t count = 0;
+		bool wrong = false;
+		ab.Each([&](Entity e, ViewAData& a, ViewBData& b)
+		{
+			wrong |= a.entity.id != e.id || b.entity.id != e.id || b.value != a.value * 2;
+			a.value += 1000000;
+			count++;
+		});
+		if (wrong || count != (numEntities + 2) / 3)
+			return __LINE__;
+
+		// references are the components themselves
+		for (uint32_t i = 0; i < numEntities; i++)
+		{
+			uint32_t expected = entities[i].Index() + (i % 3 == 0 ? 1000000 : 0);
+			if (entities[i].GetComponent<ViewAComponent>()->value != expected)
+				return __LINE__;
+		}
+
+		// entities with C are left out
+		count = 0;
+		View<ViewAComponent, ViewBComponent>::Without<ViewCComponent>().Each([&](Entity e, ViewAData&, ViewBData&)
+		{
+			wrong |= bool(e.GetComponent<ViewCComponent>());
+			count++;
+		});
+		if (wrong || count != (numEntities + 2) / 3 - (numEntities + 14) / 15)
+			return __LINE__;
+
+		// ranges of the walked array together cover the view once
+		count = 0;
+		View<ViewAComponent, ViewCComponent> ac;
+		for (uint32_t begin = 0; begin < ac.Size(); begin += 7)
+		{
+			ac.Each(begin, begin + 7, [&](Entity, ViewAData&, ViewCData&) { count++; });
+		}
+		if (count != (numEntities + 4) / 5)
+			return __LINE__;
+
+		// removed components are not joined anymore
+		for (uint32_t i = 0; i < numEntities; i += 2)
+		{
+			ViewBComponent b = entities[i].GetComponent<ViewBComponent>();
+			if (b) b.Destroy();
+		}
+
+		count = 0;
+		View<ViewBComponent, ViewAComponent>().Each([&](Entity e, ViewBData& b, ViewAData&)
+		{
+			wrong |= e.Index() != b.entity.Index();
+			count++;
+		});
+		if (wrong || count != ViewBComponent::GetNumComponents() || count != (numEntities + 5) / 6)
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int test_view()
+{
+	int ret = 0;
+
+	if (0 != (ret = test_view_join())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+#include "../../ArchetypeStorage.h"
+#include "../../Component.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using tofu::ArchetypeStorage;
+using tofu::Component;
+using tofu::Entity;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	// about the size of TransformComponentData
+	struct BenchTransform
+	{
+		Entity		entity;
+		float		position[3];
+		float		rotation[4];
+		float		scale[3];
+		float		world[16];
+
+		BenchTransform() : BenchTransform(Entity()) {}
+		BenchTransform(Entity e) : entity(e), position(), rotation(), scale(), world() {}
+	};
+
+	struct BenchVelocity
+	{
+		Entity		entity;
+		float		velocity[3];
+
+		BenchVelocity() : BenchVelocity(Entity()) {}
+		BenchVelocity(Entity e) : entity(e), velocity{ 1.0f, 2.0f, 3.0f } {}
+	};
+
+	typedef Component<BenchTransform> BenchTransformComponent;
+	typedef Component<BenchVelocity> BenchVelocityComponent;
+
+	constexpr uint32_t MaxEntities = 1000000;
+
+	// entities updated per measurement, small sets are run several times
+	constexpr uint32_t UpdatesPerRound = 4 * 1000 * 1000;
+
+	TF_INLINE void integrate(BenchTransform& t, const BenchVelocity& v)
+	{
+		t.position[0] += v.velocity[0] * 0.016f;
+		t.position[1] += v.velocity[1] * 0.016f;
+		t.position[2] += v.velocity[2] * 0.016f;
+	}
+
+	// one system touching two component types, as physics and rendering do with transforms.
+	// per type arrays walk velocities and look transforms up per entity,
+	// velocities are added in shuffled order, like arrays after some spawn and despawn churn
+	int bench_archetype_iteration()
+	{
+		if (tofu::TF_OK != Entity::SetCapacity(MaxEntities))
+			return __LINE__;
+
+		std::vector<Entity> entities;
+		for (uint32_t i = 0; i < MaxEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e)
+				return __LINE__;
+			entities.push_back(e);
+		}
+
+		printf("\ntransform += velocity over entities having both (%u updates per round)\n", UpdatesPerRound);
+		printf("%10s %16s %10s %16s %10s %9s\n", "entities", "per type ms", "ns/ent", "archetype ms", "ns/ent", "speedup");
+
+		std::default_random_engine rng;
+		const uint32_t sizes[] = { 10000, 100000, 1000000 };
+
+		for (uint32_t n : sizes)
+		{
+			uint32_t rounds = std::max(1u, UpdatesPerRound / n);
+
+			std::vector<Entity> shuffled(entities.begin(), entities.begin() + n);
+			std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+			for (uint32_t i = 0; i < n; i++)
+				entities[i].AddComponent<BenchTransformComponent>();
+			for (Entity e : shuffled)
+				e.AddComponent<BenchVelocityComponent>();
+
+			ArchetypeStorage storage;
+			if (tofu::TF_OK != storage.Init(MaxEntities))
+				return __LINE__;
+
+			for (Entity e : shuffled)
+			{
+				if (nullptr == storage.Add<BenchTransform>(e) || nullptr == storage.Add<BenchVelocity>(e))
+					return __LINE__;
+			}
+
+			auto start = clock::now();
+			for (uint32_t r = 0; r < rounds; r++)
+			{
+				BenchVelocity* velocities = BenchVelocityComponent::GetAllComponents();
+				uint32_t count = BenchVelocityComponent::GetNumComponents();
+				for (uint32_t i = 0; i < count; i++)
+				{
+					BenchTransformComponent t = velocities[i].entity.GetComponent<BenchTransformComponent>();
+					integrate(*t.operator->(), velocities[i]);
+				}
+			}
+			double perType = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			start = clock::now();
+			for (uint32_t r = 0; r < rounds; r++)
+			{
+				storage.ForEachChunk<BenchTransform, BenchVelocity>([](uint32_t count, Entity*, BenchTransform* t, BenchVelocity* v)
+				{
+					for (uint32_t i = 0; i < count; i++)
+						integrate(t[i], v[i]);
+				});
+			}
+			double archetype = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			// both did the same work
+			for (uint32_t i = 0; i < n; i += n / 16)
+			{
+				if (storage.Get<BenchTransform>(entities[i])->position[0] != entities[i].GetComponent<BenchTransformComponent>()->position[0])
+					return __LINE__;
+			}
+
+			double updates = static_cast<double>(rounds) * n;
+			printf("%10u %16.2f %10.2f %16.2f %10.2f %8.2fx\n", n,
+				perType, perType * 1e6 / updates,
+				archetype, archetype * 1e6 / updates,
+				perType / archetype);
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				entities[i].GetComponent<BenchVelocityComponent>().Destroy();
+				entities[i].GetComponent<BenchTransformComponent>().Destroy();
+			}
+		}
+
+		// leave entity ids to benchmarks after this one
+		for (Entity e : entities)
+			e.Destroy();
+		Entity::FlushDestroyed();
+
+		return 0;
+	}
+}
+
+int bench_archetype()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_archetype_iteration())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+#include "../../ComponentSorter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using tofu::Component;
+using tofu::ComponentSorter;
+using tofu::Entity;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	// about the size of TransformComponentData
+	struct DefragTransform
+	{
+		Entity		entity;
+		float		position[3];
+		float		rotation[4];
+		float		scale[3];
+		float		world[16];
+
+		DefragTransform() : DefragTransform(Entity()) {}
+		DefragTransform(Entity e) : entity(e), position(), rotation{ 0, 0, 0, 1 }, scale{ 1, 1, 1 }, world() {}
+	};
+
+	// like RenderingComponentData, world matrix copied from the transform every frame
+	struct DefragRenderable
+	{
+		Entity		entity;
+		uint32_t	material;
+		float		world[16];
+
+		DefragRenderable() : DefragRenderable(Entity()) {}
+		DefragRenderable(Entity e) : entity(e), material(0), world() {}
+	};
+
+	typedef Component<DefragTransform> DefragTransformComponent;
+	typedef Component<DefragRenderable> DefragRenderableComponent;
+
+	constexpr uint32_t EntityCount = 100000;
+	constexpr uint32_t NumMaterials = 64;
+	constexpr uint32_t Rounds = 10;
+
+	// RenderingSystem::Update walk: renderables in array order, transform of each looked up by entity.
+	// returns ms of the fastest round, switches counts material changes between neighbours
+	double walk_renderables(float* sum, uint32_t* switches)
+	{
+		double best = 1e9;
+
+		for (uint32_t r = 0; r < Rounds; r++)
+		{
+			auto start = clock::now();
+
+			DefragRenderable* comps = DefragRenderableComponent::GetAllComponents();
+			uint32_t count = DefragRenderableComponent::GetNumComponents();
+			uint32_t lastMaterial = UINT32_MAX;
+
+			*switches = 0;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				DefragTransformComponent t = comps[i].entity.GetComponent<DefragTransformComponent>();
+				std::copy(t->world, t->world + 16, comps[i].world);
+				*sum += comps[i].world[12];
+
+				if (comps[i].material != lastMaterial)
+				{
+					lastMaterial = comps[i].material;
+					(*switches)++;
+				}
+			}
+
+			best = std::min(best, std::chrono::duration<double, std::milli>(clock::now() - start).count());
+		}
+
+		return best;
+	}
+
+	// component arrays left in creation order by churn, against after ComponentSorter
+	// puts renderables in material order and transforms in the order of their renderables.
+	// there are no hardware counters here, time of the lookup walk stands for its cache misses
+	int bench_component_sort()
+	{
+		// another benchmark may have set it already
+		if (tofu::TF_OK != Entity::SetCapacity(EntityCount) && Entity::GetCapacity() < EntityCount)
+			return __LINE__;
+
+		std::vector<Entity> entities(EntityCount);
+		for (uint32_t i = 0; i < EntityCount; i++)
+		{
+			entities[i] = Entity::Create();
+			if (!entities[i])
+				return __LINE__;
+		}
+
+		// transforms added in another order than renderables, as if entities came and went
+		std::mt19937 rng(1234);
+		std::vector<uint32_t> order(EntityCount);
+		for (uint32_t i = 0; i < EntityCount; i++)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), rng);
+
+		for (uint32_t i = 0; i < EntityCount; i++)
+		{
+			DefragRenderableComponent c = entities[i].AddComponent<DefragRenderableComponent>();
+			c->material = rng() % NumMaterials;
+
+			DefragTransformComponent t = entities[order[i]].AddComponent<DefragTransformComponent>();
+			t->world[12] = static_cast<float>(order[i]);
+		}
+
+		float sum = 0;
+		uint32_t switchesBefore = 0;
+		double before = walk_renderables(&sum, &switchesBefore);
+
+		// as RenderingSystem::Defragment does, a budget every frame
+		ComponentSorter<DefragRenderable> renderableSorter;
+		ComponentSorter<DefragTransform> transformSorter;
+
+		auto renderableKey = [](Entity e, const DefragRenderable& c)
+		{
+			return static_cast<uint64_t>(c.material) << tofu::HANDLE_INDEX_BITS | e.Index();
+		};
+		auto transformKey = [](Entity e, const DefragTransform&)
+		{
+			uint64_t loc = DefragRenderableComponent::GetIndexTable()[e.Index()].idx;
+			return loc << tofu::HANDLE_INDEX_BITS | e.Index();
+		};
+
+		// sorters start checking again once done, transforms are done when found in order
+		// after renderables stopped moving
+		uint32_t frames = 0;
+		double sortTime = 0;
+		bool renderablesDone = false;
+		bool transformsDone = false;
+		while (!transformsDone)
+		{
+			auto start = clock::now();
+			if (tofu::TF_OK != renderableSorter.Update(tofu::COMPONENT_SORT_BUDGET, renderableKey)
+				|| tofu::TF_OK != transformSorter.Update(tofu::COMPONENT_SORT_BUDGET, transformKey))
+				return __LINE__;
+			sortTime += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			transformsDone = renderablesDone && transformSorter.IsSorted();
+			renderablesDone = renderablesDone || renderableSorter.IsSorted();
+
+			if (++frames > 10000)
+				return __LINE__;
+		}
+
+		// both arrays in the same order
+		for (uint32_t i = 0; i < EntityCount; i++)
+		{
+			if (DefragTransformComponent::GetAllEntities()[i].id != DefragRenderableComponent::GetAllEntities()[i].id)
+				return __LINE__;
+		}
+
+		uint32_t switchesAfter = 0;
+		double after = walk_renderables(&sum, &switchesAfter);
+
+		// handles still reach the same components
+		for (uint32_t i = 0; i < EntityCount; i += EntityCount / 16)
+		{
+			if (entities[order[i]].GetComponent<DefragTransformComponent>()->world[12] != static_cast<float>(order[i]))
+				return __LINE__;
+		}
+
+		printf("\nsort %u renderables and transforms, budget %u per frame\n", EntityCount, tofu::COMPONENT_SORT_BUDGET);
+		printf("%10s %12s %10s %18s\n", "", "walk ms", "ns/ent", "material switches");
+		printf("%10s %12.2f %10.2f %18u\n", "unsorted", before, before * 1e6 / EntityCount, switchesBefore);
+		printf("%10s %12.2f %10.2f %18u\n", "sorted", after, after * 1e6 / EntityCount, switchesAfter);
+		printf("%.2fx faster walk, %u frames to sort, %.3f ms per frame\n", before / after, frames, sortTime / frames);
+
+		// keeps the walks from being optimized away
+		if (sum < 0)
+			return __LINE__;
+
+		for (Entity e : entities)
+			e.Destroy();
+		Entity::FlushDestroyed();
+
+		return 0;
+	}
+}
+
+int bench_defrag()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_component_sort())) return ret;
+
+	return 0;
+}
@@ -0,0 +1,453 @@
+#include "../../Compression.h"
+#include "../../FileIO.h"
+#include "../../MemoryAllocator.h"
+#include "../pak_builder/pak_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+using tofu::Compression;
+using tofu::FileIO;
+using tofu::FileMapping;
+using tofu::MemoryAllocator;
+using tofu::TF_OK;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	constexpr uint32_t BenchAllocNo = tofu::ALLOC_FRAME_BASED_MEM;
+	constexpr uint32_t LoadRounds = 10;
+
+	const char* BenchFile = "bench_fileio.tmp";
+
+	// stands in for a large .model file, page cache is warm after it is written
+	bool write_file(size_t size)
+	{
+		FILE* fp = fopen(BenchFile, "wb");
+		if (nullptr == fp)
+			return false;
+
+		std::vector<uint8_t> chunk(1024 * 1024);
+		for (size_t i = 0; i < chunk.size(); i++)
+			chunk[i] = static_cast<uint8_t>(i * 7);
+
+		bool ok = true;
+		for (size_t written = 0; ok && written < size; written += chunk.size())
+			ok = 1 == fwrite(chunk.data(), chunk.size(), 1, fp);
+
+		return 0 == fclose(fp) && ok;
+	}
+
+	// like CreateModel, reads the first part (header, bones, animations) at once,
+	// the rest (vertices) is read later when the buffers are created
+	uint64_t consume(const void* data, size_t touched)
+	{
+		const uint64_t* words = reinterpret_cast<const uint64_t*>(data);
+		uint64_t sum = 0;
+		for (size_t i = 0; i < touched / sizeof(uint64_t); i++)
+			sum += words[i];
+		return sum;
+	}
+
+	int bench_model_load()
+	{
+		const size_t sizes[] = { 16, 64, 256 };
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+		if (TF_OK != alloc.Init(256 * 1024 * 1024, 4096))
+			return __LINE__;
+
+		printf("\nmodel load (%u rounds, warm page cache)\n", LoadRounds);
+		printf("%8s %16s %16s %16s %16s\n", "MB", "read ms", "map ms", "read all MB/s", "map all MB/s");
+
+		uint64_t sum = 0;
+
+		for (size_t mb : sizes)
+		{
+			size_t size = mb * 1024 * 1024;
+			if (!write_file(size))
+				return __LINE__;
+
+			double ms[2][2] = {};
+
+			for (uint32_t touchAll = 0; touchAll < 2; touchAll++)
+			{
+				size_t touched = touchAll ? size : size / 16;
+
+				for (uint32_t round = 0; round < LoadRounds; round++)
+				{
+					auto start = clock::now();
+
+					alloc.Reset();
+
+					void* data = nullptr;
+					size_t dataSize = 0;
+					if (TF_OK != FileIO::ReadFile(BenchFile, &data, &dataSize, 4, BenchAllocNo))
+						return __LINE__;
+					sum += consume(data, touched);
+
+					ms[touchAll][0] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+					start = clock::now();
+
+					FileMapping mapping = {};
+					if (TF_OK != FileIO::MapFile(BenchFile, &mapping))
+						return __LINE__;
+					sum += consume(mapping.data, touched);
+					if (TF_OK != FileIO::UnmapFile(&mapping))
+						return __LINE__;
+
+					ms[touchAll][1] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+				}
+			}
+
+			// first two columns only touch the model header part of the file
+			printf("%8zu %16.2f %16.2f %16.0f %16.0f\n", mb,
+				ms[0][0] / LoadRounds, ms[0][1] / LoadRounds,
+				mb * LoadRounds * 1000.0 / ms[1][0], mb * LoadRounds * 1000.0 / ms[1][1]);
+		}
+
+		remove(BenchFile);
+
+		// keeps the reads from being optimized away
+		if (sum == 1)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	constexpr uint32_t NumPakAssets = 500;
+	constexpr uint32_t PakRounds = 10;
+
+	// hundreds of small assets (shaders, materials, small textures) read one by one,
+	// loose files open one file each, the archive is opened once per level
+	int bench_pak_against_loose()
+	{
+		std::default_random_engine rng;
+		std::uniform_int_distribution<uint32_t> sizeDist(1024, 64 * 1024);
+
+		std::vector<std::vector<uint8_t>> contents(NumPakAssets);
+		std::vector<tofu::pak::PakSource> sources(NumPakAssets);
+		char paths[NumPakAssets][32];
+
+		for (uint32_t i = 0; i < NumPakAssets; i++)
+		{
+			snprintf(paths[i], sizeof(paths[i]), "bench_asset_%03u.tmp", i);
+			contents[i].resize(sizeDist(rng), static_cast<uint8_t>(i));
+
+			FILE* fp = fopen(paths[i], "wb");
+			if (nullptr == fp || 1 != fwrite(contents[i].data(), contents[i].size(), 1, fp) || 0 != fclose(fp))
+				return __LINE__;
+
+			sources[i].path = paths[i];
+			sources[i].data = contents[i].data();
+			sources[i].size = contents[i].size();
+		}
+
+		if (0 != tofu::pak::WritePak("bench_assets.pak", sources.data(), NumPakAssets))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+		if (TF_OK != alloc.Init(64 * 1024 * 1024, 4096))
+			return __LINE__;
+
+		double ms[2][2] = {};
+		uint64_t sum = 0;
+
+		for (uint32_t round = 0; round < PakRounds; round++)
+		{
+			for (uint32_t packed = 0; packed < 2; packed++)
+			{
+				auto start = clock::now();
+
+				if (packed && TF_OK != FileIO::MountPak("bench_assets.pak"))
+					return __LINE__;
+
+				alloc.Reset();
+				for (uint32_t i = 0; i < NumPakAssets; i++)
+				{
+					void* data = nullptr;
+					size_t size = 0;
+					if (TF_OK != FileIO::ReadFile(paths[i], &data, &size, 16, BenchAllocNo))
+						return __LINE__;
+					sum += consume(data, size);
+				}
+
+				ms[packed][0] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+				start = clock::now();
+
+				for (uint32_t i = 0; i < NumPakAssets; i++)
+				{
+					FileMapping mapping = {};
+					if (TF_OK != FileIO::MapFile(paths[i], &mapping))
+						return __LINE__;
+					sum += consume(mapping.data, mapping.size);
+					if (TF_OK != FileIO::UnmapFile(&mapping))
+						return __LINE__;
+				}
+
+				if (packed && TF_OK != FileIO::UnmountPaks())
+					return __LINE__;
+
+				ms[packed][1] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			}
+		}
+
+		printf("\npak vs loose files (%u assets, warm page cache)\n", NumPakAssets);
+		printf("%8s %12s %12s %16s\n", "", "read ms", "map ms", "map us/asset");
+		printf("%8s %12.2f %12.2f %16.2f\n", "loose", ms[0][0] / PakRounds, ms[0][1] / PakRounds, ms[0][1] * 1000.0 / PakRounds / NumPakAssets);
+		printf("%8s %12.2f %12.2f %16.2f\n", "pak", ms[1][0] / PakRounds, ms[1][1] / PakRounds, ms[1][1] * 1000.0 / PakRounds / NumPakAssets);
+
+		for (uint32_t i = 0; i < NumPakAssets; i++)
+			remove(paths[i]);
+		remove("bench_assets.pak");
+
+		// keeps the reads from being optimized away
+		if (sum == 1)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	constexpr size_t CompressedModelSize = 64 * 1024 * 1024;
+	constexpr uint32_t CompressedRounds = 10;
+
+	// vertex buffer like content: positions on a grid, normals and uvs repeating with some noise
+	void make_vertices(std::vector<uint8_t>& content)
+	{
+		std::default_random_engine rng;
+		float* v = reinterpret_cast<float*>(content.data());
+		size_t count = content.size() / sizeof(float);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t vertex = i / 12;
+			size_t attrib = i % 12;
+			float f = attrib < 3 ? static_cast<float>((vertex >> (attrib * 4)) & 15) * 0.5f : static_cast<float>(attrib & 3) * 0.25f;
+			if (rng() % 8 == 0)
+				f += static_cast<float>(rng() % 256) / 256.0f;
+			v[i] = f;
+		}
+	}
+
+	double read_ms(const char* file, uint64_t* sum)
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+		double ms = 0.0;
+
+		for (uint32_t round = 0; round < CompressedRounds; round++)
+		{
+			auto start = clock::now();
+
+			alloc.Reset();
+
+			void* data = nullptr;
+			size_t size = 0;
+			if (TF_OK != FileIO::ReadFile(file, &data, &size, 16, BenchAllocNo))
+				return -1.0;
+			*sum += consume(data, size);
+
+			ms += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		return ms / CompressedRounds;
+	}
+
+	// a large model stored raw or block compressed, the compressed one is less to read
+	// but has to be decoded, which scales with the number of threads
+	int bench_compressed()
+	{
+		std::vector<uint8_t> content(CompressedModelSize);
+		make_vertices(content);
+
+		std::vector<uint8_t> file(Compression::CompressFileBound(content.size()));
+
+		auto start = clock::now();
+		size_t fileSize = Compression::CompressFile(content.data(), content.size(), file.data(), file.size());
+		double compressMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		if (0 == fileSize)
+			return __LINE__;
+
+		const char* rawFile = "bench_raw.tmp";
+		const char* compressedFile = "bench_compressed.tmp";
+
+		FILE* fp = fopen(rawFile, "wb");
+		if (nullptr == fp || 1 != fwrite(content.data(), content.size(), 1, fp) || 0 != fclose(fp))
+			return __LINE__;
+
+		fp = fopen(compressedFile, "wb");
+		if (nullptr == fp || 1 != fwrite(file.data(), fileSize, 1, fp) || 0 != fclose(fp))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+		if (TF_OK != alloc.Init(256 * 1024 * 1024, 4096))
+			return __LINE__;
+
+		double mb = content.size() / (1024.0 * 1024.0);
+		uint64_t sum = 0;
+
+		printf("\ncompressed model (%.0f MB, ratio %.2f, compressed at %.0f MB/s, warm page cache)\n",
+			mb, static_cast<double>(content.size()) / fileSize, mb * 1000.0 / compressMs);
+		printf("%24s %12s %12s\n", "", "ms", "MB/s");
+
+		double ms = read_ms(rawFile, &sum);
+		if (ms < 0.0)
+			return __LINE__;
+		printf("%24s %12.2f %12.0f\n", "read raw", ms, mb * 1000.0 / ms);
+
+		// decoded by FileIO on every hardware thread
+		ms = read_ms(compressedFile, &sum);
+		if (ms < 0.0)
+			return __LINE__;
+		printf("%24s %12.2f %12.0f\n", "read compressed", ms, mb * 1000.0 / ms);
+
+		uint32_t maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads > tofu::MAX_DECOMPRESS_THREADS)
+			maxThreads = tofu::MAX_DECOMPRESS_THREADS;
+
+		char label[32];
+		for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			ms = 0.0;
+
+			for (uint32_t round = 0; round < CompressedRounds; round++)
+			{
+				start = clock::now();
+
+				alloc.Reset();
+
+				void* data = alloc.Allocate(content.size(), 16);
+				if (TF_OK != Compression::DecompressFile(file.data(), fileSize, data, content.size(), numThreads))
+					return __LINE__;
+				sum += consume(data, content.size());
+
+				ms += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			}
+
+			snprintf(label, sizeof(label), "decode %u thread(s)", numThreads);
+			printf("%24s %12.2f %12.0f\n", label, ms / CompressedRounds, mb * CompressedRounds * 1000.0 / ms);
+		}
+
+		remove(rawFile);
+		remove(compressedFile);
+
+		// keeps the reads from being optimized away
+		if (sum == 1)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	constexpr size_t StreamChunkSize = 1024 * 1024;
+
+	int32_t consume_chunk(const void* data, size_t, size_t size, void* userData)
+	{
+		*reinterpret_cast<uint64_t*>(userData) += consume(data, size);
+		return TF_OK;
+	}
+
+	// a large asset consumed as a whole, or chunk by chunk through one small buffer
+	int bench_stream()
+	{
+		std::vector<uint8_t> content(CompressedModelSize);
+		make_vertices(content);
+
+		std::vector<uint8_t> file(Compression::CompressFileBound(content.size()));
+		file.resize(Compression::CompressFile(content.data(), content.size(), file.data(), file.size()));
+		if (file.empty())
+			return __LINE__;
+
+		const char* files[] = { "bench_raw.tmp", "bench_compressed.tmp" };
+
+		FILE* fp = fopen(files[0], "wb");
+		if (nullptr == fp || 1 != fwrite(content.data(), content.size(), 1, fp) || 0 != fclose(fp))
+			return __LINE__;
+
+		fp = fopen(files[1], "wb");
+		if (nullptr == fp || 1 != fwrite(file.data(), file.size(), 1, fp) || 0 != fclose(fp))
+			return __LINE__;
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+		if (TF_OK != alloc.Init(256 * 1024 * 1024, 4096))
+			return __LINE__;
+
+		std::vector<uint8_t> buffer(StreamChunkSize);
+		double mb = content.size() / (1024.0 * 1024.0);
+		uint64_t sum = 0;
+
+		printf("\nstreamed reads (%.0f MB, %zu KB chunks, warm page cache)\n", mb, StreamChunkSize / 1024);
+		printf("%12s %12s %12s %12s %12s\n", "", "read ms", "stream ms", "read peak MB", "stream peak KB");
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			double ms[2] = {};
+			size_t peak = 0;
+
+			for (uint32_t round = 0; round < CompressedRounds; round++)
+			{
+				auto start = clock::now();
+
+				alloc.Reset();
+
+				void* data = nullptr;
+				size_t size = 0;
+				if (TF_OK != FileIO::ReadFile(files[i], &data, &size, 16, BenchAllocNo))
+					return __LINE__;
+				sum += consume(data, size);
+				peak = alloc.GetUsedSize();
+
+				ms[0] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+				start = clock::now();
+
+				if (TF_OK != FileIO::StreamFile(files[i], 0, content.size(), buffer.data(), buffer.size(), consume_chunk, &sum))
+					return __LINE__;
+
+				ms[1] += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			}
+
+			// streaming a compressed file also keeps a decoded block and a staging block
+			size_t streamPeak = buffer.size() + (i ? 2 * tofu::COMPRESSED_BLOCK_SIZE : 0);
+
+			printf("%12s %12.2f %12.2f %12.1f %12zu\n", i ? "compressed" : "raw",
+				ms[0] / CompressedRounds, ms[1] / CompressedRounds, peak / (1024.0 * 1024.0), streamPeak / 1024);
+		}
+
+		remove(files[0]);
+		remove(files[1]);
+
+		// keeps the reads from being optimized away
+		if (sum == 1)
+			return __LINE__;
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int bench_fileio()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_model_load())) return ret;
+	if (0 != (ret = bench_pak_against_loose())) return ret;
+	if (0 != (ret = bench_compressed())) return ret;
+	if (0 != (ret = bench_stream())) return ret;
+
+	return 0;
+}
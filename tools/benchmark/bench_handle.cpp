@@ -0,0 +1,102 @@
+#include "../../ConcurrentHandleAllocator.h"
+#include "../../HandleAllocator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using tofu::ConcurrentHandleAllocator;
+using tofu::HandleAllocator;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	HANDLE_DECL(Bench);
+
+	constexpr uint32_t BenchHandleCount = 65536;
+
+	// total allocate/free pairs per round, split evenly between threads
+	constexpr uint32_t BenchPairs = 8 * 1024 * 1024;
+	// handles each thread holds before freeing them, like a loader creating a batch of buffers
+	constexpr uint32_t BenchBatch = 64;
+
+	template<typename AllocFunc, typename FreeFunc>
+	double run_threads(uint32_t numThreads, AllocFunc allocFunc, FreeFunc freeFunc)
+	{
+		uint32_t batchesPerThread = BenchPairs / BenchBatch / numThreads;
+		std::vector<std::thread> threads;
+
+		auto start = clock::now();
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([batchesPerThread, &allocFunc, &freeFunc]()
+			{
+				BenchHandle handles[BenchBatch];
+				for (uint32_t i = 0; i < batchesPerThread; i++)
+				{
+					for (uint32_t j = 0; j < BenchBatch; j++)
+						handles[j] = allocFunc();
+					for (uint32_t j = 0; j < BenchBatch; j++)
+						freeFunc(handles[j]);
+				}
+			});
+		}
+
+		for (auto& th : threads)
+			th.join();
+
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	// lock-free allocator against the single threaded one behind a mutex
+	int bench_handle_contention()
+	{
+		static ConcurrentHandleAllocator<BenchHandle, BenchHandleCount> concurrentAlloc;
+		static HandleAllocator<BenchHandle, BenchHandleCount> lockedAlloc;
+		std::mutex lock;
+
+		uint32_t maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads == 0) maxThreads = 1;
+
+		printf("\nhandle allocator contention (%u allocate/free pairs per round, batches of %u)\n", BenchPairs, BenchBatch);
+		printf("%8s %14s %10s %14s %10s\n", "threads", "lock-free ms", "Mops/s", "mutex ms", "Mops/s");
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t n = 1; n < maxThreads; n *= 2)
+			threadCounts.push_back(n);
+		threadCounts.push_back(maxThreads);
+
+		for (uint32_t n : threadCounts)
+		{
+			double concurrent = run_threads(n,
+				[]() { return concurrentAlloc.Allocate(); },
+				[](BenchHandle h) { concurrentAlloc.Free(h); });
+
+			double locked = run_threads(n,
+				[&lock]() { std::lock_guard<std::mutex> guard(lock); return lockedAlloc.Allocate(); },
+				[&lock](BenchHandle h) { std::lock_guard<std::mutex> guard(lock); lockedAlloc.Free(h); });
+
+			if (0 != concurrentAlloc.GetNumInUse() || 0 != lockedAlloc.GetNumInUse())
+				return __LINE__;
+
+			printf("%8u %14.2f %10.1f %14.2f %10.1f\n", n,
+				concurrent, BenchPairs * 2 / concurrent / 1000.0,
+				locked, BenchPairs * 2 / locked / 1000.0);
+		}
+
+		return 0;
+	}
+}
+
+int bench_handle()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_handle_contention())) return ret;
+
+	return 0;
+}
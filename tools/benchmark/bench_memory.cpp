@@ -0,0 +1,494 @@
+#include "../../MemoryAllocator.h"
+#include "../../PageAllocator.h"
+#include "../../StlAllocator.h"
+#include "../../PoolAllocator.h"
+#include "../../TlsfAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using tofu::MemoryAllocator;
+using tofu::PoolAllocator;
+using tofu::TlsfAllocator;
+using tofu::TF_OK;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	constexpr uint32_t BenchAllocNo = tofu::ALLOC_FRAME_BASED_MEM;
+	constexpr size_t BenchMemSize = 256 * 1024 * 1024;
+
+	// total bytes handed out per round, split evenly between threads
+	constexpr size_t BenchWorkingSet = 192 * 1024 * 1024;
+	constexpr size_t BenchBlockSize = 32;
+
+	template<typename AllocFunc>
+	double run_threads(uint32_t numThreads, AllocFunc func)
+	{
+		size_t allocsPerThread = BenchWorkingSet / BenchBlockSize / numThreads;
+		std::vector<std::thread> threads;
+
+		auto start = clock::now();
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([allocsPerThread, &func]()
+			{
+				for (size_t i = 0; i < allocsPerThread; i++)
+				{
+					void* ptr = func();
+					if (nullptr == ptr) return;
+					*reinterpret_cast<uint32_t*>(ptr) = 0u;
+				}
+			});
+		}
+
+		for (auto& th : threads)
+			th.join();
+
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	// concurrent arena against the single threaded arena behind a mutex
+	int bench_frame_allocator_contention()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+
+		uint32_t maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads == 0) maxThreads = 1;
+
+		double allocCount = static_cast<double>(BenchWorkingSet / BenchBlockSize);
+
+		printf("frame allocator contention (%zu byte blocks, %.0f allocs per round)\n", BenchBlockSize, allocCount);
+		printf("%8s %14s %10s %14s %10s\n", "threads", "concurrent ms", "speedup", "mutex ms", "speedup");
+
+		double baseConcurrent = 0.0;
+		double baseLocked = 0.0;
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t n = 1; n < maxThreads; n *= 2)
+			threadCounts.push_back(n);
+		threadCounts.push_back(maxThreads);
+
+		for (uint32_t n : threadCounts)
+		{
+			if (TF_OK != alloc.Init(BenchMemSize, 4096, nullptr, tofu::ALLOC_FLAG_CONCURRENT))
+				return __LINE__;
+
+			double concurrent = run_threads(n, [&alloc]() { return alloc.Allocate(BenchBlockSize, 8); });
+
+			CHECKED(alloc.Shutdown());
+
+			if (TF_OK != alloc.Init(BenchMemSize, 4096))
+				return __LINE__;
+
+			std::mutex lock;
+			double locked = run_threads(n, [&alloc, &lock]()
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				return alloc.Allocate(BenchBlockSize, 8);
+			});
+
+			CHECKED(alloc.Shutdown());
+
+			if (n == 1)
+			{
+				baseConcurrent = concurrent;
+				baseLocked = locked;
+			}
+
+			// work is fixed per round, so linear scaling means speedup == threads
+			printf("%8u %14.2f %9.2fx %14.2f %9.2fx\n", n,
+				concurrent, baseConcurrent / concurrent,
+				locked, baseLocked / locked);
+		}
+
+		return 0;
+	}
+
+	// same random sequence of sizes and frees for every allocator
+	struct ChurnOp
+	{
+		size_t		size;
+		uint32_t	freeSlot;
+	};
+
+	constexpr uint32_t ChurnSlots = 8192;
+	constexpr uint32_t ChurnOps = 2000000;
+
+	std::vector<ChurnOp> make_churn_ops()
+	{
+		std::default_random_engine rand;
+		// mostly small blocks, with a tail of large ones as assets do
+		std::uniform_int_distribution<size_t> smallDist(16, 1024);
+		std::uniform_int_distribution<size_t> largeDist(4096, 256 * 1024);
+		std::uniform_int_distribution<uint32_t> pickDist(0, 99);
+		std::uniform_int_distribution<uint32_t> slotDist(0, ChurnSlots - 1);
+
+		std::vector<ChurnOp> ops(ChurnOps);
+		for (ChurnOp& op : ops)
+		{
+			op.size = pickDist(rand) < 95 ? smallDist(rand) : largeDist(rand);
+			op.freeSlot = slotDist(rand);
+		}
+		return ops;
+	}
+
+	// each op frees a random slot and refills it
+	template<typename AllocFunc, typename FreeFunc>
+	double run_churn(const std::vector<ChurnOp>& ops, AllocFunc allocFunc, FreeFunc freeFunc, uint32_t* failures)
+	{
+		std::vector<void*> slots(ChurnSlots, nullptr);
+		uint32_t failed = 0;
+
+		auto start = clock::now();
+
+		for (const ChurnOp& op : ops)
+		{
+			void*& slot = slots[op.freeSlot];
+			freeFunc(slot);
+			slot = allocFunc(op.size);
+			if (nullptr == slot)
+				failed++;
+			else
+				*reinterpret_cast<uint32_t*>(slot) = 0u;
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		for (void* slot : slots)
+			freeFunc(slot);
+
+		*failures = failed;
+		return ms;
+	}
+
+	int bench_tlsf_against_malloc()
+	{
+		constexpr size_t heapSize = 256 * 1024 * 1024;
+
+		std::vector<ChurnOp> ops = make_churn_ops();
+
+		void* memory = malloc(heapSize);
+		if (nullptr == memory)
+			return __LINE__;
+
+		TlsfAllocator* tlsf = TlsfAllocator::Create(memory, heapSize);
+		if (nullptr == tlsf)
+			return __LINE__;
+
+		printf("\ntlsf vs malloc (%u ops over %u live slots)\n", ChurnOps, ChurnSlots);
+
+		uint32_t tlsfFailures = 0;
+		double tlsfMs = run_churn(ops,
+			[tlsf](size_t size) { return tlsf->Allocate(size, 8); },
+			[tlsf](void* ptr) { tlsf->Deallocate(ptr); },
+			&tlsfFailures);
+
+		uint32_t mallocFailures = 0;
+		double mallocMs = run_churn(ops,
+			[](size_t size) { return malloc(size); },
+			[](void* ptr) { free(ptr); },
+			&mallocFailures);
+
+		printf("%8s %10s %14s %10s\n", "", "ms", "Mops/s", "failures");
+		printf("%8s %10.2f %14.2f %10u\n", "tlsf", tlsfMs, ChurnOps / tlsfMs / 1000.0, tlsfFailures);
+		printf("%8s %10.2f %14.2f %10u\n", "malloc", mallocMs, ChurnOps / mallocMs / 1000.0, mallocFailures);
+
+		// fragmentation, half of the blocks are freed in random order,
+		// then check how much of free memory is still usable in one piece
+		{
+			std::vector<void*> blocks;
+			std::default_random_engine rand;
+			std::uniform_int_distribution<size_t> sizeDist(64, 64 * 1024);
+
+			for (;;)
+			{
+				void* ptr = tlsf->Allocate(sizeDist(rand), 8);
+				if (nullptr == ptr) break;
+				blocks.push_back(ptr);
+			}
+
+			std::shuffle(blocks.begin(), blocks.end(), rand);
+			for (size_t i = 0; i < blocks.size() / 2; i++)
+				tlsf->Deallocate(blocks[i]);
+
+			size_t totalFree = 0, largestFree = 0;
+			tlsf->GetFreeSpace(&totalFree, &largestFree);
+
+			printf("after filling heap and freeing half at random: %.1f MB free, largest block %.1f MB, fragmentation %.1f%%\n",
+				totalFree / (1024.0 * 1024.0),
+				largestFree / (1024.0 * 1024.0),
+				totalFree > 0 ? 100.0 * (1.0 - double(largestFree) / totalFree) : 0.0);
+
+			// a small request still succeeds wherever half of the blocks were freed
+			uint32_t refilled = 0;
+			while (nullptr != tlsf->Allocate(32 * 1024, 8)) refilled++;
+			printf("32KB blocks still allocatable: %u (%.1f MB)\n", refilled, refilled * 32.0 / 1024.0);
+		}
+
+		free(memory);
+		return 0;
+	}
+
+	// about the size of a rigid body or a command param
+	struct PoolObject
+	{
+		float		data[24];
+	};
+
+	constexpr uint32_t PoolOpsPerThread = 4000000;
+
+	// each op frees a random slot of its own thread and refills it
+	template<typename CreateFunc, typename DestroyFunc>
+	double run_pool_churn(uint32_t numThreads, CreateFunc createFunc, DestroyFunc destroyFunc)
+	{
+		std::vector<std::thread> threads;
+
+		auto start = clock::now();
+
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads.emplace_back([t, &createFunc, &destroyFunc]()
+			{
+				std::default_random_engine rand(t);
+				std::uniform_int_distribution<uint32_t> slotDist(0, ChurnSlots - 1);
+				std::vector<PoolObject*> slots(ChurnSlots, nullptr);
+
+				for (uint32_t i = 0; i < PoolOpsPerThread; i++)
+				{
+					PoolObject*& slot = slots[slotDist(rand)];
+					destroyFunc(slot);
+					slot = createFunc();
+					if (nullptr != slot)
+						slot->data[0] = 0.0f;
+				}
+
+				for (PoolObject* slot : slots)
+					destroyFunc(slot);
+			});
+		}
+
+		for (auto& th : threads)
+			th.join();
+
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	int bench_pool_against_new()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (TF_OK != alloc.Init(BenchMemSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		uint32_t maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads == 0) maxThreads = 1;
+
+		std::vector<uint32_t> threadCounts;
+		for (uint32_t n = 1; n < maxThreads; n *= 2)
+			threadCounts.push_back(n);
+		threadCounts.push_back(maxThreads);
+
+		printf("\npool vs new/delete (%zu byte objects, %u ops per thread over %u live slots)\n",
+			sizeof(PoolObject), PoolOpsPerThread, ChurnSlots);
+		printf("%8s %12s %12s %12s\n", "threads", "pool ms", "cached ms", "new ms");
+
+		for (uint32_t n : threadCounts)
+		{
+			double poolMs = 0.0;
+
+			// pool without thread cache is single threaded only
+			if (n == 1)
+			{
+				PoolAllocator<PoolObject> pool(tofu::ALLOC_LEVEL_BASED_HEAP);
+				poolMs = run_pool_churn(n,
+					[&pool]() { return pool.Create(); },
+					[&pool](PoolObject* ptr) { pool.Destroy(ptr); });
+			}
+
+			PoolAllocator<PoolObject> cachedPool(tofu::ALLOC_LEVEL_BASED_HEAP, true);
+			double cachedMs = run_pool_churn(n,
+				[&cachedPool]() { return cachedPool.Create(); },
+				[&cachedPool](PoolObject* ptr) { cachedPool.Destroy(ptr); });
+
+			double newMs = run_pool_churn(n,
+				[]() { return new PoolObject(); },
+				[](PoolObject* ptr) { delete ptr; });
+
+			if (n == 1)
+				printf("%8u %12.2f %12.2f %12.2f\n", n, poolMs, cachedMs, newMs);
+			else
+				printf("%8u %12s %12.2f %12.2f\n", n, "-", cachedMs, newMs);
+		}
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+
+	// component sized item, scattered all over the arena
+	struct FrameItem
+	{
+		float		data[16];
+	};
+
+	constexpr size_t HugePageArenaSize = 512 * 1024 * 1024;
+	constexpr uint32_t HugePageFrames = 20;
+	constexpr uint32_t HugePageItems = 2 * 1024 * 1024;
+
+	// every frame resets the arena, fills it and reads it back in random order,
+	// so the walk touches far more pages than the TLB holds
+	int bench_huge_pages()
+	{
+		struct Config
+		{
+			const char*		name;
+			uint32_t		flags;
+		};
+
+		const Config configs[] = {
+			{ "4KB pages", tofu::PAGE_FLAG_NONE },
+			{ "4KB pages, prefault", tofu::PAGE_FLAG_PREFAULT },
+			{ "transparent huge", tofu::PAGE_FLAG_TRANSPARENT_HUGE_PAGES },
+			{ "transparent huge, prefault", tofu::PAGE_FLAG_TRANSPARENT_HUGE_PAGES | tofu::PAGE_FLAG_PREFAULT },
+			{ "explicit huge", tofu::PAGE_FLAG_HUGE_PAGES | tofu::PAGE_FLAG_PREFAULT },
+		};
+
+		std::vector<uint32_t> order(HugePageItems);
+		for (uint32_t i = 0; i < HugePageItems; i++)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::default_random_engine());
+
+		std::vector<FrameItem*> items(HugePageItems);
+
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[BenchAllocNo];
+
+		printf("\narena frames (%u items of %zu bytes, spread over %zu MB)\n",
+			HugePageItems, sizeof(FrameItem), HugePageArenaSize / (1024 * 1024));
+		printf("%28s %12s %14s %14s\n", "", "init ms", "first frame ms", "frame ms");
+
+		for (const Config& config : configs)
+		{
+			tofu::PageAllocator pageAlloc(config.flags);
+
+			auto start = clock::now();
+			if (TF_OK != alloc.Init(HugePageArenaSize, tofu::HUGE_PAGE_SIZE, &pageAlloc))
+				return __LINE__;
+			double initMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			double firstMs = 0.0;
+			double totalMs = 0.0;
+			float sum = 0.0f;
+
+			for (uint32_t frame = 0; frame < HugePageFrames; frame++)
+			{
+				start = clock::now();
+
+				alloc.Reset();
+
+				// gaps between items spread them over the whole arena
+				for (uint32_t i = 0; i < HugePageItems; i++)
+				{
+					items[i] = reinterpret_cast<FrameItem*>(alloc.Allocate(sizeof(FrameItem), 256));
+					if (nullptr == items[i])
+						return __LINE__;
+					items[i]->data[0] = static_cast<float>(i);
+				}
+
+				for (uint32_t i : order)
+					sum += items[i]->data[0];
+
+				double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+				if (frame == 0)
+					firstMs = ms;
+				else
+					totalMs += ms;
+			}
+
+			printf("%28s %12.2f %14.2f %14.2f\n", config.name, initMs, firstMs, totalMs / (HugePageFrames - 1));
+
+			if (TF_OK != alloc.Shutdown())
+				return __LINE__;
+
+			// keep the reads from being optimized away
+			if (sum < 0.0f)
+				return __LINE__;
+		}
+
+		return 0;
+	}
+
+	constexpr uint32_t ContainerRounds = 200;
+	constexpr uint32_t ContainerItems = 4096;
+
+	// vectors grown from empty and a map filled and emptied again, as per frame work does
+	template<typename VectorType, typename MapType, typename MakeKey>
+	double run_containers(MakeKey makeKey)
+	{
+		uint64_t sum = 0;
+		auto start = clock::now();
+
+		for (uint32_t round = 0; round < ContainerRounds; round++)
+		{
+			VectorType list;
+			MapType table;
+
+			for (uint32_t i = 0; i < ContainerItems; i++)
+			{
+				list.push_back(i);
+				table.emplace(makeKey(i), i);
+			}
+
+			for (uint32_t i = 0; i < ContainerItems; i += 2)
+				table.erase(makeKey(i));
+
+			sum += list.size() + table.size();
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		return sum > 0 ? ms : -1.0;
+	}
+
+	int bench_stl_allocator()
+	{
+		MemoryAllocator& alloc = MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (TF_OK != alloc.Init(BenchMemSize, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		double heapMs = run_containers<tofu::Vector<uint32_t>, tofu::UnorderedMap<tofu::String, uint32_t, tofu::StringHash>>(
+			[](uint32_t i) { char key[32]; snprintf(key, sizeof(key), "entity_name_%u", i); return tofu::String(key); });
+
+		double stdMs = run_containers<std::vector<uint32_t>, std::unordered_map<std::string, uint32_t>>(
+			[](uint32_t i) { char key[32]; snprintf(key, sizeof(key), "entity_name_%u", i); return std::string(key); });
+
+		printf("\ncontainers (%u rounds of %u items)\n", ContainerRounds, ContainerItems);
+		printf("%12s %10.2f ms\n", "level heap", heapMs);
+		printf("%12s %10.2f ms\n", "malloc", stdMs);
+
+		if (TF_OK != alloc.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int bench_memory()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_frame_allocator_contention())) return ret;
+	if (0 != (ret = bench_tlsf_against_malloc())) return ret;
+	if (0 != (ret = bench_pool_against_new())) return ret;
+	if (0 != (ret = bench_huge_pages())) return ret;
+	if (0 != (ret = bench_stl_allocator())) return ret;
+
+	return 0;
+}
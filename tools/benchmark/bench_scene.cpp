@@ -0,0 +1,184 @@
+#include "../../FileIO.h"
+#include "../../MemoryAllocator.h"
+#include "../../PakFormat.h"
+#include "../../RenderingComponent.h"
+#include "../../SceneSnapshot.h"
+#include "../../TransformComponent.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using tofu::Entity;
+using tofu::RenderingComponent;
+using tofu::SceneSnapshot;
+using tofu::TransformComponent;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	const char* SceneFile = "bench_scene.tmp";
+
+	// stands for a Model or Material, rendering components only hold pointers to them
+	struct SceneAsset
+	{
+		uint32_t	id;
+	};
+
+	constexpr uint32_t SceneEntities = 50000;
+	constexpr uint32_t NumModels = 16;
+	constexpr uint32_t NumMaterials = 8;
+	constexpr uint32_t Rounds = 5;
+
+	SceneAsset models[NumModels];
+	SceneAsset materials[NumMaterials];
+
+	tofu::Model* get_model(uint32_t i) { return reinterpret_cast<tofu::Model*>(&models[i]); }
+	tofu::Material* get_material(uint32_t i) { return reinterpret_cast<tofu::Material*>(&materials[i]); }
+
+	// entities in groups of 8 under a root, every one but roots is rendered
+	int32_t build_scene(std::vector<Entity>& entities)
+	{
+		for (uint32_t i = 0; i < SceneEntities; i++)
+		{
+			Entity e = Entity::Create();
+			if (!e)
+				return tofu::TF_UNKNOWN_ERR;
+
+			TransformComponent t = e.AddComponent<TransformComponent>();
+			t->SetLocalPosition(tofu::math::float3{ static_cast<float>(i), 0, 0 });
+
+			if (i % 8 != 0)
+			{
+				t->SetParent(entities[i - i % 8].GetComponent<TransformComponent>());
+
+				RenderingComponent r = e.AddComponent<RenderingComponent>();
+				r->SetModel(get_model(i % NumModels));
+				r->SetMaterial(get_material(i % NumMaterials));
+			}
+
+			entities[i] = e;
+		}
+		return tofu::TF_OK;
+	}
+
+	void destroy_all(const Entity* entities, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Entity e = entities[i];
+			e.Destroy();
+		}
+		Entity::FlushDestroyed();
+	}
+
+	// a level built with API calls, against loading a snapshot of it
+	int bench_scene_load()
+	{
+		// another benchmark may have set it already
+		if (tofu::TF_OK != Entity::SetCapacity(SceneEntities * 2) && Entity::GetCapacity() < SceneEntities * 2)
+			return __LINE__;
+
+		// children of transforms are on level heap
+		tofu::MemoryAllocator& heap = tofu::MemoryAllocator::Allocators[tofu::ALLOC_LEVEL_BASED_HEAP];
+		if (tofu::TF_OK != heap.Init(64 * 1024 * 1024, 4096, nullptr, tofu::ALLOC_FLAG_TLSF))
+			return __LINE__;
+
+		// as Engine::AddSnapshotTypes() does, models by hash of their path
+		SceneSnapshot snapshot;
+		if (tofu::TF_OK != tofu::TransformComponentData::AddSnapshotType(snapshot)
+			|| tofu::TF_OK != tofu::RenderingComponentData::AddSnapshotType(snapshot))
+			return __LINE__;
+
+		for (uint32_t i = 0; i < NumModels; i++)
+		{
+			std::string path = "assets/model" + std::to_string(i) + ".model";
+			if (tofu::TF_OK != snapshot.AddAsset(tofu::pak::HashPath(path.c_str()), get_model(i)))
+				return __LINE__;
+		}
+		for (uint32_t i = 0; i < NumMaterials; i++)
+		{
+			std::string name = "material" + std::to_string(i);
+			if (tofu::TF_OK != snapshot.AddAsset(tofu::pak::HashPath(name.c_str()), get_material(i)))
+				return __LINE__;
+		}
+
+		std::vector<Entity> entities(SceneEntities);
+		if (tofu::TF_OK != build_scene(entities))
+			return __LINE__;
+
+		auto start = clock::now();
+		if (tofu::TF_OK != snapshot.Save(SceneFile))
+			return __LINE__;
+		double save = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+		size_t fileSize = 0;
+		if (tofu::TF_OK != tofu::FileIO::GetFileSize(SceneFile, &fileSize))
+			return __LINE__;
+
+		destroy_all(entities.data(), SceneEntities);
+
+		printf("\nscene of %u entities, %u renderables, saved in %.2f ms, %.1f KB\n",
+			SceneEntities, SceneEntities - SceneEntities / 8, save, fileSize / 1024.0);
+		printf("%6s %16s %10s %16s %10s %9s\n", "round", "API calls ms", "ns/ent", "snapshot ms", "ns/ent", "speedup");
+
+		for (uint32_t r = 0; r < Rounds; r++)
+		{
+			start = clock::now();
+			if (tofu::TF_OK != build_scene(entities))
+				return __LINE__;
+			double build = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			destroy_all(entities.data(), SceneEntities);
+
+			start = clock::now();
+			if (tofu::TF_OK != snapshot.Load(SceneFile) || snapshot.GetNumLoaded() != SceneEntities)
+				return __LINE__;
+			double load = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			// hierarchy and assets came back
+			if (TransformComponent::GetNumComponents() != SceneEntities
+				|| RenderingComponent::GetNumComponents() != SceneEntities - SceneEntities / 8)
+				return __LINE__;
+
+			const Entity* loaded = snapshot.GetLoadedEntities();
+			for (uint32_t i = 0; i < SceneEntities; i += SceneEntities / 16 + 1)
+			{
+				TransformComponent t = loaded[i].GetComponent<TransformComponent>();
+				TransformComponent parent = t->GetParent();
+				if (parent && (parent->GetParent() || std::fabs(t->GetWorldPosition().x - parent->GetWorldPosition().x - t->GetLocalPosition().x) > 0.01f))
+					return __LINE__;
+			}
+
+			tofu::RenderingComponentData* renderables = RenderingComponent::GetAllComponents();
+			if (renderables[0].GetModel() < get_model(0) || renderables[0].GetModel() > get_model(NumModels - 1))
+				return __LINE__;
+
+			printf("%6u %16.2f %10.2f %16.2f %10.2f %8.2fx\n", r,
+				build, build * 1e6 / SceneEntities,
+				load, load * 1e6 / SceneEntities,
+				build / load);
+
+			destroy_all(snapshot.GetLoadedEntities(), snapshot.GetNumLoaded());
+		}
+
+		remove(SceneFile);
+
+		if (tofu::TF_OK != heap.Shutdown())
+			return __LINE__;
+
+		return 0;
+	}
+}
+
+int bench_scene()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_scene_load())) return ret;
+
+	return 0;
+}
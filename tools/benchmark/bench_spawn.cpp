@@ -0,0 +1,139 @@
+#include "../../Prefab.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using tofu::Component;
+using tofu::Entity;
+using tofu::Prefab;
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	// about the size of TransformComponentData
+	struct SpawnTransform
+	{
+		Entity		entity;
+		float		position[3];
+		float		rotation[4];
+		float		scale[3];
+		float		world[16];
+
+		SpawnTransform() : SpawnTransform(Entity()) {}
+		SpawnTransform(Entity e) : entity(e), position(), rotation{ 0, 0, 0, 1 }, scale{ 1, 1, 1 }, world() {}
+	};
+
+	// like RenderingComponentData, pointing to a shared model and material
+	struct SpawnRenderable
+	{
+		Entity		entity;
+		void*		model;
+		void*		material;
+
+		SpawnRenderable() : SpawnRenderable(Entity()) {}
+		SpawnRenderable(Entity e) : entity(e), model(nullptr), material(nullptr) {}
+	};
+
+	typedef Component<SpawnTransform> SpawnTransformComponent;
+	typedef Component<SpawnRenderable> SpawnRenderableComponent;
+
+	constexpr uint32_t SpawnCount = 100000;
+	constexpr uint32_t Rounds = 5;
+
+	// entities built one by one, as TestGame::Init does, against SpawnBatch() of a prefab.
+	// spawned entities are destroyed after each round, so later rounds reuse committed pages
+	int bench_spawn_batch()
+	{
+		// another benchmark may have set it already
+		if (tofu::TF_OK != Entity::SetCapacity(SpawnCount) && Entity::GetCapacity() < SpawnCount)
+			return __LINE__;
+
+		int model = 0, material = 0;
+
+		SpawnRenderable renderable;
+		renderable.model = &model;
+		renderable.material = &material;
+
+		SpawnTransform transform;
+		transform.position[1] = 10.0f;
+
+		Prefab prefab;
+		if (tofu::TF_OK != prefab.Add<SpawnTransformComponent>(transform)
+			|| tofu::TF_OK != prefab.Add<SpawnRenderableComponent>(renderable))
+			return __LINE__;
+
+		std::vector<Entity> entities(SpawnCount);
+
+		printf("\nspawn %u entities with 2 components\n", SpawnCount);
+		printf("%6s %16s %10s %16s %10s %9s\n", "round", "one by one ms", "ns/ent", "SpawnBatch ms", "ns/ent", "speedup");
+
+		for (uint32_t r = 0; r < Rounds; r++)
+		{
+			auto start = clock::now();
+			for (uint32_t i = 0; i < SpawnCount; i++)
+			{
+				Entity e = Entity::Create();
+				if (!e)
+					return __LINE__;
+
+				SpawnTransformComponent t = e.AddComponent<SpawnTransformComponent>();
+				t->position[0] = static_cast<float>(i);
+				t->position[1] = 10.0f;
+
+				SpawnRenderableComponent c = e.AddComponent<SpawnRenderableComponent>();
+				c->model = &model;
+				c->material = &material;
+
+				entities[i] = e;
+			}
+			double single = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			for (Entity e : entities)
+				e.Destroy();
+			Entity::FlushDestroyed();
+
+			start = clock::now();
+			int32_t err = tofu::SpawnBatch(prefab, SpawnCount, [&](Entity e, uint32_t i)
+			{
+				e.GetComponent<SpawnTransformComponent>()->position[0] = static_cast<float>(i);
+				entities[i] = e;
+			});
+			double batch = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+			if (tofu::TF_OK != err || SpawnRenderableComponent::GetNumComponents() != SpawnCount)
+				return __LINE__;
+
+			// both built the same entities
+			for (uint32_t i = 0; i < SpawnCount; i += SpawnCount / 16)
+			{
+				SpawnTransformComponent t = entities[i].GetComponent<SpawnTransformComponent>();
+				if (t->position[0] != static_cast<float>(i) || t->position[1] != 10.0f
+					|| entities[i].GetComponent<SpawnRenderableComponent>()->model != &model)
+					return __LINE__;
+			}
+
+			printf("%6u %16.2f %10.2f %16.2f %10.2f %8.2fx\n", r,
+				single, single * 1e6 / SpawnCount,
+				batch, batch * 1e6 / SpawnCount,
+				single / batch);
+
+			for (Entity e : entities)
+				e.Destroy();
+			Entity::FlushDestroyed();
+		}
+
+		return 0;
+	}
+}
+
+int bench_spawn()
+{
+	int ret = 0;
+
+	if (0 != (ret = bench_spawn_batch())) return ret;
+
+	return 0;
+}
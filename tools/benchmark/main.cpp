@@ -0,0 +1,21 @@
+#define CHECK(x) {int ret = 0; if ((ret = (x)) != 0) return ret; }
+
+extern int bench_memory();
+extern int bench_fileio();
+extern int bench_handle();
+extern int bench_archetype();
+extern int bench_spawn();
+extern int bench_scene();
+extern int bench_defrag();
+
+int main()
+{
+	CHECK(bench_memory());
+	CHECK(bench_fileio());
+	CHECK(bench_handle());
+	CHECK(bench_archetype());
+	CHECK(bench_spawn());
+	CHECK(bench_scene());
+	CHECK(bench_defrag());
+	return 0;
+}
@@ -10,6 +10,7 @@
 
 #pragma comment (lib, "assimp-vc140-mt.lib")
 
+#include "../../Compression.h"
 #include "../../ModelFormat.h"
 #include "../../TofuMath.h"
 
@@ -675,11 +676,62 @@ struct ModelFile
 	}
 };
 
+// rewrite a file as block compressed file, the engine decompresses it when loading
+int CompressFile(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (nullptr == file)
+	{
+		printf("failed to open output file.\n");
+		return __LINE__;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size_t size = static_cast<size_t>(ftell(file));
+	fseek(file, 0, SEEK_SET);
+
+	std::vector<uint8_t> raw(size);
+	if (size > 0 && 1 != fread(&raw[0], size, 1, file))
+	{
+		fclose(file);
+		printf("failed to read output file.\n");
+		return __LINE__;
+	}
+	fclose(file);
+
+	std::vector<uint8_t> compressed(tofu::Compression::CompressFileBound(size));
+	size_t compressedSize = tofu::Compression::CompressFile(raw.data(), size, compressed.data(), compressed.size());
+	if (0 == compressedSize)
+	{
+		printf("failed to compress output file.\n");
+		return __LINE__;
+	}
+
+	file = fopen(filename, "wb");
+	if (nullptr == file || 1 != fwrite(compressed.data(), compressedSize, 1, file))
+	{
+		printf("failed to write compressed data.\n");
+		return __LINE__;
+	}
+	fclose(file);
+
+	printf("compressed %zu bytes to %zu bytes.\n", size, compressedSize);
+	return 0;
+}
+
 int main(int argc, char* argv[])
 {
+	bool compress = argc > 1 && 0 == strcmp(argv[1], "-c");
+	if (compress)
+	{
+		argc--;
+		argv++;
+	}
+
 	if (argc < 3)
 	{
-		printf("model_converter output_file input_file1 [input_file2 ...]\n");
+		printf("model_converter [-c] output_file input_file1 [input_file2 ...]\n");
+		printf("  -c  write a block compressed model\n");
 		return 0;
 	}
 
@@ -700,6 +752,12 @@ int main(int argc, char* argv[])
 	err = model.Write(argv[1]);
 	if (err) return err;
 
+	if (compress)
+	{
+		err = CompressFile(argv[1]);
+		if (err) return err;
+	}
+
 	if (model.HasTextures())
 	{
 		char directory[1024] = {};
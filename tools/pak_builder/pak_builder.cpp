@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+#include "pak_writer.h"
+
+using tofu::pak::PakSource;
+
+int ReadWholeFile(const char* path, std::vector<uint8_t>& content)
+{
+	FILE* fp = fopen(path, "rb");
+	if (nullptr == fp)
+	{
+		printf("can't open %s\n", path);
+		return 1;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if (size < 0)
+	{
+		fclose(fp);
+		return 1;
+	}
+
+	content.resize(static_cast<size_t>(size));
+	if (size > 0 && 1 != fread(content.data(), content.size(), 1, fp))
+	{
+		printf("can't read %s\n", path);
+		fclose(fp);
+		return 1;
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+// one path per line
+int ReadListFile(const char* path, std::vector<std::string>& paths)
+{
+	std::vector<uint8_t> content;
+	int err = ReadWholeFile(path, content);
+	if (err) return err;
+
+	std::string line;
+	for (uint8_t c : content)
+	{
+		if (c == '\n' || c == '\r')
+		{
+			if (!line.empty()) paths.push_back(line);
+			line.clear();
+		}
+		else
+		{
+			line.push_back(static_cast<char>(c));
+		}
+	}
+	if (!line.empty()) paths.push_back(line);
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("pak_builder output_file input_file1 [input_file2 ...]\n");
+		printf("  paths are stored as given, @list_file reads paths from a file\n");
+		return 0;
+	}
+
+	std::vector<std::string> paths;
+	for (int i = 2; i < argc; i++)
+	{
+		if (argv[i][0] == '@')
+		{
+			int err = ReadListFile(argv[i] + 1, paths);
+			if (err) return err;
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	std::vector<std::vector<uint8_t>> contents(paths.size());
+	std::vector<PakSource> sources(paths.size());
+
+	uint64_t totalSize = 0;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		int err = ReadWholeFile(paths[i].c_str(), contents[i]);
+		if (err) return err;
+
+		sources[i].path = paths[i].c_str();
+		sources[i].data = contents[i].data();
+		sources[i].size = contents[i].size();
+		totalSize += contents[i].size();
+	}
+
+	int err = tofu::pak::WritePak(argv[1], sources.data(), static_cast<uint32_t>(sources.size()));
+	if (err) return err;
+
+	printf("%zu files, %llu bytes\n", sources.size(), static_cast<unsigned long long>(totalSize));
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "../../PakFormat.h"
+
+namespace tofu
+{
+	namespace pak
+	{
+		struct PakSource
+		{
+			// as the engine asks for it, e.g. "assets/cube.model"
+			const char*			path;
+			const void*			data;
+			uint64_t			size;
+		};
+
+		// write an archive of given sources, returns 0 on success,
+		// fails if two paths have the same hash
+		inline int WritePak(const char* output, const PakSource* sources, uint32_t count)
+		{
+			std::vector<PakEntry> entries(count);
+			std::vector<uint32_t> order(count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				entries[i].PathHash = HashPath(sources[i].path);
+				entries[i].Size = sources[i].size;
+				order[i] = i;
+			}
+
+			std::sort(order.begin(), order.end(),
+				[&entries](uint32_t a, uint32_t b) { return entries[a].PathHash < entries[b].PathHash; });
+
+			for (uint32_t i = 1; i < count; i++)
+			{
+				if (entries[order[i - 1]].PathHash == entries[order[i]].PathHash)
+				{
+					printf("same path hash: %s, %s\n", sources[order[i - 1]].path, sources[order[i]].path);
+					return 1;
+				}
+			}
+
+			// data is written in source order, table in hash order
+			uint64_t offset = sizeof(PakHeader) + sizeof(PakEntry) * count;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				offset = (offset + PAK_ENTRY_ALIGNMENT - 1) & ~static_cast<uint64_t>(PAK_ENTRY_ALIGNMENT - 1);
+				entries[i].Offset = offset;
+				offset += entries[i].Size;
+			}
+
+			FILE* fp = fopen(output, "wb");
+			if (nullptr == fp)
+			{
+				printf("can't open %s\n", output);
+				return 1;
+			}
+
+			PakHeader header = {};
+			header.Magic = PAK_FILE_MAGIC;
+			header.Version = PAK_FILE_VERSION;
+			header.NumEntries = count;
+			header.EntryAlignment = PAK_ENTRY_ALIGNMENT;
+
+			bool ok = 1 == fwrite(&header, sizeof(header), 1, fp);
+
+			for (uint32_t i = 0; ok && i < count; i++)
+			{
+				ok = 1 == fwrite(&entries[order[i]], sizeof(PakEntry), 1, fp);
+			}
+
+			static const uint8_t padding[PAK_ENTRY_ALIGNMENT] = {};
+			uint64_t written = sizeof(PakHeader) + sizeof(PakEntry) * count;
+
+			for (uint32_t i = 0; ok && i < count; i++)
+			{
+				size_t pad = static_cast<size_t>(entries[i].Offset - written);
+				ok = (0 == pad || 1 == fwrite(padding, pad, 1, fp))
+					&& (0 == sources[i].size || 1 == fwrite(sources[i].data, static_cast<size_t>(sources[i].size), 1, fp));
+				written = entries[i].Offset + entries[i].Size;
+			}
+
+			if (0 != fclose(fp) || !ok)
+			{
+				printf("can't write %s\n", output);
+				return 1;
+			}
+
+			return 0;
+		}
+	}
+}